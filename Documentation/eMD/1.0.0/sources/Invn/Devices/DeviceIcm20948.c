@@ -160,6 +160,7 @@ void inv_device_icm20948_init2(inv_device_icm20948_t * self,
 	icm20948_serif.context   = serif->context;
 	icm20948_serif.read_reg  = serif->read_reg;
 	icm20948_serif.write_reg = serif->write_reg;
+	icm20948_serif.submit    = 0;
 	icm20948_serif.max_read  = serif->max_read_transaction_size;
 	icm20948_serif.max_write = serif->max_write_transaction_size;
 	icm20948_serif.is_spi    = !!(serif->serif_type == INV_SERIF_HAL_TYPE_SPI);
@@ -194,6 +195,19 @@ int inv_device_icm20948_poll(void * context)
 	return inv_icm20948_poll_sensor(&self->icm20948_states, self, data_handler);
 }
 
+int inv_device_icm20948_data_ready(inv_device_icm20948_t * self, uint64_t timestamp)
+{
+	return inv_icm20948_raw_mode_data_ready(&self->icm20948_states, timestamp, self, data_handler);
+}
+
+void inv_device_icm20948_set_warm_restart(inv_device_icm20948_t * self, inv_bool_t enable,
+		const uint8_t * snapshot, uint32_t snapshot_size)
+{
+	inv_icm20948_set_warm_restart(&self->icm20948_states, enable);
+	self->warm_snapshot = (enable) ? snapshot : 0;
+	self->warm_snapshot_size = (enable) ? snapshot_size : 0;
+}
+
 int inv_device_icm20948_whoami(void * context, uint8_t * whoami)
 {
 	inv_device_icm20948_t * self = (inv_device_icm20948_t *)context;
@@ -256,6 +270,14 @@ int inv_device_icm20948_setup(void * context)
 
 	/* re-initialise base state structure */
 	inv_icm20948_init_structure(&self->icm20948_states);
+
+	/* DMP was left running: bring back the configuration it was running with */
+	if(inv_icm20948_is_warm_restarted(&self->icm20948_states) && self->warm_snapshot) {
+		INV_MSG(INV_MSG_LEVEL_INFO, "Warm restart, restoring configuration...");
+		if((rc = inv_icm20948_snapshot_restore(&self->icm20948_states, self->warm_snapshot,
+				self->warm_snapshot_size)) != 0)
+			INV_MSG(INV_MSG_LEVEL_WARNING, "Error %d while restoring configuration, using defaults", rc);
+	}
 	
 	/* we should be good to go ! */
 	INV_MSG(INV_MSG_LEVEL_VERBOSE, "We're good to go !");
@@ -332,6 +354,10 @@ int inv_device_icm20948_ping_sensor(void * context, int sensor)
 {
 	inv_device_icm20948_t * self = (inv_device_icm20948_t *)context;
 	
+	/* sensor left out of driver build */
+	if(!inv_icm20948_sensor_is_built(idd_sensortype_2_driver(sensor)))
+		return INV_ERROR_BAD_ARG;
+
 	/* HW sensors */
 	if( (sensor == INV_SENSOR_TYPE_RAW_ACCELEROMETER) ||
 	    (sensor == INV_SENSOR_TYPE_RAW_GYROSCOPE) ||
@@ -444,6 +470,12 @@ int inv_device_icm20948_set_sensor_config(void * context, int sensor, int settin
 			return inv_icm20948_set_lowpower_or_highperformance(&self->icm20948_states, *((uint8_t *)value));
 		case INV_DEVICE_ICM20948_CONFIG_OFFSET :
 			return inv_icm20948_set_bias(&self->icm20948_states, idd_sensortype_2_driver(sensor), value);
+		case INV_DEVICE_ICM20948_CONFIG_RAW_MODE : {
+			const inv_device_icm20948_config_raw_mode_t * raw = (const inv_device_icm20948_config_raw_mode_t *)value;
+			if(raw->sensors == 0)
+				return inv_icm20948_raw_mode_stop(&self->icm20948_states);
+			return inv_icm20948_raw_mode_start(&self->icm20948_states, raw->sensors, raw->div);
+		}
 		/*case INV_DEVICE_ICM20948_CONFIG_WOM_THRESHOLD: //AxL
 			switch(sensor) {
 			case INV_SENSOR_TYPE_WOM:
@@ -469,6 +501,12 @@ int inv_device_icm20948_get_sensor_config(void * context, int sensor, int settin
 			return inv_icm20948_get_lowpower_or_highperformance(&self->icm20948_states, value_out);
 		case INV_DEVICE_ICM20948_CONFIG_OFFSET :
 			return inv_icm20948_get_bias(&self->icm20948_states, idd_sensortype_2_driver(sensor), value_out);
+		case INV_DEVICE_ICM20948_CONFIG_RAW_MODE : {
+			inv_device_icm20948_config_raw_mode_t * raw = (inv_device_icm20948_config_raw_mode_t *)value_out;
+			raw->sensors = inv_icm20948_raw_mode_is_on(&self->icm20948_states) ? self->icm20948_states.raw_mode.sensors : 0;
+			raw->div = self->icm20948_states.raw_mode.div;
+			return 0;
+		}
 		default :
 			return -1;
 	}
@@ -52,6 +52,9 @@ typedef struct inv_device_icm20948
 	//dmp3 Image
 	const uint8_t * dmp3_image;
 	uint32_t dmp3_image_size;
+	//configuration restored on warm restart
+	const uint8_t * warm_snapshot;
+	uint32_t warm_snapshot_size;
 } inv_device_icm20948_t;
 
 /** @brief Allowed config setting value for 20649 device.
@@ -60,9 +63,23 @@ enum  inv_device_icm20948_config {
 	INV_DEVICE_ICM20948_CONFIG_FSR             = INV_SENSOR_CONFIG_FSR,
 	INV_DEVICE_ICM20948_CONFIG_POWER_MODE      = INV_SENSOR_CONFIG_POWER_MODE,
 	INV_DEVICE_ICM20948_CONFIG_OFFSET          = INV_SENSOR_CONFIG_OFFSET,
+	INV_DEVICE_ICM20948_CONFIG_RAW_MODE        = INV_SENSOR_CONFIG_CUSTOM,
 	//INV_DEVICE_ICM20948_CONFIG_WOM_THRESHOLD,
 };
 
+/** @brief Raw mode setting (associated with INV_DEVICE_ICM20948_CONFIG_RAW_MODE config ID)
+ *
+ *  In raw mode, DMP is bypassed and RAW_ACCELEROMETER, RAW_GYROSCOPE (and
+ *  UNCAL_MAGNETOMETER) events are reported from the hardware FIFO on each
+ *  poll, whatever sensors are enabled. See inv_icm20948_raw_mode_start().
+ *  With INV_ICM20948_RAW_MODE_DATA_READY, samples are read on data-ready
+ *  interrupt by inv_device_icm20948_data_ready().
+ */
+typedef struct inv_device_icm20948_config_raw_mode {
+	uint8_t sensors;	/**< INV_ICM20948_RAW_MODE_xxx mask, 0 to go back to DMP mode */
+	int     div;		/**< sample rate divider or INV_ICM20948_RAW_MODE_DIV_BYPASS */
+} inv_device_icm20948_config_raw_mode_t;
+
 /** @brief Return handle to underlying driver states
  *
  *  @param[in] self         handle to device
@@ -106,6 +123,32 @@ static inline inv_device_t * inv_device_icm20948_get_base(inv_device_icm20948_t
 	return 0;
 }
 
+/** @brief Read and report latest sample in raw data-ready mode
+ *
+ *  To be called from data-ready interrupt context (or a task woken by it) with
+ *  the interrupt timestamp. See inv_icm20948_raw_mode_data_ready().
+ *
+ *  @param[in] self         handle to device
+ *  @param[in] timestamp    data-ready interrupt time in us
+ */
+int INV_EXPORT inv_device_icm20948_data_ready(inv_device_icm20948_t * self, uint64_t timestamp);
+
+/** @brief Enable warm restart on next setup
+ *
+ *  To be called between init and setup. If the DMP image is still resident
+ *  (ie: sensor kept power while host was reset), setup skips the upload and,
+ *  if a snapshot is given, re-applies the configuration it holds.
+ *  See inv_icm20948_set_warm_restart() and inv_icm20948_snapshot_restore().
+ *
+ *  @param[in] self          handle to device
+ *  @param[in] enable        true to enable warm restart
+ *  @param[in] snapshot      blob from inv_icm20948_snapshot_save(), kept in memory that
+ *                           survives host reset (may be NULL)
+ *  @param[in] snapshot_size blob size
+ */
+void INV_EXPORT inv_device_icm20948_set_warm_restart(inv_device_icm20948_t * self, inv_bool_t enable,
+		const uint8_t * snapshot, uint32_t snapshot_size);
+
 /*
  * Functions below are described in Device.h
  */
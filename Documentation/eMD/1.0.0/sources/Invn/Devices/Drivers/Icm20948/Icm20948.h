@@ -36,11 +36,18 @@
 
 
 #include "Icm20948Setup.h"
+#include "Icm20948Config.h"
 #include "Icm20948Serif.h"
 #include "Icm20948Transport.h"
 #include "Icm20948DataConverter.h"
 #include "Icm20948AuxCompassAkm.h"
+#include "Icm20948AuxDevice.h"
 #include "Icm20948SelfTest.h"
+#include "Icm20948Capture.h"
+#include "Icm20948Snapshot.h"
+#include "Icm20948RawMode.h"
+#include "Icm20948FifoLog.h"
+#include "Icm20948CompassComp.h"
 
 
 #include <stdint.h>
@@ -115,6 +122,22 @@ typedef struct inv_icm20948 {
 		int compass_chip_addr;
 		int compass_slave_id;
 		inv_icm20948_compass_state_t compass_state;
+		int compass_aux_id;        // compass id in aux device list, -1 if not registered yet
+		/* auxiliary devices */
+		struct inv_icm20948_aux_device aux_dev[INV_ICM20948_AUX_MAX_DEVICES];
+		uint8_t aux_registered;    // mask of registered devices
+		uint8_t aux_enabled;       // mask of enabled devices
+		uint8_t aux_ext_offset[INV_ICM20948_AUX_MAX_DEVICES]; // device data offset in EXT_SLV_SENS_DATA
+		uint8_t aux_nb_slots;      // number of channels allocated to devices
+		struct {
+			uint8_t addr;
+			uint8_t reg;
+			uint8_t ctrl;
+			uint8_t d0;
+		} aux_slot[4];             // last values written to SLV0-3 registers
+		uint8_t aux_slot_valid;    // mask of aux_slot entries matching chip registers
+		uint8_t aux_dly_en;        // last value written to I2C_MST_DELAY_CTRL
+		uint8_t aux_dly;           // last value written to I2C_SLV4_DLY
 	} secondary_state;
 	/* self test */
 	uint8_t selftest_done;
@@ -133,11 +156,17 @@ typedef struct inv_icm20948 {
 	long s_quat_chip_to_body[4];
 	/* base driver */
 	uint8_t sAllowLpEn;
+	uint8_t sLpEnHold;         // nesting count of inv_icm20948_hold_lpen_control() calls
+	uint8_t warm_restart;      // set to 1 to skip DMP image upload if already resident
+	uint8_t warm_restarted;    // set to 1 if DMP image upload was skipped on last initialization
 	uint8_t s_compass_available;
 	uint8_t s_proximity_available;
 	/* base sensor ctrl*/
 	unsigned short inv_dmp_odr_dividers[37];//INV_SENSOR_NUM_MAX /!\ if the size change 
 	unsigned short inv_dmp_odr_delays[37];//INV_SENSOR_NUM_MAX /!\ if the size change
+	unsigned short inv_dmp_odr_rates[37];//INV_SENSOR_NUM_MAX /!\ if the size change, last rate written to DMP, 0xFFFF if unknown
+	uint8_t config_depth; // nesting count of inv_icm20948_ctrl_begin_config() calls
+	uint8_t config_pending; // writes deferred until inv_icm20948_ctrl_commit_config()
 	unsigned short bac_on; // indicates if ANDROID_SENSOR_ACTIVITY_CLASSIFICATON is on
 	unsigned short pickup;
 	unsigned short bac_status;
@@ -146,11 +175,11 @@ typedef struct inv_icm20948 {
 	unsigned short inv_sensor_control;
 	unsigned short inv_sensor_control2;
 	unsigned long inv_androidSensorsOn_mask[2] ;// Each bit corresponds to a sensor being on
-	unsigned short inv_androidSensorsOdr_boundaries[51][2];//GENERAL_SENSORS_MAX /!\ if the size change 
 	unsigned char sGmrvIsOn; // indicates if GMRV was requested to be ON by end-user. Once this variable is set, it is either GRV or GMRV which is enabled internally
 	unsigned short lLastHwSmplrtDividerAcc;
 	unsigned short lLastHwSmplrtDividerGyr;
 	unsigned char sBatchMode;
+	unsigned short sBatchTimeoutMs; // batch timeout requested with inv_icm20948_enable_batch_timeout()
 	uint8_t header2_count;
 	char mems_put_to_sleep;
 	unsigned short smd_status;
@@ -167,15 +196,56 @@ typedef struct inv_icm20948 {
 	signed char mounting_matrix[9];
 	signed char mounting_matrix_secondary_compass[9];
 	long soft_iron_matrix[9];
-	uint8_t skip_sample[INV_ICM20948_SENSOR_MAX+1];
-	uint64_t timestamp[INV_ICM20948_SENSOR_MAX+1];
-	uint8_t sFirstBatch[INV_ICM20948_SENSOR_MAX+1];
-	sensor_type_icm20948_t sensorlist[INV_ICM20948_SENSOR_MAX+1];
+	/* per-sensor states, indexed by inv_icm20948_sensor_slot() */
+	uint8_t skip_sample[INV_ICM20948_SLOT_MAX+1];
+	uint64_t timestamp[INV_ICM20948_SLOT_MAX+1];
+	sensor_type_icm20948_t sensorlist[INV_ICM20948_SLOT_MAX+1];
 	unsigned short saved_count;
 	/* Icm20948Transport*/
 	unsigned char reg;
 	unsigned char lastBank;
 	unsigned char lLastBankSelected;
+	struct inv_icm20948_async_xfer {
+		volatile uint8_t pending; // cleared by completion callback
+		volatile int status;      // status of last request, kept until inv_icm20948_complete_mems_xfers()
+		uint8_t active;           // request submitted and not waited for yet
+		uint8_t lp_restore;       // LP_EN must be enabled back once request is over
+	} async_xfer;
+	/* Icm20948RawMode */
+	struct inv_icm20948_raw_mode {
+		uint8_t on;               // DMP is bypassed, FIFO holds raw records
+		uint8_t sensors;          // INV_ICM20948_RAW_MODE_xxx mask
+		int16_t div;              // divider given to inv_icm20948_raw_mode_start()
+		uint8_t record_size;      // bytes per FIFO record or per data-ready burst
+		uint8_t burst_reg;        // first register of the data-ready burst
+		uint8_t gyro_offset;      // gyro sample offset in a record
+		uint8_t cpass_offset;     // compass read window offset in a record
+		uint8_t cpass_len;        // compass read window size
+		uint8_t cpass_resumed;    // compass was resumed by raw mode and must be suspended back
+		uint8_t cpass_last[INV_ICM20948_AUX_EXT_DATA_SIZE]; // last compass read window reported
+		uint32_t period_us;       // nominal FIFO record period
+		uint64_t last_ts;         // timestamp of last record reported, 0 to start over
+		struct {
+			uint8_t lp_config;
+			uint8_t fifo_cfg;
+			uint8_t fifo_en;
+			uint8_t gyro_config_1;
+			uint8_t accel_config;
+			uint8_t odr_align_en;
+			uint8_t pwr_mgmt_2;
+			uint8_t int_enable_1;
+		} saved;                  // registers restored when going back to DMP mode
+	} raw_mode;
+	/* Icm20948FifoLog */
+	struct inv_icm20948_fifo_log * fifo_log; // FIFO recorder, NULL if not recording
+	/* Icm20948CompassComp */
+	struct inv_icm20948_compass_cal {
+		uint32_t generation;      // incremented when secondary_state.final_matrix or bias[6..8] change
+		uint8_t  bias_valid;      // bias[6..8] holds DMP compass bias
+		int      bias_accuracy;   // compass accuracy when bias was read
+		uint64_t bias_timestamp;  // sample timestamp when bias was read
+		struct inv_icm20948_compass_comp raw_comp; // uncalibrated compensation of FIFO and raw mode samples
+	} compass_cal;
 	/* augmented sensors*/
 	unsigned short sGravityOdrMs;
 	unsigned short sGrvOdrMs;
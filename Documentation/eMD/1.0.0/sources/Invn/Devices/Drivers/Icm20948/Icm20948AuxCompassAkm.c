@@ -93,6 +93,8 @@
 
 #define DATA_AKM8963_SCALE_SHIFT      4
 #define DATA_AKM_MIN_READ_TIME            (9 * NSEC_PER_MSEC)
+/* wait after power down before setting another mode, in us */
+#define DATA_AKM_PD_WAIT                  100
 
 /* AK09912C NSF */
 /* 0:disable, 1:Low, 2:Middle, 3:High */
@@ -196,6 +198,7 @@ int inv_icm20948_setup_compass_akm(struct inv_icm20948 * s)
 	//reset variable to initial values
 	memset(s->secondary_state.final_matrix, 0, sizeof(s->secondary_state.final_matrix));
 	memset(s->secondary_state.compass_sens, 0, sizeof(s->secondary_state.compass_sens));
+	s->compass_cal.generation++;
 	s->secondary_state.scale = 0;
 	s->secondary_state.dmp_on = 1;
 	s->secondary_state.secondary_resume_compass_state = 0;
@@ -309,8 +312,11 @@ int inv_icm20948_setup_compass_akm(struct inv_icm20948 * s)
 int inv_icm20948_check_akm_self_test(struct inv_icm20948 * s)
 {
 	int result;
-	unsigned char data[6], mode, addr;
+	unsigned char data[6], status[1], mode, addr;
+	unsigned char st1, measure;
 	unsigned char counter;
+	struct inv_icm20948_secondary_xfer xfer[3];
+	int nb;
 	short x, y, z;
 	unsigned char *sens;
 	int shift;
@@ -357,76 +363,68 @@ int inv_icm20948_check_akm_self_test(struct inv_icm20948 * s)
 	else
 		mode = REG_AKM_MODE;
 #endif
-	/* set to power down mode */
-	result = inv_icm20948_execute_write_secondary(s, 0, addr, mode, DATA_AKM_MODE_PD);
+	/* set to power down mode, then wait before any other mode is set */
+	xfer[0].addr = addr; xfer[0].reg = mode; xfer[0].len = 0; xfer[0].v = DATA_AKM_MODE_PD;
+	result = inv_icm20948_secondary_execute_xfer(s, xfer, 1);
 	if (result)
 		goto AKM_fail;
-		
-	/* write 1 to ASTC register */
+	inv_icm20948_sleep_us(DATA_AKM_PD_WAIT);
+
+	/* write 1 to ASTC register and set self test mode in one I2C master window */
+	nb = 0;
 	if ((HW_AK09911 != s->secondary_state.compass_slave_id) &&
 		(HW_AK09912 != s->secondary_state.compass_slave_id)) {
-		result = inv_icm20948_execute_write_secondary(s, 0, addr, REG_AKM_ST_CTRL, DATA_AKM_SELF_TEST);
-		if (result)
-			goto AKM_fail;
+		xfer[nb].addr = addr; xfer[nb].reg = REG_AKM_ST_CTRL; xfer[nb].len = 0; xfer[nb].v = DATA_AKM_SELF_TEST; nb++;
 	}
+	xfer[nb].addr = addr; xfer[nb].reg = mode; xfer[nb].len = 0;
 #if (MEMS_CHIP == HW_ICM20948)
-	result = inv_icm20948_execute_write_secondary(s, 0, addr, mode, DATA_AK09916_MODE_ST);
+	xfer[nb].v = DATA_AK09916_MODE_ST;
+	st1 = REG_AK09916_STATUS1;
+	measure = REG_AK09916_MEASURE_DATA;
 #else
-	/* set self test mode */
-	if (HW_AK09911 == s->secondary_state.compass_slave_id)
-		result = inv_icm20948_execute_write_secondary(s, 0, addr, mode, DATA_AK09911_MODE_ST);
-	else if (HW_AK09912 == s->secondary_state.compass_slave_id)
-		result = inv_icm20948_execute_write_secondary(s, 0, addr, mode, DATA_AK09912_MODE_ST);
-	else if (HW_AK09916 == s->secondary_state.compass_slave_id)
-		result = inv_icm20948_execute_write_secondary(s, 0, addr, mode, DATA_AK09916_MODE_ST);
-	else
-		result = inv_icm20948_execute_write_secondary(s, 0, addr, mode,	DATA_AKM_MODE_ST);
+	if (HW_AK09911 == s->secondary_state.compass_slave_id) {
+		xfer[nb].v = DATA_AK09911_MODE_ST;
+		st1 = REG_AK09911_STATUS1;
+		measure = REG_AK09911_MEASURE_DATA;
+	} else if (HW_AK09912 == s->secondary_state.compass_slave_id) {
+		xfer[nb].v = DATA_AK09912_MODE_ST;
+		st1 = REG_AK09912_STATUS1;
+		measure = REG_AK09912_MEASURE_DATA;
+	} else if (HW_AK09916 == s->secondary_state.compass_slave_id) {
+		xfer[nb].v = DATA_AK09916_MODE_ST;
+		st1 = REG_AK09916_STATUS1;
+		measure = REG_AK09916_MEASURE_DATA;
+	} else {
+		xfer[nb].v = DATA_AKM_MODE_ST;
+		st1 = REG_AKM_STATUS;
+		measure = REG_AKM_MEASURE_DATA;
+	}
 #endif
+	nb++;
+	result = inv_icm20948_secondary_execute_xfer(s, xfer, nb);
 	if (result)
 		goto AKM_fail;
+
+	/* status and measure are read in the same window, measure is valid once DRDY is set */
+	xfer[0].addr = addr; xfer[0].reg = st1;     xfer[0].len = 1;                xfer[0].d = status;
+	xfer[1].addr = addr; xfer[1].reg = measure; xfer[1].len = BYTES_PER_SENSOR; xfer[1].d = data;
 	counter = DEF_ST_COMPASS_TRY_TIMES;
 	while (counter > 0) {
 //		usleep_range(DEF_ST_COMPASS_WAIT_MIN, DEF_ST_COMPASS_WAIT_MAX);
         inv_icm20948_sleep_us(15000);
 
-#if (MEMS_CHIP == HW_ICM20948)
-		result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09916_STATUS1, 1, data);
-#else
-		if (HW_AK09911 == s->secondary_state.compass_slave_id)
-			result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09911_STATUS1, 1, data);
-		else if (HW_AK09912 == s->secondary_state.compass_slave_id)
-			result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09912_STATUS1, 1, data);
-		else if (HW_AK09916 == s->secondary_state.compass_slave_id)
-			result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09916_STATUS1, 1, data);
-		else
-			result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AKM_STATUS, 1, data);
-#endif
+		result = inv_icm20948_secondary_execute_xfer(s, xfer, 2);
 		if (result)
 			goto AKM_fail;
-		if ((data[0] & DATA_AKM_DRDY) == 0)
+		if ((status[0] & DATA_AKM_DRDY) == 0)
 			counter--;
 		else
 			counter = 0;
 	}
-	if ((data[0] & DATA_AKM_DRDY) == 0) {
+	if ((status[0] & DATA_AKM_DRDY) == 0) {
 		result = -1;
 		goto AKM_fail;
 	}
-#if (MEMS_CHIP == HW_ICM20948)
-	result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09916_MEASURE_DATA, BYTES_PER_SENSOR, data);
-#else
-	if (HW_AK09911 == s->secondary_state.compass_slave_id) {
-		result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09911_MEASURE_DATA, BYTES_PER_SENSOR, data);
-	} else if (HW_AK09912 == s->secondary_state.compass_slave_id) {
-		result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09912_MEASURE_DATA, BYTES_PER_SENSOR, data);
-	} else if (HW_AK09916 == s->secondary_state.compass_slave_id) {
-		result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AK09916_MEASURE_DATA, BYTES_PER_SENSOR, data);
-	} else {
-		result = inv_icm20948_execute_read_secondary(s, 0, addr, REG_AKM_MEASURE_DATA, BYTES_PER_SENSOR, data);
-	}
-#endif
-	if (result)
-		goto AKM_fail;
 
     x = ((short)data[1])<<8|data[0];
     y = ((short)data[3])<<8|data[2];
@@ -461,14 +459,16 @@ int inv_icm20948_check_akm_self_test(struct inv_icm20948 * s)
 		goto AKM_fail;
 	result = 0;
 AKM_fail:
+	nb = 0;
 	/*write 0 to ASTC register */
 	if ((HW_AK09911 != s->secondary_state.compass_slave_id) &&
 		(HW_AK09912 != s->secondary_state.compass_slave_id) &&
 		(HW_AK09916 != s->secondary_state.compass_slave_id)) {
-		result |= inv_icm20948_execute_write_secondary(s, 0, addr, REG_AKM_ST_CTRL, 0);
+		xfer[nb].addr = addr; xfer[nb].reg = REG_AKM_ST_CTRL; xfer[nb].len = 0; xfer[nb].v = 0; nb++;
 	}
 	/*set to power down mode */
-	result |= inv_icm20948_execute_write_secondary(s, 0, addr, mode, DATA_AKM_MODE_PD);
+	xfer[nb].addr = addr; xfer[nb].reg = mode; xfer[nb].len = 0; xfer[nb].v = DATA_AKM_MODE_PD; nb++;
+	result |= inv_icm20948_secondary_execute_xfer(s, xfer, nb);
 
     return result;
 }
@@ -534,16 +534,14 @@ int inv_icm20948_suspend_akm(struct inv_icm20948 * s)
 	if (!s->secondary_state.secondary_resume_compass_state)
 		return 0;
     
-	/* slave 0 is disabled */
-	result = inv_icm20948_secondary_stop_channel(s, COMPASS_I2C_SLV_READ);
-	/* slave 1 is disabled */
-	result |= inv_icm20948_secondary_stop_channel(s, COMPASS_I2C_SLV_WRITE);
+	/* compass channels are released, I2C Interface is switched off if no other device is enabled */
+	if (s->secondary_state.compass_aux_id >= 0)
+		result = inv_icm20948_aux_enable(s, s->secondary_state.compass_aux_id, 0);
+	else
+		result = inv_icm20948_aux_update(s);
 	if (result)
 		return result;
 	
-	// Switch off I2C Interface as compass is alone
-	result |= inv_icm20948_secondary_disable_i2c(s);
-	
 	s->secondary_state.secondary_resume_compass_state = 0;
     
 	return result;
@@ -554,6 +552,7 @@ int inv_icm20948_resume_akm(struct inv_icm20948 * s)
 	int result;
 	uint8_t reg_addr, bytes;
     unsigned char lDataToWrite;
+	struct inv_icm20948_aux_device compass;
     
 	if (s->secondary_state.secondary_resume_compass_state)
 		return 0;
@@ -604,10 +603,13 @@ int inv_icm20948_resume_akm(struct inv_icm20948 * s)
 		}
 	}
 #endif
-	/* slave 0 is enabled, read 10 or 8 bytes from here depending on compass type, swap bytes to feed DMP */
-	result = inv_icm20948_read_secondary(s, COMPASS_I2C_SLV_READ, s->secondary_state.compass_chip_addr, reg_addr, INV_MPU_BIT_GRP | INV_MPU_BIT_BYTE_SW | bytes);
-	if (result)
-		return result;
+	/* read 10 or 8 bytes from here depending on compass type, swap bytes to feed DMP */
+	compass.addr = (unsigned char)s->secondary_state.compass_chip_addr;
+	compass.read_reg = reg_addr;
+	compass.read_len = bytes;
+	compass.flags = INV_ICM20948_AUX_GRP | INV_ICM20948_AUX_BYTE_SW;
+	compass.odr_div = 1;
+	compass.dmp_offset = s->secondary_state.dmp_on ? 0 : -1;
 #if (MEMS_CHIP == HW_ICM20948)
 	lDataToWrite = DATA_AKM_MODE_SM;
 #else
@@ -631,11 +633,21 @@ int inv_icm20948_resume_akm(struct inv_icm20948 * s)
 		return -1;
 	}
 #endif
-	result = inv_icm20948_write_secondary(s, COMPASS_I2C_SLV_WRITE, s->secondary_state.compass_chip_addr, s->secondary_state.mode_reg_addr, lDataToWrite);
+	compass.trigger_reg = s->secondary_state.mode_reg_addr;
+	compass.trigger_val = lDataToWrite;
+
+	/* descriptor depends on dmp_on, register it again on each resume */
+	if (s->secondary_state.compass_aux_id >= 0)
+		inv_icm20948_aux_unregister(s, s->secondary_state.compass_aux_id);
+	result = inv_icm20948_aux_register(s, &compass);
+	if (result < 0)
+		return result;
+	s->secondary_state.compass_aux_id = result;
+
+	/* compass read takes channel 0 and one-shot acquisition write channel 1, unless other devices are enabled */
+	result = inv_icm20948_aux_enable(s, s->secondary_state.compass_aux_id, 1);
 	if (result)
 		return result;
-	
-	result |= inv_icm20948_secondary_enable_i2c(s);
 
     s->secondary_state.secondary_resume_compass_state = 1;
     
@@ -730,6 +742,9 @@ int inv_icm20948_compass_dmp_cal(struct inv_icm20948 * s, const signed char *m,
                                  current_compass_matrix[j + k * THREE_AXES]);
 		}
 	}
+	/* invalidate compass compensation caches, DMP bias to be read again */
+	s->compass_cal.generation++;
+	s->compass_cal.bias_valid = 0;
     
     for (i = 0; i < THREE_AXES; i++)
 		for (j = 0; j < THREE_AXES; j++)
@@ -0,0 +1,404 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948Defs.h"
+#include "Icm20948DataBaseDriver.h"
+
+#include "Icm20948AuxDevice.h"
+#include "Icm20948AuxTransport.h"
+
+/* a periodic read, possibly shared by several devices at the same address */
+struct inv_aux_window {
+	unsigned char addr;
+	unsigned char reg;
+	unsigned char len;
+	unsigned char flags;
+	unsigned char div;
+	signed char   dmp_offset;	// EXT_SLV_SENS_DATA offset required for the window start, -1 if none
+};
+
+/* content of SLV0-3 registers */
+struct inv_aux_slot {
+	unsigned char addr;
+	unsigned char reg;
+	unsigned char ctrl;
+	unsigned char d0;
+	unsigned char div;
+};
+
+static unsigned char inv_aux_div(const struct inv_icm20948_aux_device * dev)
+{
+	return (dev->odr_div > 1) ? dev->odr_div : 1;
+}
+
+/*
+* inv_aux_merge_window(): extend window w with read window of dev if it is at the same
+* address with the same flags and rate, overlaps or is adjacent and fits in a single channel.
+* Return 1 if merged.
+*/
+static int inv_aux_merge_window(struct inv_aux_window * w, const struct inv_icm20948_aux_device * dev)
+{
+	int lo, hi, w_offset, dev_offset;
+
+	if (w->addr != dev->addr || w->flags != dev->flags || w->div != inv_aux_div(dev))
+		return 0;
+	if (dev->read_reg > w->reg + w->len || w->reg > dev->read_reg + dev->read_len)
+		return 0;
+
+	lo = (w->reg < dev->read_reg) ? w->reg : dev->read_reg;
+	hi = (w->reg + w->len > dev->read_reg + dev->read_len) ? w->reg + w->len : dev->read_reg + dev->read_len;
+	if (hi - lo > INV_ICM20948_SECONDARY_MAX_READ)
+		return 0;
+
+	/* offset the DMP expects the merged window at */
+	w_offset = w->dmp_offset - (w->reg - lo);
+	dev_offset = dev->dmp_offset - (dev->read_reg - lo);
+	if (w->dmp_offset >= 0 && w_offset < 0)
+		return 0;
+	if (dev->dmp_offset >= 0 && dev_offset < 0)
+		return 0;
+	if (w->dmp_offset >= 0 && dev->dmp_offset >= 0 && w_offset != dev_offset)
+		return 0;
+
+	if (w->dmp_offset < 0)
+		w->dmp_offset = (dev->dmp_offset >= 0) ? (signed char)dev_offset : -1;
+	else
+		w->dmp_offset = (signed char)w_offset;
+	w->reg = (unsigned char)lo;
+	w->len = (unsigned char)(hi - lo);
+
+	return 1;
+}
+
+/*
+* inv_aux_schedule(): allocate SLV0-3 to enabled devices.
+* Read windows are merged, ordered so that data fed to the DMP land where it expects them,
+* then trigger writes take the remaining channels.
+*/
+static int inv_aux_schedule(struct inv_icm20948 * s, unsigned char enabled,
+		struct inv_aux_slot slot[INV_ICM20948_AUX_MAX_SLOTS], int * nb_slots,
+		unsigned char ext_offset[INV_ICM20948_AUX_MAX_DEVICES], unsigned char * dly)
+{
+	struct inv_aux_window win[INV_ICM20948_AUX_MAX_DEVICES];
+	unsigned char dev_win[INV_ICM20948_AUX_MAX_DEVICES];
+	unsigned char win_offset[INV_ICM20948_AUX_MAX_DEVICES];
+	int nb_win = 0, nb = 0, ext = 0;
+	int i, j;
+
+	*dly = 0;
+
+	/* collect read windows */
+	for (i = 0; i < INV_ICM20948_AUX_MAX_DEVICES; i++) {
+		const struct inv_icm20948_aux_device * dev = &s->secondary_state.aux_dev[i];
+
+		if (!(enabled & (1 << i)) || !dev->read_len)
+			continue;
+		if (dev->read_len > INV_ICM20948_SECONDARY_MAX_READ)
+			return INV_ERROR_SIZE;
+		for (j = 0; j < nb_win; j++) {
+			if (inv_aux_merge_window(&win[j], dev))
+				break;
+		}
+		if (j == nb_win) {
+			win[j].addr = dev->addr;
+			win[j].reg = dev->read_reg;
+			win[j].len = dev->read_len;
+			win[j].flags = dev->flags;
+			win[j].div = inv_aux_div(dev);
+			win[j].dmp_offset = dev->dmp_offset;
+			nb_win++;
+		}
+		dev_win[i] = (unsigned char)j;
+	}
+
+	/* windows fed to the DMP first, by increasing offset, then the others in registration order */
+	for (i = 0; i < nb_win; i++) {
+		int min = -1;
+
+		for (j = 0; j < nb_win; j++) {
+			if (win[j].len && win[j].dmp_offset >= 0 && (min < 0 || win[j].dmp_offset < win[min].dmp_offset))
+				min = j;
+		}
+		if (min < 0) {
+			for (j = 0; j < nb_win; j++) {
+				if (win[j].len) {
+					min = j;
+					break;
+				}
+			}
+		}
+		if (win[min].dmp_offset >= 0 && win[min].dmp_offset != ext)
+			return INV_ERROR_BAD_ARG;
+		if (nb == INV_ICM20948_AUX_MAX_SLOTS || ext + win[min].len > INV_ICM20948_AUX_EXT_DATA_SIZE)
+			return INV_ERROR_SIZE;
+
+		slot[nb].addr = INV_MPU_BIT_I2C_READ | win[min].addr;
+		slot[nb].reg = win[min].reg;
+		slot[nb].ctrl = INV_MPU_BIT_SLV_EN | win[min].flags | win[min].len;
+		slot[nb].d0 = 0;
+		slot[nb].div = win[min].div;
+		win_offset[min] = (unsigned char)ext;
+		ext += win[min].len;
+		win[min].len = 0;
+		nb++;
+	}
+
+	for (i = 0; i < INV_ICM20948_AUX_MAX_DEVICES; i++) {
+		const struct inv_icm20948_aux_device * dev = &s->secondary_state.aux_dev[i];
+
+		if ((enabled & (1 << i)) && dev->read_len)
+			ext_offset[i] = win_offset[dev_win[i]] + (dev->read_reg - win[dev_win[i]].reg);
+		else
+			ext_offset[i] = 0;
+	}
+
+	/* trigger writes, identical ones are done once */
+	for (i = 0; i < INV_ICM20948_AUX_MAX_DEVICES; i++) {
+		const struct inv_icm20948_aux_device * dev = &s->secondary_state.aux_dev[i];
+
+		if (!(enabled & (1 << i)) || !dev->trigger_reg)
+			continue;
+		for (j = 0; j < nb; j++) {
+			if (slot[j].addr == dev->addr && slot[j].reg == dev->trigger_reg &&
+					slot[j].d0 == dev->trigger_val && slot[j].div == inv_aux_div(dev))
+				break;
+		}
+		if (j < nb)
+			continue;
+		if (nb == INV_ICM20948_AUX_MAX_SLOTS)
+			return INV_ERROR_SIZE;
+		slot[nb].addr = dev->addr;
+		slot[nb].reg = dev->trigger_reg;
+		slot[nb].ctrl = INV_MPU_BIT_SLV_EN | 1;
+		slot[nb].d0 = dev->trigger_val;
+		slot[nb].div = inv_aux_div(dev);
+		nb++;
+	}
+
+	/* all delayed channels share I2C_SLV4_DLY */
+	for (i = 0; i < nb; i++) {
+		if (slot[i].div == 1)
+			continue;
+		if (slot[i].div - 1 > BIT_I2C_SLV4_DLY_MASK || (*dly && *dly != slot[i].div - 1))
+			return INV_ERROR_BAD_ARG;
+		*dly = slot[i].div - 1;
+	}
+
+	for (i = nb; i < INV_ICM20948_AUX_MAX_SLOTS; i++) {
+		slot[i].addr = 0;
+		slot[i].reg = 0;
+		slot[i].ctrl = 0;
+		slot[i].d0 = 0;
+		slot[i].div = 1;
+	}
+	*nb_slots = nb;
+
+	return 0;
+}
+
+/*
+* inv_aux_write_slot(): write registers of channel index that differ from last written values.
+*/
+static int inv_aux_write_slot(struct inv_icm20948 * s, int index, const struct inv_aux_slot * slot)
+{
+	int result = 0;
+	int valid = s->secondary_state.aux_slot_valid & (1 << index);
+	int is_read = slot->addr & INV_MPU_BIT_I2C_READ;
+
+	if (!slot->ctrl) {
+		if (valid && !s->secondary_state.aux_slot[index].ctrl)
+			return 0;
+		result = inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].ctrl, 0);
+		if (result)
+			s->secondary_state.aux_slot_valid &= ~(1 << index);
+		else
+			s->secondary_state.aux_slot[index].ctrl = 0;
+		return result;
+	}
+
+	if (valid && s->secondary_state.aux_slot[index].ctrl == slot->ctrl &&
+			s->secondary_state.aux_slot[index].addr == slot->addr &&
+			s->secondary_state.aux_slot[index].reg == slot->reg &&
+			(is_read || s->secondary_state.aux_slot[index].d0 == slot->d0))
+		return 0;
+
+	/* do not let the I2C master run a half updated channel */
+	if (!valid || (s->secondary_state.aux_slot[index].ctrl & INV_MPU_BIT_SLV_EN))
+		result |= inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].ctrl, 0);
+	if (!valid || s->secondary_state.aux_slot[index].addr != slot->addr)
+		result |= inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].addr, slot->addr);
+	if (!valid || s->secondary_state.aux_slot[index].reg != slot->reg)
+		result |= inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].reg, slot->reg);
+	/* d0 last written is only known if the channel was last used for a write */
+	if (!is_read && (!valid || (s->secondary_state.aux_slot[index].addr & INV_MPU_BIT_I2C_READ) ||
+			s->secondary_state.aux_slot[index].d0 != slot->d0))
+		result |= inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].d0, slot->d0);
+	result |= inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].ctrl, slot->ctrl);
+
+	if (result) {
+		s->secondary_state.aux_slot_valid &= ~(1 << index);
+		return result;
+	}
+
+	s->secondary_state.aux_slot[index].addr = slot->addr;
+	s->secondary_state.aux_slot[index].reg = slot->reg;
+	if (!is_read)
+		s->secondary_state.aux_slot[index].d0 = slot->d0;
+	s->secondary_state.aux_slot[index].ctrl = slot->ctrl;
+	s->secondary_state.aux_slot_valid |= (1 << index);
+
+	return 0;
+}
+
+static int inv_aux_apply(struct inv_icm20948 * s, unsigned char enabled)
+{
+	struct inv_aux_slot slot[INV_ICM20948_AUX_MAX_SLOTS];
+	unsigned char ext_offset[INV_ICM20948_AUX_MAX_DEVICES];
+	unsigned char dly, dly_en = 0;
+	int nb_slots, rc, i;
+	int result = 0;
+
+	rc = inv_aux_schedule(s, enabled, slot, &nb_slots, ext_offset, &dly);
+	if (rc)
+		return rc;
+
+	for (i = 0; i < INV_ICM20948_AUX_MAX_SLOTS; i++) {
+		result |= inv_aux_write_slot(s, i, &slot[i]);
+		if (slot[i].div > 1)
+			dly_en |= (BIT_SLV0_DLY_EN << i);
+	}
+
+	if (dly != s->secondary_state.aux_dly) {
+		result |= inv_icm20948_write_single_mems_reg(s, REG_I2C_SLV4_CTRL, dly);
+		s->secondary_state.aux_dly = dly;
+	}
+	if (dly_en != s->secondary_state.aux_dly_en) {
+		result |= inv_icm20948_write_single_mems_reg(s, REG_I2C_MST_DELAY_CTRL, dly_en);
+		s->secondary_state.aux_dly_en = dly_en;
+	}
+
+	if (enabled)
+		result |= inv_icm20948_secondary_enable_i2c(s);
+	else
+		result |= inv_icm20948_secondary_disable_i2c(s);
+
+	s->secondary_state.aux_enabled = enabled;
+	s->secondary_state.aux_nb_slots = (uint8_t)nb_slots;
+	memcpy(s->secondary_state.aux_ext_offset, ext_offset, sizeof(ext_offset));
+
+	return result;
+}
+
+static int inv_aux_check_id(struct inv_icm20948 * s, int id)
+{
+	if (id < 0 || id >= INV_ICM20948_AUX_MAX_DEVICES || !(s->secondary_state.aux_registered & (1 << id)))
+		return INV_ERROR_BAD_ARG;
+
+	return 0;
+}
+
+int inv_icm20948_aux_register(struct inv_icm20948 * s, const struct inv_icm20948_aux_device * dev)
+{
+	int id;
+
+	if (dev->read_len > INV_ICM20948_SECONDARY_MAX_READ || (dev->flags & ~(INV_ICM20948_AUX_BYTE_SW | INV_ICM20948_AUX_GRP)))
+		return INV_ERROR_BAD_ARG;
+
+	for (id = 0; id < INV_ICM20948_AUX_MAX_DEVICES; id++) {
+		if (!(s->secondary_state.aux_registered & (1 << id))) {
+			s->secondary_state.aux_dev[id] = *dev;
+			s->secondary_state.aux_registered |= (1 << id);
+			return id;
+		}
+	}
+
+	return INV_ERROR_MEM;
+}
+
+int inv_icm20948_aux_unregister(struct inv_icm20948 * s, int id)
+{
+	int rc;
+
+	if ((rc = inv_aux_check_id(s, id)) != 0)
+		return rc;
+
+	if (s->secondary_state.aux_enabled & (1 << id)) {
+		if ((rc = inv_icm20948_aux_enable(s, id, 0)) != 0)
+			return rc;
+	}
+
+	s->secondary_state.aux_registered &= ~(1 << id);
+
+	return 0;
+}
+
+int inv_icm20948_aux_enable(struct inv_icm20948 * s, int id, int enable)
+{
+	unsigned char enabled = s->secondary_state.aux_enabled;
+	int rc;
+
+	if ((rc = inv_aux_check_id(s, id)) != 0)
+		return rc;
+
+	if (enable)
+		enabled |= (1 << id);
+	else
+		enabled &= ~(1 << id);
+
+	return inv_aux_apply(s, enabled);
+}
+
+int inv_icm20948_aux_set_trigger(struct inv_icm20948 * s, int id, unsigned char val)
+{
+	unsigned char prev;
+	int rc;
+
+	if ((rc = inv_aux_check_id(s, id)) != 0)
+		return rc;
+
+	prev = s->secondary_state.aux_dev[id].trigger_val;
+	s->secondary_state.aux_dev[id].trigger_val = val;
+
+	if (!(s->secondary_state.aux_enabled & (1 << id)))
+		return 0;
+
+	rc = inv_aux_apply(s, s->secondary_state.aux_enabled);
+	if (rc)
+		s->secondary_state.aux_dev[id].trigger_val = prev;
+
+	return rc;
+}
+
+int inv_icm20948_aux_get_data(struct inv_icm20948 * s, int id, unsigned char * data)
+{
+	int rc;
+
+	if ((rc = inv_aux_check_id(s, id)) != 0)
+		return rc;
+
+	if (!(s->secondary_state.aux_enabled & (1 << id)) || !s->secondary_state.aux_dev[id].read_len)
+		return INV_ERROR_BAD_ARG;
+
+	return inv_icm20948_read_mems_reg(s, REG_EXT_SLV_SENS_DATA_00 + s->secondary_state.aux_ext_offset[id],
+			s->secondary_state.aux_dev[id].read_len, data);
+}
+
+int inv_icm20948_aux_update(struct inv_icm20948 * s)
+{
+	return inv_aux_apply(s, s->secondary_state.aux_enabled);
+}
+
+int inv_icm20948_aux_get_slots(struct inv_icm20948 * s)
+{
+	return s->secondary_state.aux_nb_slots;
+}
@@ -0,0 +1,118 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+/** @defgroup	inv_icm20948_aux_device	inv_aux_device
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#ifndef INV_ICM20948_AUX_DEVICE_H__
+#define INV_ICM20948_AUX_DEVICE_H__
+
+#include "Invn/InvExport.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Maximum number of devices that can be registered on the secondary I2C bus */
+#define INV_ICM20948_AUX_MAX_DEVICES	4
+
+/** @brief Number of I2C master channels shared by auxiliary devices (SLV0 to SLV3) */
+#define INV_ICM20948_AUX_MAX_SLOTS		4
+
+/** @brief Size of EXT_SLV_SENS_DATA area receiving periodic reads */
+#define INV_ICM20948_AUX_EXT_DATA_SIZE	24
+
+/** @brief Flags for inv_icm20948_aux_device.flags */
+#define INV_ICM20948_AUX_BYTE_SW		0x40	/**< swap bytes of each word read (INV_MPU_BIT_BYTE_SW) */
+#define INV_ICM20948_AUX_GRP			0x10	/**< words start at odd register (INV_MPU_BIT_GRP) */
+
+/** @brief Descriptor of a device on the secondary I2C bus
+*
+* Each I2C master cycle, the device read window is copied into EXT_SLV_SENS_DATA
+* and, if trigger_reg is set, trigger_val is written to start next measurement.
+*/
+struct inv_icm20948_aux_device {
+	unsigned char addr;			/**< 7-bit i2c address */
+	unsigned char read_reg;		/**< first register of the periodic read window */
+	unsigned char read_len;		/**< size of the read window in bytes (up to 15, 0 for none) */
+	unsigned char flags;		/**< INV_ICM20948_AUX_xxx flags applied to the read window */
+	unsigned char trigger_reg;	/**< register written each cycle (0 for none) */
+	unsigned char trigger_val;	/**< value written to trigger_reg */
+	unsigned char odr_div;		/**< device is accessed once every odr_div I2C master cycles (0 or 1 for all) */
+	signed char   dmp_offset;	/**< offset in EXT_SLV_SENS_DATA the DMP expects data at, -1 if not fed to DMP */
+};
+
+/** @brief Register a device on the secondary I2C bus
+* Device is registered disabled.
+* @param[in] dev  	device descriptor (copied)
+* @return 	   		device id (>= 0) in case of success, INV_ERROR_MEM if no room is left
+*/
+int INV_EXPORT inv_icm20948_aux_register(struct inv_icm20948 * s, const struct inv_icm20948_aux_device * dev);
+
+/** @brief Unregister a device from the secondary I2C bus
+* @param[in] id  	device id returned by inv_icm20948_aux_register()
+* @return 	   		0 in case of success, negative value on error
+*/
+int INV_EXPORT inv_icm20948_aux_unregister(struct inv_icm20948 * s, int id);
+
+/** @brief Enable or disable periodic access to a device
+* SLV0-3 are re-allocated across all enabled devices: read windows of a same device
+* (or of devices sharing an address) that overlap or are adjacent are merged into a
+* single channel, devices fed to the DMP are placed at their dmp_offset and trigger
+* writes use the remaining channels. Only channel registers that changed are written.
+* I2C master is enabled as long as at least one device is enabled.
+* @param[in] id  	device id returned by inv_icm20948_aux_register()
+* @param[in] enable	1 to enable, 0 to disable
+* @return 	   		0 in case of success, INV_ERROR_SIZE if enabled devices need more than 4 channels
+*                   or 24 bytes of EXT_SLV_SENS_DATA, INV_ERROR_BAD_ARG if a dmp_offset cannot be met
+*                   or enabled devices require different odr_div. On error, previous configuration is kept.
+*/
+int INV_EXPORT inv_icm20948_aux_enable(struct inv_icm20948 * s, int id, int enable);
+
+/** @brief Update the value written to trigger_reg of a device
+* @param[in] id  	device id returned by inv_icm20948_aux_register()
+* @param[in] val	new value
+* @return 	   		0 in case of success, negative value on error
+*/
+int INV_EXPORT inv_icm20948_aux_set_trigger(struct inv_icm20948 * s, int id, unsigned char val);
+
+/** @brief Read last data of an enabled device from EXT_SLV_SENS_DATA
+* @param[in]  id  	device id returned by inv_icm20948_aux_register()
+* @param[out] data	read_len bytes
+* @return 	   		0 in case of success, negative value on error
+*/
+int INV_EXPORT inv_icm20948_aux_get_data(struct inv_icm20948 * s, int id, unsigned char * data);
+
+/** @brief Apply again current allocation of SLV0-3
+* To be called after channels were used directly (inv_icm20948_secondary_execute_xfer() and
+* alike) while devices are enabled. Stops channels no enabled device needs and enables or
+* disables I2C master accordingly.
+* @return 	   		0 in case of success, negative value on error
+*/
+int INV_EXPORT inv_icm20948_aux_update(struct inv_icm20948 * s);
+
+/** @brief Return the number of I2C master channels currently allocated
+*/
+int INV_EXPORT inv_icm20948_aux_get_slots(struct inv_icm20948 * s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_AUX_DEVICE_H__
+
+/** @} */
@@ -37,6 +37,14 @@ void inv_icm20948_init_secondary(struct inv_icm20948 * s)
 	s->secondary_state.slv_reg[3].reg  = REG_I2C_SLV3_REG;
 	s->secondary_state.slv_reg[3].ctrl = REG_I2C_SLV3_CTRL;
 	s->secondary_state.slv_reg[3].d0   = REG_I2C_SLV3_DO;
+
+	s->secondary_state.compass_aux_id = -1;
+	s->secondary_state.aux_registered = 0;
+	s->secondary_state.aux_enabled = 0;
+	s->secondary_state.aux_nb_slots = 0;
+	s->secondary_state.aux_slot_valid = 0;
+	s->secondary_state.aux_dly_en = 0;
+	s->secondary_state.aux_dly = 0;
 	
 	/* Make sure that by default all channels are disabled 
 	To not inherit from a previous configuration from a previous run*/
@@ -48,6 +56,65 @@ void inv_icm20948_init_secondary(struct inv_icm20948 * s)
 
 /* the following functions are used for configuring the secondary devices */
 
+/*
+* inv_secondary_arm_done(): program SLV4 to read, once, one byte of register
+* SECONDARY_DONE_REG (WIA on AKM devices) of the slave at addr.
+* SLV4 is serviced after SLV0-3 within an I2C master cycle and is the only channel
+* reporting completion (SLV4_DONE in I2C_MST_STATUS), so it marks the end of the
+* transfers queued on the other channels. The byte read lands in SLV4_DI and is
+* not used: the read has no side effect on the slave nor on EXT_SLV_SENS_DATA.
+*/
+static int inv_secondary_arm_done(struct inv_icm20948 * s, unsigned char addr)
+{
+	int result = 0;
+	unsigned char status;
+
+	// clear stale SLV4_DONE
+	result |= inv_icm20948_read_mems_reg(s, REG_I2C_MST_STATUS, 1, &status);
+
+	result |= inv_icm20948_write_single_mems_reg(s, REG_I2C_SLV4_ADDR, INV_MPU_BIT_I2C_READ | addr);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_I2C_SLV4_REG, SECONDARY_DONE_REG);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_I2C_SLV4_CTRL, INV_MPU_BIT_SLV_EN | s->secondary_state.aux_dly);
+
+	return result;
+}
+
+/*
+* inv_secondary_check_done(): return 1 while SLV4 transfer is pending, 0 once done,
+* a negative value if a slave did not acknowledge.
+*/
+static int inv_secondary_check_done(struct inv_icm20948 * s)
+{
+	unsigned char status;
+
+	if (inv_icm20948_read_mems_reg(s, REG_I2C_MST_STATUS, 1, &status))
+		return INV_ERROR_TRANSPORT;
+
+	if (status & (BIT_I2C_LOST_ARB | BIT_I2C_SLV4_NACK | BIT_I2C_SLV3_NACK |
+			BIT_I2C_SLV2_NACK | BIT_I2C_SLV1_NACK | BIT_I2C_SLV0_NACK))
+		return INV_ERROR_TRANSPORT;
+
+	return (status & BIT_I2C_SLV4_DONE) ? 0 : 1;
+}
+
+/*
+* inv_secondary_wait_done(): poll until queued transfers are done,
+* SECONDARY_INIT_WAIT ms at most.
+*/
+static int inv_secondary_wait_done(struct inv_icm20948 * s)
+{
+	uint64_t deadline = inv_icm20948_get_time_us() + SECONDARY_INIT_WAIT*1000;
+	int rc;
+
+	while ((rc = inv_secondary_check_done(s)) == 1) {
+		if (inv_icm20948_get_time_us() >= deadline)
+			return INV_ERROR_TIMEOUT;
+		inv_icm20948_sleep_us(SECONDARY_POLL_WAIT);
+	}
+
+	return rc;
+}
+
 /*
 * inv_configure_secondary_read(): set secondary registers for reading.
 The chip must be set as bank 3 before calling.
@@ -65,6 +132,9 @@ int inv_icm20948_read_secondary(struct inv_icm20948 * s, int index, unsigned cha
 	int result = 0;
     unsigned char data;
 
+	// channel no longer matches aux device allocation
+	s->secondary_state.aux_slot_valid &= ~(1 << index);
+
     data = INV_MPU_BIT_I2C_READ | addr;
 	result |= inv_icm20948_write_mems_reg(s, s->secondary_state.slv_reg[index].addr, 1, &data);
 
@@ -82,10 +152,12 @@ int inv_icm20948_execute_read_secondary(struct inv_icm20948 * s, int index, unsi
 	int result = 0;
 
 	result |= inv_icm20948_read_secondary(s, index, addr, reg, len);
+
+	result |= inv_secondary_arm_done(s, addr);
 	
 	result |= inv_icm20948_secondary_enable_i2c(s);
     
-	inv_icm20948_sleep_us(SECONDARY_INIT_WAIT*1000);
+	result |= inv_secondary_wait_done(s);
     
 	result |= inv_icm20948_secondary_disable_i2c(s);
 
@@ -113,6 +185,9 @@ int inv_icm20948_write_secondary(struct inv_icm20948 * s, int index, unsigned ch
 	int result = 0;
     unsigned char data;
     
+	// channel no longer matches aux device allocation
+	s->secondary_state.aux_slot_valid &= ~(1 << index);
+
     data = (unsigned char)addr;
 	result |= inv_icm20948_write_mems_reg(s, s->secondary_state.slv_reg[index].addr, 1, &data);
 
@@ -133,10 +208,12 @@ int inv_icm20948_execute_write_secondary(struct inv_icm20948 * s, int index, uns
 	int result = 0;
 
 	result |= inv_icm20948_write_secondary(s, index, addr, reg, v);
+
+	result |= inv_secondary_arm_done(s, addr);
 	
 	result |= inv_icm20948_secondary_enable_i2c(s);
     
-	inv_icm20948_sleep_us(SECONDARY_INIT_WAIT*1000);
+	result |= inv_secondary_wait_done(s);
     
 	result |= inv_icm20948_secondary_disable_i2c(s);
 
@@ -145,6 +222,89 @@ int inv_icm20948_execute_write_secondary(struct inv_icm20948 * s, int index, uns
 	return result;
 }
 
+int inv_icm20948_secondary_start_xfer(struct inv_icm20948 * s, const struct inv_icm20948_secondary_xfer * xfer, int nb)
+{
+	int result = 0;
+	int i;
+
+	if (nb <= 0 || nb > INV_ICM20948_SECONDARY_MAX_XFER)
+		return INV_ERROR_BAD_ARG;
+
+	for (i = 0; i < nb; i++) {
+		if (xfer[i].len) {
+			if (xfer[i].len > INV_ICM20948_SECONDARY_MAX_READ)
+				return INV_ERROR_SIZE;
+			result |= inv_icm20948_read_secondary(s, i, xfer[i].addr, xfer[i].reg, xfer[i].len);
+		} else {
+			result |= inv_icm20948_write_secondary(s, i, xfer[i].addr, xfer[i].reg, xfer[i].v);
+		}
+	}
+
+	i = nb - 1;
+	result |= inv_secondary_arm_done(s, xfer[i].addr);
+
+	result |= inv_icm20948_secondary_enable_i2c(s);
+
+	return result;
+}
+
+int inv_icm20948_secondary_poll_xfer(struct inv_icm20948 * s, struct inv_icm20948_secondary_xfer * xfer, int nb)
+{
+	unsigned char data[INV_ICM20948_SECONDARY_MAX_XFER * INV_ICM20948_SECONDARY_MAX_READ];
+	int rc, result = 0;
+	int i, len = 0;
+
+	rc = inv_secondary_check_done(s);
+	if (rc == 1)
+		return 1;
+
+	result |= inv_icm20948_secondary_disable_i2c(s);
+
+	// reads are stored one after the other in EXT_SLV_SENS_DATA, following channel order
+	if (rc == 0) {
+		for (i = 0; i < nb; i++)
+			len += xfer[i].len;
+		if (len)
+			result |= inv_icm20948_read_mems_reg(s, REG_EXT_SLV_SENS_DATA_00, len, data);
+		len = 0;
+		for (i = 0; i < nb; i++) {
+			if (xfer[i].len) {
+				memcpy(xfer[i].d, &data[len], xfer[i].len);
+				len += xfer[i].len;
+			}
+		}
+	}
+
+	for (i = 0; i < nb; i++)
+		result |= inv_icm20948_secondary_stop_channel(s, i);
+
+	return rc ? rc : result;
+}
+
+int inv_icm20948_secondary_execute_xfer(struct inv_icm20948 * s, struct inv_icm20948_secondary_xfer * xfer, int nb)
+{
+	uint64_t deadline;
+	int rc;
+
+	rc = inv_icm20948_secondary_start_xfer(s, xfer, nb);
+	if (rc)
+		return rc;
+
+	deadline = inv_icm20948_get_time_us() + SECONDARY_INIT_WAIT*1000;
+	while ((rc = inv_icm20948_secondary_poll_xfer(s, xfer, nb)) == 1) {
+		if (inv_icm20948_get_time_us() >= deadline) {
+			int i;
+			inv_icm20948_secondary_disable_i2c(s);
+			for (i = 0; i < nb; i++)
+				inv_icm20948_secondary_stop_channel(s, i);
+			return INV_ERROR_TIMEOUT;
+		}
+		inv_icm20948_sleep_us(SECONDARY_POLL_WAIT);
+	}
+
+	return rc;
+}
+
 void inv_icm20948_secondary_saveI2cOdr(struct inv_icm20948 * s)
 {
 	inv_icm20948_read_mems_reg(s, REG_I2C_MST_ODR_CONFIG,1,&s->secondary_state.sSavedI2cOdr);
@@ -157,6 +317,7 @@ void inv_icm20948_secondary_restoreI2cOdr(struct inv_icm20948 * s)
 
 int inv_icm20948_secondary_stop_channel(struct inv_icm20948 * s, int index)
 {
+	s->secondary_state.aux_slot_valid &= ~(1 << index);
 	return inv_icm20948_write_single_mems_reg(s, s->secondary_state.slv_reg[index].ctrl, 0);
 }
 
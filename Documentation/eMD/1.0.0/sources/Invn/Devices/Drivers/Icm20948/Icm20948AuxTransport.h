@@ -26,11 +26,28 @@ struct inv_icm20948;
 /** @brief I2C from secondary device can stand on up to 4 channels. To perform automatic read and feed DMP :
 - channel 0 is reserved for compass reading data
 - channel 1 is reserved for compass writing one-shot acquisition register
-- channel 2 is reserved for als reading data */
+- channel 2 is reserved for als reading data
+When devices are registered with inv_icm20948_aux_register(), channels are allocated by
+inv_icm20948_aux_enable() instead (compass still gets channels 0 and 1 when alone). */
 #define COMPASS_I2C_SLV_READ		0
 #define COMPASS_I2C_SLV_WRITE		1
 #define ALS_I2C_SLV					2
 
+/** @brief Maximum number of transfers queued in a single I2C master enable window (SLV0 to SLV3) */
+#define INV_ICM20948_SECONDARY_MAX_XFER		4
+
+/** @brief Maximum number of bytes read by a single transfer */
+#define INV_ICM20948_SECONDARY_MAX_READ		15
+
+/** @brief One transfer on the secondary I2C bus */
+struct inv_icm20948_secondary_xfer {
+	unsigned char   addr;	/**< i2c address of the secondary slave */
+	unsigned char   reg;	/**< register to be accessed on the secondary slave */
+	unsigned char   len;	/**< number of bytes to read, 0 for a single byte write */
+	unsigned char   v;		/**< data to be written (write only) */
+	unsigned char * d;		/**< where to store read data (read only) */
+};
+
 /** @brief Initializes the register for the i2c communication*/
 void INV_EXPORT inv_icm20948_init_secondary(struct inv_icm20948 * s);
 
@@ -71,6 +88,33 @@ int INV_EXPORT inv_icm20948_write_secondary(struct inv_icm20948 * s, int index,
 */
 int INV_EXPORT inv_icm20948_execute_write_secondary(struct inv_icm20948 * s, int index, unsigned char addr, int reg, uint8_t v);
 
+/** @brief Queue transfers on the secondary I2C bus and start them
+* Transfers are assigned to SLV0 to SLV(nb-1) and run in that order within one I2C
+* master enable window. SLV4 then does a one-byte read of SECONDARY_DONE_REG on the
+* slave of the last transfer to signal completion: it is serviced after SLV0-3 and
+* sets SLV4_DONE in I2C_MST_STATUS, which is polled instead of waiting a fixed time.
+* @param[in] xfer  	transfers to perform
+* @param[in] nb 	number of transfers, up to INV_ICM20948_SECONDARY_MAX_XFER
+* @return 	   		0 in case of success, negative value on error
+* @warning Channels used by the DMP to read the compass are overwritten: to be used
+*          at setup or self-test time only, or followed by inv_icm20948_aux_update().
+*/
+int INV_EXPORT inv_icm20948_secondary_start_xfer(struct inv_icm20948 * s, const struct inv_icm20948_secondary_xfer * xfer, int nb);
+
+/** @brief Check completion of transfers started with inv_icm20948_secondary_start_xfer()
+* Does not wait. Once done, I2C master is disabled, read data are copied and channels are stopped.
+* @param[in] xfer  	transfers given to inv_icm20948_secondary_start_xfer()
+* @param[in] nb 	number of transfers
+* @return 	   		1 while transfers are pending, 0 once done, INV_ERROR_TRANSPORT if a slave did not acknowledge
+*/
+int INV_EXPORT inv_icm20948_secondary_poll_xfer(struct inv_icm20948 * s, struct inv_icm20948_secondary_xfer * xfer, int nb);
+
+/** @brief Perform transfers on the secondary I2C bus and wait for their completion
+* Waits SECONDARY_INIT_WAIT ms at most.
+* @return 	   		0 in case of success, INV_ERROR_TIMEOUT or INV_ERROR_TRANSPORT on error
+*/
+int INV_EXPORT inv_icm20948_secondary_execute_xfer(struct inv_icm20948 * s, struct inv_icm20948_secondary_xfer * xfer, int nb);
+
 /** @brief Save current secondary I2C ODR configured
 */
 void INV_EXPORT inv_icm20948_secondary_saveI2cOdr(struct inv_icm20948 * s);
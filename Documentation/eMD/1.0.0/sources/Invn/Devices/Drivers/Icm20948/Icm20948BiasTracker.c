@@ -0,0 +1,136 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948BiasTracker.h"
+
+#include "Icm20948MPUFifoControl.h"
+
+#include <string.h>
+
+/* accuracy reported by the DMP once a bias is fully calibrated */
+#define BIAS_TRACKER_ACCURACY_MAX   3
+
+static const struct {
+	uint8_t                  mask;
+	enum inv_icm20948_sensor sensor;
+	int                      threshold;
+	int                   (* get_accuracy)(void);
+} bias_tracker_sensors[INV_ICM20948_BIAS_TRACKER_NB_SENSORS] = {
+	{ INV_ICM20948_BIAS_TRACKER_ACCEL, INV_ICM20948_SENSOR_ACCELEROMETER,
+		INV_ICM20948_BIAS_TRACKER_ACCEL_THRESHOLD, inv_icm20948_get_accel_accuracy },
+	{ INV_ICM20948_BIAS_TRACKER_GYRO, INV_ICM20948_SENSOR_GYROSCOPE,
+		INV_ICM20948_BIAS_TRACKER_GYRO_THRESHOLD, inv_icm20948_get_gyro_accuracy },
+	{ INV_ICM20948_BIAS_TRACKER_MAG, INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD,
+		INV_ICM20948_BIAS_TRACKER_MAG_THRESHOLD, inv_icm20948_get_mag_accuracy },
+};
+
+static int inv_bias_tracker_index(uint8_t sensor)
+{
+	int i;
+
+	for (i = 0; i < INV_ICM20948_BIAS_TRACKER_NB_SENSORS; i++) {
+		if (bias_tracker_sensors[i].mask == sensor)
+			return i;
+	}
+	return -1;
+}
+
+/* return 1 if any axis of a differs from b by more than threshold */
+static int inv_bias_tracker_moved(const int a[3], const int b[3], int threshold)
+{
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		const int diff = a[i] - b[i];
+		if (diff > threshold || diff < -threshold)
+			return 1;
+	}
+	return 0;
+}
+
+void inv_icm20948_bias_tracker_init(struct inv_icm20948_bias_tracker * tracker,
+		uint8_t sensors, inv_icm20948_bias_tracker_store_t store, void * cookie)
+{
+	memset(tracker, 0, sizeof(*tracker));
+	tracker->sensors = sensors;
+	tracker->store = store;
+	tracker->cookie = cookie;
+}
+
+int inv_icm20948_bias_tracker_poll(struct inv_icm20948 * s,
+		struct inv_icm20948_bias_tracker * tracker)
+{
+	int i, rc, accuracy;
+	int bias[3];
+	int nb_stored = 0;
+
+	for (i = 0; i < INV_ICM20948_BIAS_TRACKER_NB_SENSORS; i++) {
+		if (!(tracker->sensors & bias_tracker_sensors[i].mask))
+			continue;
+
+		/* accuracy comes from DMP output already parsed by the driver, no bus access */
+		accuracy = bias_tracker_sensors[i].get_accuracy();
+		if (accuracy < BIAS_TRACKER_ACCURACY_MAX) {
+			tracker->state[i].stable = 0;
+			continue;
+		}
+
+		rc = inv_icm20948_get_bias(s, bias_tracker_sensors[i].sensor, bias);
+		if (rc < 0)
+			return rc;
+
+		if (tracker->state[i].stable == 0 ||
+				inv_bias_tracker_moved(bias, tracker->state[i].bias, bias_tracker_sensors[i].threshold)) {
+			memcpy(tracker->state[i].bias, bias, sizeof(bias));
+			tracker->state[i].stable = 1;
+			continue;
+		}
+		if (tracker->state[i].stable < INV_ICM20948_BIAS_TRACKER_STABLE_POLLS)
+			tracker->state[i].stable++;
+		if (tracker->state[i].stable < INV_ICM20948_BIAS_TRACKER_STABLE_POLLS)
+			continue;
+
+		if (tracker->state[i].has_stored &&
+				!inv_bias_tracker_moved(bias, tracker->state[i].stored, bias_tracker_sensors[i].threshold))
+			continue;
+
+		rc = tracker->store ? tracker->store(tracker->cookie, bias_tracker_sensors[i].mask, bias, accuracy) : 0;
+		if (rc == 0) {
+			memcpy(tracker->state[i].stored, bias, sizeof(bias));
+			tracker->state[i].has_stored = 1;
+			nb_stored++;
+		}
+	}
+
+	return nb_stored;
+}
+
+int inv_icm20948_bias_tracker_restore(struct inv_icm20948 * s,
+		struct inv_icm20948_bias_tracker * tracker, uint8_t sensor, const int bias[3])
+{
+	const int i = inv_bias_tracker_index(sensor);
+	int rc;
+
+	if (i < 0)
+		return INV_ERROR_BAD_ARG;
+
+	rc = inv_icm20948_set_bias(s, bias_tracker_sensors[i].sensor, bias);
+	if (rc < 0)
+		return rc;
+
+	memcpy(tracker->state[i].stored, bias, sizeof(tracker->state[i].stored));
+	tracker->state[i].has_stored = 1;
+	tracker->state[i].stable = 0;
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_BIAS_TRACKER_H__
+#define INV_ICM20948_BIAS_TRACKER_H__
+
+/** @defgroup	icm20948_bias_tracker	bias_tracker
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Sensors which bias can be tracked
+ */
+#define INV_ICM20948_BIAS_TRACKER_ACCEL       0x01
+#define INV_ICM20948_BIAS_TRACKER_GYRO        0x02
+#define INV_ICM20948_BIAS_TRACKER_MAG         0x04
+
+/** @brief Number of sensors which bias can be tracked
+ */
+#define INV_ICM20948_BIAS_TRACKER_NB_SENSORS  3
+
+/** @brief Minimum bias change in q16 for a new value to be stored (accel in g, gyro in dps, mag in uT)
+ *  Also the maximum change between two polls for the bias to be considered stable.
+ */
+#ifndef INV_ICM20948_BIAS_TRACKER_ACCEL_THRESHOLD
+#define INV_ICM20948_BIAS_TRACKER_ACCEL_THRESHOLD  66     /* ~1 mg */
+#endif
+#ifndef INV_ICM20948_BIAS_TRACKER_GYRO_THRESHOLD
+#define INV_ICM20948_BIAS_TRACKER_GYRO_THRESHOLD   3277   /* ~0.05 dps */
+#endif
+#ifndef INV_ICM20948_BIAS_TRACKER_MAG_THRESHOLD
+#define INV_ICM20948_BIAS_TRACKER_MAG_THRESHOLD    32768  /* 0.5 uT */
+#endif
+
+/** @brief Number of consecutive polls at full accuracy with a stable bias before it is stored
+ */
+#ifndef INV_ICM20948_BIAS_TRACKER_STABLE_POLLS
+#define INV_ICM20948_BIAS_TRACKER_STABLE_POLLS     3
+#endif
+
+/** @brief Prototype for the function storing a converged bias
+ *  @param[in]  cookie    value passed to inv_icm20948_bias_tracker_init()
+ *  @param[in]  sensor    one of INV_ICM20948_BIAS_TRACKER_xxx
+ *  @param[in]  bias      bias in q16 (accel in g, gyro in dps, mag in uT)
+ *  @param[in]  accuracy  accuracy reported by the DMP when the bias converged
+ *  @return     0 if the bias was stored, negative value on error (store is retried on next poll)
+ */
+typedef int (*inv_icm20948_bias_tracker_store_t)(void * cookie, uint8_t sensor,
+		const int bias[3], int accuracy);
+
+/** @brief Background bias tracking states
+ *  Fields are private to the driver.
+ */
+struct inv_icm20948_bias_tracker {
+	uint8_t                           sensors;  /**< INV_ICM20948_BIAS_TRACKER_xxx mask */
+	inv_icm20948_bias_tracker_store_t store;
+	void *                            cookie;
+	struct {
+		int     bias[3];                        /**< last sampled bias, q16 */
+		int     stored[3];                      /**< last stored or restored bias, q16 */
+		uint8_t stable;                         /**< consecutive polls with a stable bias */
+		uint8_t has_stored;                     /**< stored[] is valid */
+	} state[INV_ICM20948_BIAS_TRACKER_NB_SENSORS];
+};
+
+/** @brief Initialize bias tracking states
+ *  @param[out] tracker  tracker states
+ *  @param[in]  sensors  INV_ICM20948_BIAS_TRACKER_xxx mask of sensors to track
+ *  @param[in]  store    function called when a converged bias differs from the stored one
+ *  @param[in]  cookie   value passed to store
+ */
+void INV_EXPORT inv_icm20948_bias_tracker_init(struct inv_icm20948_bias_tracker * tracker,
+		uint8_t sensors, inv_icm20948_bias_tracker_store_t store, void * cookie);
+
+/** @brief Sample DMP biases and accuracies, store converged biases
+ *  Meant to be called periodically at a low rate (eg: once per second) from
+ *  the same context as the driver, while sensors are running.
+ *  A bias is considered converged once the DMP reports accuracy 3 and the
+ *  bias stayed within threshold for INV_ICM20948_BIAS_TRACKER_STABLE_POLLS
+ *  polls. It is then stored if it moved by more than threshold from the
+ *  last stored or restored value.
+ *  @param[in]  s        driver states
+ *  @param[in]  tracker  tracker states
+ *  @return     number of biases stored, negative value on error
+ */
+int INV_EXPORT inv_icm20948_bias_tracker_poll(struct inv_icm20948 * s,
+		struct inv_icm20948_bias_tracker * tracker);
+
+/** @brief Apply a previously stored bias to the DMP
+ *  To be called at boot, after the DMP image was loaded. The restored value
+ *  becomes the reference for the next store.
+ *  @param[in]  s        driver states
+ *  @param[in]  tracker  tracker states
+ *  @param[in]  sensor   one of INV_ICM20948_BIAS_TRACKER_xxx
+ *  @param[in]  bias     bias in q16 as passed to the store function
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_bias_tracker_restore(struct inv_icm20948 * s,
+		struct inv_icm20948_bias_tracker * tracker, uint8_t sensor, const int bias[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_BIAS_TRACKER_H__
+
+/** @} */
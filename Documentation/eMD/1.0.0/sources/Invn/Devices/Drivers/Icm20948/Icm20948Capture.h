@@ -0,0 +1,128 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_CAPTURE_H__
+#define INV_ICM20948_CAPTURE_H__
+
+/** @defgroup	icm20948_capture	capture
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Sensors that can be captured through the FIFO
+ */
+#define INV_ICM20948_CAPTURE_ACCEL        0x01
+#define INV_ICM20948_CAPTURE_GYRO         0x02
+
+/** @brief Maximum number of axes in a captured record (accel + gyro)
+ */
+#define INV_ICM20948_CAPTURE_MAX_AXES     6
+
+/** @brief Maximum number of records per capture (keeps variance computation within 64 bits)
+ */
+#define INV_ICM20948_CAPTURE_MAX_SAMPLES  65535
+
+/** @brief Delay in ms between two FIFO reads done by inv_icm20948_capture_run()
+ *  A full hardware FIFO (HARDWARE_FIFO_SIZE bytes) is reported as an overflow. It holds
+ *  HARDWARE_FIFO_SIZE / 12 = 85 complete accel+gyro records, HARDWARE_FIFO_SIZE / 6 = 170
+ *  accel or gyro only records, so this must be lower than 85 (resp. 170) sample periods.
+ */
+#ifndef INV_ICM20948_CAPTURE_POLL_TIME
+#define INV_ICM20948_CAPTURE_POLL_TIME    100
+#endif
+
+/** @brief Number of consecutive polls without data after which inv_icm20948_capture_run() gives up
+ */
+#ifndef INV_ICM20948_CAPTURE_MAX_IDLE_POLLS
+#define INV_ICM20948_CAPTURE_MAX_IDLE_POLLS 10
+#endif
+
+/** @brief Raw accel/gyro capture states
+ *  Records are made of accel x,y,z (if captured) followed by gyro x,y,z
+ *  (if captured), in raw LSB, as ordered by the hardware FIFO.
+ *  Fields are private to the driver.
+ */
+struct inv_icm20948_capture {
+	uint8_t   sensors;                              /**< INV_ICM20948_CAPTURE_xxx mask */
+	uint8_t   nb_axes;                              /**< number of int16 per record */
+	int       nb_samples;                           /**< records captured so far */
+	int       max_samples;                          /**< records to capture */
+	int16_t * samples;                              /**< optional record buffer (may be NULL) */
+	int64_t   sum[INV_ICM20948_CAPTURE_MAX_AXES];    /**< sum per axis */
+	int64_t   sum_sq[INV_ICM20948_CAPTURE_MAX_AXES]; /**< sum of squares per axis */
+};
+
+/** @brief Route raw accel and/or gyro data to the FIFO and clear it
+ *  Sensors must already be powered and configured (ODR, FSR, filter) and the
+ *  DMP must not be writing to the FIFO (eg: during self-test or factory calibration).
+ *  @param[in]  s            driver states
+ *  @param[out] cap          capture states
+ *  @param[in]  sensors      INV_ICM20948_CAPTURE_ACCEL and/or INV_ICM20948_CAPTURE_GYRO
+ *  @param[out] samples      buffer receiving nb_samples records (may be NULL if only statistics are needed)
+ *  @param[in]  nb_samples   number of records to capture (up to INV_ICM20948_CAPTURE_MAX_SAMPLES)
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_capture_start(struct inv_icm20948 * s, struct inv_icm20948_capture * cap,
+		uint8_t sensors, int16_t * samples, int nb_samples);
+
+/** @brief Read all complete records available in the FIFO
+ *  Never waits. Data are read in bursts of INV_MAX_SERIAL_READ bytes.
+ *  @param[in]  s    driver states
+ *  @param[in]  cap  capture states
+ *  @return     1 if more records are expected, 0 once nb_samples records were captured,
+ *              INV_ERROR_SIZE if the FIFO overflowed (records were lost),
+ *              INV_ERROR_TRANSPORT on bus error
+ */
+int INV_EXPORT inv_icm20948_capture_poll(struct inv_icm20948 * s, struct inv_icm20948_capture * cap);
+
+/** @brief Stop routing raw data to the FIFO
+ *  @param[in]  s    driver states
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_capture_stop(struct inv_icm20948 * s);
+
+/** @brief Blocking capture
+ *  Calls inv_icm20948_capture_start(), then inv_icm20948_capture_poll() every
+ *  INV_ICM20948_CAPTURE_POLL_TIME ms until done, then inv_icm20948_capture_stop().
+ *  @return     0 on success, INV_ERROR_TIMEOUT if sensors stopped producing data,
+ *              negative value on other errors
+ */
+int INV_EXPORT inv_icm20948_capture_run(struct inv_icm20948 * s, struct inv_icm20948_capture * cap,
+		uint8_t sensors, int16_t * samples, int nb_samples);
+
+/** @brief Return mean and variance of records captured so far
+ *  @param[in]  cap       capture states
+ *  @param[out] mean      mean per axis in LSB (truncated toward 0), one entry per record axis
+ *  @param[out] variance  population variance per axis in LSB^2 (may be NULL)
+ *  @return     number of records used
+ */
+int INV_EXPORT inv_icm20948_capture_get_stats(const struct inv_icm20948_capture * cap,
+		int32_t * mean, uint32_t * variance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_CAPTURE_H__
+
+/** @} */
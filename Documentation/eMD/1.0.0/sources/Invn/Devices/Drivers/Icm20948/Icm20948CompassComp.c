@@ -0,0 +1,216 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948CompassComp.h"
+
+#include "Icm20948DataBaseControl.h"
+
+#include <string.h>
+
+/*
+ * Minimal vector layer on doubles, selected as in Icm20948Fusion. A q30 matrix element times a
+ * 16-bit sample and the sum of three such products fit in the 53-bit mantissa, so results are
+ * exact and match the 64-bit integer computation. Scalar targets (Cortex-M) use the latter.
+ */
+#if defined(__AVX__)
+#include <immintrin.h>
+#define COMP_VEC_LANES 4
+typedef __m256d dvec;
+static inline dvec v_ld(const double * p)         { return _mm256_loadu_pd(p); }
+static inline dvec v_set(double x)                { return _mm256_set1_pd(x); }
+static inline dvec v_add(dvec a, dvec b)          { return _mm256_add_pd(a, b); }
+static inline dvec v_sub(dvec a, dvec b)          { return _mm256_sub_pd(a, b); }
+static inline dvec v_mul(dvec a, dvec b)          { return _mm256_mul_pd(a, b); }
+static inline dvec v_floor(dvec a)                { return _mm256_floor_pd(a); }
+static inline void v_st_i32(int32_t * p, dvec a)  { _mm_storeu_si128((__m128i *)p, _mm256_cvttpd_epi32(a)); }
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COMP_VEC_LANES 2
+typedef __m128d dvec;
+static inline dvec v_ld(const double * p)         { return _mm_loadu_pd(p); }
+static inline dvec v_set(double x)                { return _mm_set1_pd(x); }
+static inline dvec v_add(dvec a, dvec b)          { return _mm_add_pd(a, b); }
+static inline dvec v_sub(dvec a, dvec b)          { return _mm_sub_pd(a, b); }
+static inline dvec v_mul(dvec a, dvec b)          { return _mm_mul_pd(a, b); }
+/* no floor before SSE4.1: truncate, then remove 1 where that rounded up (negative values) */
+static inline dvec v_floor(dvec a)                { const dvec t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(a));
+	return _mm_sub_pd(t, _mm_and_pd(_mm_cmpgt_pd(t, a), _mm_set1_pd(1.0))); }
+static inline void v_st_i32(int32_t * p, dvec a)  { _mm_storel_epi64((__m128i *)p, _mm_cvttpd_epi32(a)); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define COMP_VEC_LANES 2
+typedef float64x2_t dvec;
+static inline dvec v_ld(const double * p)         { return vld1q_f64(p); }
+static inline dvec v_set(double x)                { return vdupq_n_f64(x); }
+static inline dvec v_add(dvec a, dvec b)          { return vaddq_f64(a, b); }
+static inline dvec v_sub(dvec a, dvec b)          { return vsubq_f64(a, b); }
+static inline dvec v_mul(dvec a, dvec b)          { return vmulq_f64(a, b); }
+static inline dvec v_floor(dvec a)                { return vrndmq_f64(a); }
+static inline void v_st_i32(int32_t * p, dvec a)  { vst1_s32(p, vmovn_s64(vcvtq_s64_f64(a))); }
+#else
+#define COMP_VEC_LANES 1
+#endif
+
+/* samples compensated at once, staged as structure of arrays */
+#define COMP_BLOCK  32
+
+/* DMP compass unit (Q16) to uT, as done by inv_icm20948_poll_sensor() */
+#define COMP_TO_UT  (1/(float)(1UL<<16))
+
+void inv_icm20948_compass_comp_init(struct inv_icm20948_compass_comp * c,
+		const long matrix[9], const long offset[3])
+{
+	memcpy(c->matrix, matrix, sizeof(c->matrix));
+	if(offset)
+		memcpy(c->offset, offset, sizeof(c->offset));
+	else
+		memset(c->offset, 0, sizeof(c->offset));
+	c->generation = 0;
+	c->with_bias = (offset != 0);
+}
+
+int inv_icm20948_compass_comp_sync(struct inv_icm20948 * s,
+		struct inv_icm20948_compass_comp * c, int with_bias)
+{
+	int i;
+
+	with_bias = !!with_bias;
+	if(c->generation == s->compass_cal.generation && c->with_bias == with_bias)
+		return 0;
+
+	memcpy(c->matrix, s->secondary_state.final_matrix, sizeof(c->matrix));
+	for(i = 0; i < 3; i++)
+		c->offset[i] = with_bias ? s->bias[6 + i] : 0;
+	c->generation = s->compass_cal.generation;
+	c->with_bias = with_bias;
+
+	return 1;
+}
+
+/*
+ * Same as inv_icm20948_apply_raw_compass_matrix(): (m * (raw << 16)) >> 30 is (m * raw) >> 14,
+ * that is floor((m * raw) / 2^14).
+ */
+static void compass_comp_block(const struct inv_icm20948_compass_comp * c, const short * raw, unsigned n,
+		int32_t q[3][COMP_BLOCK])
+{
+#if (COMP_VEC_LANES > 1)
+	double r[3][COMP_BLOCK];
+	dvec m[9], o[3];
+	unsigned i, k;
+
+	for(i = 0; i < 9; i++)
+		m[i] = v_set(c->matrix[i] * (1 / 16384.0));
+	for(i = 0; i < 3; i++)
+		o[i] = v_set((double)c->offset[i]);
+
+	for(k = 0; k < n; k++, raw += 3) {
+		r[0][k] = raw[0];
+		r[1][k] = raw[1];
+		r[2][k] = raw[2];
+	}
+	/* pad last group of lanes, its results are not used */
+	for(; k % COMP_VEC_LANES; k++)
+		r[0][k] = r[1][k] = r[2][k] = 0;
+
+	for(k = 0; k < n; k += COMP_VEC_LANES) {
+		const dvec r0 = v_ld(&r[0][k]), r1 = v_ld(&r[1][k]), r2 = v_ld(&r[2][k]);
+
+		for(i = 0; i < 3; i++) {
+			const dvec a = v_add(v_add(v_mul(m[3*i], r0), v_mul(m[3*i+1], r1)), v_mul(m[3*i+2], r2));
+			v_st_i32(&q[i][k], v_sub(v_floor(a), o[i]));
+		}
+	}
+#else
+	long long m[9];
+	unsigned i, k;
+
+	for(i = 0; i < 9; i++)
+		m[i] = c->matrix[i];
+
+	for(k = 0; k < n; k++, raw += 3) {
+		const long long r0 = raw[0], r1 = raw[1], r2 = raw[2];
+
+		for(i = 0; i < 3; i++)
+			q[i][k] = (int32_t)(((m[3*i] * r0 + m[3*i+1] * r1 + m[3*i+2] * r2) >> 14) - c->offset[i]);
+	}
+#endif
+}
+
+void inv_icm20948_compass_comp_apply(const struct inv_icm20948_compass_comp * c,
+		const short * raw, long * out, unsigned n)
+{
+	int32_t q[3][COMP_BLOCK];
+
+	while(n) {
+		const unsigned nb = (n < COMP_BLOCK) ? n : COMP_BLOCK;
+		unsigned k;
+
+		compass_comp_block(c, raw, nb, q);
+		for(k = 0; k < nb; k++, out += 3) {
+			out[0] = q[0][k];
+			out[1] = q[1][k];
+			out[2] = q[2][k];
+		}
+		raw += 3 * nb;
+		n -= nb;
+	}
+}
+
+void inv_icm20948_compass_comp_apply_f(const struct inv_icm20948_compass_comp * c,
+		const short * raw, float * out, unsigned n)
+{
+	int32_t q[3][COMP_BLOCK];
+
+	while(n) {
+		const unsigned nb = (n < COMP_BLOCK) ? n : COMP_BLOCK;
+		unsigned k;
+
+		compass_comp_block(c, raw, nb, q);
+		for(k = 0; k < nb; k++, out += 3) {
+			out[0] = q[0][k] * COMP_TO_UT;
+			out[1] = q[1][k] * COMP_TO_UT;
+			out[2] = q[2][k] * COMP_TO_UT;
+		}
+		raw += 3 * nb;
+		n -= nb;
+	}
+}
+
+int inv_icm20948_compass_comp_get_bias(struct inv_icm20948 * s, int accuracy, uint64_t timestamp,
+		int bias[3])
+{
+	struct inv_icm20948_compass_cal * cal = &s->compass_cal;
+	int rc = 0;
+
+	if(!cal->bias_valid || accuracy != cal->bias_accuracy
+			|| timestamp - cal->bias_timestamp >= INV_ICM20948_COMPASS_BIAS_REFRESH_US) {
+		int dmp_bias[3];
+
+		rc = inv_icm20948_ctrl_get_mag_bias(s, dmp_bias);
+		if(rc == 0) {
+			if(!cal->bias_valid || memcmp(&s->bias[6], dmp_bias, sizeof(dmp_bias))) {
+				memcpy(&s->bias[6], dmp_bias, sizeof(dmp_bias));
+				cal->generation++;
+			}
+			cal->bias_valid = 1;
+			cal->bias_accuracy = accuracy;
+			cal->bias_timestamp = timestamp;
+		}
+	}
+	memcpy(bias, &s->bias[6], 3 * sizeof(int));
+
+	return rc;
+}
+
+/** @} */
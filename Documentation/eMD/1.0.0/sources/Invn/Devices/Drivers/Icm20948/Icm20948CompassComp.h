@@ -0,0 +1,110 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_COMPASS_COMP_H__
+#define INV_ICM20948_COMPASS_COMP_H__
+
+/** @defgroup	icm20948_compass_comp	compass_comp
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Maximum age in us of the compass bias cached by inv_icm20948_compass_comp_get_bias()
+ *  The DMP keeps refining its bias without reporting it, the cache is read again after this time
+ *  (and whenever reported compass accuracy changes).
+ */
+#ifndef INV_ICM20948_COMPASS_BIAS_REFRESH_US
+#define INV_ICM20948_COMPASS_BIAS_REFRESH_US  1000000
+#endif
+
+/** @brief Compensation of raw compass samples, cached from driver calibration
+ *  out = matrix x raw - offset, in q16 uT, exactly as inv_icm20948_apply_raw_compass_matrix()
+ *  then minus offset.
+ */
+struct inv_icm20948_compass_comp {
+	long     matrix[9];    /**< soft iron x compass mounting x sensitivity, q30 (secondary_state.final_matrix) */
+	long     offset[3];    /**< hard iron offset subtracted from output, q16 uT (DMP compass bias or 0) */
+	uint32_t generation;   /**< driver calibration generation the cache was built from */
+	uint8_t  with_bias;    /**< offset is the DMP compass bias */
+};
+
+/** @brief Setup compensation from explicit values
+ *  For host side processing of logged raw samples, eg with a matrix saved from the driver.
+ *  @param[out] c       compensation
+ *  @param[in]  matrix  q30 matrix, as secondary_state.final_matrix
+ *  @param[in]  offset  q16 offset, NULL for none (uncalibrated output)
+ */
+void INV_EXPORT inv_icm20948_compass_comp_init(struct inv_icm20948_compass_comp * c,
+		const long matrix[9], const long offset[3]);
+
+/** @brief Update compensation from driver calibration if it changed since last call
+ *  Calibration changes when compass is setup (inv_icm20948_compass_dmp_cal()) and when
+ *  the compass bias known by the driver changes. Start from a zeroed structure.
+ *  @param[in]  s          driver states
+ *  @param[out] c          compensation
+ *  @param[in]  with_bias  1 to subtract last known DMP compass bias (calibrated output), 0 for uncalibrated output
+ *  @return     1 if compensation was updated, 0 if it was up to date
+ */
+int INV_EXPORT inv_icm20948_compass_comp_sync(struct inv_icm20948 * s,
+		struct inv_icm20948_compass_comp * c, int with_bias);
+
+/** @brief Compensate n raw compass samples
+ *  Output is bit exact with inv_icm20948_apply_raw_compass_matrix() minus offset, whatever the
+ *  instruction set used, as long as it fits on 32 bits (always the case for compass ranges).
+ *  @param[in]  c    compensation
+ *  @param[in]  raw  n x 3 raw samples, as read from the compass (x y z)
+ *  @param[out] out  n x 3 compensated samples in q16 uT
+ *  @param[in]  n    number of samples
+ */
+void INV_EXPORT inv_icm20948_compass_comp_apply(const struct inv_icm20948_compass_comp * c,
+		const short * raw, long * out, unsigned n);
+
+/** @brief Compensate n raw compass samples to float uT
+ *  Same as inv_icm20948_compass_comp_apply() then conversion as done by inv_icm20948_poll_sensor().
+ *  @param[in]  c    compensation
+ *  @param[in]  raw  n x 3 raw samples
+ *  @param[out] out  n x 3 compensated samples in uT
+ *  @param[in]  n    number of samples
+ */
+void INV_EXPORT inv_icm20948_compass_comp_apply_f(const struct inv_icm20948_compass_comp * c,
+		const short * raw, float * out, unsigned n);
+
+/** @brief Return DMP compass bias, read from DMP memory only when the cached one may be outdated
+ *  Cache is refreshed when it was never read, when accuracy differs from the one it was read
+ *  with or after INV_ICM20948_COMPASS_BIAS_REFRESH_US. inv_icm20948_ctrl_set_mag_bias() updates it.
+ *  @param[in]  s          driver states
+ *  @param[in]  accuracy   compass accuracy reported with current sample
+ *  @param[in]  timestamp  current sample timestamp in us
+ *  @param[out] bias       compass bias in q16 uT
+ *  @return     0 on success, error if DMP memory could not be read (last cached bias is returned)
+ */
+int INV_EXPORT inv_icm20948_compass_comp_get_bias(struct inv_icm20948 * s, int accuracy, uint64_t timestamp,
+		int bias[3]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_COMPASS_COMP_H__
+
+/** @} */
@@ -0,0 +1,157 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_CONFIG_H__
+#define INV_ICM20948_CONFIG_H__
+
+/** @defgroup	icm20948_config	config
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include "Icm20948Setup.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @brief Compile-time sensor subset
+ *  Each INV_ICM20948_CFG_<sensor> macro is 0 or 1 and tells if the sensor is built in the driver.
+ *  They default to INV_ICM20948_CFG_ALL_SENSORS, so a build can start from an empty set
+ *  (-DINV_ICM20948_CFG_ALL_SENSORS=0) and add the sensors it needs, or remove some from the full set.
+ *  A sensor left out is refused by inv_icm20948_enable_sensor(), holds no per-sensor states and
+ *  its FIFO processing and DMP feature setup are not compiled.
+ *  DMP image, FIFO packet parsing and compass setup are unchanged whatever the subset.
+ */
+#ifndef INV_ICM20948_CFG_ALL_SENSORS
+#define INV_ICM20948_CFG_ALL_SENSORS                   1
+#endif
+
+#ifndef INV_ICM20948_CFG_ACCELEROMETER
+#define INV_ICM20948_CFG_ACCELEROMETER                 INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_GYROSCOPE
+#define INV_ICM20948_CFG_GYROSCOPE                     INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_RAW_ACCELEROMETER
+#define INV_ICM20948_CFG_RAW_ACCELEROMETER             INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_RAW_GYROSCOPE
+#define INV_ICM20948_CFG_RAW_GYROSCOPE                 INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_MAGNETIC_FIELD_UNCALIBRATED
+#define INV_ICM20948_CFG_MAGNETIC_FIELD_UNCALIBRATED   INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
+#define INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED        INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON
+#define INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON        INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_STEP_DETECTOR
+#define INV_ICM20948_CFG_STEP_DETECTOR                 INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_STEP_COUNTER
+#define INV_ICM20948_CFG_STEP_COUNTER                  INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_GAME_ROTATION_VECTOR
+#define INV_ICM20948_CFG_GAME_ROTATION_VECTOR          INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_ROTATION_VECTOR
+#define INV_ICM20948_CFG_ROTATION_VECTOR               INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_GEOMAGNETIC_ROTATION_VECTOR
+#define INV_ICM20948_CFG_GEOMAGNETIC_ROTATION_VECTOR   INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_GEOMAGNETIC_FIELD
+#define INV_ICM20948_CFG_GEOMAGNETIC_FIELD             INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_WAKEUP_SIGNIFICANT_MOTION
+#define INV_ICM20948_CFG_WAKEUP_SIGNIFICANT_MOTION     INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_FLIP_PICKUP
+#define INV_ICM20948_CFG_FLIP_PICKUP                   INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR
+#define INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR          INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_GRAVITY
+#define INV_ICM20948_CFG_GRAVITY                       INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_LINEAR_ACCELERATION
+#define INV_ICM20948_CFG_LINEAR_ACCELERATION           INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_ORIENTATION
+#define INV_ICM20948_CFG_ORIENTATION                   INV_ICM20948_CFG_ALL_SENSORS
+#endif
+#ifndef INV_ICM20948_CFG_B2S
+#define INV_ICM20948_CFG_B2S                           INV_ICM20948_CFG_ALL_SENSORS
+#endif
+
+/** @brief DMP pedometer, runs step sensors and significant motion */
+#define INV_ICM20948_CFG_PEDOMETER  (INV_ICM20948_CFG_STEP_DETECTOR || INV_ICM20948_CFG_STEP_COUNTER \
+                                     || INV_ICM20948_CFG_WAKEUP_SIGNIFICANT_MOTION)
+
+/** @brief DMP activity classifier engine, runs at BAC rate when any of its sensors is on */
+#define INV_ICM20948_CFG_BAC_ENGINE (INV_ICM20948_CFG_PEDOMETER || INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON \
+                                     || INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR || INV_ICM20948_CFG_B2S)
+
+/** @brief Index of built sensors in per-sensor states
+ *  Sensors left out take no index. With all sensors built, slot and sensor ids are the same.
+ *  INV_ICM20948_SLOT_MAX is the extra entry written for ids without a slot, it is never read back.
+ */
+enum inv_icm20948_sensor_slot {
+	INV_ICM20948_SLOT_ACCELEROMETER               = 0,
+	INV_ICM20948_SLOT_GYROSCOPE                   = INV_ICM20948_SLOT_ACCELEROMETER + INV_ICM20948_CFG_ACCELEROMETER,
+	INV_ICM20948_SLOT_RAW_ACCELEROMETER           = INV_ICM20948_SLOT_GYROSCOPE + INV_ICM20948_CFG_GYROSCOPE,
+	INV_ICM20948_SLOT_RAW_GYROSCOPE               = INV_ICM20948_SLOT_RAW_ACCELEROMETER + INV_ICM20948_CFG_RAW_ACCELEROMETER,
+	INV_ICM20948_SLOT_MAGNETIC_FIELD_UNCALIBRATED = INV_ICM20948_SLOT_RAW_GYROSCOPE + INV_ICM20948_CFG_RAW_GYROSCOPE,
+	INV_ICM20948_SLOT_GYROSCOPE_UNCALIBRATED      = INV_ICM20948_SLOT_MAGNETIC_FIELD_UNCALIBRATED + INV_ICM20948_CFG_MAGNETIC_FIELD_UNCALIBRATED,
+	INV_ICM20948_SLOT_ACTIVITY_CLASSIFICATON      = INV_ICM20948_SLOT_GYROSCOPE_UNCALIBRATED + INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED,
+	INV_ICM20948_SLOT_STEP_DETECTOR               = INV_ICM20948_SLOT_ACTIVITY_CLASSIFICATON + INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON,
+	INV_ICM20948_SLOT_STEP_COUNTER                = INV_ICM20948_SLOT_STEP_DETECTOR + INV_ICM20948_CFG_STEP_DETECTOR,
+	INV_ICM20948_SLOT_GAME_ROTATION_VECTOR        = INV_ICM20948_SLOT_STEP_COUNTER + INV_ICM20948_CFG_STEP_COUNTER,
+	INV_ICM20948_SLOT_ROTATION_VECTOR             = INV_ICM20948_SLOT_GAME_ROTATION_VECTOR + INV_ICM20948_CFG_GAME_ROTATION_VECTOR,
+	INV_ICM20948_SLOT_GEOMAGNETIC_ROTATION_VECTOR = INV_ICM20948_SLOT_ROTATION_VECTOR + INV_ICM20948_CFG_ROTATION_VECTOR,
+	INV_ICM20948_SLOT_GEOMAGNETIC_FIELD           = INV_ICM20948_SLOT_GEOMAGNETIC_ROTATION_VECTOR + INV_ICM20948_CFG_GEOMAGNETIC_ROTATION_VECTOR,
+	INV_ICM20948_SLOT_WAKEUP_SIGNIFICANT_MOTION   = INV_ICM20948_SLOT_GEOMAGNETIC_FIELD + INV_ICM20948_CFG_GEOMAGNETIC_FIELD,
+	INV_ICM20948_SLOT_FLIP_PICKUP                 = INV_ICM20948_SLOT_WAKEUP_SIGNIFICANT_MOTION + INV_ICM20948_CFG_WAKEUP_SIGNIFICANT_MOTION,
+	INV_ICM20948_SLOT_WAKEUP_TILT_DETECTOR        = INV_ICM20948_SLOT_FLIP_PICKUP + INV_ICM20948_CFG_FLIP_PICKUP,
+	INV_ICM20948_SLOT_GRAVITY                     = INV_ICM20948_SLOT_WAKEUP_TILT_DETECTOR + INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR,
+	INV_ICM20948_SLOT_LINEAR_ACCELERATION         = INV_ICM20948_SLOT_GRAVITY + INV_ICM20948_CFG_GRAVITY,
+	INV_ICM20948_SLOT_ORIENTATION                 = INV_ICM20948_SLOT_LINEAR_ACCELERATION + INV_ICM20948_CFG_LINEAR_ACCELERATION,
+	INV_ICM20948_SLOT_B2S                         = INV_ICM20948_SLOT_ORIENTATION + INV_ICM20948_CFG_ORIENTATION,
+	INV_ICM20948_SLOT_MAX                         = INV_ICM20948_SLOT_B2S + INV_ICM20948_CFG_B2S,
+};
+
+/** @brief Return per-sensor states index of a sensor
+ *  @return     slot, INV_ICM20948_SLOT_MAX if sensor is not built or is not a valid id
+ */
+int INV_EXPORT inv_icm20948_sensor_slot(int sensor);
+
+/** @brief Tell if a sensor is part of the compile-time subset
+ *  @return     1 if built, 0 otherwise
+ */
+static inline int inv_icm20948_sensor_is_built(int sensor)
+{
+	return (inv_icm20948_sensor_slot(sensor) != INV_ICM20948_SLOT_MAX);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_CONFIG_H__
+
+/** @} */
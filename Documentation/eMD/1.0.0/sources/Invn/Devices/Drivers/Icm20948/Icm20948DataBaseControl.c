@@ -24,12 +24,20 @@
 // BAC ped y ration for wearable, the value will influence pedometer result
 #define BAC_PED_Y_RATIO_WEARABLE 1073741824
 
+// Writes deferred until inv_icm20948_ctrl_commit_config()
+#define INV_CONFIG_PENDING_ODR     0x01
+#define INV_CONFIG_PENDING_CONTROL 0x02
+
 static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char androidSensor, unsigned char enable, char * mems_put_to_sleep);
+static int inv_apply_sensor_control(struct inv_icm20948 * s, char * mems_put_to_sleep);
 static unsigned char sensor_needs_compass(unsigned char androidSensor);
 static unsigned char sensor_needs_bac_algo(unsigned char androidSensor);
 static int inv_set_hw_smplrt_dmp_odrs(struct inv_icm20948 * s);
 static void inv_reGenerate_sensorControl(struct inv_icm20948 * s, const short *sen_num_2_ctrl, unsigned short *sensor_control, uint8_t header2_count);
+#if INV_ICM20948_CFG_BAC_ENGINE || INV_ICM20948_CFG_B2S
 static short get_multiple_56_rate(unsigned short delayInMs);
+#endif
+static void get_odr_boundaries(unsigned char androidSensor, unsigned short * min_ms, unsigned short * max_ms);
 
 unsigned long inv_icm20948_ctrl_androidSensor_enabled(struct inv_icm20948 * s, unsigned char androidSensor)
 {
@@ -68,7 +76,11 @@ static int DividerRateSet(struct inv_icm20948 *s, unsigned short minDelay, unsig
 		unsigned short dmpOdrDivider = (minDelay * 1125L) / (hwSampleRateDivider * 1000L); // a divider from (1125Hz/hw_smplrt_divider).
 
 		s->inv_dmp_odr_dividers[InvSensor] = hwSampleRateDivider * dmpOdrDivider;
-		result |= dmp_icm20948_set_sensor_rate(s, InvSensor, (dmpOdrDivider - 1));
+		// only write DMP ODR register if it is not already holding this value
+		if (s->inv_dmp_odr_rates[InvSensor] != (unsigned short)(dmpOdrDivider - 1)) {
+			result |= dmp_icm20948_set_sensor_rate(s, InvSensor, (dmpOdrDivider - 1));
+			s->inv_dmp_odr_rates[InvSensor] = (result == 0) ? (unsigned short)(dmpOdrDivider - 1) : 0xFFFF;
+		}
 	}
 	
 	return result;
@@ -227,6 +239,7 @@ int inv_icm20948_base_control_init(struct inv_icm20948 * s)
 	unsigned int i;
 
 	memset(s->inv_dmp_odr_dividers, 0, sizeof(s->inv_dmp_odr_dividers));
+	memset(s->inv_dmp_odr_rates, 0xFF, sizeof(s->inv_dmp_odr_rates));
 	
 	for(i = 0; i < (sizeof(s->inv_dmp_odr_delays)/sizeof(unsigned short)); i++) {
 		if((i == INV_SENSOR_ACTIVITY_CLASSIFIER) ||
@@ -240,23 +253,6 @@ int inv_icm20948_base_control_init(struct inv_icm20948 * s)
 		else
 			s->inv_dmp_odr_delays[i] = INV_ODR_MIN_DELAY;
 	}
-	for(i = 0; i < (sizeof(s->inv_androidSensorsOdr_boundaries)/sizeof(s->inv_androidSensorsOdr_boundaries[0])); i++) {
-		if ((i == ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED) || (i == ANDROID_SENSOR_GEOMAGNETIC_FIELD) ||
-		    (i == ANDROID_SENSOR_WAKEUP_MAGNETIC_FIELD_UNCALIBRATED) || (i == ANDROID_SENSOR_WAKEUP_MAGNETIC_FIELD)) {
-			s->inv_androidSensorsOdr_boundaries[i][0] = INV_MIN_ODR_CPASS;
-			s->inv_androidSensorsOdr_boundaries[i][1] = INV_MAX_ODR_CPASS;
-		} else if ((i == ANDROID_SENSOR_GAME_ROTATION_VECTOR) || (i == ANDROID_SENSOR_WAKEUP_GAME_ROTATION_VECTOR) ||
-		           (i == ANDROID_SENSOR_GRAVITY) || (i == ANDROID_SENSOR_WAKEUP_GRAVITY) ||
-		           (i == ANDROID_SENSOR_LINEAR_ACCELERATION) || (i == ANDROID_SENSOR_WAKEUP_LINEAR_ACCELERATION) ||
-		           (i == ANDROID_SENSOR_ROTATION_VECTOR) || (i == ANDROID_SENSOR_WAKEUP_ROTATION_VECTOR) ||
-		           (i == ANDROID_SENSOR_ORIENTATION) || (i == ANDROID_SENSOR_WAKEUP_ORIENTATION)) {
-			s->inv_androidSensorsOdr_boundaries[i][0] = INV_MIN_ODR_GRV;
-			s->inv_androidSensorsOdr_boundaries[i][1] = INV_MAX_ODR_GRV;
-		} else {
-			s->inv_androidSensorsOdr_boundaries[i][0] = INV_MIN_ODR;
-			s->inv_androidSensorsOdr_boundaries[i][1] = INV_MAX_ODR;
-		}
-	}
 	s->lLastHwSmplrtDividerAcc = 0;
 	s->lLastHwSmplrtDividerGyr = 0;
 	s->sBatchMode              = 0;
@@ -271,6 +267,8 @@ int inv_icm20948_base_control_init(struct inv_icm20948 * s)
 	s->odr_racc_ms = INV_ODR_MIN_DELAY;
 	s->odr_gyr_ms = INV_ODR_MIN_DELAY;
 	s->odr_rgyr_ms = INV_ODR_MIN_DELAY;
+	s->config_depth            = 0;
+	s->config_pending          = 0;
 
 	return result;
 }
@@ -387,6 +385,7 @@ static int inv_set_hw_smplrt_dmp_odrs(struct inv_icm20948 * s)
 	if (minDly_cpass != 0xFFFF)    minDly_cpass = minDly;
 	if (minDly_pressure != 0xFFFF) minDly_pressure = minDly;
 
+#if INV_ICM20948_CFG_BAC_ENGINE
 	if (s->bac_request != 0) {
 		unsigned short lBACMinDly = min(INV_ODR_DEFAULT_BAC, minDly_accel);
 		// estimate closest decimator value to have 56Hz multiple and apply it
@@ -396,6 +395,8 @@ static int inv_set_hw_smplrt_dmp_odrs(struct inv_icm20948 * s)
 		hw_smplrt_divider = SampleRateDividerGet(minDly_accel);
 		result |= DividerRateSet(s, lBACMinDly, hw_smplrt_divider, INV_SENSOR_ACTIVITY_CLASSIFIER);
 	}
+#endif
+#if INV_ICM20948_CFG_B2S
 	if (s->b2s_status != 0) {
 		unsigned short lB2SMinDly = min(INV_ODR_DEFAULT_B2S, minDly_accel);
 		lB2SMinDly = 1000/(get_multiple_56_rate(lB2SMinDly));
@@ -404,6 +405,7 @@ static int inv_set_hw_smplrt_dmp_odrs(struct inv_icm20948 * s)
 		hw_smplrt_divider = SampleRateDividerGet(minDly_accel);
 		result |= DividerRateSet(s, lB2SMinDly, hw_smplrt_divider, INV_SENSOR_BRING_TO_SEE);
 	}
+#endif
 
 	// set odrs for each enabled sensors
 
@@ -471,6 +473,7 @@ static int inv_set_hw_smplrt_dmp_odrs(struct inv_icm20948 * s)
 	return result;
 }
 
+#if INV_ICM20948_CFG_BAC_ENGINE || INV_ICM20948_CFG_B2S
 static short get_multiple_56_rate(unsigned short delayInMs)
 {
 	short lfreq = 0;
@@ -498,10 +501,44 @@ static short get_multiple_56_rate(unsigned short delayInMs)
 	
 	return lfreq;
 }
+#endif
+
+/** Returns min and max delays in ms allowed for an android sensor
+*/
+static void get_odr_boundaries(unsigned char androidSensor, unsigned short * min_ms, unsigned short * max_ms)
+{
+	switch(androidSensor) {
+	case ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED:
+	case ANDROID_SENSOR_GEOMAGNETIC_FIELD:
+	case ANDROID_SENSOR_WAKEUP_MAGNETIC_FIELD_UNCALIBRATED:
+	case ANDROID_SENSOR_WAKEUP_MAGNETIC_FIELD:
+		*min_ms = INV_MIN_ODR_CPASS;
+		*max_ms = INV_MAX_ODR_CPASS;
+		break;
+	case ANDROID_SENSOR_GAME_ROTATION_VECTOR:
+	case ANDROID_SENSOR_WAKEUP_GAME_ROTATION_VECTOR:
+	case ANDROID_SENSOR_GRAVITY:
+	case ANDROID_SENSOR_WAKEUP_GRAVITY:
+	case ANDROID_SENSOR_LINEAR_ACCELERATION:
+	case ANDROID_SENSOR_WAKEUP_LINEAR_ACCELERATION:
+	case ANDROID_SENSOR_ROTATION_VECTOR:
+	case ANDROID_SENSOR_WAKEUP_ROTATION_VECTOR:
+	case ANDROID_SENSOR_ORIENTATION:
+	case ANDROID_SENSOR_WAKEUP_ORIENTATION:
+		*min_ms = INV_MIN_ODR_GRV;
+		*max_ms = INV_MAX_ODR_GRV;
+		break;
+	default:
+		*min_ms = INV_MIN_ODR;
+		*max_ms = INV_MAX_ODR;
+		break;
+	}
+}
 
 int inv_icm20948_set_odr(struct inv_icm20948 * s, unsigned char androidSensor, unsigned short delayInMs)
 {
 	int result;
+	unsigned short min_ms, max_ms;
 
 	if(sensor_needs_compass(androidSensor))
 		if(!inv_icm20948_get_compass_availability(s))
@@ -516,8 +553,9 @@ int inv_icm20948_set_odr(struct inv_icm20948 * s, unsigned char androidSensor, u
 	inv_icm20948_prevent_lpen_control(s);
 
 	// check that requested ODR is within the allowed limits
-	if (delayInMs < s->inv_androidSensorsOdr_boundaries[androidSensor][0]) delayInMs = s->inv_androidSensorsOdr_boundaries[androidSensor][0];
-	if (delayInMs > s->inv_androidSensorsOdr_boundaries[androidSensor][1]) delayInMs = s->inv_androidSensorsOdr_boundaries[androidSensor][1];
+	get_odr_boundaries(androidSensor, &min_ms, &max_ms);
+	if (delayInMs < min_ms) delayInMs = min_ms;
+	if (delayInMs > max_ms) delayInMs = max_ms;
 	switch (androidSensor) {
 		case ANDROID_SENSOR_ACCELEROMETER:
 			if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_ACCELEROMETER))
@@ -695,8 +733,14 @@ int inv_icm20948_set_odr(struct inv_icm20948 * s, unsigned char androidSensor, u
 			break;
 	}
 
-	result = inv_set_hw_smplrt_dmp_odrs(s);
-	result |= inv_icm20948_set_gyro_sf(s, inv_icm20948_get_gyro_divider(s), inv_icm20948_get_gyro_fullscale(s));
+	if (s->config_depth) {
+		// written once by inv_icm20948_ctrl_commit_config()
+		s->config_pending |= INV_CONFIG_PENDING_ODR;
+		result = 0;
+	} else {
+		result = inv_set_hw_smplrt_dmp_odrs(s);
+		result |= inv_icm20948_set_gyro_sf(s, inv_icm20948_get_gyro_divider(s), inv_icm20948_get_gyro_fullscale(s));
+	}
 
 	// debug get odr
 	// result should be SAME as you entered in Ms in the Rolldice console
@@ -960,12 +1004,44 @@ int inv_icm20948_ctrl_enable_sensor(struct inv_icm20948 * s, unsigned char andro
 	return result;
 }
 
+void inv_icm20948_ctrl_begin_config(struct inv_icm20948 * s)
+{
+	s->config_depth++;
+}
+
+int inv_icm20948_ctrl_commit_config(struct inv_icm20948 * s)
+{
+	int result = 0;
+
+	if (s->config_depth == 0)
+		return -1;
+	if (--s->config_depth || !s->config_pending)
+		return 0;
+
+	inv_icm20948_prevent_lpen_control(s);
+	if (s->config_pending & INV_CONFIG_PENDING_CONTROL) {
+		if( s->mems_put_to_sleep ) {
+			s->mems_put_to_sleep = 0;
+			result |= inv_icm20948_wakeup_mems(s);
+		}
+		// control words, ODRs and sleep state are all derived from final sensors state
+		result |= inv_apply_sensor_control(s, &s->mems_put_to_sleep);
+	} else {
+		result |= inv_set_hw_smplrt_dmp_odrs(s);
+		result |= inv_icm20948_set_gyro_sf(s, inv_icm20948_get_gyro_divider(s), inv_icm20948_get_gyro_fullscale(s));
+	}
+	s->config_pending = 0;
+	inv_icm20948_allow_lpen_control(s);
+
+	return result;
+}
+
 static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char androidSensor, unsigned char enable, char * mems_put_to_sleep)
 {
 	int result = 0;
-	unsigned short inv_event_control = 0;
-	unsigned short data_rdy_status = 0;
+#if INV_ICM20948_CFG_STEP_COUNTER
 	unsigned long steps=0;
+#endif
 	const short inv_androidSensor_to_control_bits[ANDROID_SENSOR_NUM_MAX]=
 	{
 		// Unsupported Sensors are -1
@@ -1016,8 +1092,9 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 		0x4048, // Raw Gyr
 	};
 	if(enable && !inv_icm20948_ctrl_androidSensor_enabled(s, androidSensor))
-		s->skip_sample[inv_icm20948_sensor_android_2_sensor_type(androidSensor)] = 1;
+		s->skip_sample[inv_icm20948_sensor_slot(inv_icm20948_sensor_android_2_sensor_type(androidSensor))] = 1;
 		
+#if INV_ICM20948_CFG_WAKEUP_SIGNIFICANT_MOTION
 	if (androidSensor == ANDROID_SENSOR_WAKEUP_SIGNIFICANT_MOTION) {
 		if (enable) {
 			s->smd_status = INV_SMD_EN;
@@ -1028,7 +1105,9 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 			s->bac_request --;
 		}
 	}
+#endif
 
+#if INV_ICM20948_CFG_STEP_DETECTOR
 	if (androidSensor == ANDROID_SENSOR_STEP_DETECTOR) {
 		if (enable) {
 			s->ped_int_status = INV_PEDOMETER_INT_EN;
@@ -1039,7 +1118,9 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 			s->bac_request --;
 		}
 	}
+#endif
 	
+#if INV_ICM20948_CFG_STEP_COUNTER
 	if (androidSensor == ANDROID_SENSOR_STEP_COUNTER) {
 		if (enable) {
 			s->bac_request ++;
@@ -1048,7 +1129,9 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 			s->bac_request --;
 		}
 	}
+#endif
 
+#if INV_ICM20948_CFG_FLIP_PICKUP
 	if (androidSensor == ANDROID_SENSOR_FLIP_PICKUP) {
 		if (enable){
 			s->flip_pickup_status = FLIP_PICKUP_SET;
@@ -1056,7 +1139,9 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 		else
 			s->flip_pickup_status = 0;
 	}
+#endif
 
+#if INV_ICM20948_CFG_B2S
 	if (androidSensor == ANDROID_SENSOR_B2S) {
 		if(enable){
 			s->b2s_status = INV_BTS_EN;
@@ -1067,13 +1152,80 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 			s->bac_request --;
 		}
 	}
+#endif
+#if INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON
 	if (androidSensor == ANDROID_SENSOR_ACTIVITY_CLASSIFICATON)
 		inv_icm20948_ctrl_enable_activity_classifier(s, enable);
+#endif
 
+#if INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR
 	if (androidSensor == ANDROID_SENSOR_WAKEUP_TILT_DETECTOR)
 		inv_icm20948_ctrl_enable_tilt(s, enable);
+#endif
 
 	inv_convert_androidSensor_to_control(s, androidSensor, enable, inv_androidSensor_to_control_bits, &s->inv_sensor_control);
+
+	// A sensor was just enabled/disabled, need to recompute the required ODR for all augmented sensor-related sensors
+	// The fastest ODR will always be applied to other related sensors
+	if (   (androidSensor == ANDROID_SENSOR_GRAVITY) 
+		|| (androidSensor == ANDROID_SENSOR_GAME_ROTATION_VECTOR) 
+		|| (androidSensor == ANDROID_SENSOR_LINEAR_ACCELERATION) ) {
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_SIXQ]);
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_SIXQ_accel]);
+	}
+
+	if (   (androidSensor == ANDROID_SENSOR_ORIENTATION) 
+		|| (androidSensor == ANDROID_SENSOR_ROTATION_VECTOR) ) {
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_NINEQ]);
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_NINEQ_accel]);
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_NINEQ_cpass]);
+	}
+
+	if (   (androidSensor == ANDROID_SENSOR_WAKEUP_GRAVITY) 
+		|| (androidSensor == ANDROID_SENSOR_WAKEUP_GAME_ROTATION_VECTOR) 
+		|| (androidSensor == ANDROID_SENSOR_WAKEUP_LINEAR_ACCELERATION) ) {
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_SIXQ]);
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_SIXQ_accel]);
+	}
+
+	if (   (androidSensor == ANDROID_SENSOR_WAKEUP_ORIENTATION) 
+		|| (androidSensor == ANDROID_SENSOR_WAKEUP_ROTATION_VECTOR) ) {
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_NINEQ]);
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_NINEQ_accel]);
+		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_NINEQ_cpass]);
+	}
+
+	if (s->config_depth) {
+		// written once by inv_icm20948_ctrl_commit_config()
+		s->config_pending |= INV_CONFIG_PENDING_CONTROL | INV_CONFIG_PENDING_ODR;
+	} else {
+		result |= inv_apply_sensor_control(s, mems_put_to_sleep);
+	}
+
+#if INV_ICM20948_CFG_STEP_COUNTER
+	// To have the all steps when you enable the sensor
+	if (androidSensor == ANDROID_SENSOR_STEP_COUNTER)
+	{
+		if (enable)
+		{
+			dmp_icm20948_get_pedometer_num_of_steps(s, &steps);
+			s->sStepCounterToBeSubtracted = steps - s->sOldSteps;
+		}
+	}
+#endif
+
+	return result;
+}
+
+/** Writes DMP control words, ODRs and hardware sensors enable derived from current sensors state
+* @param[out] mems_put_to_sleep set to 1 if chip was put to sleep because no sensor is on
+*/
+static int inv_apply_sensor_control(struct inv_icm20948 * s, char * mems_put_to_sleep)
+{
+	int result;
+	unsigned short inv_event_control = 0;
+	unsigned short data_rdy_status = 0;
+
 	result = dmp_icm20948_set_data_output_control1(s, s->inv_sensor_control);
 	if (s->b2s_status)
 		result |= dmp_icm20948_set_data_interrupt_control(s, s->inv_sensor_control|0x8008);
@@ -1102,6 +1254,7 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 	else
 		s->inv_sensor_control2 &= ~FLIP_PICKUP_SET;
 
+#if INV_ICM20948_CFG_B2S
 	// inv_event_control   |= s->b2s_status; 
 	if(s->b2s_status)
 	{
@@ -1120,6 +1273,7 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 		inv_event_control &= ~INV_BAC_WEARABLE_EN;
 #endif
 	}
+#endif
 
 	result |= dmp_icm20948_set_data_output_control2(s, s->inv_sensor_control2);
 
@@ -1153,6 +1307,7 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 	if (s->inv_sensor_control & QUAT9_SET)
 		inv_event_control |= INV_NINE_AXIS_EN;
 
+#if INV_ICM20948_CFG_BAC_ENGINE
 	if (s->inv_sensor_control & (PED_STEPDET_SET | PED_STEPIND_SET) || inv_event_control & INV_SMD_EN) {
 		inv_event_control |= INV_PEDOMETER_EN;
 #ifndef ICM20948_FOR_MOBILE // Next lines change BAC behavior to wearable platform
@@ -1168,6 +1323,7 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 		dmp_icm20948_set_ped_y_ratio(s, BAC_PED_Y_RATIO_WEARABLE);
 #endif
 	}
+#endif
 
 	if (s->inv_sensor_control2 & FLIP_PICKUP_SET){
 		inv_event_control |= FLIP_PICKUP_EN;
@@ -1178,36 +1334,6 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 
 	result |= dmp_icm20948_set_motion_event_control(s, inv_event_control);
 	
-	// A sensor was just enabled/disabled, need to recompute the required ODR for all augmented sensor-related sensors
-	// The fastest ODR will always be applied to other related sensors
-	if (   (androidSensor == ANDROID_SENSOR_GRAVITY) 
-		|| (androidSensor == ANDROID_SENSOR_GAME_ROTATION_VECTOR) 
-		|| (androidSensor == ANDROID_SENSOR_LINEAR_ACCELERATION) ) {
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_SIXQ]);
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_SIXQ_accel]);
-	}
-
-	if (   (androidSensor == ANDROID_SENSOR_ORIENTATION) 
-		|| (androidSensor == ANDROID_SENSOR_ROTATION_VECTOR) ) {
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_NINEQ]);
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_NINEQ_accel]);
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_NINEQ_cpass]);
-	}
-
-	if (   (androidSensor == ANDROID_SENSOR_WAKEUP_GRAVITY) 
-		|| (androidSensor == ANDROID_SENSOR_WAKEUP_GAME_ROTATION_VECTOR) 
-		|| (androidSensor == ANDROID_SENSOR_WAKEUP_LINEAR_ACCELERATION) ) {
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_SIXQ]);
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_SIXQ_accel]);
-	}
-
-	if (   (androidSensor == ANDROID_SENSOR_WAKEUP_ORIENTATION) 
-		|| (androidSensor == ANDROID_SENSOR_WAKEUP_ROTATION_VECTOR) ) {
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_NINEQ]);
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_NINEQ_accel]);
-		inv_icm20948_augmented_sensors_update_odr(s, androidSensor, &s->inv_dmp_odr_delays[INV_SENSOR_WAKEUP_NINEQ_cpass]);
-	}
-
 	result |= inv_set_hw_smplrt_dmp_odrs(s);
 	result |= inv_icm20948_set_gyro_sf(s, inv_icm20948_get_gyro_divider(s), inv_icm20948_get_gyro_fullscale(s));
 
@@ -1226,16 +1352,6 @@ static int inv_enable_sensor_internal(struct inv_icm20948 * s, unsigned char and
 
 	result |= dmp_icm20948_set_data_rdy_status(s, data_rdy_status);
 
-	// To have the all steps when you enable the sensor
-	if (androidSensor == ANDROID_SENSOR_STEP_COUNTER)
-	{
-		if (enable)
-		{
-			dmp_icm20948_get_pedometer_num_of_steps(s, &steps);
-			s->sStepCounterToBeSubtracted = steps - s->sOldSteps;
-		}
-	}
-
 	return result;
 }
 
@@ -1343,13 +1459,15 @@ int inv_icm20948_ctrl_set_batch_timeout(struct inv_icm20948 * s, unsigned short
 int inv_icm20948_ctrl_set_batch_timeout_ms(struct inv_icm20948 * s, unsigned short batch_time_in_ms)
 {
 	unsigned int timeout = 0;
+	unsigned short min_ms, max_ms;
 
 	if(    s->inv_sensor_control & GYRO_CALIBR_SET 
 		|| s->inv_sensor_control & QUAT6_SET 
 		|| s->inv_sensor_control & QUAT9_SET 
 		|| s->inv_sensor_control & GYRO_SET ) { // If Gyro based sensor is enabled.
 		timeout = (unsigned int) ((batch_time_in_ms * (BASE_SAMPLE_RATE/ (inv_icm20948_get_gyro_divider(s) + 1)))/1000);
-		if(batch_time_in_ms < s->inv_androidSensorsOdr_boundaries[ANDROID_SENSOR_GYROSCOPE][0]) {
+		get_odr_boundaries(ANDROID_SENSOR_GYROSCOPE, &min_ms, &max_ms);
+		if(batch_time_in_ms < min_ms) {
 			return -1; // requested batch timeout is not supported
 		} else {
 			return dmp_icm20948_set_batchmode_params(s, timeout, GYRO_AVAILABLE);
@@ -1359,7 +1477,8 @@ int inv_icm20948_ctrl_set_batch_timeout_ms(struct inv_icm20948 * s, unsigned sho
 	if(    s->inv_sensor_control & ACCEL_SET
 		|| s->inv_sensor_control & GEOMAG_SET ) { // If Accel is enabled and no Gyro based sensor is enabled.
 		timeout = (unsigned int) ((batch_time_in_ms * (BASE_SAMPLE_RATE/ (inv_icm20948_get_accel_divider(s) + 1)))/1000);
-		if(batch_time_in_ms < s->inv_androidSensorsOdr_boundaries[ANDROID_SENSOR_ACCELEROMETER][0]) {
+		get_odr_boundaries(ANDROID_SENSOR_ACCELEROMETER, &min_ms, &max_ms);
+		if(batch_time_in_ms < min_ms) {
 			return -1; // requested batch timeout is not supported
 		} else {
 			return dmp_icm20948_set_batchmode_params(s, timeout, ACCEL_AVAILABLE);
@@ -1369,7 +1488,8 @@ int inv_icm20948_ctrl_set_batch_timeout_ms(struct inv_icm20948 * s, unsigned sho
 	if(    s->inv_sensor_control & CPASS_SET 
 		|| s->inv_sensor_control & CPASS_CALIBR_SET ) {
 		timeout = (unsigned int) ((batch_time_in_ms * (BASE_SAMPLE_RATE/ inv_icm20948_get_secondary_divider(s)))/1000);
-		if(batch_time_in_ms < s->inv_androidSensorsOdr_boundaries[ANDROID_SENSOR_GEOMAGNETIC_FIELD][0]) {
+		get_odr_boundaries(ANDROID_SENSOR_GEOMAGNETIC_FIELD, &min_ms, &max_ms);
+		if(batch_time_in_ms < min_ms) {
 			return -1; // requested batch timeout is not supported
 		} else {
 			return dmp_icm20948_set_batchmode_params(s, timeout, SECONDARY_COMPASS_AVAILABLE);
@@ -1522,6 +1642,9 @@ int inv_icm20948_ctrl_set_mag_bias(struct inv_icm20948 * s, int * mag_bias)
 	
 	rc = dmp_icm20948_set_bias_cmp(s, &s->bias[6]);
 	
+	s->compass_cal.generation++;
+	s->compass_cal.bias_valid = (rc == 0);
+	
 	return rc;
 }
 static unsigned char sensor_needs_compass(unsigned char androidSensor)
@@ -148,6 +148,20 @@ int INV_EXPORT inv_icm20948_set_odr(struct inv_icm20948 * s, unsigned char andro
 */
 int INV_EXPORT inv_icm20948_ctrl_enable_sensor(struct inv_icm20948 * s, unsigned char androidSensor, unsigned char enable);
 
+/** @brief Starts a configuration transaction
+* Until the matching inv_icm20948_ctrl_commit_config(), inv_icm20948_set_odr() and
+* inv_icm20948_ctrl_enable_sensor() only update driver states. Dividers and control
+* words are computed once at commit and only DMP ODR registers whose value changed
+* are written. Calls can be nested.
+*/
+void INV_EXPORT inv_icm20948_ctrl_begin_config(struct inv_icm20948 * s);
+
+/** @brief Ends a configuration transaction started with inv_icm20948_ctrl_begin_config()
+* Writes accumulated changes when the outermost transaction is committed.
+* @return 0 in case of success, -1 for any error
+*/
+int INV_EXPORT inv_icm20948_ctrl_commit_config(struct inv_icm20948 * s);
+
 /** @brief Enables / disables batch for the sensors
 * @param[in] enable			0=off, 1=on
 * @return 0 in case of success, -1 for any error
@@ -19,6 +19,7 @@
 #include "Icm20948AuxCompassAkm.h"
 #include "Icm20948AuxTransport.h"
 #include "Icm20948Dmp3Driver.h"
+#include "Icm20948LoadFirmware.h"
 
 static unsigned char inv_is_gyro_enabled(struct inv_icm20948 * s);
 
@@ -28,9 +29,21 @@ void inv_icm20948_prevent_lpen_control(struct inv_icm20948 * s)
 }
 void inv_icm20948_allow_lpen_control(struct inv_icm20948 * s)
 {
+	if(s->sLpEnHold)
+		return;
 	s->sAllowLpEn = 1;
 	inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
 }
+void inv_icm20948_hold_lpen_control(struct inv_icm20948 * s)
+{
+	s->sLpEnHold++;
+	inv_icm20948_prevent_lpen_control(s);
+}
+void inv_icm20948_release_lpen_control(struct inv_icm20948 * s)
+{
+	if(s->sLpEnHold && --s->sLpEnHold == 0)
+		inv_icm20948_allow_lpen_control(s);
+}
 static uint8_t inv_icm20948_get_lpen_control(struct inv_icm20948 * s)
 {
 	return s->sAllowLpEn;
@@ -211,6 +224,7 @@ int inv_icm20948_initialize_lower_driver(struct inv_icm20948 * s, enum SMARTSENS
 	static unsigned char data;
 	// set static variable
 	s->sAllowLpEn = 1;
+	s->sLpEnHold = 0;
 	s->s_compass_available = 0;
 	// ICM20948 do not support the proximity sensor for the moment.
 	// s_proximity_available variable is nerver changes
@@ -242,7 +256,14 @@ int inv_icm20948_initialize_lower_driver(struct inv_icm20948 * s, enum SMARTSENS
 	result |= inv_icm20948_write_single_mems_reg(s, REG_USER_CTRL, s->base_state.user_ctrl);
 
 	//Setup Ivory DMP.
-	result |= inv_icm20948_load_firmware(s, dmp3_image, dmp3_image_size);
+	s->warm_restarted = 0;
+	if(s->warm_restart && result == 0 &&
+			inv_icm20948_firmware_check(s, dmp3_image, dmp3_image_size, DMP_LOAD_START) == 0) {
+		// DMP image is still resident, skip upload
+		s->warm_restarted = 1;
+	} else {
+		result |= inv_icm20948_load_firmware(s, dmp3_image, dmp3_image_size);
+	}
 	if(result)
 		return result;
 	else
@@ -251,6 +272,8 @@ int inv_icm20948_initialize_lower_driver(struct inv_icm20948 * s, enum SMARTSENS
 	// Turn off all sensors on DMP by default.
 	//result |= dmp_set_data_output_control1(0);   // FIXME in DMP, these should be off by default.
 	result |= dmp_icm20948_reset_control_registers(s);
+	// DMP ODR registers are back to image defaults
+	memset(s->inv_dmp_odr_rates, 0xFF, sizeof(s->inv_dmp_odr_rates));
 	
 	// set FIFO watermark to 80% of actual FIFO size
 	result |= dmp_icm20948_set_FIFO_watermark(s, 800);
@@ -292,6 +315,13 @@ int inv_icm20948_initialize_lower_driver(struct inv_icm20948 * s, enum SMARTSENS
 	if(s->base_state.lp_en_support == 1)
 		inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
 
+	// Biases kept in resident DMP memory are reloaded in driver states
+	if(s->warm_restarted) {
+		result |= inv_icm20948_ctrl_get_acc_bias(s, &s->bias[0]);
+		result |= inv_icm20948_ctrl_get_gyr_bias(s, &s->bias[3]);
+		result |= inv_icm20948_ctrl_get_mag_bias(s, &s->bias[6]);
+	}
+
 	result |= inv_icm20948_sleep_mems(s);   
         
 	return result;
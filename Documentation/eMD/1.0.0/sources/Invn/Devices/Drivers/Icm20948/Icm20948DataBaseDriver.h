@@ -191,6 +191,18 @@ void INV_EXPORT inv_icm20948_prevent_lpen_control(struct inv_icm20948 * s);
 */
 void INV_EXPORT inv_icm20948_allow_lpen_control(struct inv_icm20948 * s);
 
+/** @brief Keep LP_EN to 0 across a sequence of calls
+*   inv_icm20948_allow_lpen_control() has no effect until the matching
+*   inv_icm20948_release_lpen_control() so that LP_EN is toggled only once
+*   for the whole sequence. Calls can be nested.
+*/
+void INV_EXPORT inv_icm20948_hold_lpen_control(struct inv_icm20948 * s);
+
+/** @brief End a sequence started with inv_icm20948_hold_lpen_control()
+*   LP_EN is allowed again when the outermost hold is released.
+*/
+void INV_EXPORT inv_icm20948_release_lpen_control(struct inv_icm20948 * s);
+
 /** @brief Determine if compass could be successfully found and inited on board
 * @return	1 on success, 0 if not available.
 */
@@ -118,6 +118,15 @@ extern "C" {
 
 #define REG_INT_ENABLE_3        (BANK_0 | 0x13)
 
+#define REG_I2C_MST_STATUS      (BANK_0 | 0x17)
+#define BIT_I2C_SLV4_DONE               0x40
+#define BIT_I2C_LOST_ARB                0x20
+#define BIT_I2C_SLV4_NACK               0x10
+#define BIT_I2C_SLV3_NACK               0x08
+#define BIT_I2C_SLV2_NACK               0x04
+#define BIT_I2C_SLV1_NACK               0x02
+#define BIT_I2C_SLV0_NACK               0x01
+
 #define REG_DMP_INT_STATUS      (BANK_0 | 0x18)
 #define BIT_WAKE_ON_MOTION_INT          0x08
 #define BIT_MSG_DMP_INT                 0x0002
@@ -246,7 +255,12 @@ extern "C" {
 #define REG_I2C_SLV3_CTRL       (BANK_3 | 0x11)
 #define REG_I2C_SLV3_DO         (BANK_3 | 0x12)
 
+#define REG_I2C_SLV4_ADDR       (BANK_3 | 0x13)
+#define REG_I2C_SLV4_REG        (BANK_3 | 0x14)
 #define REG_I2C_SLV4_CTRL       (BANK_3 | 0x15)
+#define REG_I2C_SLV4_DO         (BANK_3 | 0x16)
+#define REG_I2C_SLV4_DI         (BANK_3 | 0x17)
+#define BIT_I2C_SLV4_DLY_MASK           0x1F
 
 #define INV_MPU_BIT_SLV_EN      0x80
 #define INV_MPU_BIT_BYTE_SW     0x40
@@ -311,6 +325,8 @@ extern "C" {
 #define TEMPERATURE_SCALE  3340827L
 #define TEMPERATURE_OFFSET 1376256L
 #define SECONDARY_INIT_WAIT 60
+#define SECONDARY_POLL_WAIT 200
+#define SECONDARY_DONE_REG  0x00
 #define MPU_SOFT_UPDT_ADDR               0x86
 #define MPU_SOFT_UPTD_MASK               0x0F
 #define AK99XX_SHIFT                    23
@@ -0,0 +1,240 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948FifoDecoder.h"
+
+#include "Icm20948Defs.h"
+#include "Icm20948DataBaseControl.h"
+#include "Icm20948DataBaseDriver.h"
+#include "Icm20948DataConverter.h"
+#include "Icm20948MPUFifoControl.h"
+
+/* DMP compass unit (Q16) to uT, as done by inv_icm20948_poll_sensor() */
+#define FIFO_DECODER_COMPASS_SCALE  (1/(float)(1UL<<16))
+
+static const uint8_t fifo_column_width[INV_ICM20948_FIFO_COL_MAX] = {
+	sizeof(uint32_t),       /* INV_ICM20948_FIFO_COL_OFFSET */
+	2 * sizeof(uint16_t),   /* INV_ICM20948_FIFO_COL_HEADER */
+	3 * sizeof(float),      /* INV_ICM20948_FIFO_COL_ACCEL */
+	3 * sizeof(float),      /* INV_ICM20948_FIFO_COL_GYRO */
+	3 * sizeof(float),      /* INV_ICM20948_FIFO_COL_GYRO_BIAS */
+	3 * sizeof(float),      /* INV_ICM20948_FIFO_COL_COMPASS */
+	4 * sizeof(float),      /* INV_ICM20948_FIFO_COL_GRV */
+	4 * sizeof(float),      /* INV_ICM20948_FIFO_COL_RV */
+	4 * sizeof(float),      /* INV_ICM20948_FIFO_COL_GMRV */
+};
+
+unsigned inv_icm20948_fifo_column_width(int column)
+{
+	if (column < 0 || column >= INV_ICM20948_FIFO_COL_MAX)
+		return 0;
+
+	return fifo_column_width[column];
+}
+
+void inv_icm20948_fifo_decoder_init(struct inv_icm20948_fifo_decoder * d, struct inv_icm20948 * s)
+{
+	/* same conversions as inv_icm20948_poll_sensor() */
+	const float scale_deg = (1 << inv_icm20948_get_gyro_fullscale(s)) * 250.f;
+
+	d->s = s;
+	memset(&d->compass, 0, sizeof(d->compass));
+	inv_icm20948_compass_comp_sync(s, &d->compass, 0);
+	d->accel_scale = (1 << inv_icm20948_get_accel_fullscale(s)) * 2.f / (1L<<30);
+	d->gyro_scale = scale_deg / (1L<<15);
+	d->gyro_bias_scale = scale_deg / (1L<<20);
+}
+
+/** Return 1 if nb packets starting at pos are valid or valid packets lead to the end of data */
+static int fifo_decoder_is_sync(const uint8_t * data, uint32_t len, uint32_t pos, int nb)
+{
+	while (nb--) {
+		unsigned short header, header2;
+		int sz;
+
+		if (pos >= len)
+			return 1;
+		sz = inv_icm20948_fifo_packet_size(&data[pos], len - pos, &header, &header2);
+		if (sz < 0)
+			return 0;
+		if (sz == 0)
+			return 1;
+		pos += sz;
+	}
+
+	return 1;
+}
+
+uint32_t inv_icm20948_fifo_decoder_sync(const uint8_t * data, uint32_t len, uint32_t pos)
+{
+	while (pos < len && !fifo_decoder_is_sync(data, len, pos, INV_ICM20948_FIFO_DECODER_SYNC_PACKETS))
+		pos++;
+
+	return pos;
+}
+
+void inv_icm20948_fifo_decoder_split(const uint8_t * data, uint32_t len, unsigned nb_chunks, uint32_t * bounds)
+{
+	unsigned i;
+
+	bounds[0] = 0;
+	for (i = 1; i < nb_chunks; i++) {
+		const uint32_t start = (uint32_t)((uint64_t)len * i / nb_chunks);
+
+		bounds[i] = (start > bounds[i-1]) ? inv_icm20948_fifo_decoder_sync(data, len, start) : bounds[i-1];
+	}
+	bounds[nb_chunks] = len;
+}
+
+static void fifo_decoder_vec3(const struct inv_icm20948_fifo_decoder * d, int set, const long * in, float scale, float * out)
+{
+	if (set)
+		inv_icm20948_convert_dmp3_to_body(d->s, in, scale, out);
+	else
+		memset(out, 0, 3 * sizeof(float));
+}
+
+static void fifo_decoder_quat(const struct inv_icm20948_fifo_decoder * d, int set, const long * quat, float * out)
+{
+	float rv[4];
+
+	if (!set) {
+		memset(out, 0, 4 * sizeof(float));
+		return;
+	}
+
+	inv_icm20948_convert_rotation_vector(d->s, quat, rv);
+	out[0] = rv[3];
+	out[1] = rv[0];
+	out[2] = rv[1];
+	out[3] = rv[2];
+}
+
+static void fifo_decoder_row(const struct inv_icm20948_fifo_decoder * d, const uint8_t * packet, uint32_t offset,
+		unsigned short header, unsigned short header2, struct inv_icm20948_fifo_columns * cols)
+{
+	void * const * col = cols->col;
+	const uint32_t row = cols->nb_rows;
+	struct inv_fifo_decoded_t fd;
+	long l[3];
+
+	fd.header = header;
+	fd.header2 = header2;
+	packet += HEADER_SZ;
+	if (header & HEADER2_SET)
+		packet += HEADER2_SZ;
+	inv_icm20948_inv_decode_one_ivory_fifo_packet(&d->compass, &fd, packet);
+
+	if (col[INV_ICM20948_FIFO_COL_OFFSET])
+		((uint32_t *)col[INV_ICM20948_FIFO_COL_OFFSET])[row] = offset;
+	if (col[INV_ICM20948_FIFO_COL_HEADER]) {
+		uint16_t * h = &((uint16_t *)col[INV_ICM20948_FIFO_COL_HEADER])[2 * row];
+		h[0] = header;
+		h[1] = header2;
+	}
+	if (col[INV_ICM20948_FIFO_COL_ACCEL])
+		fifo_decoder_vec3(d, header & ACCEL_SET, fd.accel, d->accel_scale,
+				&((float *)col[INV_ICM20948_FIFO_COL_ACCEL])[3 * row]);
+	if (col[INV_ICM20948_FIFO_COL_GYRO]) {
+		l[0] = fd.gyro[0];
+		l[1] = fd.gyro[1];
+		l[2] = fd.gyro[2];
+		fifo_decoder_vec3(d, header & GYRO_SET, l, d->gyro_scale,
+				&((float *)col[INV_ICM20948_FIFO_COL_GYRO])[3 * row]);
+	}
+	if (col[INV_ICM20948_FIFO_COL_GYRO_BIAS]) {
+		l[0] = fd.gyro_bias[0];
+		l[1] = fd.gyro_bias[1];
+		l[2] = fd.gyro_bias[2];
+		fifo_decoder_vec3(d, header & GYRO_SET, l, d->gyro_bias_scale,
+				&((float *)col[INV_ICM20948_FIFO_COL_GYRO_BIAS])[3 * row]);
+	}
+	if (col[INV_ICM20948_FIFO_COL_COMPASS]) {
+		float * v = &((float *)col[INV_ICM20948_FIFO_COL_COMPASS])[3 * row];
+		if (header & CPASS_SET) {
+			v[0] = fd.compass[0] * FIFO_DECODER_COMPASS_SCALE;
+			v[1] = fd.compass[1] * FIFO_DECODER_COMPASS_SCALE;
+			v[2] = fd.compass[2] * FIFO_DECODER_COMPASS_SCALE;
+		} else {
+			memset(v, 0, 3 * sizeof(float));
+		}
+	}
+	if (col[INV_ICM20948_FIFO_COL_GRV])
+		fifo_decoder_quat(d, header & QUAT6_SET, fd.dmp_3e_6quat, &((float *)col[INV_ICM20948_FIFO_COL_GRV])[4 * row]);
+	if (col[INV_ICM20948_FIFO_COL_RV])
+		fifo_decoder_quat(d, header & QUAT9_SET, fd.dmp_3e_9quat, &((float *)col[INV_ICM20948_FIFO_COL_RV])[4 * row]);
+	if (col[INV_ICM20948_FIFO_COL_GMRV])
+		fifo_decoder_quat(d, header & GEOMAG_SET, fd.dmp_3e_geomagquat, &((float *)col[INV_ICM20948_FIFO_COL_GMRV])[4 * row]);
+}
+
+uint32_t inv_icm20948_fifo_decoder_run(const struct inv_icm20948_fifo_decoder * d,
+		const uint8_t * data, uint32_t len, uint32_t begin, uint32_t end, struct inv_icm20948_fifo_columns * cols)
+{
+	uint32_t pos = begin;
+
+	cols->nb_rows = 0;
+
+	while (pos < end && cols->nb_rows < cols->capacity) {
+		unsigned short header, header2;
+		const int sz = inv_icm20948_fifo_packet_size(&data[pos], len - pos, &header, &header2);
+
+		if (sz < 0) {
+			/* not aligned on a packet (lost bytes or corrupted stream) */
+			const uint32_t sync = inv_icm20948_fifo_decoder_sync(data, len, pos + 1);
+
+			cols->resyncs++;
+			cols->skipped += sync - pos;
+			pos = sync;
+			continue;
+		}
+		/* truncated last packet */
+		if (sz == 0 || pos + sz > len)
+			break;
+
+		fifo_decoder_row(d, &data[pos], pos, header, header2, cols);
+		cols->nb_rows++;
+		pos += sz;
+	}
+
+	cols->next = pos;
+
+	return cols->nb_rows;
+}
+
+int inv_icm20948_fifo_columns_write(const struct inv_icm20948_fifo_columns * cols,
+		int (*write)(void * context, const void * buf, uint32_t len), void * context)
+{
+	uint32_t hdr[3];
+	int i;
+
+	hdr[0] = INV_ICM20948_FIFO_COLUMNS_MAGIC;
+	hdr[1] = cols->nb_rows;
+	hdr[2] = 0;
+	for (i = 0; i < INV_ICM20948_FIFO_COL_MAX; i++) {
+		if (cols->col[i])
+			hdr[2] |= 1UL << i;
+	}
+
+	if (write(context, hdr, sizeof(hdr)))
+		return INV_ERROR_TRANSPORT;
+
+	for (i = 0; i < INV_ICM20948_FIFO_COL_MAX; i++) {
+		if (cols->col[i] && cols->nb_rows &&
+				write(context, cols->col[i], cols->nb_rows * fifo_column_width[i]))
+			return INV_ERROR_TRANSPORT;
+	}
+
+	return 0;
+}
+
+/** @} */
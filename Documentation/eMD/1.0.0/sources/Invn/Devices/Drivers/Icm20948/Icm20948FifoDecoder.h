@@ -0,0 +1,146 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_FIFO_DECODER_H__
+#define INV_ICM20948_FIFO_DECODER_H__
+
+/** @defgroup	icm20948_fifo_decoder	fifo_decoder
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include "Icm20948CompassComp.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Number of consecutive valid packets required to resynchronize on a FIFO stream
+ */
+#ifndef INV_ICM20948_FIFO_DECODER_SYNC_PACKETS
+#define INV_ICM20948_FIFO_DECODER_SYNC_PACKETS 4
+#endif
+
+/** @brief Decoded columns, one row per DMP FIFO packet
+ *  Fields a packet does not hold (see header column) are set to 0.
+ */
+enum inv_icm20948_fifo_column {
+	INV_ICM20948_FIFO_COL_OFFSET = 0, /**< uint32_t: packet offset in the stream */
+	INV_ICM20948_FIFO_COL_HEADER,     /**< uint16_t[2]: header and header2 */
+	INV_ICM20948_FIFO_COL_ACCEL,      /**< float[3]: accel in g, body frame */
+	INV_ICM20948_FIFO_COL_GYRO,       /**< float[3]: uncalibrated gyro in dps, body frame */
+	INV_ICM20948_FIFO_COL_GYRO_BIAS,  /**< float[3]: gyro bias in dps, body frame */
+	INV_ICM20948_FIFO_COL_COMPASS,    /**< float[3]: uncalibrated compass in uT */
+	INV_ICM20948_FIFO_COL_GRV,        /**< float[4]: game rotation vector, w x y z */
+	INV_ICM20948_FIFO_COL_RV,         /**< float[4]: rotation vector, w x y z */
+	INV_ICM20948_FIFO_COL_GMRV,       /**< float[4]: geomagnetic rotation vector, w x y z */
+	INV_ICM20948_FIFO_COL_MAX
+};
+
+/** @brief Magic number starting each row group written by inv_icm20948_fifo_columns_write()
+ *  Also tells byte order of the file, columns are written in host byte order.
+ */
+#define INV_ICM20948_FIFO_COLUMNS_MAGIC  0x31434649	/**< "IFC1" */
+
+/** @brief Decoder settings, taken from driver states once
+ *  Decoding only reads them and driver mounting matrix, so one decoder can be shared by
+ *  several threads as long as the driver is not reconfigured meanwhile.
+ */
+struct inv_icm20948_fifo_decoder {
+	struct inv_icm20948 * s;   /**< mounting matrix */
+	struct inv_icm20948_compass_comp compass; /**< compass soft iron matrix, uncalibrated output */
+	float accel_scale;         /**< DMP unit to g */
+	float gyro_scale;          /**< DMP raw gyro (Q15) to dps */
+	float gyro_bias_scale;     /**< DMP gyro bias (Q20) to dps */
+};
+
+/** @brief Column buffers to be filled by inv_icm20948_fifo_decoder_run()
+ */
+struct inv_icm20948_fifo_columns {
+	void *   col[INV_ICM20948_FIFO_COL_MAX]; /**< buffers of capacity rows, NULL if column is not wanted */
+	uint32_t capacity;                       /**< number of rows buffers can hold */
+	uint32_t nb_rows;                        /**< rows filled by last run */
+	uint32_t next;                           /**< stream offset where last run stopped */
+	uint32_t resyncs;                        /**< times packet alignment was lost (cumulated) */
+	uint32_t skipped;                        /**< bytes skipped to resynchronize (cumulated) */
+};
+
+/** @brief Size in bytes of a row of a column
+ */
+unsigned INV_EXPORT inv_icm20948_fifo_column_width(int column);
+
+/** @brief Setup decoder with current full scale ranges and matrices of the driver
+ *  @param[out] d  decoder
+ *  @param[in]  s  driver states configured as when the stream was recorded
+ */
+void INV_EXPORT inv_icm20948_fifo_decoder_init(struct inv_icm20948_fifo_decoder * d, struct inv_icm20948 * s);
+
+/** @brief Return first offset at or after pos where decoding can start
+ *  That is where INV_ICM20948_FIFO_DECODER_SYNC_PACKETS consecutive packets have valid headers
+ *  (or valid packets lead to the end of the stream).
+ *  @return     sync offset, len if there is none
+ */
+uint32_t INV_EXPORT inv_icm20948_fifo_decoder_sync(const uint8_t * data, uint32_t len, uint32_t pos);
+
+/** @brief Split a stream into chunks that can be decoded independently
+ *  Chunk i holds packets starting in [bounds[i], bounds[i+1]). Chunks have about the
+ *  same size and start on sync offsets, except the first one which starts at 0.
+ *  A sync offset may still fall inside a packet. Once chunk i is decoded, if cols->next
+ *  differs from bounds[i+1], chunk i+1 must be decoded again from cols->next: output is
+ *  then the same as decoding the whole stream at once.
+ *  @param[in]  data       FIFO stream (eg: a memory mapped file)
+ *  @param[in]  len        stream size
+ *  @param[in]  nb_chunks  number of chunks
+ *  @param[out] bounds     nb_chunks + 1 offsets (empty chunks have equal bounds)
+ */
+void INV_EXPORT inv_icm20948_fifo_decoder_split(const uint8_t * data, uint32_t len, unsigned nb_chunks, uint32_t * bounds);
+
+/** @brief Decode packets starting in [begin, end) into columns
+ *  On an invalid packet, decoding resumes from next sync offset. Stops when cols is full
+ *  or when a packet goes past the end of the stream: call again from cols->next.
+ *  Only reads data, d and driver mounting matrix: chunks can be decoded in parallel.
+ *  @param[in]  d      decoder
+ *  @param[in]  data   FIFO stream
+ *  @param[in]  len    stream size
+ *  @param[in]  begin  offset of first packet
+ *  @param[in]  end    packets starting at or after end are not decoded
+ *  @param[inout] cols column buffers, nb_rows and next are updated
+ *  @return     number of rows decoded
+ */
+uint32_t INV_EXPORT inv_icm20948_fifo_decoder_run(const struct inv_icm20948_fifo_decoder * d,
+		const uint8_t * data, uint32_t len, uint32_t begin, uint32_t end, struct inv_icm20948_fifo_columns * cols);
+
+/** @brief Append decoded rows to a columnar file as one row group
+ *  Row group: magic(4) nb_rows(4) column mask(4) then, for each column in mask, in
+ *  column order, nb_rows rows of inv_icm20948_fifo_column_width() bytes.
+ *  @param[in]  cols     columns, as filled by inv_icm20948_fifo_decoder_run()
+ *  @param[in]  write    append callback, returns 0 on success
+ *  @param[in]  context  passed to write
+ *  @return     0 on success, INV_ERROR_TRANSPORT if write failed
+ */
+int INV_EXPORT inv_icm20948_fifo_columns_write(const struct inv_icm20948_fifo_columns * cols,
+		int (*write)(void * context, const void * buf, uint32_t len), void * context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_FIFO_DECODER_H__
+
+/** @} */
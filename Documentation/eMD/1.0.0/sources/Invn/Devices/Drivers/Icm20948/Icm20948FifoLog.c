@@ -0,0 +1,474 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948FifoLog.h"
+
+#include "Icm20948Defs.h"
+
+/* largest record payload a block can hold */
+#define FIFO_LOG_MAX_PAYLOAD  (INV_ICM20948_FIFO_LOG_BLOCK_SIZE - INV_ICM20948_FIFO_LOG_BLOCK_HDR_SZ - INV_ICM20948_FIFO_LOG_REC_HDR_SZ)
+
+static void put_le16(uint8_t * p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t * p, uint32_t v)
+{
+	put_le16(p, (uint16_t)v);
+	put_le16(&p[2], (uint16_t)(v >> 16));
+}
+
+static void put_le64(uint8_t * p, uint64_t v)
+{
+	put_le32(p, (uint32_t)v);
+	put_le32(&p[4], (uint32_t)(v >> 32));
+}
+
+static uint16_t get_le16(const uint8_t * p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_le32(const uint8_t * p)
+{
+	return get_le16(p) | ((uint32_t)get_le16(&p[2]) << 16);
+}
+
+static uint64_t get_le64(const uint8_t * p)
+{
+	return get_le32(p) | ((uint64_t)get_le32(&p[4]) << 32);
+}
+
+/** Pad current block with END records and hand it over to the write callback */
+static void fifo_log_flush(struct inv_icm20948_fifo_log * log)
+{
+	if (log->used == 0)
+		return;
+
+	memset(&log->block[log->used], INV_ICM20948_FIFO_LOG_END, INV_ICM20948_FIFO_LOG_BLOCK_SIZE - log->used);
+	if (log->write(log->context, log->block))
+		log->dropped++;
+	log->seq++;
+	log->used = 0;
+}
+
+/** Reserve a record in current block, starting a new one if needed, and return its payload */
+static uint8_t * fifo_log_alloc(struct inv_icm20948_fifo_log * log, uint8_t type, uint16_t len)
+{
+	uint8_t * p;
+
+	if (log->used + INV_ICM20948_FIFO_LOG_REC_HDR_SZ + len > INV_ICM20948_FIFO_LOG_BLOCK_SIZE)
+		fifo_log_flush(log);
+
+	if (log->used == 0) {
+		put_le32(log->block, INV_ICM20948_FIFO_LOG_MAGIC);
+		put_le32(&log->block[4], log->seq);
+		put_le64(&log->block[8], log->last_ts);
+		log->used = INV_ICM20948_FIFO_LOG_BLOCK_HDR_SZ;
+	}
+
+	p = &log->block[log->used];
+	p[0] = type;
+	put_le16(&p[1], len);
+	log->used += INV_ICM20948_FIFO_LOG_REC_HDR_SZ + len;
+
+	return &p[INV_ICM20948_FIFO_LOG_REC_HDR_SZ];
+}
+
+int inv_icm20948_fifo_log_start(struct inv_icm20948 * s, struct inv_icm20948_fifo_log * log,
+		inv_icm20948_fifo_log_write_t write, void * context)
+{
+	uint8_t * p;
+
+	if (!log || !write)
+		return INV_ERROR_BAD_ARG;
+
+	if (s->fifo_log)
+		inv_icm20948_fifo_log_stop(s);
+
+	memset(log, 0, sizeof(*log));
+	log->write = write;
+	log->context = context;
+
+	p = fifo_log_alloc(log, INV_ICM20948_FIFO_LOG_START, 6);
+	put_le16(p, (uint16_t)inv_icm20948_serif_max_read(&s->serif));
+	put_le16(&p[2], (uint16_t)inv_icm20948_serif_max_write(&s->serif));
+	p[4] = inv_icm20948_serif_is_spi(&s->serif) ? 1 : 0;
+	p[5] = inv_icm20948_serif_can_submit(&s->serif) ? 1 : 0;
+
+	s->fifo_log = log;
+
+	return 0;
+}
+
+int inv_icm20948_fifo_log_stop(struct inv_icm20948 * s)
+{
+	struct inv_icm20948_fifo_log * log = s->fifo_log;
+
+	if (!log)
+		return 0;
+
+	s->fifo_log = 0;
+	fifo_log_flush(log);
+
+	return log->dropped ? INV_ERROR_TRANSPORT : 0;
+}
+
+void inv_icm20948_fifo_log_irq(struct inv_icm20948 * s, uint16_t int_status, uint64_t timestamp)
+{
+	uint8_t * p = fifo_log_alloc(s->fifo_log, INV_ICM20948_FIFO_LOG_IRQ, 10);
+
+	put_le16(p, int_status);
+	put_le64(&p[2], timestamp);
+	s->fifo_log->last_ts = timestamp;
+}
+
+void inv_icm20948_fifo_log_fifo(struct inv_icm20948 * s, int type, uint16_t count,
+		const uint8_t * data, uint16_t len)
+{
+	const uint16_t hdr = (type == INV_ICM20948_FIFO_LOG_FIFO) ? 2 : 0;
+	uint8_t * p;
+
+	if (len > FIFO_LOG_MAX_PAYLOAD - hdr)
+		len = FIFO_LOG_MAX_PAYLOAD - hdr;
+
+	p = fifo_log_alloc(s->fifo_log, (uint8_t)type, hdr + len);
+	if (hdr)
+		put_le16(p, count);
+	if (len)
+		memcpy(&p[hdr], data, len);
+}
+
+void inv_icm20948_fifo_log_config(struct inv_icm20948 * s, int config, uint8_t sensor, uint32_t value)
+{
+	uint8_t * p = fifo_log_alloc(s->fifo_log, INV_ICM20948_FIFO_LOG_CONFIG, 6);
+
+	p[0] = (uint8_t)config;
+	p[1] = sensor;
+	put_le32(&p[2], value);
+}
+
+void inv_icm20948_fifo_log_mem(struct inv_icm20948 * s, uint16_t addr, const uint8_t * data, uint16_t len)
+{
+	uint8_t * p;
+
+	if (len > FIFO_LOG_MAX_PAYLOAD - 2)
+		len = FIFO_LOG_MAX_PAYLOAD - 2;
+
+	p = fifo_log_alloc(s->fifo_log, INV_ICM20948_FIFO_LOG_MEM, 2 + len);
+	put_le16(p, addr);
+	memcpy(&p[2], data, len);
+}
+
+/** Return payload of first record at or after *pos, setting *pos to its start, NULL at end of log */
+static const uint8_t * replay_peek(const struct inv_icm20948_fifo_replay * r, uint32_t * pos,
+		uint8_t * type, uint16_t * len)
+{
+	for (;;) {
+		const uint32_t block_end = (*pos / INV_ICM20948_FIFO_LOG_BLOCK_SIZE + 1) * INV_ICM20948_FIFO_LOG_BLOCK_SIZE;
+		const uint8_t * p;
+
+		if (*pos % INV_ICM20948_FIFO_LOG_BLOCK_SIZE == 0) {
+			if (*pos + INV_ICM20948_FIFO_LOG_BLOCK_HDR_SZ > r->size)
+				return 0;
+			if (get_le32(&r->log[*pos]) != INV_ICM20948_FIFO_LOG_MAGIC) {
+				*pos = block_end;
+				continue;
+			}
+			*pos += INV_ICM20948_FIFO_LOG_BLOCK_HDR_SZ;
+		}
+
+		p = &r->log[*pos];
+		if (*pos + INV_ICM20948_FIFO_LOG_REC_HDR_SZ > block_end || *pos + INV_ICM20948_FIFO_LOG_REC_HDR_SZ > r->size ||
+				p[0] == INV_ICM20948_FIFO_LOG_END) {
+			*pos = block_end;
+			continue;
+		}
+
+		*type = p[0];
+		*len = get_le16(&p[1]);
+		if (*pos + INV_ICM20948_FIFO_LOG_REC_HDR_SZ + *len > r->size)
+			return 0;
+		/* corrupted record, resume from next block */
+		if (*pos + INV_ICM20948_FIFO_LOG_REC_HDR_SZ + *len > block_end) {
+			*pos = block_end;
+			continue;
+		}
+
+		return &p[INV_ICM20948_FIFO_LOG_REC_HDR_SZ];
+	}
+}
+
+static void replay_fifo_count(struct inv_icm20948_fifo_replay * r)
+{
+	uint32_t pos = r->pos;
+	uint8_t type;
+	uint16_t len;
+	const uint8_t * p = replay_peek(r, &pos, &type, &len);
+
+	r->count = 0;
+	r->data_len = 0;
+
+	if (r->fifo_reset)
+		return;
+
+	/* all counts read outside of a FIFO reset are logged: replay diverged from recording (or log is
+	over), report an overflow for the driver to reset the FIFO rather than wait for more data */
+	if (!p || type != INV_ICM20948_FIFO_LOG_FIFO || len < 2) {
+		r->count = HARDWARE_FIFO_SIZE;
+		return;
+	}
+
+	r->pos = pos + INV_ICM20948_FIFO_LOG_REC_HDR_SZ + len;
+	r->count = get_le16(p);
+	r->data = &p[2];
+	r->data_len = len - 2;
+}
+
+static void replay_fifo_read(struct inv_icm20948_fifo_replay * r, uint8_t * buf, uint32_t len)
+{
+	const uint32_t n = (len < r->data_len) ? len : r->data_len;
+
+	memcpy(buf, r->data, n);
+	r->data += n;
+	r->data_len -= n;
+}
+
+/* DMP memory reads are logged once over: look ahead for the record holding the bytes read,
+up to the next interrupt or configuration change */
+static void replay_mem_read(struct inv_icm20948_fifo_replay * r, uint8_t * buf, uint32_t len)
+{
+	uint32_t pos = (r->mem_end > r->pos) ? r->mem_end : r->pos;
+	const uint8_t * p;
+	uint8_t type;
+	uint16_t rec_len;
+
+	while ((p = replay_peek(r, &pos, &type, &rec_len)) != 0) {
+		if (type == INV_ICM20948_FIFO_LOG_IRQ || type == INV_ICM20948_FIFO_LOG_CONFIG)
+			break;
+		if (type == INV_ICM20948_FIFO_LOG_MEM && rec_len >= 2) {
+			const uint16_t addr = get_le16(p);
+			const uint32_t size = rec_len - 2;
+
+			if (r->mem_addr >= addr && r->mem_addr + len <= addr + size) {
+				memcpy(buf, &p[2 + r->mem_addr - addr], len);
+				/* reads are split in serial transactions: keep record until its last byte is read */
+				r->mem_end = (r->mem_addr + len == addr + size) ?
+						pos + INV_ICM20948_FIFO_LOG_REC_HDR_SZ + rec_len : pos;
+				break;
+			}
+		}
+		pos += INV_ICM20948_FIFO_LOG_REC_HDR_SZ + rec_len;
+	}
+	r->mem_addr += len;
+}
+
+static int replay_read_reg(void * context, uint8_t reg, uint8_t * buf, uint32_t len)
+{
+	struct inv_icm20948_fifo_replay * r = (struct inv_icm20948_fifo_replay *)context;
+
+	memset(buf, 0, len);
+
+	if (reg == REG_BANK_SEL) {
+		buf[0] = r->bank << 4;
+		return 0;
+	}
+	if (r->bank != 0)
+		return 0;
+
+	switch (reg) {
+	case REG_INT_STATUS:
+		buf[0] = (uint8_t)r->int_status;
+		break;
+	case REG_DMP_INT_STATUS:
+		buf[0] = (uint8_t)(r->int_status >> 8);
+		break;
+	case REG_FIFO_COUNT_H:
+		replay_fifo_count(r);
+		buf[0] = (uint8_t)(r->count >> 8);
+		if (len > 1)
+			buf[1] = (uint8_t)r->count;
+		break;
+	case REG_FIFO_R_W:
+		replay_fifo_read(r, buf, len);
+		break;
+	case REG_MEM_R_W:
+		replay_mem_read(r, buf, len);
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static int replay_write_reg(void * context, uint8_t reg, const uint8_t * buf, uint32_t len)
+{
+	struct inv_icm20948_fifo_replay * r = (struct inv_icm20948_fifo_replay *)context;
+
+	(void)len;
+
+	if (reg == REG_BANK_SEL) {
+		r->bank = (buf[0] >> 4) & 0x3;
+	} else if (r->bank == 0 && reg == REG_MEM_BANK_SEL) {
+		r->mem_addr = (uint16_t)((buf[0] << 8) | (r->mem_addr & 0xff));
+	} else if (r->bank == 0 && reg == REG_MEM_START_ADDR) {
+		r->mem_addr = (uint16_t)((r->mem_addr & 0xff00) | buf[0]);
+	} else if (r->bank == 0 && reg == REG_FIFO_RST) {
+		/* FIFO is empty until reset is over (DMP enabled back) */
+		r->fifo_reset = 1;
+		r->data_len = 0;
+	} else if (r->bank == 0 && reg == REG_USER_CTRL) {
+		r->fifo_reset = 0;
+	}
+
+	return 0;
+}
+
+/* Asynchronous FIFO refill was logged once over, after next interrupt: data is looked up ahead */
+static int replay_submit(void * context, const struct inv_icm20948_serif_xfer * xfers,
+		uint32_t count, inv_icm20948_serif_done_t done, void * cookie)
+{
+	struct inv_icm20948_fifo_replay * r = (struct inv_icm20948_fifo_replay *)context;
+	uint32_t pos = (r->prefetch_end > r->pos) ? r->prefetch_end : r->pos;
+	const uint8_t * p;
+	uint8_t type;
+	uint16_t len;
+	uint32_t i;
+
+	r->data_len = 0;
+	while ((p = replay_peek(r, &pos, &type, &len)) != 0) {
+		pos += INV_ICM20948_FIFO_LOG_REC_HDR_SZ + len;
+		if (type == INV_ICM20948_FIFO_LOG_PREFETCH) {
+			r->data = p;
+			r->data_len = len;
+			r->prefetch_end = pos;
+			break;
+		}
+		/* refill of this FIFO count was not logged */
+		if (type == INV_ICM20948_FIFO_LOG_FIFO)
+			break;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (xfers[i].write)
+			replay_write_reg(r, xfers[i].reg, xfers[i].buf, xfers[i].len);
+		else
+			replay_read_reg(r, xfers[i].reg, xfers[i].buf, xfers[i].len);
+	}
+	r->data_len = 0;
+
+	done(cookie, 0);
+
+	return 0;
+}
+
+int inv_icm20948_fifo_replay_init(struct inv_icm20948_fifo_replay * r,
+		const uint8_t * log, uint32_t size, struct inv_icm20948_serif * serif)
+{
+	const uint8_t * p;
+	uint8_t type;
+	uint16_t len;
+
+	memset(r, 0, sizeof(*r));
+	r->log = log;
+	r->size = size;
+
+	p = replay_peek(r, &r->pos, &type, &len);
+	if (!p || type != INV_ICM20948_FIFO_LOG_START || len < 6)
+		return INV_ERROR_BAD_ARG;
+	r->pos += INV_ICM20948_FIFO_LOG_REC_HDR_SZ + len;
+
+	memset(serif, 0, sizeof(*serif));
+	serif->context   = r;
+	serif->read_reg  = replay_read_reg;
+	serif->write_reg = replay_write_reg;
+	serif->submit    = p[5] ? replay_submit : 0;
+	serif->max_read  = get_le16(p);
+	serif->max_write = get_le16(&p[2]);
+	serif->is_spi    = p[4];
+
+	return 0;
+}
+
+int inv_icm20948_fifo_replay_seek(struct inv_icm20948_fifo_replay * r, uint64_t timestamp)
+{
+	uint32_t lo = 0, hi = r->size / INV_ICM20948_FIFO_LOG_BLOCK_SIZE;
+
+	/* first block whose header timestamp is not lower than timestamp */
+	while (lo < hi) {
+		const uint32_t mid = (lo + hi) / 2;
+
+		if (get_le64(&r->log[mid * INV_ICM20948_FIFO_LOG_BLOCK_SIZE + 8]) < timestamp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo * INV_ICM20948_FIFO_LOG_BLOCK_SIZE >= r->size)
+		return INV_ERROR_SIZE;
+
+	r->pos = lo * INV_ICM20948_FIFO_LOG_BLOCK_SIZE;
+	r->prefetch_end = 0;
+	r->mem_end = 0;
+	r->data_len = 0;
+
+	return 0;
+}
+
+int inv_icm20948_fifo_replay_step(struct inv_icm20948 * s, struct inv_icm20948_fifo_replay * r, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg))
+{
+	const uint8_t * p;
+	uint8_t type;
+	uint16_t len;
+
+	while ((p = replay_peek(r, &r->pos, &type, &len)) != 0) {
+		r->pos += INV_ICM20948_FIFO_LOG_REC_HDR_SZ + len;
+
+		switch (type) {
+		case INV_ICM20948_FIFO_LOG_CONFIG:
+			if (len < 6)
+				return INV_ERROR;
+			/* result is the one met while recording */
+			if (p[0] == INV_ICM20948_FIFO_LOG_CONFIG_ENABLE)
+				inv_icm20948_enable_sensor(s, (enum inv_icm20948_sensor)p[1], (inv_bool_t)get_le32(&p[2]));
+			else if (p[0] == INV_ICM20948_FIFO_LOG_CONFIG_PERIOD)
+				inv_icm20948_set_sensor_period(s, (enum inv_icm20948_sensor)p[1], get_le32(&p[2]));
+			break;
+		case INV_ICM20948_FIFO_LOG_IRQ:
+			if (len < 10)
+				return INV_ERROR;
+			r->int_status = get_le16(p);
+			r->timestamp = get_le64(&p[2]);
+			r->data_len = 0;
+			inv_icm20948_poll_sensor(s, context, handler);
+			r->int_status = 0;
+			return 1;
+		default:
+			/* START, DMP memory or FIFO contents not read back */
+			break;
+		}
+	}
+
+	return 0;
+}
+
+uint64_t inv_icm20948_fifo_replay_get_time_us(const struct inv_icm20948_fifo_replay * r)
+{
+	return r->timestamp;
+}
+
+/** @} */
@@ -0,0 +1,188 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_FIFO_LOG_H__
+#define INV_ICM20948_FIFO_LOG_H__
+
+/** @defgroup	icm20948_fifo_log	fifo_log
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include "Icm20948Setup.h"
+#include "Icm20948Serif.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Size of a log block in bytes
+ *  A log is a sequence of fixed size blocks, so that block n starts at offset
+ *  n * INV_ICM20948_FIFO_LOG_BLOCK_SIZE. Records never cross a block boundary.
+ *  Must hold a block header and a full hardware FIFO record.
+ */
+#ifndef INV_ICM20948_FIFO_LOG_BLOCK_SIZE
+#define INV_ICM20948_FIFO_LOG_BLOCK_SIZE     2048
+#endif
+
+/** @brief Block header: magic(4) seq(4) ts(8)
+ *  seq increments from 0, ts is the last interrupt timestamp logged before the block
+ *  (non decreasing, used to seek in the log).
+ */
+#define INV_ICM20948_FIFO_LOG_MAGIC          0x314C4649	/**< "IFL1" */
+#define INV_ICM20948_FIFO_LOG_BLOCK_HDR_SZ   16
+
+/** @brief Record header: type(1) len(2) followed by len bytes of payload
+ *  All fields are little endian. Space left at the end of a block is filled with 0
+ *  (INV_ICM20948_FIFO_LOG_END).
+ */
+#define INV_ICM20948_FIFO_LOG_REC_HDR_SZ     3
+
+/** @brief Log record types
+ */
+enum inv_icm20948_fifo_log_type {
+	INV_ICM20948_FIFO_LOG_END      = 0, /**< no more record in this block */
+	INV_ICM20948_FIFO_LOG_START    = 1, /**< max_read(2) max_write(2) is_spi(1) can_submit(1): serif used by the driver */
+	INV_ICM20948_FIFO_LOG_IRQ      = 2, /**< int_status(2) timestamp(8): DMP interrupt handled by inv_icm20948_poll_sensor() */
+	INV_ICM20948_FIFO_LOG_FIFO     = 3, /**< count(2) data[len-2]: FIFO_COUNT read (even 0) and bytes read from FIFO right after */
+	INV_ICM20948_FIFO_LOG_PREFETCH = 4, /**< data[len]: bytes read by asynchronous FIFO refill, part of last count */
+	INV_ICM20948_FIFO_LOG_CONFIG   = 5, /**< config(1) sensor(1) value(4): see inv_icm20948_fifo_log_config */
+	INV_ICM20948_FIFO_LOG_MEM      = 6, /**< addr(2) data[len-2]: DMP memory read (eg: compass bias for UNCAL mag) */
+};
+
+/** @brief Configuration changes replayed through driver API
+ */
+enum inv_icm20948_fifo_log_config {
+	INV_ICM20948_FIFO_LOG_CONFIG_ENABLE = 0, /**< inv_icm20948_enable_sensor() */
+	INV_ICM20948_FIFO_LOG_CONFIG_PERIOD = 1, /**< inv_icm20948_set_sensor_period() */
+};
+
+/** @brief Write a complete block to storage
+ *  @param[in]  context  value given to inv_icm20948_fifo_log_start()
+ *  @param[in]  block    INV_ICM20948_FIFO_LOG_BLOCK_SIZE bytes to append to the log
+ *  @return     0 on success, non-zero if the block was lost
+ */
+typedef int (*inv_icm20948_fifo_log_write_t)(void * context, const uint8_t * block);
+
+/** @brief Recorder states
+ *  Fields are private to the driver.
+ */
+struct inv_icm20948_fifo_log {
+	inv_icm20948_fifo_log_write_t write;
+	void *   context;
+	uint32_t seq;                                     /**< sequence number of current block */
+	uint32_t dropped;                                 /**< blocks the write callback failed to store */
+	uint16_t used;                                    /**< bytes used in current block */
+	uint64_t last_ts;                                 /**< last interrupt timestamp logged */
+	uint8_t  block[INV_ICM20948_FIFO_LOG_BLOCK_SIZE]; /**< block being filled */
+};
+
+/** @brief Start recording what the driver reads from the FIFO
+ *  Interrupts handled by inv_icm20948_poll_sensor() along with their timestamp, FIFO
+ *  contents and sensor configuration changes are appended to the log until
+ *  inv_icm20948_fifo_log_stop() is called. Start recording before sensors are
+ *  enabled for the log to be replayed from scratch.
+ *  @param[in]  s        driver states
+ *  @param[out] log      recorder states, must remain valid until recording is stopped
+ *  @param[in]  write    block write callback, called from inv_icm20948_poll_sensor() context
+ *  @param[in]  context  passed to write
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_fifo_log_start(struct inv_icm20948 * s, struct inv_icm20948_fifo_log * log,
+		inv_icm20948_fifo_log_write_t write, void * context);
+
+/** @brief Write last (partial) block and stop recording
+ *  @param[in]  s    driver states
+ *  @return     0 on success, INV_ERROR_TRANSPORT if some blocks could not be written
+ */
+int INV_EXPORT inv_icm20948_fifo_log_stop(struct inv_icm20948 * s);
+
+/** @brief Hooks called by the driver while recording
+ */
+void INV_EXPORT inv_icm20948_fifo_log_irq(struct inv_icm20948 * s, uint16_t int_status, uint64_t timestamp);
+void INV_EXPORT inv_icm20948_fifo_log_fifo(struct inv_icm20948 * s, int type, uint16_t count,
+		const uint8_t * data, uint16_t len);
+void INV_EXPORT inv_icm20948_fifo_log_config(struct inv_icm20948 * s, int config, uint8_t sensor, uint32_t value);
+void INV_EXPORT inv_icm20948_fifo_log_mem(struct inv_icm20948 * s, uint16_t addr, const uint8_t * data, uint16_t len);
+
+/** @brief Replay engine states
+ *  Fields are private to the driver.
+ */
+struct inv_icm20948_fifo_replay {
+	const uint8_t * log;
+	uint32_t size;
+	uint32_t pos;            /**< offset of next record */
+	const uint8_t * data;    /**< FIFO bytes of current record not read yet */
+	uint16_t data_len;
+	uint16_t count;          /**< FIFO count left to be read */
+	uint16_t int_status;     /**< current interrupt */
+	uint64_t timestamp;
+	uint32_t prefetch_end;   /**< offset after last refill record looked up ahead */
+	uint32_t mem_end;        /**< offset of first DMP memory record not fully read back */
+	uint16_t mem_addr;       /**< DMP memory address selected by the driver */
+	uint8_t  bank;           /**< bank selected by the driver */
+	uint8_t  fifo_reset;     /**< FIFO reset in progress */
+};
+
+/** @brief Prepare replay of a log held in memory
+ *  serif is filled with a replay serial interface, to be given to inv_icm20948_reset_states()
+ *  instead of the bus one, with the same capabilities as the recorded one. This serif returns
+ *  logged interrupt status, FIFO contents and DMP memory reads, other registers and DMP
+ *  memory not read while recording read as 0 and writes are dropped. It never waits. A FIFO count read that was not logged (replay diverged from
+ *  recording or log is over) reads as a full FIFO, for the driver to reset it.
+ *  @param[out] r      replay states
+ *  @param[in]  log    log contents, as written block by block by the recorder
+ *  @param[in]  size   log size in bytes
+ *  @param[out] serif  serial interface for the driver
+ *  @return     0 on success, INV_ERROR_BAD_ARG if log does not start with a valid block
+ */
+int INV_EXPORT inv_icm20948_fifo_replay_init(struct inv_icm20948_fifo_replay * r,
+		const uint8_t * log, uint32_t size, struct inv_icm20948_serif * serif);
+
+/** @brief Move to the first block logged at or after timestamp
+ *  Blocks are located by binary search on their header. Driver states are not
+ *  restored: FIFO decoding and timestamps restart from that point.
+ *  @return     0 on success, INV_ERROR_SIZE if timestamp is past the end of the log
+ */
+int INV_EXPORT inv_icm20948_fifo_replay_seek(struct inv_icm20948_fifo_replay * r, uint64_t timestamp);
+
+/** @brief Replay log up to next interrupt
+ *  Logged configuration changes are applied, then inv_icm20948_poll_sensor() is called
+ *  with logged interrupt status and FIFO contents. inv_icm20948_get_time_us() must return
+ *  inv_icm20948_fifo_replay_get_time_us() for timestamps to be those of the recording.
+ *  @param[in]  s        driver states, set up with serif from inv_icm20948_fifo_replay_init()
+ *  @param[in]  r        replay states
+ *  @param[in]  context  passed to handler
+ *  @param[in]  handler  same handler as for inv_icm20948_poll_sensor()
+ *  @return     1 if an interrupt was replayed, 0 at end of log, negative value on error
+ */
+int INV_EXPORT inv_icm20948_fifo_replay_step(struct inv_icm20948 * s, struct inv_icm20948_fifo_replay * r, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg));
+
+/** @brief Return timestamp of interrupt being replayed
+ */
+uint64_t INV_EXPORT inv_icm20948_fifo_replay_get_time_us(const struct inv_icm20948_fifo_replay * r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_FIFO_LOG_H__
+
+/** @} */
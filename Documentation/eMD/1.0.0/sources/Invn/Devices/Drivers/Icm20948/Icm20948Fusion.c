@@ -0,0 +1,455 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948Fusion.h"
+
+#include "Icm20948DataConverter.h"
+
+#include <math.h>
+
+/*
+ * Minimal vector layer: lanes are processed FUSION_VEC_LANES at a time with the
+ * widest instruction set the compiler targets, or one at a time otherwise.
+ */
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FUSION_VEC_LANES 8
+typedef __m256 fvec;
+static inline fvec v_ld(const float * p)          { return _mm256_loadu_ps(p); }
+static inline void v_st(float * p, fvec a)        { _mm256_storeu_ps(p, a); }
+static inline fvec v_set(float x)                 { return _mm256_set1_ps(x); }
+static inline fvec v_add(fvec a, fvec b)          { return _mm256_add_ps(a, b); }
+static inline fvec v_sub(fvec a, fvec b)          { return _mm256_sub_ps(a, b); }
+static inline fvec v_mul(fvec a, fvec b)          { return _mm256_mul_ps(a, b); }
+static inline fvec v_div(fvec a, fvec b)          { return _mm256_div_ps(a, b); }
+static inline fvec v_sqrt(fvec a)                 { return _mm256_sqrt_ps(a); }
+/* x where c > 0, 0 elsewhere */
+static inline fvec v_if_pos(fvec c, fvec x)       { return _mm256_and_ps(_mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_GT_OQ), x); }
+/* -x where c < 0, x elsewhere */
+static inline fvec v_sign_of(fvec c, fvec x)      { return _mm256_xor_ps(x, _mm256_and_ps(c, _mm256_set1_ps(-0.f))); }
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FUSION_VEC_LANES 4
+typedef __m128 fvec;
+static inline fvec v_ld(const float * p)          { return _mm_loadu_ps(p); }
+static inline void v_st(float * p, fvec a)        { _mm_storeu_ps(p, a); }
+static inline fvec v_set(float x)                 { return _mm_set1_ps(x); }
+static inline fvec v_add(fvec a, fvec b)          { return _mm_add_ps(a, b); }
+static inline fvec v_sub(fvec a, fvec b)          { return _mm_sub_ps(a, b); }
+static inline fvec v_mul(fvec a, fvec b)          { return _mm_mul_ps(a, b); }
+static inline fvec v_div(fvec a, fvec b)          { return _mm_div_ps(a, b); }
+static inline fvec v_sqrt(fvec a)                 { return _mm_sqrt_ps(a); }
+static inline fvec v_if_pos(fvec c, fvec x)       { return _mm_and_ps(_mm_cmpgt_ps(c, _mm_setzero_ps()), x); }
+static inline fvec v_sign_of(fvec c, fvec x)      { return _mm_xor_ps(x, _mm_and_ps(c, _mm_set1_ps(-0.f))); }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define FUSION_VEC_LANES 4
+typedef float32x4_t fvec;
+static inline fvec v_ld(const float * p)          { return vld1q_f32(p); }
+static inline void v_st(float * p, fvec a)        { vst1q_f32(p, a); }
+static inline fvec v_set(float x)                 { return vdupq_n_f32(x); }
+static inline fvec v_add(fvec a, fvec b)          { return vaddq_f32(a, b); }
+static inline fvec v_sub(fvec a, fvec b)          { return vsubq_f32(a, b); }
+static inline fvec v_mul(fvec a, fvec b)          { return vmulq_f32(a, b); }
+static inline fvec v_div(fvec a, fvec b)          { return vdivq_f32(a, b); }
+static inline fvec v_sqrt(fvec a)                 { return vsqrtq_f32(a); }
+static inline fvec v_if_pos(fvec c, fvec x)       { return vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(c, vdupq_n_f32(0.f)), vreinterpretq_u32_f32(x))); }
+static inline fvec v_sign_of(fvec c, fvec x)      { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(x),
+		vandq_u32(vreinterpretq_u32_f32(c), vdupq_n_u32(0x80000000U)))); }
+#else
+#define FUSION_VEC_LANES 1
+typedef float fvec;
+static inline fvec v_ld(const float * p)          { return *p; }
+static inline void v_st(float * p, fvec a)        { *p = a; }
+static inline fvec v_set(float x)                 { return x; }
+static inline fvec v_add(fvec a, fvec b)          { return a + b; }
+static inline fvec v_sub(fvec a, fvec b)          { return a - b; }
+static inline fvec v_mul(fvec a, fvec b)          { return a * b; }
+static inline fvec v_div(fvec a, fvec b)          { return a / b; }
+static inline fvec v_sqrt(fvec a)                 { return sqrtf(a); }
+static inline fvec v_if_pos(fvec c, fvec x)       { return (c > 0.f) ? x : 0.f; }
+static inline fvec v_sign_of(fvec c, fvec x)      { return signbit(c) ? -x : x; }
+#endif
+
+#if (INV_ICM20948_FUSION_MAX_LANES % INV_ICM20948_FUSION_LANE_ALIGN) != 0
+#error "INV_ICM20948_FUSION_MAX_LANES must be a multiple of INV_ICM20948_FUSION_LANE_ALIGN"
+#endif
+
+#define FUSION_DEG_TO_RAD   ((float)M_PI / 180.f)
+
+static const float fusion_default_gain[2][2] = {
+	/* GRV and RV, GMRV */
+	{ 1.0f, 40.0f },  /* Mahony Kp */
+	{ 0.1f, 2.0f },   /* Madgwick beta */
+};
+
+/* One sample of a group of lanes */
+struct fusion_sample {
+	fvec a[3], g[3], m[3], dt;
+};
+
+/* a * 1/|a|, 0 if a is 0. Return squared norm. */
+static fvec fusion_normalize3(const fvec in[3], fvec out[3])
+{
+	const fvec n2 = v_add(v_add(v_mul(in[0], in[0]), v_mul(in[1], in[1])), v_mul(in[2], in[2]));
+	const fvec r = v_if_pos(n2, v_div(v_set(1.f), v_sqrt(n2)));
+
+	out[0] = v_mul(in[0], r);
+	out[1] = v_mul(in[1], r);
+	out[2] = v_mul(in[2], r);
+
+	return n2;
+}
+
+/* Update one output filter of a group of lanes with one sample */
+static void fusion_update(int algorithm, struct inv_icm20948_fusion_state * st, unsigned l,
+		const struct fusion_sample * in, int use_gyro, int use_mag, float gain, float integral_gain)
+{
+	const fvec zero = v_set(0.f), one = v_set(1.f), two = v_set(2.f), half = v_set(0.5f);
+	fvec q0 = v_ld(&st->q[0][l]), q1 = v_ld(&st->q[1][l]), q2 = v_ld(&st->q[2][l]), q3 = v_ld(&st->q[3][l]);
+	fvec a[3], m[3], g[3], an2;
+	fvec r00, r01, r02, r10, r11, r12, r20, r21, r22;
+	fvec hx, hy, hz, bx, bz, wx, wy, wz;
+	fvec d0, d1, d2, d3, n;
+
+	an2 = fusion_normalize3(in->a, a);
+	if(use_mag) {
+		fusion_normalize3(in->m, m);
+	} else {
+		m[0] = m[1] = m[2] = zero;
+	}
+	if(use_gyro) {
+		const fvec k = v_set(FUSION_DEG_TO_RAD);
+		g[0] = v_mul(in->g[0], k);
+		g[1] = v_mul(in->g[1], k);
+		g[2] = v_mul(in->g[2], k);
+	} else {
+		g[0] = g[1] = g[2] = zero;
+	}
+
+	/* rotation matrix, sensor to world */
+	{
+		const fvec q1q1 = v_mul(q1, q1), q2q2 = v_mul(q2, q2), q3q3 = v_mul(q3, q3);
+		const fvec q0q1 = v_mul(q0, q1), q0q2 = v_mul(q0, q2), q0q3 = v_mul(q0, q3);
+		const fvec q1q2 = v_mul(q1, q2), q1q3 = v_mul(q1, q3), q2q3 = v_mul(q2, q3);
+
+		r00 = v_sub(one, v_mul(two, v_add(q2q2, q3q3)));
+		r01 = v_mul(two, v_sub(q1q2, q0q3));
+		r02 = v_mul(two, v_add(q1q3, q0q2));
+		r10 = v_mul(two, v_add(q1q2, q0q3));
+		r11 = v_sub(one, v_mul(two, v_add(q1q1, q3q3)));
+		r12 = v_mul(two, v_sub(q2q3, q0q1));
+		r20 = v_mul(two, v_sub(q1q3, q0q2));
+		r21 = v_mul(two, v_add(q2q3, q0q1));
+		r22 = v_sub(one, v_mul(two, v_add(q1q1, q2q2)));
+	}
+
+	/* compass in world frame, reference keeps its inclination and points north (x) */
+	hx = v_add(v_add(v_mul(r00, m[0]), v_mul(r01, m[1])), v_mul(r02, m[2]));
+	hy = v_add(v_add(v_mul(r10, m[0]), v_mul(r11, m[1])), v_mul(r12, m[2]));
+	hz = v_add(v_add(v_mul(r20, m[0]), v_mul(r21, m[1])), v_mul(r22, m[2]));
+	bx = v_sqrt(v_add(v_mul(hx, hx), v_mul(hy, hy)));
+	bz = hz;
+
+	/* expected gravity (r20 r21 r22) and compass (w) in sensor frame */
+	wx = v_add(v_mul(bx, r00), v_mul(bz, r20));
+	wy = v_add(v_mul(bx, r01), v_mul(bz, r21));
+	wz = v_add(v_mul(bx, r02), v_mul(bz, r22));
+
+	if(algorithm == INV_ICM20948_FUSION_MAHONY) {
+		const fvec kp = v_set(gain);
+		fvec e[3];
+
+		/* error is cross product between measured and expected directions */
+		e[0] = v_add(v_sub(v_mul(a[1], r22), v_mul(a[2], r21)), v_sub(v_mul(m[1], wz), v_mul(m[2], wy)));
+		e[1] = v_add(v_sub(v_mul(a[2], r20), v_mul(a[0], r22)), v_sub(v_mul(m[2], wx), v_mul(m[0], wz)));
+		e[2] = v_add(v_sub(v_mul(a[0], r21), v_mul(a[1], r20)), v_sub(v_mul(m[0], wy), v_mul(m[1], wx)));
+
+		if(integral_gain > 0.f) {
+			const fvec kidt = v_mul(v_set(integral_gain), in->dt);
+			int i;
+
+			for(i = 0; i < 3; i++) {
+				const fvec it = v_add(v_ld(&st->integral[i][l]), v_mul(kidt, e[i]));
+				v_st(&st->integral[i][l], it);
+				g[i] = v_add(g[i], it);
+			}
+		}
+		g[0] = v_add(g[0], v_mul(kp, e[0]));
+		g[1] = v_add(g[1], v_mul(kp, e[1]));
+		g[2] = v_add(g[2], v_mul(kp, e[2]));
+	}
+
+	/* q' = q * (0, g) / 2 */
+	d0 = v_mul(half, v_sub(v_sub(v_sub(zero, v_mul(q1, g[0])), v_mul(q2, g[1])), v_mul(q3, g[2])));
+	d1 = v_mul(half, v_sub(v_add(v_mul(q0, g[0]), v_mul(q2, g[2])), v_mul(q3, g[1])));
+	d2 = v_mul(half, v_add(v_sub(v_mul(q0, g[1]), v_mul(q1, g[2])), v_mul(q3, g[0])));
+	d3 = v_mul(half, v_sub(v_add(v_mul(q0, g[2]), v_mul(q1, g[1])), v_mul(q2, g[0])));
+
+	if(algorithm == INV_ICM20948_FUSION_MADGWICK) {
+		/* gradient of |R^T.(0 0 1) - a|^2 + |R^T.b - m|^2 (halved) */
+		const fvec f1 = v_sub(r20, a[0]), f2 = v_sub(r21, a[1]), f3 = v_sub(r22, a[2]);
+		const fvec f4 = v_sub(wx, m[0]), f5 = v_sub(wy, m[1]), f6 = v_sub(wz, m[2]);
+		const fvec A = v_add(f1, v_mul(bz, f4)), B = v_add(f2, v_mul(bz, f5)), C = v_add(f3, v_mul(bz, f6));
+		fvec s0, s1, s2, s3;
+
+		s0 = v_add(v_sub(v_mul(q1, B), v_mul(q2, A)),
+				v_mul(bx, v_sub(v_mul(q2, f6), v_mul(q3, f5))));
+		s1 = v_add(v_sub(v_add(v_mul(q3, A), v_mul(q0, B)), v_mul(two, v_mul(q1, C))),
+				v_mul(bx, v_add(v_mul(q2, f5), v_mul(q3, f6))));
+		s2 = v_add(v_sub(v_sub(v_mul(q3, B), v_mul(q0, A)), v_mul(two, v_mul(q2, C))),
+				v_mul(bx, v_add(v_sub(v_mul(q1, f5), v_mul(two, v_mul(q2, f4))), v_mul(q0, f6))));
+		s3 = v_add(v_add(v_mul(q1, A), v_mul(q2, B)),
+				v_mul(bx, v_sub(v_sub(v_mul(q1, f6), v_mul(two, v_mul(q3, f4))), v_mul(q0, f5))));
+
+		/* step of beta along normalized gradient, none without accel */
+		n = v_add(v_add(v_mul(s0, s0), v_mul(s1, s1)), v_add(v_mul(s2, s2), v_mul(s3, s3)));
+		n = v_if_pos(an2, v_if_pos(n, v_div(v_set(gain), v_sqrt(n))));
+		d0 = v_sub(d0, v_mul(n, s0));
+		d1 = v_sub(d1, v_mul(n, s1));
+		d2 = v_sub(d2, v_mul(n, s2));
+		d3 = v_sub(d3, v_mul(n, s3));
+	}
+
+	q0 = v_add(q0, v_mul(d0, in->dt));
+	q1 = v_add(q1, v_mul(d1, in->dt));
+	q2 = v_add(q2, v_mul(d2, in->dt));
+	q3 = v_add(q3, v_mul(d3, in->dt));
+
+	n = v_add(v_add(v_mul(q0, q0), v_mul(q1, q1)), v_add(v_mul(q2, q2), v_mul(q3, q3)));
+	n = v_div(one, v_sqrt(n));
+	v_st(&st->q[0][l], v_mul(q0, n));
+	v_st(&st->q[1][l], v_mul(q1, n));
+	v_st(&st->q[2][l], v_mul(q2, n));
+	v_st(&st->q[3][l], v_mul(q3, n));
+}
+
+/* Convert filter quaternions of a group of lanes to DMP output convention (see inv_icm20948_fusion_get()) */
+static void fusion_convert(const struct inv_icm20948_fusion * f, int output, unsigned l, fvec q[4])
+{
+	fvec w = v_ld(&f->state[output].q[0][l]), x = v_ld(&f->state[output].q[1][l]);
+	fvec y = v_ld(&f->state[output].q[2][l]), z = v_ld(&f->state[output].q[3][l]);
+	const fvec m0 = v_ld(&f->mounting[0][l]), m1 = v_ld(&f->mounting[1][l]);
+	const fvec m2 = v_ld(&f->mounting[2][l]), m3 = v_ld(&f->mounting[3][l]);
+
+	if(output != INV_ICM20948_FUSION_GRV) {
+		/* NWU to ENU: rotate by 90 deg around z */
+		const fvec c = v_set(0.70710678f);
+		const fvec w2 = v_mul(c, v_sub(w, z)), x2 = v_mul(c, v_sub(x, y));
+		const fvec y2 = v_mul(c, v_add(y, x)), z2 = v_mul(c, v_add(z, w));
+		w = w2; x = x2; y = y2; z = z2;
+	}
+
+	/* chip to world * (chip to body)^-1, as inv_icm20948_q_mult_q_qi() */
+	q[0] = v_add(v_add(v_mul(w, m0), v_mul(x, m1)), v_add(v_mul(y, m2), v_mul(z, m3)));
+	q[1] = v_add(v_sub(v_mul(x, m0), v_mul(w, m1)), v_sub(v_mul(z, m2), v_mul(y, m3)));
+	q[2] = v_add(v_sub(v_mul(y, m0), v_mul(w, m2)), v_sub(v_mul(x, m3), v_mul(z, m1)));
+	q[3] = v_add(v_sub(v_mul(z, m0), v_mul(w, m3)), v_sub(v_mul(y, m1), v_mul(x, m2)));
+
+	/* positive w, as inv_icm20948_convert_rotation_vector() */
+	q[1] = v_sign_of(q[0], q[1]);
+	q[2] = v_sign_of(q[0], q[2]);
+	q[3] = v_sign_of(q[0], q[3]);
+	q[0] = v_sign_of(q[0], q[0]);
+}
+
+/* Set orientation of a lane from accel (and compass), in NWU frame */
+static int fusion_init_lane(struct inv_icm20948_fusion * f, unsigned lane, const float a[3], const float m[3])
+{
+	const float an = sqrtf(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+	float up[3], tilt[4], heading[4];
+	int o;
+
+	if(an == 0.f)
+		return 0;
+
+	up[0] = a[0] / an;
+	up[1] = a[1] / an;
+	up[2] = a[2] / an;
+
+	/* shortest rotation bringing up to z */
+	if(up[2] > -0.999f) {
+		const float n = sqrtf(2.f * (1.f + up[2]));
+		tilt[0] = (1.f + up[2]) / n;
+		tilt[1] = up[1] / n;
+		tilt[2] = -up[0] / n;
+		tilt[3] = 0.f;
+	} else {
+		tilt[0] = 0.f; tilt[1] = 1.f; tilt[2] = 0.f; tilt[3] = 0.f;
+	}
+
+	/* with a compass: rows of sensor to world matrix are north, west and up in sensor frame */
+	heading[0] = tilt[0]; heading[1] = tilt[1]; heading[2] = tilt[2]; heading[3] = tilt[3];
+	if(m) {
+		float east[3], R[9], q[4], n;
+
+		east[0] = m[1]*up[2] - m[2]*up[1];
+		east[1] = m[2]*up[0] - m[0]*up[2];
+		east[2] = m[0]*up[1] - m[1]*up[0];
+		n = sqrtf(east[0]*east[0] + east[1]*east[1] + east[2]*east[2]);
+		if(n > 0.f) {
+			east[0] /= n; east[1] /= n; east[2] /= n;
+			R[0] = up[1]*east[2] - up[2]*east[1];
+			R[1] = up[2]*east[0] - up[0]*east[2];
+			R[2] = up[0]*east[1] - up[1]*east[0];
+			R[3] = -east[0]; R[4] = -east[1]; R[5] = -east[2];
+			R[6] = up[0]; R[7] = up[1]; R[8] = up[2];
+			/* returns inverse rotation (see inv_icm20948_set_chip_to_body_axis_quaternion()) */
+			inv_icm20948_convert_matrix_to_quat_flt(R, q);
+			heading[0] = q[0]; heading[1] = -q[1]; heading[2] = -q[2]; heading[3] = -q[3];
+		}
+	}
+
+	for(o = 0; o < INV_ICM20948_FUSION_OUTPUT_MAX; o++) {
+		const float * q = (o == INV_ICM20948_FUSION_GRV) ? tilt : heading;
+		struct inv_icm20948_fusion_state * st = &f->state[o];
+		int i;
+
+		for(i = 0; i < 4; i++)
+			st->q[i][lane] = q[i];
+		for(i = 0; i < 3; i++)
+			st->integral[i][lane] = 0.f;
+	}
+
+	return 1;
+}
+
+int inv_icm20948_fusion_init(struct inv_icm20948_fusion * f, int algorithm,
+		unsigned outputs, unsigned nb_lanes)
+{
+	unsigned l;
+
+	if((algorithm != INV_ICM20948_FUSION_MAHONY && algorithm != INV_ICM20948_FUSION_MADGWICK)
+			|| nb_lanes > INV_ICM20948_FUSION_MAX_LANES
+			|| (outputs & ~((1U << INV_ICM20948_FUSION_OUTPUT_MAX) - 1)))
+		return INV_ERROR_BAD_ARG;
+
+	memset(f, 0, sizeof(*f));
+	f->algorithm = algorithm;
+	f->outputs = outputs;
+	f->nb_lanes = nb_lanes;
+	f->gain = fusion_default_gain[algorithm][0];
+	f->gmrv_gain = fusion_default_gain[algorithm][1];
+
+	for(l = 0; l < INV_ICM20948_FUSION_MAX_LANES; l++) {
+		int o;
+
+		f->mounting[0][l] = 1.f;
+		for(o = 0; o < INV_ICM20948_FUSION_OUTPUT_MAX; o++)
+			f->state[o].q[0][l] = 1.f;
+	}
+
+	return 0;
+}
+
+void inv_icm20948_fusion_set_mounting(struct inv_icm20948_fusion * f, unsigned lane,
+		const long quat_q30[4])
+{
+	int i;
+
+	for(i = 0; i < 4; i++)
+		f->mounting[i][lane] = (float)quat_q30[i] / (1L << 30);
+}
+
+void inv_icm20948_fusion_reset_lane(struct inv_icm20948_fusion * f, unsigned lane)
+{
+	f->initialized[lane] = 0;
+}
+
+int inv_icm20948_fusion_run(struct inv_icm20948_fusion * f,
+		const struct inv_icm20948_fusion_block * block)
+{
+	const int need_gyro = f->outputs & ((1 << INV_ICM20948_FUSION_GRV) | (1 << INV_ICM20948_FUSION_RV));
+	const int need_mag = f->outputs & ((1 << INV_ICM20948_FUSION_RV) | (1 << INV_ICM20948_FUSION_GMRV));
+	const unsigned stride = block->stride;
+	unsigned l, t, i;
+
+	if(stride % INV_ICM20948_FUSION_LANE_ALIGN || stride < f->nb_lanes || !block->dt
+			|| !block->accel[0] || !block->accel[1] || !block->accel[2]
+			|| (need_gyro && (!block->gyro[0] || !block->gyro[1] || !block->gyro[2]))
+			|| (need_mag && (!block->compass[0] || !block->compass[1] || !block->compass[2])))
+		return INV_ERROR_BAD_ARG;
+
+	if(block->nb_samples == 0)
+		return 0;
+
+	/* first orientation from first sample */
+	for(l = 0; l < f->nb_lanes; l++) {
+		if(!f->initialized[l]) {
+			float a[3], m[3];
+
+			for(i = 0; i < 3; i++) {
+				a[i] = block->accel[i][l];
+				m[i] = need_mag ? block->compass[i][l] : 0.f;
+			}
+			f->initialized[l] = fusion_init_lane(f, l, a, need_mag ? m : 0);
+		}
+	}
+
+	for(l = 0; l < f->nb_lanes; l += FUSION_VEC_LANES) {
+		struct fusion_sample in;
+		float dt[FUSION_VEC_LANES];
+
+		/* dt holds nb_lanes values only, padding lanes do not move */
+		for(i = 0; i < FUSION_VEC_LANES; i++)
+			dt[i] = (l + i < f->nb_lanes) ? block->dt[l + i] : 0.f;
+		in.dt = v_ld(dt);
+		for(t = 0; t < block->nb_samples; t++) {
+			const unsigned idx = t * stride + l;
+			int o;
+
+			for(i = 0; i < 3; i++) {
+				in.a[i] = v_ld(&block->accel[i][idx]);
+				in.g[i] = need_gyro ? v_ld(&block->gyro[i][idx]) : v_set(0.f);
+				in.m[i] = need_mag ? v_ld(&block->compass[i][idx]) : v_set(0.f);
+			}
+
+			for(o = 0; o < INV_ICM20948_FUSION_OUTPUT_MAX; o++) {
+				if(!(f->outputs & (1 << o)))
+					continue;
+
+				fusion_update(f->algorithm, &f->state[o], l, &in,
+						o != INV_ICM20948_FUSION_GMRV, o != INV_ICM20948_FUSION_GRV,
+						(o == INV_ICM20948_FUSION_GMRV) ? f->gmrv_gain : f->gain,
+						(o == INV_ICM20948_FUSION_GMRV) ? 0.f : f->integral_gain);
+
+				if(block->out[o]) {
+					fvec q[4];
+
+					fusion_convert(f, o, l, q);
+					for(i = 0; i < 4; i++)
+						v_st(&block->out[o][(t * 4 + i) * stride + l], q[i]);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+void inv_icm20948_fusion_get(const struct inv_icm20948_fusion * f, int output,
+		unsigned lane, float quat[4])
+{
+	const unsigned l = lane - lane % FUSION_VEC_LANES;
+	float v[FUSION_VEC_LANES];
+	fvec q[4];
+	int i;
+
+	fusion_convert(f, output, l, q);
+	for(i = 0; i < 4; i++) {
+		v_st(v, q[i]);
+		quat[i] = v[lane - l];
+	}
+}
+
+/** @} */
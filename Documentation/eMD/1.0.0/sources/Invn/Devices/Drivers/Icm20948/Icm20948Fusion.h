@@ -0,0 +1,142 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_FUSION_H__
+#define INV_ICM20948_FUSION_H__
+
+/** @defgroup	icm20948_fusion	fusion
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @brief Maximum number of independent filters (lanes) run by a fusion engine
+ *  Must be a multiple of INV_ICM20948_FUSION_LANE_ALIGN.
+ */
+#ifndef INV_ICM20948_FUSION_MAX_LANES
+#define INV_ICM20948_FUSION_MAX_LANES   64
+#endif
+
+/** @brief Lanes are processed by groups of up to this many (AVX2 width)
+ *  Input and output strides must be a multiple of it, padding lanes are computed but ignored.
+ */
+#define INV_ICM20948_FUSION_LANE_ALIGN  8
+
+/** @brief Fusion algorithms
+ */
+enum inv_icm20948_fusion_algorithm {
+	INV_ICM20948_FUSION_MAHONY = 0,   /**< complementary filter with PI correction */
+	INV_ICM20948_FUSION_MADGWICK,     /**< gradient descent correction */
+};
+
+/** @brief Fusion outputs, equivalent to DMP quaternions
+ */
+enum inv_icm20948_fusion_output {
+	INV_ICM20948_FUSION_GRV = 0,      /**< accel + gyro, as QUAT6 (game rotation vector) */
+	INV_ICM20948_FUSION_RV,           /**< accel + gyro + compass, as QUAT9 (rotation vector) */
+	INV_ICM20948_FUSION_GMRV,         /**< accel + compass, as GEOMAG (geomagnetic rotation vector) */
+	INV_ICM20948_FUSION_OUTPUT_MAX
+};
+
+/** @brief Filter states of one output for all lanes (structure of arrays)
+ *  Quaternion rotates sensor frame to world frame (NWU while filtering).
+ */
+struct inv_icm20948_fusion_state {
+	float q[4][INV_ICM20948_FUSION_MAX_LANES];         /**< w, x, y, z */
+	float integral[3][INV_ICM20948_FUSION_MAX_LANES];  /**< Mahony integral term in rad/s */
+};
+
+/** @brief Fusion engine states
+ */
+struct inv_icm20948_fusion {
+	int      algorithm;        /**< enum inv_icm20948_fusion_algorithm, same for all lanes */
+	unsigned outputs;          /**< mask of (1 << enum inv_icm20948_fusion_output) to compute */
+	unsigned nb_lanes;         /**< lanes in use */
+	float    gain;             /**< GRV and RV gain: Mahony Kp or Madgwick beta */
+	float    integral_gain;    /**< GRV and RV Mahony Ki (0 to disable) */
+	float    gmrv_gain;        /**< GMRV gain: Mahony Kp or Madgwick beta, high as there is no gyro
+	                                (sampling period must stay well below 1/gmrv_gain) */
+	float    mounting[4][INV_ICM20948_FUSION_MAX_LANES]; /**< chip to body quaternion per lane, w x y z */
+	uint8_t  initialized[INV_ICM20948_FUSION_MAX_LANES];  /**< lane orientation was set from first samples */
+	struct inv_icm20948_fusion_state state[INV_ICM20948_FUSION_OUTPUT_MAX];
+};
+
+/** @brief Block of samples for all lanes
+ *
+ *  Sample t of lane l of channel c is c[t * stride + l]. Accel, gyro and compass must
+ *  be sampled at the same time (repeat last compass sample, or use 0 vectors when there
+ *  is none). A 0 accel or compass vector disables its correction for that sample.
+ */
+struct inv_icm20948_fusion_block {
+	unsigned      nb_samples;
+	unsigned      stride;    /**< multiple of INV_ICM20948_FUSION_LANE_ALIGN, at least nb_lanes */
+	const float * accel[3];  /**< any unit (only direction is used) */
+	const float * gyro[3];   /**< dps, calibrated (or NULL for GMRV only) */
+	const float * compass[3];/**< any unit, calibrated (or NULL for GRV only) */
+	const float * dt;        /**< sampling period in s, one per lane (nb_lanes values, no padding) */
+	float *       out[INV_ICM20948_FUSION_OUTPUT_MAX];
+	                         /**< quaternion per sample or NULL: component c (w x y z) of sample t of
+	                              lane l at out[(t * 4 + c) * stride + l] */
+};
+
+/** @brief Setup an engine with default gains, all lanes reset to identity mounting
+ *  @param[out] f          engine states
+ *  @param[in]  algorithm  enum inv_icm20948_fusion_algorithm
+ *  @param[in]  outputs    mask of (1 << enum inv_icm20948_fusion_output) to compute
+ *  @param[in]  nb_lanes   number of independent filters, at most INV_ICM20948_FUSION_MAX_LANES
+ *  @return     0 on success, INV_ERROR_BAD_ARG otherwise
+ */
+int INV_EXPORT inv_icm20948_fusion_init(struct inv_icm20948_fusion * f, int algorithm,
+		unsigned outputs, unsigned nb_lanes);
+
+/** @brief Set chip to body mounting quaternion of a lane
+ *  Samples are then expected in chip frame and outputs are in body frame, as DMP
+ *  quaternions converted by inv_icm20948_convert_rotation_vector().
+ *  @param[in]  quat_q30  s_quat_chip_to_body of the driver states the lane was recorded with
+ */
+void INV_EXPORT inv_icm20948_fusion_set_mounting(struct inv_icm20948_fusion * f, unsigned lane,
+		const long quat_q30[4]);
+
+/** @brief Forget orientation of a lane: it is set again from next accel (and compass) sample
+ */
+void INV_EXPORT inv_icm20948_fusion_reset_lane(struct inv_icm20948_fusion * f, unsigned lane);
+
+/** @brief Run all lanes over a block of samples
+ *  @return     0 on success, INV_ERROR_BAD_ARG if block does not match engine
+ */
+int INV_EXPORT inv_icm20948_fusion_run(struct inv_icm20948_fusion * f,
+		const struct inv_icm20948_fusion_block * block);
+
+/** @brief Get current quaternion of a lane in DMP output convention
+ *
+ *  Quaternion rotates body frame to world frame (ENU for RV and GMRV), w is positive.
+ *
+ *  @param[in]  output  enum inv_icm20948_fusion_output
+ *  @param[out] quat    w, x, y, z
+ */
+void INV_EXPORT inv_icm20948_fusion_get(const struct inv_icm20948_fusion * f, int output,
+		unsigned lane, float quat[4]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_FUSION_H__
+
+/** @} */
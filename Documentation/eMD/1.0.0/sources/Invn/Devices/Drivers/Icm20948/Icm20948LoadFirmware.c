@@ -15,63 +15,193 @@
 #include "Icm20948Defs.h"
 #include "Icm20948DataBaseDriver.h"
 
+static uint32_t firmware_crc32(uint32_t crc, const unsigned char *data, unsigned int len)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+	}
+
+	return crc;
+}
+
+static int firmware_verify_full(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short memaddr)
+{
+	unsigned char data_cmp[INV_ICM20948_FIRMWARE_VERIFY_SIZE];
+	int result;
+
+	while (size > 0) {
+		const unsigned short read_size = min(size, INV_ICM20948_FIRMWARE_VERIFY_SIZE);
+
+		result = inv_icm20948_read_mems_core(s, memaddr, read_size, data_cmp);
+		if (result)
+			return result;
+		if (memcmp(data_cmp, data, read_size))
+			return -1; // Error, DMP not written correctly
+		data += read_size;
+		size -= read_size;
+		memaddr += read_size;
+	}
+
+	return 0;
+}
+
+static int firmware_verify_spot(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short memaddr)
+{
+	unsigned char data_cmp[INV_ICM20948_FIRMWARE_VERIFY_SIZE];
+	uint32_t crc_img = 0xFFFFFFFFUL, crc_mem = 0xFFFFFFFFUL;
+	int result;
+
+	while (size > 0) {
+		// Check the first bytes of current DMP memory bank then skip to the next one
+		const unsigned short bank_size = min(size, 0x100 - (memaddr & 0xff));
+		const unsigned short read_size = min(bank_size, INV_ICM20948_FIRMWARE_VERIFY_SIZE);
+
+		result = inv_icm20948_read_mems_core(s, memaddr, read_size, data_cmp);
+		if (result)
+			return result;
+		crc_mem = firmware_crc32(crc_mem, data_cmp, read_size);
+		crc_img = firmware_crc32(crc_img, data, read_size);
+		data += bank_size;
+		size -= bank_size;
+		memaddr += bank_size;
+	}
+
+	if (crc_mem != crc_img)
+		return -1; // Error, DMP not written correctly
+
+	return 0;
+}
+
+#define FIRMWARE_MARKER_MAGIC    0x33504d44UL /* "DMP3" */
+
+static uint32_t firmware_sample_crc32(const unsigned char *data, unsigned short size, unsigned short load_addr)
+{
+	uint32_t crc = 0xFFFFFFFFUL;
+	unsigned int memaddr = (load_addr > INV_ICM20948_FIRMWARE_CODE_START) ? load_addr : INV_ICM20948_FIRMWARE_CODE_START;
+
+	for (; memaddr < (unsigned int)load_addr + size; memaddr += INV_ICM20948_FIRMWARE_SAMPLE_STRIDE) {
+		const unsigned int len = min((unsigned int)load_addr + size - memaddr, INV_ICM20948_FIRMWARE_VERIFY_SIZE);
+		crc = firmware_crc32(crc, &data[memaddr - load_addr], len);
+	}
+
+	return crc;
+}
+
+static void firmware_marker_pack(unsigned char marker[16], uint32_t size, uint32_t crc)
+{
+	const uint32_t words[4] = { FIRMWARE_MARKER_MAGIC, size, crc, ~crc };
+	int i;
+
+	for (i = 0; i < 16; i++)
+		marker[i] = (unsigned char)(words[i/4] >> (8*(i%4)));
+}
+
+static int firmware_power_begin(struct inv_icm20948 * s)
+{
+	int result = 0;
+
+	if((inv_icm20948_get_chip_power_state(s) & CHIP_AWAKE) == 0)
+		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
+	result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 0);
+
+	return result;
+}
+
+static int firmware_power_end(struct inv_icm20948 * s)
+{
+	//Enable LP_EN since we disabled it in firmware_power_begin().
+	return inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+}
+
+int inv_icm20948_firmware_check(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr)
+{
+	const uint32_t crc_img = firmware_sample_crc32(data, size, load_addr);
+	unsigned char data_cmp[INV_ICM20948_FIRMWARE_VERIFY_SIZE];
+	unsigned char marker[16], marker_mem[16];
+	uint32_t crc_mem = 0xFFFFFFFFUL;
+	unsigned int memaddr = (load_addr > INV_ICM20948_FIRMWARE_CODE_START) ? load_addr : INV_ICM20948_FIRMWARE_CODE_START;
+	int result;
+
+	if ((result = firmware_power_begin(s)) != 0)
+		return result;
+
+	// Marker must correspond to this image
+	result = inv_icm20948_read_mems_core(s, INV_ICM20948_FIRMWARE_MARKER_ADDR(load_addr, size), sizeof(marker_mem), marker_mem);
+	if (result)
+		goto end;
+	firmware_marker_pack(marker, size, crc_img);
+	if (memcmp(marker, marker_mem, sizeof(marker))) {
+		result = 1;
+		goto end;
+	}
+
+	// Sampled regions must be intact
+	for (; memaddr < (unsigned int)load_addr + size; memaddr += INV_ICM20948_FIRMWARE_SAMPLE_STRIDE) {
+		const unsigned int len = min((unsigned int)load_addr + size - memaddr, INV_ICM20948_FIRMWARE_VERIFY_SIZE);
+
+		result = inv_icm20948_read_mems_core(s, (unsigned short)memaddr, len, data_cmp);
+		if (result)
+			goto end;
+		crc_mem = firmware_crc32(crc_mem, data_cmp, len);
+	}
+
+	result = (crc_mem == crc_img) ? 0 : 1;
+
+end:
+	firmware_power_end(s);
+
+	return result;
+}
+
 int inv_icm20948_firmware_load(struct inv_icm20948 * s, const unsigned char *data_start, unsigned short size_start, unsigned short load_addr)
+{
+	return inv_icm20948_firmware_load_ex(s, data_start, size_start, load_addr, INV_ICM20948_FIRMWARE_VERIFY);
+}
+
+int inv_icm20948_firmware_load_ex(struct inv_icm20948 * s, const unsigned char *data_start, unsigned short size_start, unsigned short load_addr, int verify)
 { 
-    int write_size;
-    int result;
-    unsigned short memaddr;
-    const unsigned char *data;
-    unsigned short size;
-    unsigned char data_cmp[INV_MAX_SERIAL_READ];
-    int flag = 0;
+	unsigned char marker[16] = { 0 };
+	int result;
 
 	if(s->base_state.firmware_loaded)
 		return 0;
-		
-    // Write DMP memory
-    data = data_start;
-    size = size_start;
-    memaddr = load_addr;
-    while (size > 0) {
-        write_size = min(size, INV_MAX_SERIAL_WRITE);
-        if ((memaddr & 0xff) + write_size > 0x100) {
-            // Moved across a bank
-            write_size = (memaddr & 0xff) + write_size - 0x100;
-        }
-        result = inv_icm20948_write_mems(s, memaddr, write_size, (unsigned char *)data);
-        if (result)  
-            return result;
-        data += write_size;
-        size -= write_size;
-        memaddr += write_size;
-    }
-
-    // Verify DMP memory
-
-    data = data_start;
-    size = size_start;
-    memaddr = load_addr;
-    while (size > 0) {
-        write_size = min(size, INV_MAX_SERIAL_READ);
-        if ((memaddr & 0xff) + write_size > 0x100) {
-            // Moved across a bank
-            write_size = (memaddr & 0xff) + write_size - 0x100;
-        }
-        result = inv_icm20948_read_mems(s, memaddr, write_size, data_cmp);
-        if (result)
-            flag++; // Error, DMP not written correctly
-        if (memcmp(data_cmp, data, write_size))
-            return -1;
-        data += write_size;
-        size -= write_size;
-        memaddr += write_size;
-    }
-
-#if defined(WIN32)   
-    //if(!flag)
-      // inv_log("DMP Firmware was updated successfully..\r\n");
-#endif
-
-    return 0;
-}
 
+	// Power setup is done once for the whole image
+	if ((result = firmware_power_begin(s)) != 0)
+		return result;
+
+	// Clear marker so that an interrupted load is not considered as resident
+	result = inv_icm20948_write_mems_core(s, INV_ICM20948_FIRMWARE_MARKER_ADDR(load_addr, size_start), sizeof(marker), marker);
+
+	// Write DMP memory
+	if (result == 0)
+		result = inv_icm20948_write_mems_core(s, load_addr, size_start, data_start);
+
+	// Verify DMP memory
+	if (result == 0) {
+		switch (verify) {
+		case INV_ICM20948_FIRMWARE_VERIFY_SPOT:
+			result = firmware_verify_spot(s, data_start, size_start, load_addr);
+			break;
+		case INV_ICM20948_FIRMWARE_VERIFY_FULL:
+			result = firmware_verify_full(s, data_start, size_start, load_addr);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// Write marker for next warm restart
+	if (result == 0) {
+		firmware_marker_pack(marker, size_start, firmware_sample_crc32(data_start, size_start, load_addr));
+		result = inv_icm20948_write_mems_core(s, INV_ICM20948_FIRMWARE_MARKER_ADDR(load_addr, size_start), sizeof(marker), marker);
+	}
+
+	result |= firmware_power_end(s);
+
+	return result;
+}
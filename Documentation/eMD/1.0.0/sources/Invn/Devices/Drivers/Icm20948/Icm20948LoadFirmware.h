@@ -25,7 +25,62 @@ extern "C"
 /* forward declaration */
 struct inv_icm20948;
 
+/** @brief DMP firmware verification modes
+*/
+enum inv_icm20948_firmware_verify {
+	INV_ICM20948_FIRMWARE_VERIFY_NONE = 0, /**< no verification */
+	INV_ICM20948_FIRMWARE_VERIFY_SPOT,     /**< read back the start of each DMP memory bank
+	                                            and compare CRC of read data against CRC of image */
+	INV_ICM20948_FIRMWARE_VERIFY_FULL,     /**< read back whole image and compare */
+};
+
+/** @brief Verification mode used by inv_icm20948_firmware_load()
+*/
+#ifndef INV_ICM20948_FIRMWARE_VERIFY
+	#define INV_ICM20948_FIRMWARE_VERIFY    INV_ICM20948_FIRMWARE_VERIFY_FULL
+#endif
+
+/** @brief Size of the buffer used to read back firmware
+* Corresponds to the number of bytes checked per DMP memory bank in SPOT mode
+*/
+#ifndef INV_ICM20948_FIRMWARE_VERIFY_SIZE
+	#define INV_ICM20948_FIRMWARE_VERIFY_SIZE    64
+#endif
+
+/** @brief DMP memory below this address holds DMP variables modified at runtime
+* Only DMP memory above this address is sampled to fingerprint a resident image
+*/
+#ifndef INV_ICM20948_FIRMWARE_CODE_START
+	#define INV_ICM20948_FIRMWARE_CODE_START    0x1000
+#endif
+
+/** @brief Distance between two regions sampled to fingerprint a resident image
+* INV_ICM20948_FIRMWARE_VERIFY_SIZE bytes are sampled every INV_ICM20948_FIRMWARE_SAMPLE_STRIDE bytes
+*/
+#ifndef INV_ICM20948_FIRMWARE_SAMPLE_STRIDE
+	#define INV_ICM20948_FIRMWARE_SAMPLE_STRIDE    0x800
+#endif
+
+/** @brief DMP memory address of the 16-byte marker written after a successful load
+* Default to the first 16-byte row after the image
+*/
+#ifndef INV_ICM20948_FIRMWARE_MARKER_ADDR
+	#define INV_ICM20948_FIRMWARE_MARKER_ADDR(load_addr, size)    ((((load_addr) + (size)) + 15) & ~15)
+#endif
+
+/** @brief Check if a DMP firmware image is already resident in DMP memory
+* Resident image is fingerprinted by a CRC over a few sampled regions of DMP memory,
+* that is compared with the CRC of the same regions of the image and with the marker
+* written by inv_icm20948_firmware_load_ex() after a successful load.
+* @param[in] data  pointer where the image 
+* @param[in] size  size if the image
+* @param[in] load_addr  address to loading the image
+* @return 0 if image is resident, 1 if it is not, negative value on error
+*/
+int INV_EXPORT inv_icm20948_firmware_check(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr);
+
 /** @brief Loads the DMP firmware from SRAM
+* Identical to inv_icm20948_firmware_load_ex() with INV_ICM20948_FIRMWARE_VERIFY verification mode
 * @param[in] data  pointer where the image 
 * @param[in] size  size if the image
 * @param[in] load_addr  address to loading the image
@@ -33,6 +88,20 @@ struct inv_icm20948;
 */
 int INV_EXPORT inv_icm20948_firmware_load(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr);
 
+/** @brief Loads the DMP firmware from SRAM
+* Chip is woken up and LP_EN is disabled once for the whole load.
+* Marker used by inv_icm20948_firmware_check() is cleared before the load and written once
+* the image was successfully loaded (and verified).
+* Image is written in bursts as large as allowed by the serial interface (serif.max_write)
+* and read back in bursts as large as allowed by serif.max_read.
+* @param[in] data  pointer where the image 
+* @param[in] size  size if the image
+* @param[in] load_addr  address to loading the image
+* @param[in] verify  verification mode (see enum inv_icm20948_firmware_verify)
+* @return 0 in case of success, -1 for any error
+*/
+int INV_EXPORT inv_icm20948_firmware_load_ex(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr, int verify);
+
 #ifdef __cplusplus
 }
 #endif
@@ -177,16 +177,21 @@ static int dmp_read_fifo(struct inv_icm20948 * s, unsigned char *data, uint_fast
 *  @param  length
 *              Max number of bytes to read from the FIFO that buffer is still able to sustain.
 *  @param  buffer Reads up to length into the buffer.
+*  @param  left   If not NULL, at most INV_ICM20948_FIFO_PREFETCH_BATCH bytes are read
+*                 and left is set to number of bytes remaining in the FIFO.
 *
 *  @return number of bytes of read.
 **/
-static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t length, unsigned char *buffer, int *reset)
+static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t length, unsigned char *buffer, int *reset, uint_fast16_t *left)
 {
 	int result;
 	uint_fast16_t in_fifo;
+	uint_fast16_t in_batch;
     
 	if(reset)
 		*reset = 0;
+	if(left)
+		*left = 0;
    
 	result = dmp_get_fifo_length(s, &in_fifo);
 	if (result) {
@@ -194,6 +199,10 @@ static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t len
 		return 0;
 	}
     
+	// Nothing to read or overflow, only count is logged
+	if (s->fifo_log && (in_fifo == 0 || in_fifo > length))
+		inv_icm20948_fifo_log_fifo(s, INV_ICM20948_FIFO_LOG_FIFO, in_fifo, 0, 0);
+
 	// Nothing to read
 	if (in_fifo == 0)
 		return 0;
@@ -207,12 +216,20 @@ static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t len
 		return 0;
 	}
 
-	result = dmp_read_fifo(s, buffer, in_fifo);
+	in_batch = in_fifo;
+	if (left && in_batch > INV_ICM20948_FIFO_PREFETCH_BATCH)
+		in_batch = INV_ICM20948_FIFO_PREFETCH_BATCH;
+
+	result = dmp_read_fifo(s, buffer, in_batch);
 	if (result) {
 		s->fifo_info.fifoError = result;
 		return 0;
 	}
-	return in_fifo;
+	if (s->fifo_log)
+		inv_icm20948_fifo_log_fifo(s, INV_ICM20948_FIFO_LOG_FIFO, in_fifo, buffer, in_batch);
+	if (left)
+		*left = in_fifo - in_batch;
+	return in_batch;
 }
 
 /** Determines the packet size by decoding the header. Both header and header2 are set. header2 is set to zero
@@ -360,9 +377,125 @@ static int check_fifo_decoded_headers(unsigned short header, unsigned short head
     return 0;
 }
 
+int inv_icm20948_fifo_packet_size(const unsigned char *data, unsigned int len, unsigned short *header, unsigned short *header2)
+{
+	int sz;
+
+	if (len < HEADER_SZ)
+		return 0;
+	if ((((unsigned short)data[0] << 8 | data[1]) & HEADER2_SET) && len < HEADER_SZ + HEADER2_SZ)
+		return 0;
+
+	sz = get_packet_size_and_samplecnt((unsigned char *)data, header, header2, 0);
+	if (check_fifo_decoded_headers(*header, *header2))
+		return -1;
+
+	return sz;
+}
+
 /** Software FIFO, mirror of DMP HW FIFO, hence of max HARDWARE_FIFO_SIZE */
 static unsigned char fifo_data[HARDWARE_FIFO_SIZE];
-    
+
+/** Index of next byte to be popped from SW FIFO, data is moved back to index 0 when SW FIFO is mirrored */
+static int fifo_rd;
+
+/** Number of bytes counted in HW FIFO but not mirrored yet */
+static uint_fast16_t fifo_count_left;
+
+/** Asynchronous SW FIFO refill */
+static struct {
+	uint_fast16_t len;    // number of bytes being read, 0 if nothing in progress
+	struct inv_icm20948_serif_xfer xfers[INV_ICM20948_FIFO_PREFETCH_MAX_XFERS];
+} fifo_prefetch;
+
+/** Move fifo_size bytes still to be popped back to start of SW FIFO */
+static void fifo_compact(int fifo_size)
+{
+	if (fifo_rd) {
+		if (fifo_size)
+			memmove(fifo_data, &fifo_data[fifo_rd], fifo_size);
+		fifo_rd = 0;
+	}
+}
+
+/** Wait for end of asynchronous refill and append data read to SW FIFO. Returns 1 if a refill was
+* in progress, 0 otherwise.
+*/
+static int fifo_prefetch_wait(struct inv_icm20948 * s, int * fifo_size)
+{
+	int result;
+
+	if (fifo_prefetch.len == 0)
+		return 0;
+
+	result = inv_icm20948_complete_mems_xfers(s);
+	if (result) {
+		dmp_reset_fifo(s);
+		s->fifo_info.fifoError = result;
+		fifo_count_left = 0;
+	} else {
+		if (s->fifo_log)
+			inv_icm20948_fifo_log_fifo(s, INV_ICM20948_FIFO_LOG_PREFETCH, 0, fifo_prefetch.xfers[0].buf, fifo_prefetch.len);
+		*fifo_size += fifo_prefetch.len;
+	}
+	fifo_prefetch.len = 0;
+
+	return 1;
+}
+
+int inv_icm20948_dmp_reset_fifo(struct inv_icm20948 * s)
+{
+	int fifo_size = 0;
+
+	fifo_prefetch_wait(s, &fifo_size);
+	fifo_rd = 0;
+	fifo_count_left = 0;
+
+	return dmp_reset_fifo(s);
+}
+
+int inv_icm20948_fifo_prefetch_start(struct inv_icm20948 * s, int fifo_sw_size)
+{
+	const uint_fast16_t max_read = inv_icm20948_serif_max_read(&s->serif);
+	// refill is stored right after bytes still present in SW FIFO
+	const int end = fifo_rd + fifo_sw_size;
+	uint_fast16_t len = fifo_count_left;
+	uint_fast16_t offset = 0;
+	uint32_t count = 0;
+
+	if (fifo_prefetch.len)
+		return 1;
+
+	if (len > INV_ICM20948_FIFO_PREFETCH_BATCH)
+		len = INV_ICM20948_FIFO_PREFETCH_BATCH;
+	if (len > INV_ICM20948_FIFO_PREFETCH_MAX_XFERS * max_read)
+		len = INV_ICM20948_FIFO_PREFETCH_MAX_XFERS * max_read;
+	if (len > (uint_fast16_t)(HARDWARE_FIFO_SIZE - end))
+		len = HARDWARE_FIFO_SIZE - end;
+	if (len == 0)
+		return 0;
+
+	while (offset < len) {
+		fifo_prefetch.xfers[count].reg = (REG_FIFO_R_W & 0x7F);
+		fifo_prefetch.xfers[count].write = 0;
+		fifo_prefetch.xfers[count].buf = &fifo_data[end + offset];
+		fifo_prefetch.xfers[count].len = min(max_read, len - offset);
+		offset += fifo_prefetch.xfers[count].len;
+		count++;
+	}
+
+	// on error, remaining bytes are read by inv_icm20948_fifo_swmirror() along with new ones
+	if (inv_icm20948_submit_mems_xfers(s, REG_FIFO_R_W >> 7, fifo_prefetch.xfers, count)) {
+		fifo_count_left = 0;
+		return 0;
+	}
+
+	fifo_count_left -= len;
+	fifo_prefetch.len = len;
+
+	return 1;
+}
+
 /** Determine number of samples present in SW FIFO fifo_data containing fifo_size bytes to be analyzed. Total number
 * of samples filled in total_sample_cnt, number of samples per sensor filled in sample_cnt_array array
 */
@@ -374,7 +507,7 @@ static int extract_sample_cnt(struct inv_icm20948 * s, int fifo_size, unsigned s
 	while (fifo_idx < fifo_size) {
 		unsigned short header;
 		unsigned short header2;
-		int need_sz = get_packet_size_and_samplecnt(&fifo_data[fifo_idx], &header, &header2, sample_cnt_array);
+		int need_sz = get_packet_size_and_samplecnt(&fifo_data[fifo_idx], &header, &header2, 0);
 		
 		// Guarantee there is a full packet before continuing to decode the FIFO packet
 		if (fifo_size-fifo_idx < need_sz)
@@ -387,6 +520,10 @@ static int extract_sample_cnt(struct inv_icm20948 * s, int fifo_size, unsigned s
 			return -1;
 		}
 		
+		// Partial packet is not counted, it will be once completed by next mirroring
+		if (sample_cnt_array)
+			get_packet_size_and_samplecnt(&fifo_data[fifo_idx], &header, &header2, sample_cnt_array);
+
 		fifo_idx += need_sz;
 		
 		// One sample found, increment total sample counter
@@ -394,6 +531,14 @@ static int extract_sample_cnt(struct inv_icm20948 * s, int fifo_size, unsigned s
 	}
 
 endSuccess:
+	// Only part of HW FIFO contents was mirrored, extrapolate number of samples per sensor to the whole
+	// contents so that timestamps are spread properly; they are adjusted once last part is mirrored
+	if (sample_cnt_array && fifo_count_left && fifo_idx) {
+		int i;
+		for (i = 0; i < GENERAL_SENSORS_MAX; i++)
+			sample_cnt_array[i] = (sample_cnt_array[i] * (fifo_size + fifo_count_left) + fifo_idx / 2) / fifo_idx;
+	}
+
 	// Augmented sensors are not part of DMP FIFO, they are computed by DMP driver based on GRV or RV presence in DMP FIFO
 	// So their sample counts must rely on GRV and RV sample counts
 	if (sample_cnt_array) {
@@ -408,12 +553,21 @@ endSuccess:
 int inv_icm20948_fifo_swmirror(struct inv_icm20948 * s, int *fifo_sw_size, unsigned short * total_sample_cnt, unsigned short * sample_cnt_array)
 {
 	int reset=0; 
+	int prefetched;
 
 	*total_sample_cnt = 0;
 
+	// HW FIFO contents may already have been read by asynchronous refill
+	prefetched = fifo_prefetch_wait(s, fifo_sw_size);
+	fifo_compact(*fifo_sw_size);
+	if (!prefetched)
+		fifo_count_left = 0;
+
 	// Mirror HW FIFO into local SW FIFO, taking into account remaining *fifo_sw_size bytes still present in SW FIFO
-	if (*fifo_sw_size < HARDWARE_FIFO_SIZE ) {
-		*fifo_sw_size += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *fifo_sw_size),&fifo_data[*fifo_sw_size],&reset);
+	// If serif supports asynchronous requests, only first batch is read, next ones are read while this one is decoded
+	if (!prefetched && *fifo_sw_size < HARDWARE_FIFO_SIZE ) {
+		*fifo_sw_size += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *fifo_sw_size),&fifo_data[*fifo_sw_size],&reset,
+				inv_icm20948_serif_can_submit(&s->serif) ? &fifo_count_left : 0);
 
 		if (reset)
 			goto error;
@@ -427,6 +581,7 @@ int inv_icm20948_fifo_swmirror(struct inv_icm20948 * s, int *fifo_sw_size, unsig
 	
 error:
 	*fifo_sw_size = 0;
+	fifo_count_left = 0;
 	return -1;
 	
 }
@@ -434,11 +589,11 @@ error:
 int inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header, unsigned short *user_header2, int *fifo_sw_size)  
 {
 	int need_sz=0; // size in bytes of packet to be analyzed from FIFO
-	unsigned char *fifo_ptr = fifo_data; // pointer to next byte in SW FIFO to be parsed
+	unsigned char *fifo_ptr = &fifo_data[fifo_rd]; // pointer to next byte in SW FIFO to be parsed
     
 	if (*fifo_sw_size > 3) {
 		// extract headers and number of bytes requested by next sample present in FIFO
-		need_sz = get_packet_size_and_samplecnt(fifo_data, &fd.header, &fd.header2, 0);
+		need_sz = get_packet_size_and_samplecnt(fifo_ptr, &fd.header, &fd.header2, 0);
 
 		// Guarantee there is a full packet before continuing to decode the FIFO packet
 		if (*fifo_sw_size < need_sz) {
@@ -450,12 +605,12 @@ int inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header,
 			fifo_ptr += HEADER2_SZ;        
 
 		// extract payload data from SW FIFO
-		fifo_ptr += inv_icm20948_inv_decode_one_ivory_fifo_packet(s, &fd, fifo_ptr);        
+		fifo_ptr += inv_icm20948_inv_decode_one_ivory_fifo_packet(&s->compass_cal.raw_comp, &fd, fifo_ptr);        
 
-		// remove first need_sz bytes from SW FIFO
+		// remove first need_sz bytes from SW FIFO, data left is not moved as an asynchronous
+		// refill may be in progress right after it
 		*fifo_sw_size -= need_sz;
-		if(*fifo_sw_size)
-			memmove(fifo_data, &fifo_data[need_sz], *fifo_sw_size);// Data left in FIFO
+		fifo_rd += need_sz;
 
 		*user_header = fd.header;
 		*user_header2 = fd.header2;
@@ -475,10 +630,15 @@ int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, un
 
     if(!left_in_fifo)
         return -1;
+
+    // SW FIFO may have been left by inv_icm20948_fifo_pop() with data not at its start
+    fifo_prefetch_wait(s, left_in_fifo);
+    fifo_compact(*left_in_fifo);
+    fifo_count_left = 0;
     
     if (*left_in_fifo < HARDWARE_FIFO_SIZE ) 
     {
-        *left_in_fifo += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *left_in_fifo),&fifo_data[*left_in_fifo],&reset);
+        *left_in_fifo += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *left_in_fifo),&fifo_data[*left_in_fifo],&reset,0);
         //sprintf(test_str, "Left in FIFO: %d\r\n",*left_in_fifo);
         //print_command_console(test_str);
         if (reset) 
@@ -520,7 +680,8 @@ int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, un
         //time stamp 
         ts = inv_icm20948_get_tick_count();
         
-        fifo_ptr += inv_icm20948_inv_decode_one_ivory_fifo_packet(s, &fd, fifo_ptr);
+        inv_icm20948_compass_comp_sync(s, &s->compass_cal.raw_comp, 0);
+        fifo_ptr += inv_icm20948_inv_decode_one_ivory_fifo_packet(&s->compass_cal.raw_comp, &fd, fifo_ptr);
 
         if(time_stamp)
             *time_stamp = ts;
@@ -551,11 +712,12 @@ static void inv_decode_3_16bit_elements(short *out_data, const unsigned char *in
 }
 
 /** Decodes one packet of data from Ivory FIFO
+* @param[in] comp Raw compass compensation, only read
 * @param[in] fd Structure to be filled out with data. Assumes header and header2 are already set inside.
 * @param[in] fifo_ptr FIFO data, points to just after any header information
 * @return Returns the number of bytes consumed in FIFO data.
 */
-int inv_icm20948_inv_decode_one_ivory_fifo_packet(struct inv_icm20948 * s, struct inv_fifo_decoded_t *fd, const unsigned char *fifo_ptr)
+int inv_icm20948_inv_decode_one_ivory_fifo_packet(const struct inv_icm20948_compass_comp * comp, struct inv_fifo_decoded_t *fd, const unsigned char *fifo_ptr)
 {
     const unsigned char *fifo_ptr_start = fifo_ptr;  
 	short odr_cntr;
@@ -577,7 +739,7 @@ int inv_icm20948_inv_decode_one_ivory_fifo_packet(struct inv_icm20948 * s, struc
 
     if (fd->header & CPASS_SET) {
         inv_decode_3_16bit_elements(fd->cpass_raw_data, fifo_ptr);
-        inv_icm20948_apply_raw_compass_matrix(s, fd->cpass_raw_data, fd->compass);
+        inv_icm20948_compass_comp_apply(comp, fd->cpass_raw_data, fd->compass, 1);
         memcpy( fd->cpass_calibr_6chars, fifo_ptr, 6*sizeof(unsigned char));
         fifo_ptr += CPASS_DATA_SZ;
     }
@@ -22,6 +22,20 @@
 
 /* forward declaration */
 struct inv_icm20948;
+struct inv_icm20948_compass_comp;
+
+/** @brief Max number of bytes read from HW FIFO at once when serif supports asynchronous requests
+* Next batch is read while current one is decoded.
+*/
+#ifndef INV_ICM20948_FIFO_PREFETCH_BATCH
+	#define INV_ICM20948_FIFO_PREFETCH_BATCH     128
+#endif
+
+/** @brief Max number of transfers used to read one batch asynchronously
+*/
+#ifndef INV_ICM20948_FIFO_PREFETCH_MAX_XFERS
+	#define INV_ICM20948_FIFO_PREFETCH_MAX_XFERS 8
+#endif
 
 /** @brief Struct for the fifo. this contains the sensor data */
 struct inv_fifo_decoded_t
@@ -132,11 +146,13 @@ int INV_EXPORT inv_icm20948_dmp_get_raw_compass(long raw_compass[3]);
 int INV_EXPORT inv_icm20948_dmp_get_calibrated_compass(long cal_compass[3]);
 
 /** @brief Decodes the fifo packet 
+* Driver states are not accessed: packets can be decoded from several threads.
+* @param[in] comp 		raw compass compensation, see inv_icm20948_compass_comp_sync()
 * @param[in] fifo_ptr 	pointer to the fifo data
 * @param[in] fd 		pointer to the fifo what contains the sensor data
 * @return 				0 on success, negative value on error.
 */	
-int INV_EXPORT inv_icm20948_inv_decode_one_ivory_fifo_packet(struct inv_icm20948 * s, struct inv_fifo_decoded_t *fd, const unsigned char *fifo_ptr);
+int INV_EXPORT inv_icm20948_inv_decode_one_ivory_fifo_packet(const struct inv_icm20948_compass_comp * comp, struct inv_fifo_decoded_t *fd, const unsigned char *fifo_ptr);
 
 /** @brief Gets the state of the BAC sensor
 * @param[in] bac_state	pointer for recuperate the state of BAC
@@ -200,6 +216,7 @@ int INV_EXPORT inv_icm20948_fifo_swmirror(struct inv_icm20948 * s, int *left_in_
 
 
 /** @brief Pop one sample out of SW FIFO
+* Compass samples are compensated with s->compass_cal.raw_comp, to be synced by the caller.
 * @param[out] user_header 	Header value read from SW FIFO
 * @param[out] user_header2 	Header2 value read from SW FIFO
 * @param[inout] left_in_fifo 	Contains number of bytes still be parsed from SW FIFO
@@ -207,6 +224,33 @@ int INV_EXPORT inv_icm20948_fifo_swmirror(struct inv_icm20948 * s, int *left_in_
 */	
 int INV_EXPORT inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header, unsigned short *user_header2, int *left_in_fifo);
 
+/** @brief Start asynchronous refill of SW FIFO
+* When serif supports asynchronous requests, inv_icm20948_fifo_swmirror() only reads first batch
+* of HW FIFO contents. This reads next batch with inv_icm20948_submit_mems_xfers() while samples
+* already mirrored are popped. Next call to inv_icm20948_fifo_swmirror() waits for the refill to be
+* over and appends data read to SW FIFO instead of reading HW FIFO.
+* @param[in] left_in_fifo 	number of bytes still to be parsed from SW FIFO
+* @return 			1 if refill was started, 0 if there is nothing left to read asynchronously.
+*/
+int INV_EXPORT inv_icm20948_fifo_prefetch_start(struct inv_icm20948 * s, int left_in_fifo);
+
+/** @brief Clear HW and SW FIFO and (re)start the DMP
+* Any asynchronous refill in progress is waited for and dropped.
+* @return 			0 on success, negative value on error.
+*/
+int INV_EXPORT inv_icm20948_dmp_reset_fifo(struct inv_icm20948 * s);
+
+/** @brief Check headers of the DMP FIFO packet at start of data and return its size
+* Does not rely on driver states, can be used on FIFO contents recorded on a host.
+* @param[in] data 	packet data
+* @param[in] len 	number of bytes available at data (packet may be longer)
+* @param[out] header 	packet header
+* @param[out] header2 	packet header2, 0 if not present
+* @return 			packet size, 0 if len is too short to hold the headers,
+*					-1 if headers are not valid (FIFO is not aligned on a packet).
+*/
+int INV_EXPORT inv_icm20948_fifo_packet_size(const unsigned char *data, unsigned int len, unsigned short *header, unsigned short *header2);
+
 #ifdef __cplusplus
 }
 #endif
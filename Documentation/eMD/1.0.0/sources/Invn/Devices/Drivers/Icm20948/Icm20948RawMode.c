@@ -0,0 +1,392 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948RawMode.h"
+
+#include "Icm20948Defs.h"
+#include "Icm20948DataBaseDriver.h"
+#include "Icm20948MPUFifoControl.h"
+
+/* bytes read from the FIFO before parsing, multiple of INV_MAX_SERIAL_READ */
+#define RAW_MODE_CHUNK_SIZE         240
+
+/* bytes of an accel or gyro sample in a FIFO record */
+#define RAW_MODE_SENSOR_SZ          (THREE_AXES * 2)
+
+/* largest data-ready burst: accel, gyro, temperature and EXT_SLV_SENS_DATA */
+#define RAW_MODE_BURST_MAX          (REG_EXT_SLV_SENS_DATA_00 + INV_ICM20948_AUX_EXT_DATA_SIZE - REG_ACCEL_XOUT_H_SH)
+
+/* bank 2, ODR start-time alignment of accel and gyro */
+#define REG_ODR_ALIGN_EN            (BANK_2 | 0x09)
+
+/* compass read window starts with ST1, preceded by one more register when set up for the DMP */
+#define RAW_MODE_CPASS_DATA(s)      ((s)->secondary_state.dmp_on ? 2 : 1)
+
+/** Raw sensor data to body frame, with the accel/gyro mounting matrix */
+static void raw_mode_to_body(struct inv_icm20948 * s, const uint8_t * d, long out[3])
+{
+	const signed char * m = s->mounting_matrix;
+	long in[3];
+	int i;
+
+	for (i = 0; i < THREE_AXES; i++)
+		in[i] = (int16_t)((d[2*i] << 8) | d[2*i + 1]);
+
+	for (i = 0; i < THREE_AXES; i++)
+		out[i] = m[3*i] * in[0] + m[3*i + 1] * in[1] + m[3*i + 2] * in[2];
+}
+
+static void raw_mode_report_compass(struct inv_icm20948 * s, const uint8_t * w, uint64_t timestamp, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg))
+{
+	const uint8_t * d = w + RAW_MODE_CPASS_DATA(s);
+	short raw[3];
+	float raw_bias_mag[6] = {0};
+	int accuracy = 0;
+	int i;
+
+	/* EXT_SLV_SENS_DATA is pushed to the FIFO with each record, whether the compass was read again or not */
+	if (!memcmp(s->raw_mode.cpass_last, w, s->raw_mode.cpass_len))
+		return;
+	memcpy(s->raw_mode.cpass_last, w, s->raw_mode.cpass_len);
+
+	for (i = 0; i < THREE_AXES; i++)
+		raw[i] = (short)((d[2*i] << 8) | d[2*i + 1]);
+	inv_icm20948_compass_comp_apply_f(&s->compass_cal.raw_comp, raw, raw_bias_mag, 1);
+
+	handler(context, INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED, timestamp, raw_bias_mag, &accuracy);
+}
+
+static void raw_mode_report(struct inv_icm20948 * s, const uint8_t * rec, uint64_t timestamp, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg))
+{
+	long out[3];
+	int accuracy = 0;
+
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_ACCEL) {
+		raw_mode_to_body(s, rec, out);
+		handler(context, INV_ICM20948_SENSOR_RAW_ACCELEROMETER, timestamp, out, &accuracy);
+	}
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_GYRO) {
+		raw_mode_to_body(s, &rec[s->raw_mode.gyro_offset], out);
+		handler(context, INV_ICM20948_SENSOR_RAW_GYROSCOPE, timestamp, out, &accuracy);
+	}
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_COMPASS)
+		raw_mode_report_compass(s, &rec[s->raw_mode.cpass_offset], timestamp, context, handler);
+}
+
+/** Setup record layout, return FIFO_EN value
+* FIFO records hold accel, gyro then EXT_SLV_SENS_DATA. In data-ready mode, a record is the burst
+* read of registers from first sensor data to last one, temperature included.
+*/
+static uint8_t raw_mode_layout(struct inv_icm20948 * s)
+{
+	uint8_t fifo_en = 0;
+	int i;
+
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_DATA_READY) {
+		const int id = s->secondary_state.compass_aux_id;
+		uint8_t end;
+
+		s->raw_mode.burst_reg = (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_ACCEL) ?
+				REG_ACCEL_XOUT_H_SH : REG_GYRO_XOUT_H_SH;
+		s->raw_mode.gyro_offset = REG_GYRO_XOUT_H_SH - s->raw_mode.burst_reg;
+		end = (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_GYRO) ?
+				REG_GYRO_XOUT_H_SH + RAW_MODE_SENSOR_SZ : REG_ACCEL_XOUT_H_SH + RAW_MODE_SENSOR_SZ;
+		if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_COMPASS) {
+			s->raw_mode.cpass_offset = REG_EXT_SLV_SENS_DATA_00 + s->secondary_state.aux_ext_offset[id] - s->raw_mode.burst_reg;
+			s->raw_mode.cpass_len = s->secondary_state.aux_dev[id].read_len;
+			end = s->raw_mode.burst_reg + s->raw_mode.cpass_offset + s->raw_mode.cpass_len;
+			memset(s->raw_mode.cpass_last, 0, sizeof(s->raw_mode.cpass_last));
+		}
+		s->raw_mode.record_size = end - s->raw_mode.burst_reg;
+		return 0;
+	}
+
+	s->raw_mode.record_size = 0;
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_ACCEL)
+		s->raw_mode.record_size += RAW_MODE_SENSOR_SZ;
+	s->raw_mode.gyro_offset = s->raw_mode.record_size;
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_GYRO)
+		s->raw_mode.record_size += RAW_MODE_SENSOR_SZ;
+
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_COMPASS) {
+		const int id = s->secondary_state.compass_aux_id;
+
+		/* read channels come first and fill EXT_SLV_SENS_DATA in channel order, so does the FIFO */
+		s->raw_mode.cpass_offset = s->raw_mode.record_size + s->secondary_state.aux_ext_offset[id];
+		s->raw_mode.cpass_len = s->secondary_state.aux_dev[id].read_len;
+		for (i = 0; i < s->secondary_state.aux_nb_slots; i++) {
+			if (!(s->secondary_state.aux_slot[i].addr & INV_MPU_BIT_I2C_READ) ||
+					!(s->secondary_state.aux_slot[i].ctrl & INV_MPU_BIT_SLV_EN))
+				continue;
+			fifo_en |= (BIT_SLV_0_FIFO_EN << i);
+			s->raw_mode.record_size += s->secondary_state.aux_slot[i].ctrl & 0x0F;
+		}
+		memset(s->raw_mode.cpass_last, 0, sizeof(s->raw_mode.cpass_last));
+	}
+
+	return fifo_en;
+}
+
+int inv_icm20948_raw_mode_start(struct inv_icm20948 * s, uint8_t sensors, int div)
+{
+	const uint8_t ag = sensors & (INV_ICM20948_RAW_MODE_ACCEL | INV_ICM20948_RAW_MODE_GYRO);
+	int result = 0;
+	uint8_t fifo_en, fifo_en_2 = 0;
+	uint8_t pwr_mgmt_2 = BIT_PWR_PRESSURE_STBY;
+	uint8_t gyro_config_1, accel_config;
+	uint8_t data[2];
+
+	if (!ag || (sensors & ~(ag | INV_ICM20948_RAW_MODE_COMPASS | INV_ICM20948_RAW_MODE_DATA_READY)) || div > 255 ||
+			(div < 0 && div != INV_ICM20948_RAW_MODE_DIV_BYPASS))
+		return INV_ERROR_BAD_ARG;
+	/* accel and gyro do not run at the same rate with DLPF bypassed */
+	if (div == INV_ICM20948_RAW_MODE_DIV_BYPASS &&
+			(ag != INV_ICM20948_RAW_MODE_ACCEL && ag != INV_ICM20948_RAW_MODE_GYRO))
+		return INV_ERROR_BAD_ARG;
+	if ((sensors & INV_ICM20948_RAW_MODE_COMPASS) &&
+			(div == INV_ICM20948_RAW_MODE_DIV_BYPASS || !s->s_compass_available))
+		return INV_ERROR_BAD_ARG;
+
+	if (s->raw_mode.on) {
+		if ((result = inv_icm20948_raw_mode_stop(s)) != 0)
+			return result;
+	}
+
+	result |= inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
+	inv_icm20948_hold_lpen_control(s);
+	result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 0);
+
+	s->raw_mode.cpass_resumed = 0;
+	if ((sensors & INV_ICM20948_RAW_MODE_COMPASS) && !s->secondary_state.secondary_resume_compass_state) {
+		result |= inv_icm20948_resume_akm(s);
+		s->raw_mode.cpass_resumed = 1;
+	}
+
+	/* save what is changed below and not cached in base_state */
+	result |= inv_icm20948_read_mems_reg(s, REG_LP_CONFIG, 1, &s->raw_mode.saved.lp_config);
+	result |= inv_icm20948_read_mems_reg(s, REG_FIFO_CFG, 1, &s->raw_mode.saved.fifo_cfg);
+	result |= inv_icm20948_read_mems_reg(s, REG_FIFO_EN, 1, &s->raw_mode.saved.fifo_en);
+	result |= inv_icm20948_read_mems_reg(s, REG_GYRO_CONFIG_1, 1, &s->raw_mode.saved.gyro_config_1);
+	result |= inv_icm20948_read_mems_reg(s, REG_ACCEL_CONFIG, 1, &s->raw_mode.saved.accel_config);
+	result |= inv_icm20948_read_mems_reg(s, REG_ODR_ALIGN_EN, 1, &s->raw_mode.saved.odr_align_en);
+	result |= inv_icm20948_read_mems_reg(s, REG_INT_ENABLE_1, 1, &s->raw_mode.saved.int_enable_1);
+	s->raw_mode.saved.pwr_mgmt_2 = s->base_state.pwr_mgmt_2;
+	if (result)
+		goto error;
+
+	/* stop DMP and FIFO */
+	s->base_state.user_ctrl &= ~(BIT_DMP_EN | BIT_FIFO_EN);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_USER_CTRL, s->base_state.user_ctrl);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN, 0);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN_2, 0);
+
+	/* low noise mode, sensors on, keeping full scale ranges */
+	result |= inv_icm20948_write_single_mems_reg(s, REG_LP_CONFIG, BIT_I2C_MST_CYCLE);
+	if (sensors & INV_ICM20948_RAW_MODE_ACCEL)
+		fifo_en_2 |= BIT_ACCEL_FIFO_EN;
+	else
+		pwr_mgmt_2 |= BIT_PWR_ACCEL_STBY;
+	if (sensors & INV_ICM20948_RAW_MODE_GYRO)
+		fifo_en_2 |= BITS_GYRO_FIFO_EN;
+	else
+		pwr_mgmt_2 |= BIT_PWR_GYRO_STBY;
+	result |= inv_icm20948_write_single_mems_reg(s, REG_PWR_MGMT_2, pwr_mgmt_2);
+
+	gyro_config_1 = s->raw_mode.saved.gyro_config_1 & (0x03 << SHIFT_GYRO_FS_SEL);
+	accel_config = s->raw_mode.saved.accel_config & (0x03 << SHIFT_ACCEL_FS);
+	if (div == INV_ICM20948_RAW_MODE_DIV_BYPASS) {
+		s->raw_mode.period_us = 1000000UL / ((sensors & INV_ICM20948_RAW_MODE_GYRO) ?
+				INV_ICM20948_RAW_MODE_GYRO_BYPASS_HZ : INV_ICM20948_RAW_MODE_ACCEL_BYPASS_HZ);
+	} else {
+		gyro_config_1 |= (INV_ICM20948_RAW_MODE_DLPCFG << SHIFT_GYRO_DLPCFG) | 1;
+		accel_config |= (INV_ICM20948_RAW_MODE_DLPCFG << 3) | 1;
+		s->raw_mode.period_us = (1000000UL * (1 + div)) / INV_ICM20948_RAW_MODE_BASE_HZ;
+	}
+	result |= inv_icm20948_write_single_mems_reg(s, REG_GYRO_CONFIG_1, gyro_config_1);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_ACCEL_CONFIG, accel_config);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_ODR_ALIGN_EN, 1);
+	s->raw_mode.div = (int16_t)div;
+	if (div < 0)
+		div = 0;
+	result |= inv_icm20948_write_single_mems_reg(s, REG_GYRO_SMPLRT_DIV, (uint8_t)div);
+	data[0] = 0;
+	data[1] = (uint8_t)div;
+	result |= inv_icm20948_write_mems_reg(s, REG_ACCEL_SMPLRT_DIV_1, 2, data);
+
+	s->raw_mode.sensors = sensors;
+	fifo_en = raw_mode_layout(s);
+	if (sensors & INV_ICM20948_RAW_MODE_DATA_READY) {
+		/* raise an interrupt for each new sample */
+		result |= inv_icm20948_write_single_mems_reg(s, REG_INT_ENABLE_1, BIT_DATA_RDY_0_EN);
+	} else {
+		/* clear FIFO and route raw data to it */
+		result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_CFG, BIT_SINGLE_FIFO_CFG);
+		result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, MAX_5_BIT_VALUE);
+		result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, 0);
+		s->base_state.user_ctrl |= BIT_FIFO_EN;
+		result |= inv_icm20948_write_single_mems_reg(s, REG_USER_CTRL, s->base_state.user_ctrl);
+		result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN, fifo_en);
+		result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN_2, fifo_en_2);
+	}
+
+	s->raw_mode.last_ts = 0;
+	s->raw_mode.on = 1;
+	if (result)
+		inv_icm20948_raw_mode_stop(s);
+
+	return result;
+
+error:
+	if (s->raw_mode.cpass_resumed)
+		inv_icm20948_suspend_akm(s);
+	inv_icm20948_release_lpen_control(s);
+	return result;
+}
+
+int inv_icm20948_raw_mode_stop(struct inv_icm20948 * s)
+{
+	int result = 0;
+	unsigned char data[2];
+
+	if (!s->raw_mode.on)
+		return 0;
+
+	result |= inv_icm20948_write_single_mems_reg(s, REG_INT_ENABLE_1, s->raw_mode.saved.int_enable_1);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN_2, 0);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN, s->raw_mode.saved.fifo_en);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_CFG, s->raw_mode.saved.fifo_cfg);
+
+	/* DMP settings */
+	result |= inv_icm20948_write_single_mems_reg(s, REG_GYRO_CONFIG_1, s->raw_mode.saved.gyro_config_1);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_ACCEL_CONFIG, s->raw_mode.saved.accel_config);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_ODR_ALIGN_EN, s->raw_mode.saved.odr_align_en);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_GYRO_SMPLRT_DIV, s->base_state.gyro_div);
+	data[0] = (unsigned char)(s->base_state.accel_div >> 8);
+	data[1] = (unsigned char)(s->base_state.accel_div & 0xff);
+	result |= inv_icm20948_write_mems_reg(s, REG_ACCEL_SMPLRT_DIV_1, 2, data);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_PWR_MGMT_2, s->raw_mode.saved.pwr_mgmt_2);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_LP_CONFIG, s->raw_mode.saved.lp_config);
+
+	if (s->raw_mode.cpass_resumed) {
+		result |= inv_icm20948_suspend_akm(s);
+		s->raw_mode.cpass_resumed = 0;
+	}
+
+	s->raw_mode.on = 0;
+
+	/* clear FIFO and restart DMP, timestamps start over on first DMP batch */
+	result |= inv_icm20948_dmp_reset_fifo(s);
+	memset(s->timestamp, 0, sizeof(s->timestamp));
+
+	inv_icm20948_release_lpen_control(s);
+
+	return result;
+}
+
+int inv_icm20948_raw_mode_is_on(struct inv_icm20948 * s)
+{
+	return s->raw_mode.on;
+}
+
+int inv_icm20948_raw_mode_poll(struct inv_icm20948 * s, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg))
+{
+	uint8_t d[RAW_MODE_CHUNK_SIZE];
+	uint8_t fifo_count[FIFO_COUNT_BYTE];
+	const int record_size = s->raw_mode.record_size;
+	int count, len, bytes, i;
+	uint64_t now, step;
+
+	if (!s->raw_mode.on)
+		return 0;
+
+	/* data-ready interrupt not serviced by inv_icm20948_raw_mode_data_ready(), sample is timestamped now */
+	if (s->raw_mode.sensors & INV_ICM20948_RAW_MODE_DATA_READY) {
+		uint8_t int_status_1;
+
+		if (inv_icm20948_read_mems_reg(s, REG_INT_STATUS_1, 1, &int_status_1))
+			return INV_ERROR_TRANSPORT;
+		if (!(int_status_1 & BIT_DATA_RDY_0_EN))
+			return 0;
+		return inv_icm20948_raw_mode_data_ready(s, inv_icm20948_get_time_us(), context, handler);
+	}
+
+	if (inv_icm20948_read_mems_reg(s, REG_FIFO_COUNT_H, FIFO_COUNT_BYTE, fifo_count))
+		return INV_ERROR_TRANSPORT;
+	now = inv_icm20948_get_time_us();
+	count = (fifo_count[0] << 8) | fifo_count[1];
+
+	// records are no longer aligned once FIFO overflowed
+	if (count >= HARDWARE_FIFO_SIZE) {
+		inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, MAX_5_BIT_VALUE);
+		inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, 0);
+		s->raw_mode.last_ts = 0;
+		return INV_ERROR_SIZE;
+	}
+
+	count /= record_size;
+	if (count == 0)
+		return 0;
+
+	/* last record read was sampled at about now, previous ones are spread since last call */
+	if (s->raw_mode.last_ts == 0 || now <= s->raw_mode.last_ts) {
+		step = s->raw_mode.period_us;
+		s->raw_mode.last_ts = now - count * step;
+	} else {
+		step = (now - s->raw_mode.last_ts) / count;
+	}
+
+	inv_icm20948_compass_comp_sync(s, &s->compass_cal.raw_comp, 0);
+
+	while (count > 0) {
+		len = min(count, RAW_MODE_CHUNK_SIZE / record_size);
+
+		// FIFO_R_W does not auto-increment, so each burst is limited to INV_MAX_SERIAL_READ bytes
+		for (bytes = 0; bytes < len * record_size; bytes += INV_MAX_SERIAL_READ) {
+			if (inv_icm20948_read_mems_reg(s, REG_FIFO_R_W,
+					min(INV_MAX_SERIAL_READ, len * record_size - bytes), &d[bytes]))
+				return INV_ERROR_TRANSPORT;
+		}
+
+		for (i = 0; i < len; i++) {
+			s->raw_mode.last_ts += step;
+			raw_mode_report(s, &d[i * record_size], s->raw_mode.last_ts, context, handler);
+		}
+
+		count -= len;
+	}
+
+	return 0;
+}
+
+int inv_icm20948_raw_mode_data_ready(struct inv_icm20948 * s, uint64_t timestamp, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg))
+{
+	uint8_t d[RAW_MODE_BURST_MAX];
+
+	if (!s->raw_mode.on || !(s->raw_mode.sensors & INV_ICM20948_RAW_MODE_DATA_READY))
+		return 0;
+
+	if (inv_icm20948_read_mems_reg_burst(s, s->raw_mode.burst_reg, s->raw_mode.record_size, d))
+		return INV_ERROR_TRANSPORT;
+
+	s->raw_mode.last_ts = timestamp;
+	inv_icm20948_compass_comp_sync(s, &s->compass_cal.raw_comp, 0);
+	raw_mode_report(s, d, timestamp, context, handler);
+
+	return 0;
+}
+
+/** @} */
@@ -0,0 +1,132 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_RAW_MODE_H__
+#define INV_ICM20948_RAW_MODE_H__
+
+/** @defgroup	icm20948_raw_mode	raw_mode
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include "Icm20948Setup.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Sensors that can be streamed in raw mode
+ */
+#define INV_ICM20948_RAW_MODE_ACCEL       0x01
+#define INV_ICM20948_RAW_MODE_GYRO        0x02
+#define INV_ICM20948_RAW_MODE_COMPASS     0x04	/**< EXT_SLV_SENS_DATA of the auxiliary compass */
+#define INV_ICM20948_RAW_MODE_DATA_READY  0x08	/**< read data registers on data-ready interrupt instead of FIFO */
+
+/** @brief Divider value selecting DLPF bypass (FCHOICE=0)
+ *  Gyro then runs at INV_ICM20948_RAW_MODE_GYRO_BYPASS_HZ and accel at
+ *  INV_ICM20948_RAW_MODE_ACCEL_BYPASS_HZ. Only one of them can be streamed.
+ */
+#define INV_ICM20948_RAW_MODE_DIV_BYPASS  (-1)
+
+/** @brief Rates in Hz of the hardware FIFO in raw mode
+ *  With DLPF enabled, FIFO rate is INV_ICM20948_RAW_MODE_BASE_HZ / (1 + div).
+ */
+#define INV_ICM20948_RAW_MODE_BASE_HZ         1125
+#define INV_ICM20948_RAW_MODE_GYRO_BYPASS_HZ  9000
+#define INV_ICM20948_RAW_MODE_ACCEL_BYPASS_HZ 4500
+
+/** @brief DLPF setting (GYRO_DLPFCFG and ACCEL_DLPFCFG) used when DLPF is enabled
+ *  7 is the widest bandwidth (361 Hz for gyro, 473 Hz for accel).
+ */
+#ifndef INV_ICM20948_RAW_MODE_DLPCFG
+#define INV_ICM20948_RAW_MODE_DLPCFG      7
+#endif
+
+/** @brief Disable the DMP and stream raw sensor data from the hardware FIFO
+ *  Records are made of accel x,y,z (if streamed), gyro x,y,z (if streamed)
+ *  then, if the compass is streamed, the EXT_SLV_SENS_DATA bytes of all auxiliary
+ *  read channels. No DMP packet header is involved: all records have the same size.
+ *  Accel/gyro full scale ranges are kept. If raw mode is already on, it is
+ *  reconfigured. DMP sensors cannot be enabled or configured until
+ *  inv_icm20948_raw_mode_stop() is called.
+ *  With INV_ICM20948_RAW_MODE_DATA_READY, the FIFO is not used: the data-ready interrupt
+ *  is enabled on INT pin and each sample is read from data registers by
+ *  inv_icm20948_raw_mode_data_ready().
+ *  @param[in]  s        driver states
+ *  @param[in]  sensors  INV_ICM20948_RAW_MODE_xxx mask (accel and/or gyro required)
+ *  @param[in]  div      sample rate divider in [0, 255] applied to both accel and gyro,
+ *                       or INV_ICM20948_RAW_MODE_DIV_BYPASS
+ *  @return     0 on success, INV_ERROR_BAD_ARG if the configuration is not supported,
+ *              negative value on other errors
+ */
+int INV_EXPORT inv_icm20948_raw_mode_start(struct inv_icm20948 * s, uint8_t sensors, int div);
+
+/** @brief Stop raw mode and restart the DMP
+ *  Registers changed by inv_icm20948_raw_mode_start() are restored, FIFO is cleared
+ *  and sensor timestamps are restarted.
+ *  @param[in]  s    driver states
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_raw_mode_stop(struct inv_icm20948 * s);
+
+/** @brief Return 1 if raw mode is on, 0 otherwise
+ */
+int INV_EXPORT inv_icm20948_raw_mode_is_on(struct inv_icm20948 * s);
+
+/** @brief Read and deliver all complete records available in the FIFO
+ *  No interrupt is raised in FIFO raw mode: this must be called periodically, often enough
+ *  for the FIFO (HARDWARE_FIFO_SIZE bytes) not to overflow. Called by inv_icm20948_poll_sensor()
+ *  while raw mode is on.
+ *  Accel and gyro are delivered as INV_ICM20948_SENSOR_RAW_ACCELEROMETER and
+ *  INV_ICM20948_SENSOR_RAW_GYROSCOPE (long[3], raw LSB in body frame). Compass is
+ *  delivered as INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED (float[6], uT with zero bias)
+ *  each time the compass read window changes.
+ *  Timestamps are spread between previous call and this one.
+ *  @param[in]  s        driver states
+ *  @param[in]  context  passed to handler
+ *  @param[in]  handler  same handler as for inv_icm20948_poll_sensor()
+ *  @return     0 on success, INV_ERROR_SIZE if the FIFO overflowed (it is then cleared),
+ *              INV_ERROR_TRANSPORT on bus error
+ */
+int INV_EXPORT inv_icm20948_raw_mode_poll(struct inv_icm20948 * s, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg));
+
+/** @brief Read and deliver latest sample in data-ready mode
+ *  To be called upon data-ready interrupt, with the timestamp captured by the interrupt handler,
+ *  for the lowest latency between sampling and delivery. Accel, gyro and compass are read in
+ *  a single burst of consecutive registers and delivered with that timestamp, as by
+ *  inv_icm20948_raw_mode_poll(). If the interrupt is not serviced, inv_icm20948_raw_mode_poll()
+ *  checks data-ready status and calls this function with current time.
+ *  @param[in]  s          driver states
+ *  @param[in]  timestamp  data-ready interrupt time in us
+ *  @param[in]  context    passed to handler
+ *  @param[in]  handler    same handler as for inv_icm20948_poll_sensor()
+ *  @return     0 on success (nothing done if data-ready mode is off),
+ *              INV_ERROR_TRANSPORT on bus error
+ */
+int INV_EXPORT inv_icm20948_raw_mode_data_ready(struct inv_icm20948 * s, uint64_t timestamp, void * context,
+		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INV_ICM20948_RAW_MODE_H__
+
+/** @} */
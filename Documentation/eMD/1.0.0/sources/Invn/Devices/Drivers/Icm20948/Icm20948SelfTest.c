@@ -12,6 +12,7 @@
  
 #include "Icm20948.h"
 #include "Icm20948SelfTest.h"
+#include "Icm20948Capture.h"
  
 #include "Icm20948Defs.h"
 #include "Icm20948DataBaseDriver.h"
@@ -27,8 +28,8 @@
 #define SELFTEST_ACCEL_SMPLRT_DIV       10
 #define SELFTEST_ACCEL_DEC3_CFG     	2
 
-/* wait time in ms between 2 data collection */
-#define WAIT_TIME_BTW_2_SAMPLESREAD     10
+/* wait time in ms after soft reset */
+#define SELFTEST_RESET_TIME             100
 /* wait time in ms after sensor self-test enabling for oscillations to stabilize */
 #define DEF_ST_STABLE_TIME              20 //ms
 /* number of times self test reading should be done until abord */
@@ -39,28 +40,6 @@
 #define LOWER_BOUND_CHECK(value) ((value)>>1) // value * 0.5
 #define UPPER_BOUND_CHECK(value) ((value) + ((value)>>1) ) // value * 1.5
 
-struct recover_regs {
-	// Bank#0
-	uint8_t fifo_cfg;			// REG_FIFO_CFG
-	uint8_t user_ctrl;			// REG_USER_CTRL
-	uint8_t lp_config;			// REG_LP_CONFIG
-	uint8_t int_enable;			// REG_INT_ENABLE
-	uint8_t int_enable_1;		// REG_INT_ENABLE_1
-    uint8_t int_enable_2;       // REG_INT_ENABLE_2
-	uint8_t fifo_en;				// REG_FIFO_EN
-	uint8_t fifo_en_2;			// REG_FIFO_EN_2
-	uint8_t fifo_rst;			// REG_FIFO_RST
-    
-	// Bank#2
-	uint8_t gyro_smplrt_div;		// REG_GYRO_SMPLRT_DIV
-	uint8_t gyro_config_1;		// REG_GYRO_CONFIG_1
-	uint8_t gyro_config_2;		// REG_GYRO_CONFIG_2
-	uint8_t accel_smplrt_div_1;	// REG_ACCEL_SMPLRT_DIV_1
-	uint8_t accel_smplrt_div_2;	// REG_ACCEL_SMPLRT_DIV_2
-	uint8_t accel_config;		// REG_ACCEL_CONFIG
-	uint8_t accel_config_2;		// REG_ACCEL_CONFIG_2
-};
-
 // Table for list of results for factory self-test value equation
 // st_otp = 2620/2^FS * 1.01^(st_value - 1)
 // for gyro and accel FS = 0 so 2620 * 1.01^(st_value - 1)
@@ -102,7 +81,7 @@ static const uint16_t sSelfTestEquation[256] = {
 	30903, 31212, 31524, 31839, 32157, 32479, 32804
 };
 
-static int inv_save_setting(struct inv_icm20948 * s, struct recover_regs * saved_regs)
+static int inv_save_setting(struct inv_icm20948 * s, struct inv_icm20948_selftest_regs * saved_regs)
 {
 	int result = 0;
 
@@ -141,7 +120,7 @@ static int inv_save_setting(struct inv_icm20948 * s, struct recover_regs * saved
 	return result;
 }
 
-static int inv_recover_setting(struct inv_icm20948 * s, const struct recover_regs * saved_regs)
+static int inv_recover_setting(struct inv_icm20948 * s, const struct inv_icm20948_selftest_regs * saved_regs)
 {
 	int result = 0;
 
@@ -182,10 +161,16 @@ static int inv_recover_setting(struct inv_icm20948 * s, const struct recover_reg
 	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, saved_regs->fifo_rst);
 
 	// Reset DMP
+	// Caller must wait DMP_RESET_TIME before calling inv_recover_dmp()
 	result |= inv_icm20948_write_single_mems_reg(s, REG_USER_CTRL, 
                                      (saved_regs->user_ctrl & (~BIT_FIFO_EN)) | BIT_DMP_RST);
-	inv_icm20948_sleep_us(DMP_RESET_TIME*1000);
-    
+	return result;
+}
+
+static int inv_recover_dmp(struct inv_icm20948 * s)
+{
+	int result = 0;
+
     result |=inv_icm20948_set_dmp_address(s);
     result |=inv_icm20948_set_secondary(s);
     result |=inv_icm20948_setup_compass_akm(s);
@@ -251,7 +236,7 @@ static int inv_check_accelgyro_self_test(enum INV_SENSORS sensorType, uint8_t *
     return ret_val;
 }
 
-static int inv_setup_selftest(struct inv_icm20948 * s, struct recover_regs * recover_regs)
+static int inv_setup_selftest(struct inv_icm20948 * s, struct inv_icm20948_selftest_regs * recover_regs)
 {
 	int result = 0;
 
@@ -270,10 +255,17 @@ static int inv_setup_selftest(struct inv_icm20948 * s, struct recover_regs * rec
     
     /*   Perform a soft-reset of the chip by setting the MSB of PWR_MGMT_1 register
     * This will clear any prior states in the chip
+    * Caller must wait SELFTEST_RESET_TIME before calling inv_configure_selftest()
     */
     result |= inv_icm20948_write_single_mems_reg(s, REG_PWR_MGMT_1, BIT_H_RESET);               
-    inv_icm20948_sleep_us(100000); //100ms delay after soft reset--yd
-        
+
+	return result;
+}
+
+static int inv_configure_selftest(struct inv_icm20948 * s)
+{
+	int result = 0;
+
     // Wake up
     result |= inv_icm20948_write_single_mems_reg(s, REG_PWR_MGMT_1, BIT_CLK_PLL);
 	if (result)
@@ -313,160 +305,215 @@ static int inv_setup_selftest(struct inv_icm20948 * s, struct recover_regs * rec
 
 	result |= inv_icm20948_read_mems_reg(s, REG_SELF_TEST6, 1, &s->accel_st_data[2]);
 
-	// Restart sensors
-    inv_icm20948_sleep_us(GYRO_ENGINE_UP_TIME*1000);
-    
+	// Sensors are restarted by the FIFO setup, after GYRO_ENGINE_UP_TIME
 	return result;
 }
 
-static int inv_selftest_read_samples(struct inv_icm20948 * self, enum INV_SENSORS type, int *sum_result, int *s)
-{
-	uint8_t w;
-	int16_t vals[3];
-	uint8_t d[BYTES_PER_SENSOR];
-	int j;
-    
-	// Average 200 readings and save the averaged values as GX_OS, GY_OS, GZ_OS, AX_OS, AY_OS and AZ_OS. 
-	// - GX_OS = Average (GYRO_XOUT_H | GYRO_XOUT_L)
-	// - GY_OS = Average (GYRO_YOUT_H | GYRO_YOUT_L)
-	// - GZ_OS = Average (GYRO_ZOUT_H | GYRO_ZOUT_L)
-	// - AX_OS = Average (ACCEL_XOUT_H | ACCEL_XOUT_L)
-	// - AY_OS = Average (ACCEL_YOUT_H | ACCEL_YOUT_L)
-	// - AZ_OS = Average (ACCEL_ZOUT_H | ACCEL_ZOUT_L)
-
-    if (INV_SENSOR_GYRO == type)
-        w = REG_GYRO_XOUT_H_SH;
-    else
-        w = REG_ACCEL_XOUT_H_SH;
-    
-    while (*s < DEF_ST_SAMPLES) {
-        
-            if(inv_icm20948_read_mems_reg(self, w, BYTES_PER_SENSOR, d))
-                return -1;
-               
-            for (j = 0; j < THREE_AXES; j++) {
-                vals[j] = (d[(2*j)]<<8) | (d[(2*j)+ 1] & 0xff);
-                sum_result[j] += vals[j];
-            }
-
-            (*s)++;
-
-			inv_icm20948_sleep_us(WAIT_TIME_BTW_2_SAMPLESREAD*1000);
-    }
-	return 0;
-}
-
-/*
-*  inv_do_test_accelgyro() - do the actual test of self testing
-*/
-static int inv_do_test_accelgyro(struct inv_icm20948 * s, enum INV_SENSORS sensorType, int *meanValue, int *stMeanValue)
+static int inv_selftest_set_st_bit(struct inv_icm20948 * s, enum INV_SENSORS sensorType)
 {
-	int result, i, j;
-	int lNbSamples = 0;
-    
-    // initialize output to be 0
-	for (i = 0; i < THREE_AXES; i++) {
-		meanValue[i] = 0;
-		stMeanValue[i] = 0;
-	}
-	
-    // read the accel/gyro output
-    // the output values are 16 bits wide and in 2s complement
-    // Average 200 readings and save the averaged values
-    result = inv_selftest_read_samples(s, sensorType, meanValue, &lNbSamples);
-    if (result)
-        return result;
-	for (j = 0; j < THREE_AXES; j++) {
-		meanValue[j] /= lNbSamples;
-	}
-    
     // Set Self-Test Bit
     if (sensorType == INV_SENSOR_GYRO)
     {
         // Enable gyroscope Self-Test by setting register User Bank 2, Register Address 02 (02h) Bit [5:3] to b111
-        result = inv_icm20948_write_single_mems_reg(s, REG_GYRO_CONFIG_2, BIT_GYRO_CTEN | SELFTEST_GYRO_AVGCFG);
+        return inv_icm20948_write_single_mems_reg(s, REG_GYRO_CONFIG_2, BIT_GYRO_CTEN | SELFTEST_GYRO_AVGCFG);
     } else
     {
-        result = inv_icm20948_write_single_mems_reg(s, REG_ACCEL_CONFIG_2, BIT_ACCEL_CTEN | SELFTEST_ACCEL_DEC3_CFG);
+        return inv_icm20948_write_single_mems_reg(s, REG_ACCEL_CONFIG_2, BIT_ACCEL_CTEN | SELFTEST_ACCEL_DEC3_CFG);
     }
-    if (result)
-        return result;
-    
-    // Wait 20ms for oscillations to stabilize. 
-    inv_icm20948_sleep_us(DEF_ST_STABLE_TIME*1000);
-        
-    // Read the accel/gyro output and average 200 readings
-    // These readings are in units of LSBs
-    lNbSamples = 0; 
-    result = inv_selftest_read_samples(s, sensorType, stMeanValue, &lNbSamples);
-    if (result)
-        return result;
-	for (j = 0; j < THREE_AXES; j++) {
-		stMeanValue[j] /= lNbSamples;
+}
+
+static int inv_selftest_clear_st_bit(struct inv_icm20948 * s, enum INV_SENSORS sensorType)
+{
+    if (sensorType == INV_SENSOR_GYRO)
+        return inv_icm20948_write_single_mems_reg(s, REG_GYRO_CONFIG_2, SELFTEST_GYRO_AVGCFG);
+    else
+        return inv_icm20948_write_single_mems_reg(s, REG_ACCEL_CONFIG_2, SELFTEST_ACCEL_DEC3_CFG);
+}
+
+static enum INV_SENSORS inv_selftest_sensor(const struct inv_icm20948_selftest * st)
+{
+	return (st->sensor == 0) ? INV_SENSOR_GYRO : INV_SENSOR_ACCEL;
+}
+
+/* route sensor under test to the FIFO, samples are only accumulated */
+static int inv_selftest_start_capture(struct inv_icm20948 * s, struct inv_icm20948_selftest * st)
+{
+	return inv_icm20948_capture_start(s, &st->cap,
+			(st->sensor == 0) ? INV_ICM20948_CAPTURE_GYRO : INV_ICM20948_CAPTURE_ACCEL,
+			0, DEF_ST_SAMPLES);
+}
+
+static void inv_selftest_wait(struct inv_icm20948_selftest * st, uint8_t next_state, uint32_t wait_us)
+{
+	st->state = next_state;
+	st->deadline_us = inv_icm20948_get_time_us() + wait_us;
+}
+
+/* restart test of current sensor or give up if all attempts failed */
+static void inv_selftest_retry(struct inv_icm20948 * s, struct inv_icm20948_selftest * st)
+{
+	inv_icm20948_capture_stop(s);
+	inv_selftest_clear_st_bit(s, inv_selftest_sensor(st));
+	if (--st->tries > 0) {
+		st->state = INV_ICM20948_SELFTEST_START;
+	} else {
+		st->result = 0;
+		st->state = INV_ICM20948_SELFTEST_RECOVER;
 	}
-    
-	return 0;
 }
 
+void inv_icm20948_selftest_init(struct inv_icm20948_selftest * st)
+{
+	memset(st, 0, sizeof(*st));
+	st->state = INV_ICM20948_SELFTEST_SETUP;
+}
+
+int inv_icm20948_selftest_step(struct inv_icm20948 * s, struct inv_icm20948_selftest * st, uint32_t * next_us)
+{
+	uint64_t now = inv_icm20948_get_time_us();
+	int32_t mean[THREE_AXES];
+	int rc, j;
 
+	*next_us = 0;
 
+	// a settle time is not elapsed yet
+	if (st->deadline_us > now) {
+		*next_us = (uint32_t)(st->deadline_us - now);
+		return 1;
+	}
+
+	switch (st->state) {
+	case INV_ICM20948_SELFTEST_SETUP:
+		// save original state of the chip and reset it
+		st->result = 0;
+		if (inv_setup_selftest(s, &st->recover_regs)) {
+			st->state = INV_ICM20948_SELFTEST_RECOVER;
+			break;
+		}
+		inv_selftest_wait(st, INV_ICM20948_SELFTEST_CONFIGURE, SELFTEST_RESET_TIME*1000);
+		break;
+
+	case INV_ICM20948_SELFTEST_CONFIGURE:
+		// initialize registers, configure sensors and read ST values
+		if (inv_configure_selftest(s)) {
+			st->state = INV_ICM20948_SELFTEST_RECOVER;
+			break;
+		}
+		st->sensor = 0;
+		st->tries = DEF_ST_TRY_TIMES;
+		inv_selftest_wait(st, INV_ICM20948_SELFTEST_START, GYRO_ENGINE_UP_TIME*1000);
+		break;
+
+	case INV_ICM20948_SELFTEST_START:
+		// read the accel/gyro output
+		// the output values are 16 bits wide and in 2's complement
+		st->st_on = 0;
+		if (inv_selftest_start_capture(s, st)) {
+			inv_selftest_retry(s, st);
+			break;
+		}
+		st->state = INV_ICM20948_SELFTEST_COLLECT;
+		*next_us = INV_ICM20948_CAPTURE_POLL_TIME*1000;
+		break;
+
+	case INV_ICM20948_SELFTEST_COLLECT:
+		// Average 200 readings and save the averaged values as GX_OS, GY_OS, GZ_OS, AX_OS, AY_OS and AZ_OS. 
+		// FIFO overflow means the caller was too late, attempt is retried
+		rc = inv_icm20948_capture_poll(s, &st->cap);
+		if (rc < 0) {
+			inv_selftest_retry(s, st);
+			break;
+		}
+		if (rc > 0) {
+			*next_us = INV_ICM20948_CAPTURE_POLL_TIME*1000;
+			break;
+		}
+		inv_icm20948_capture_get_stats(&st->cap, mean, 0);
+		for (j = 0; j < THREE_AXES; j++)
+			st->mean[st->sensor][st->st_on][j] = mean[j];
+
+		if (!st->st_on) {
+			if (inv_icm20948_capture_stop(s) || inv_selftest_set_st_bit(s, inv_selftest_sensor(st))) {
+				inv_selftest_retry(s, st);
+				break;
+			}
+			// Wait 20ms for oscillations to stabilize. 
+			inv_selftest_wait(st, INV_ICM20948_SELFTEST_START_ST, DEF_ST_STABLE_TIME*1000);
+		} else if (st->sensor == 0) {
+			// perform self test for accel
+			inv_icm20948_capture_stop(s);
+			st->sensor = 1;
+			st->tries = DEF_ST_TRY_TIMES;
+			st->state = INV_ICM20948_SELFTEST_START;
+		} else {
+			inv_icm20948_capture_stop(s);
+			st->state = INV_ICM20948_SELFTEST_CHECK;
+		}
+		break;
+
+	case INV_ICM20948_SELFTEST_START_ST:
+		// Read the accel/gyro output and average 200 readings
+		// These readings are in units of LSBs
+		st->st_on = 1;
+		if (inv_selftest_start_capture(s, st)) {
+			inv_selftest_retry(s, st);
+			break;
+		}
+		st->state = INV_ICM20948_SELFTEST_COLLECT;
+		*next_us = INV_ICM20948_CAPTURE_POLL_TIME*1000;
+		break;
+
+	case INV_ICM20948_SELFTEST_CHECK:
+	{
+		// check values read at various steps
+		char accel_result = !inv_check_accelgyro_self_test(INV_SENSOR_ACCEL, s->accel_st_data, st->mean[1][0], st->mean[1][1]);
+		char gyro_result = !inv_check_accelgyro_self_test(INV_SENSOR_GYRO, s->gyro_st_data, st->mean[0][0], st->mean[0][1]);
+		char compass_result = !inv_icm20948_check_akm_self_test(s);
+
+		st->result = (compass_result << 2) |
+		             (accel_result   << 1) |
+		              gyro_result;
+		st->state = INV_ICM20948_SELFTEST_RECOVER;
+		break;
+	}
+
+	case INV_ICM20948_SELFTEST_RECOVER:
+		// restore original state of the chips
+		inv_recover_setting(s, &st->recover_regs);
+		inv_selftest_wait(st, INV_ICM20948_SELFTEST_RESTART_DMP, DMP_RESET_TIME*1000);
+		break;
+
+	case INV_ICM20948_SELFTEST_RESTART_DMP:
+		inv_recover_dmp(s);
+		st->state = INV_ICM20948_SELFTEST_DONE;
+		return 0;
+
+	case INV_ICM20948_SELFTEST_DONE:
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+int inv_icm20948_selftest_get_result(const struct inv_icm20948_selftest * st)
+{
+	return st->result;
+}
 
 int inv_icm20948_run_selftest(struct inv_icm20948 * s)
 {
-	int result;
-	int gyro_bias_st[THREE_AXES], gyro_bias_regular[THREE_AXES];
-	int accel_bias_st[THREE_AXES], accel_bias_regular[THREE_AXES];
-	int test_times;
-	char accel_result, gyro_result, compass_result;
-    struct recover_regs recover_regs;
-	
-	accel_result = 0;
-	gyro_result = 0;
-	compass_result = 0;
-    
-	// save original state of the chip, initialize registers, configure sensors and read ST values
-    result = inv_setup_selftest(s, &recover_regs);
-    if (result)
-		goto test_fail;
-    
-	// perform self test for gyro
-	test_times = DEF_ST_TRY_TIMES;	
-	while (test_times > 0) {
-		result = inv_do_test_accelgyro(s, INV_SENSOR_GYRO, gyro_bias_regular, gyro_bias_st);
-		if (result)
-			test_times--;
-        else
-            break;
-	}
-	if (result)
-		goto test_fail;    
-    
-	// perform self test for accel
-	test_times = DEF_ST_TRY_TIMES;
-	while (test_times > 0) {
-		result = inv_do_test_accelgyro(s, INV_SENSOR_ACCEL, accel_bias_regular, accel_bias_st);
-		if (result)
-			test_times--;
-        else
-            break;
+	struct inv_icm20948_selftest st;
+	uint32_t next_us;
+
+	inv_icm20948_selftest_init(&st);
+	while (inv_icm20948_selftest_step(s, &st, &next_us)) {
+		if (next_us)
+			inv_icm20948_sleep_us(next_us);
 	}
-	if (result)
-		goto test_fail;
-    
-	// check values read at various steps
-	accel_result = !inv_check_accelgyro_self_test(INV_SENSOR_ACCEL, s->accel_st_data, accel_bias_regular, accel_bias_st);
-	gyro_result = !inv_check_accelgyro_self_test(INV_SENSOR_GYRO, s->gyro_st_data, gyro_bias_regular, gyro_bias_st);
-	compass_result = !inv_icm20948_check_akm_self_test(s);
-    
-test_fail:
-	// restore original state of the chips
-	inv_recover_setting(s, &recover_regs);
 
-    return (compass_result << 2) |
-           (accel_result   << 1) |
-            gyro_result;
+	return inv_icm20948_selftest_get_result(&st);
 }
  /**
  * @}
  */
- 
@@ -13,10 +13,16 @@
 #ifndef INV_ICM20948_EMS_SELF_TEST_H__
 #define INV_ICM20948_EMS_SELF_TEST_H__
 
+#include "Invn/InvExport.h"
+
+#include "Icm20948Capture.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #define INV_ICM20948_GYR_SELF_TEST_OK  (0x01 << 0)
 #define INV_ICM20948_ACC_SELF_TEST_OK  (0x01 << 1)
 #define INV_ICM20948_MAG_SELF_TEST_OK  (0x01 << 2)
@@ -26,8 +32,90 @@ extern "C" {
 
 /* forward declaration */
 struct inv_icm20948;
+
+/** @brief Registers saved before self-test and restored once done
+ */
+struct inv_icm20948_selftest_regs {
+	// Bank#0
+	uint8_t fifo_cfg;			// REG_FIFO_CFG
+	uint8_t user_ctrl;			// REG_USER_CTRL
+	uint8_t lp_config;			// REG_LP_CONFIG
+	uint8_t int_enable;			// REG_INT_ENABLE
+	uint8_t int_enable_1;		// REG_INT_ENABLE_1
+	uint8_t int_enable_2;		// REG_INT_ENABLE_2
+	uint8_t fifo_en;			// REG_FIFO_EN
+	uint8_t fifo_en_2;			// REG_FIFO_EN_2
+	uint8_t fifo_rst;			// REG_FIFO_RST
+	// Bank#2
+	uint8_t gyro_smplrt_div;		// REG_GYRO_SMPLRT_DIV
+	uint8_t gyro_config_1;		// REG_GYRO_CONFIG_1
+	uint8_t gyro_config_2;		// REG_GYRO_CONFIG_2
+	uint8_t accel_smplrt_div_1;	// REG_ACCEL_SMPLRT_DIV_1
+	uint8_t accel_smplrt_div_2;	// REG_ACCEL_SMPLRT_DIV_2
+	uint8_t accel_config;		// REG_ACCEL_CONFIG
+	uint8_t accel_config_2;		// REG_ACCEL_CONFIG_2
+};
+
+/** @brief Steps of the self-test state machine
+ */
+enum inv_icm20948_selftest_state {
+	INV_ICM20948_SELFTEST_SETUP = 0,   /**< save settings and soft-reset the chip */
+	INV_ICM20948_SELFTEST_CONFIGURE,   /**< configure sensors and read ST codes */
+	INV_ICM20948_SELFTEST_START,       /**< start collecting normal output */
+	INV_ICM20948_SELFTEST_COLLECT,     /**< accumulate samples from the FIFO */
+	INV_ICM20948_SELFTEST_START_ST,    /**< start collecting self-test output */
+	INV_ICM20948_SELFTEST_CHECK,       /**< check accel/gyro results and run compass self-test */
+	INV_ICM20948_SELFTEST_RECOVER,     /**< restore saved settings and reset the DMP */
+	INV_ICM20948_SELFTEST_RESTART_DMP, /**< restart DMP and compass once reset is done */
+	INV_ICM20948_SELFTEST_DONE,
+};
+
+/** @brief Context for non-blocking self-test
+ *  Fields are private to the driver.
+ */
+struct inv_icm20948_selftest {
+	uint8_t  state;           /**< one of enum inv_icm20948_selftest_state */
+	uint8_t  sensor;          /**< 0 for gyro, 1 for accel */
+	uint8_t  st_on;           /**< 1 if self-test bit is set */
+	uint8_t  tries;           /**< remaining attempts for current sensor */
+	struct inv_icm20948_capture cap; /**< FIFO capture of current phase */
+	int      mean[2][2][3];   /**< average [sensor][st_on][axis] */
+	uint64_t deadline_us;     /**< time until which current step must not run */
+	int      result;          /**< result mask once done */
+	struct inv_icm20948_selftest_regs recover_regs;
+};
+
+/**
+*  @brief      Prepare a non-blocking self-test for Accel, Gyro and Compass.
+*              No bus access is done.
+*  @param[out] st  self-test context
+*/
+void INV_EXPORT inv_icm20948_selftest_init(struct inv_icm20948_selftest * st);
+
+/**
+*  @brief      Run the next step of a self-test started with inv_icm20948_selftest_init().
+*              Never sleeps: settle times are enforced against inv_icm20948_get_time_us()
+*              and accel/gyro samples are read from the FIFO. Can be called from a scheduler
+*              task or from the data ready/FIFO interrupt handler. No other driver function
+*              must be called until the test is done.
+*  @param[in]  st       self-test context
+*  @param[out] next_us  delay in us after which the function should be called again
+*  @return     1 while the test is running, 0 once done (see inv_icm20948_selftest_get_result())
+*  @warning    Compass self-test is performed in a single step and blocks for the AKM
+*              measurement time.
+*/
+int INV_EXPORT inv_icm20948_selftest_step(struct inv_icm20948 * s, struct inv_icm20948_selftest * st,
+		uint32_t * next_us);
+
+/**
+*  @brief      Return result of a completed non-blocking self-test.
+*  @return     COMPASS_SUCESS<<2 | ACCEL_SUCCESS<<1 | GYRO_SUCCESS so 7 if all devices pass the self-test.
+*/
+int INV_EXPORT inv_icm20948_selftest_get_result(const struct inv_icm20948_selftest * st);
+
 /**
 *  @brief      Perform hardware self-test for Accel, Gyro and Compass.
+*              Blocking wrapper around inv_icm20948_selftest_step().
 *  @param[in]  None
 *  @return     COMPASS_SUCESS<<2 | ACCEL_SUCCESS<<1 | GYRO_SUCCESS so 7 if all devices pass the self-test.
 */
@@ -40,12 +40,37 @@ extern "C" {
 #include <stdint.h>
 #include <assert.h>
 
+/** @brief Descriptor for one register access of an asynchronous request
+ */
+struct inv_icm20948_serif_xfer {
+	uint8_t    reg;      /**< register address in currently selected bank */
+	uint8_t    write;    /**< 0 to read from register, 1 to write to register */
+	uint8_t *  buf;      /**< buffer to fill for a read, data to send for a write */
+	uint32_t   len;      /**< number of bytes, at most max_read (or max_write) */
+};
+
+/** @brief Completion callback for an asynchronous request
+ *  @param[in] cookie  value given at submission
+ *  @param[in] status  0 if all transfers succeeded, non-zero otherwise
+ */
+typedef void (*inv_icm20948_serif_done_t)(void * cookie, int status);
+
 /** @brief ICM20948 serial interface
+ *
+ *  submit is optional and may be left NULL. When set, it must queue the count
+ *  transfers described by xfers (to be executed in order, eg: by DMA) and return
+ *  immediately, then call done once all of them are over. done may be called
+ *  from interrupt context or before submit returns. xfers and their buffers
+ *  must not be accessed anymore once done was called.
+ *  Only one request is submitted at a time and read_reg/write_reg are not
+ *  called while a request is in progress.
  */
 struct inv_icm20948_serif {
 	void *     context;
 	int      (*read_reg)(void * context, uint8_t reg, uint8_t * buf, uint32_t len);
 	int      (*write_reg)(void * context, uint8_t reg, const uint8_t * buf, uint32_t len);
+	int      (*submit)(void * context, const struct inv_icm20948_serif_xfer * xfers,
+	                   uint32_t count, inv_icm20948_serif_done_t done, void * cookie);
 	uint32_t   max_read;
 	uint32_t   max_write;
 	inv_bool_t is_spi;
@@ -100,6 +125,35 @@ static inline int inv_icm20948_serif_write_reg(struct inv_icm20948_serif * s,
 	return 0;
 }
 
+static inline inv_bool_t inv_icm20948_serif_can_submit(struct inv_icm20948_serif * s)
+{
+	assert(s);
+
+	return (s->submit != 0);
+}
+
+static inline int inv_icm20948_serif_submit(struct inv_icm20948_serif * s,
+		const struct inv_icm20948_serif_xfer * xfers, uint32_t count,
+		inv_icm20948_serif_done_t done, void * cookie)
+{
+	uint32_t i;
+
+	assert(s);
+
+	if(!s->submit)
+		return INV_ERROR_NIMPL;
+
+	for(i = 0; i < count; i++) {
+		if(xfers[i].len > (xfers[i].write ? s->max_write : s->max_read))
+			return INV_ERROR_SIZE;
+	}
+
+	if(s->submit(s->context, xfers, count, done, cookie) != 0)
+		return INV_ERROR_TRANSPORT;
+
+	return 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
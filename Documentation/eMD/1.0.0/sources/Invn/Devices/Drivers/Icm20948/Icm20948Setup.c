@@ -30,6 +30,7 @@
 #include "Icm20948Augmented.h"
 #include "Icm20948LoadFirmware.h"
 #include "Icm20948Dmp3Driver.h"
+#include "Icm20948CompassComp.h"
 
 #include "Invn/EmbUtils/DataConverter.h"
 #include "Invn/EmbUtils/Message.h"
@@ -102,16 +103,56 @@ enum inv_icm20948_sensor inv_icm20948_sensor_android_2_sensor_type(int sensor)
 	}
 }
 
+#define SENSOR_SLOT(name) (INV_ICM20948_CFG_##name ? INV_ICM20948_SLOT_##name : INV_ICM20948_SLOT_MAX)
+
+static const uint8_t sensor_slot[INV_ICM20948_SENSOR_MAX] = {
+	SENSOR_SLOT(ACCELEROMETER),
+	SENSOR_SLOT(GYROSCOPE),
+	SENSOR_SLOT(RAW_ACCELEROMETER),
+	SENSOR_SLOT(RAW_GYROSCOPE),
+	SENSOR_SLOT(MAGNETIC_FIELD_UNCALIBRATED),
+	SENSOR_SLOT(GYROSCOPE_UNCALIBRATED),
+	SENSOR_SLOT(ACTIVITY_CLASSIFICATON),
+	SENSOR_SLOT(STEP_DETECTOR),
+	SENSOR_SLOT(STEP_COUNTER),
+	SENSOR_SLOT(GAME_ROTATION_VECTOR),
+	SENSOR_SLOT(ROTATION_VECTOR),
+	SENSOR_SLOT(GEOMAGNETIC_ROTATION_VECTOR),
+	SENSOR_SLOT(GEOMAGNETIC_FIELD),
+	SENSOR_SLOT(WAKEUP_SIGNIFICANT_MOTION),
+	SENSOR_SLOT(FLIP_PICKUP),
+	SENSOR_SLOT(WAKEUP_TILT_DETECTOR),
+	SENSOR_SLOT(GRAVITY),
+	SENSOR_SLOT(LINEAR_ACCELERATION),
+	SENSOR_SLOT(ORIENTATION),
+	SENSOR_SLOT(B2S),
+};
+
+int inv_icm20948_sensor_slot(int sensor)
+{
+	if(sensor < 0 || sensor >= INV_ICM20948_SENSOR_MAX)
+		return INV_ICM20948_SLOT_MAX;
+
+	return sensor_slot[sensor];
+}
+
+#if INV_ICM20948_CFG_ACCELEROMETER || INV_ICM20948_CFG_GYROSCOPE || INV_ICM20948_CFG_RAW_ACCELEROMETER \
+	|| INV_ICM20948_CFG_RAW_GYROSCOPE || INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED \
+	|| INV_ICM20948_CFG_GEOMAGNETIC_FIELD || INV_ICM20948_CFG_MAGNETIC_FIELD_UNCALIBRATED \
+	|| INV_ICM20948_CFG_GAME_ROTATION_VECTOR || INV_ICM20948_CFG_ROTATION_VECTOR \
+	|| INV_ICM20948_CFG_GEOMAGNETIC_ROTATION_VECTOR || INV_ICM20948_CFG_ORIENTATION \
+	|| INV_ICM20948_CFG_GRAVITY || INV_ICM20948_CFG_LINEAR_ACCELERATION
 static int skip_sensor(struct inv_icm20948 * s, unsigned char androidSensor)
 {
-	enum inv_icm20948_sensor icm20948_sensor_id = inv_icm20948_sensor_android_2_sensor_type(androidSensor);
-	uint8_t skip_sample = s->skip_sample[icm20948_sensor_id];
+	const int slot = inv_icm20948_sensor_slot(inv_icm20948_sensor_android_2_sensor_type(androidSensor));
+	uint8_t skip_sample = s->skip_sample[slot];
 	
-	if (s->skip_sample[icm20948_sensor_id])
-		s->skip_sample[icm20948_sensor_id]--;
+	if (s->skip_sample[slot])
+		s->skip_sample[slot]--;
 
 	return skip_sample;
 }
+#endif
 
 /* Identification related functions */
 int inv_icm20948_get_whoami(struct inv_icm20948 * s, uint8_t * whoami)
@@ -141,15 +182,14 @@ void inv_icm20948_init_matrix(struct inv_icm20948 * s)
 
 int inv_icm20948_init_structure(struct inv_icm20948 * s)
 {
-	int i;
 	inv_icm20948_base_control_init(s);
 	inv_icm20948_transport_init(s);
 	inv_icm20948_augmented_init(s);
 	//Init state
 	s->set_accuracy = 0;
 	s->new_accuracy = 0;
-	for(i = 0; i < GENERAL_SENSORS_MAX; i ++)
-		s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] = 0;
+	/* warm_restart and warm_restarted are kept: setup calls this after initialization */
+	memset(s->timestamp, 0, sizeof(s->timestamp));
 		
 	return 0;
 }
@@ -173,6 +213,18 @@ int inv_icm20948_initialize(struct inv_icm20948 * s, const uint8_t *dmp3_image,
 	return 0;
 }
 
+void inv_icm20948_set_warm_restart(struct inv_icm20948 * s, inv_bool_t enable)
+{
+	/* On next inv_icm20948_initialize(), DMP image upload will be skipped if the image is
+	   still resident (ie: sensor kept power while host was reset) */
+	s->warm_restart = (enable) ? 1 : 0;
+}
+
+inv_bool_t inv_icm20948_is_warm_restarted(struct inv_icm20948 * s)
+{
+	return (s->warm_restarted != 0);
+}
+
 int inv_icm20948_init_scale(struct inv_icm20948 * s)
 {
 	/* Force accelero fullscale to 4g and gyr to 200dps */
@@ -429,12 +481,23 @@ int inv_icm20948_enable_sensor(struct inv_icm20948 * s, enum inv_icm20948_sensor
 {
 	uint8_t androidSensor = sensor_type_2_android_sensor(sensor);
 
+	/* sensor left out of the build, see Icm20948Config.h */
+	if(!inv_icm20948_sensor_is_built(sensor))
+		return INV_ERROR_NIMPL;
+
+	/* DMP is bypassed in raw mode */
+	if(s->raw_mode.on)
+		return -1;
+
+	if(s->fifo_log)
+		inv_icm20948_fifo_log_config(s, INV_ICM20948_FIFO_LOG_CONFIG_ENABLE, (uint8_t)sensor, state);
+
 	if(0!=inv_icm20948_ctrl_enable_sensor(s, androidSensor, state))
 		return -1;
 
 	//In case we disable a sensor, we reset his timestamp
 	if(state == 0)
-		s->timestamp[sensor] = 0;
+		s->timestamp[inv_icm20948_sensor_slot(sensor)] = 0;
 
 	return 0;
 }
@@ -443,12 +506,22 @@ int inv_icm20948_set_sensor_period(struct inv_icm20948 * s, enum inv_icm20948_se
 {
 	uint8_t androidSensor = sensor_type_2_android_sensor(sensor);
 
+	if(!inv_icm20948_sensor_is_built(sensor))
+		return INV_ERROR_NIMPL;
+
+	/* DMP is bypassed in raw mode */
+	if(s->raw_mode.on)
+		return -1;
+
+	if(s->fifo_log)
+		inv_icm20948_fifo_log_config(s, INV_ICM20948_FIFO_LOG_CONFIG_PERIOD, (uint8_t)sensor, period);
+
 	if(0!=inv_icm20948_set_odr(s, androidSensor, period))
 		return -1;
 	
 	// reset timestamp value and save current odr
-	s->timestamp[sensor] = 0;
-	s->sensorlist[sensor].odr_us = period * 1000;
+	s->timestamp[inv_icm20948_sensor_slot(sensor)] = 0;
+	s->sensorlist[inv_icm20948_sensor_slot(sensor)].odr_us = period * 1000;
 	return 0; 
 }
 
@@ -460,10 +533,12 @@ int inv_icm20948_enable_batch_timeout(struct inv_icm20948 * s, unsigned short ba
 		/* If configuration was succesful then we enable it */
 		if((rc = inv_icm20948_ctrl_enable_batch(s, 1)) != 0)
 			return rc;
+		s->sBatchTimeoutMs = batchTimeoutMs;
 	} else {         
 		/* Else we disable it */
 		if((rc = inv_icm20948_ctrl_enable_batch(s, 0)) != 0)
 			return rc;                     
+		s->sBatchTimeoutMs = 0;
 	}
 	return 0;
 }
@@ -503,26 +578,21 @@ static uint8_t inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in
 	if (inv_icm20948_fifo_swmirror(s, data_left_in_fifo, total_sample_cnt, sample_cnt_array)) {
 		for(i = 0; i< GENERAL_SENSORS_MAX; i++) {
 			if (inv_icm20948_is_streamed_sensor(i)) {
-				s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] = *lastIrqTimeUs;
+				s->timestamp[inv_icm20948_sensor_slot(inv_icm20948_sensor_android_2_sensor_type(i))] = *lastIrqTimeUs;
 			}
 		}
 		return -1;
 	}
 	// we parse all senosr according to android type
 	for (i = 0; i < GENERAL_SENSORS_MAX; i++) {
+		/* sensors left out of the build and non driver sensors all go to last slot */
+		const int slot = inv_icm20948_sensor_slot(inv_icm20948_sensor_android_2_sensor_type(i));
+
 		if (inv_icm20948_is_streamed_sensor(i)) {
 			if (sample_cnt_array[i]) {
 				/** Number of samples present in MEMS FIFO last time we mirrored it */
 				unsigned short fifo_sample_cnt = sample_cnt_array[i];
 
-				/** In case of first batch we have less than the expected number of samples in the batch */
-				/** To avoid a bad timestamping we recompute the startup time based on the theorical ODR and the number of samples */
-				if (s->sFirstBatch[inv_icm20948_sensor_android_2_sensor_type(i)]) {
-					s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] += *lastIrqTimeUs-s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] 
-																	- fifo_sample_cnt*s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_us;
-					s->sFirstBatch[inv_icm20948_sensor_android_2_sensor_type(i)] = 0;
-				}
-
 				/** In case it's the first time timestamp is set we create a factice one,
 				In other cases, update timestamp for all streamed sensors depending on number of samples available in FIFO
 				first time to be printed is t1+(t2-t1)/N
@@ -530,18 +600,18 @@ static uint8_t inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in
 				- t2 is when IRQ was fired so that we pop the FIFO
 				- N is number of samples */
 				
-				if(s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] == 0) {
-					s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] = *lastIrqTimeUs;
-					s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] -= s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_us*(fifo_sample_cnt);
-					s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_applied_us = s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_us;
+				if(s->timestamp[slot] == 0) {
+					s->timestamp[slot] = *lastIrqTimeUs;
+					s->timestamp[slot] -= s->sensorlist[slot].odr_us*(fifo_sample_cnt);
+					s->sensorlist[slot].odr_applied_us = s->sensorlist[slot].odr_us;
 				}
 				else {
-					s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_applied_us = (*lastIrqTimeUs-s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)])/fifo_sample_cnt;
+					s->sensorlist[slot].odr_applied_us = (*lastIrqTimeUs-s->timestamp[slot])/fifo_sample_cnt;
 				}
 			}
 		} else {
 			/** update timestamp for all event sensors with time at which MEMS IRQ was fired */
-			s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] = *lastIrqTimeUs;
+			s->timestamp[slot] = *lastIrqTimeUs;
 		}
 	}
 	
@@ -554,67 +624,86 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 	short int_read_back=0;
 	unsigned short header=0, header2 = 0; 
 	int data_left_in_fifo=0;
-	short short_data[3] = {0};
-	signed long  long_data[3] = {0};
-	signed long  long_quat[3] = {0};
-	float gyro_raw_float[3];
-	float gyro_bias_float[3];
-	int gyro_accuracy = 0;
-	int dummy_accuracy = 0;
+#if INV_ICM20948_CFG_ACCELEROMETER || INV_ICM20948_CFG_GRAVITY || INV_ICM20948_CFG_LINEAR_ACCELERATION
+	/* set by accel sample, used by gravity and linear acceleration computed from next quaternion */
 	int accel_accuracy = 0;
-	int compass_accuracy = 0;
-	float rv_accuracy = 0;
-	float gmrv_accuracy = 0;
+#endif
+#if INV_ICM20948_CFG_ACCELEROMETER || INV_ICM20948_CFG_LINEAR_ACCELERATION
 	float accel_float[3];
-	float grv_float[4];
-	float gyro_float[3];
-	float compass_float[3] = {0};
-	float compass_raw_float[3];
-	float rv_float[4];
-	float gmrv_float[4];
-	uint16_t pickup_state = 0;
+#endif
 	uint64_t lastIrqTimeUs;
+	int prefetching = 0;
 	
+	/* FIFO holds raw records without DMP interrupt in raw mode */
+	if (s->raw_mode.on)
+		return inv_icm20948_raw_mode_poll(s, context, handler);
+
 	inv_icm20948_identify_interrupt(s, &int_read_back);
 	
 	if (int_read_back & (BIT_MSG_DMP_INT | BIT_MSG_DMP_INT_0)) {
 		lastIrqTimeUs = inv_icm20948_get_time_us();
+		if (s->fifo_log)
+			inv_icm20948_fifo_log_irq(s, int_read_back, lastIrqTimeUs);
+		/* compass compensation used to decode FIFO packets, not updated while decoding */
+		inv_icm20948_compass_comp_sync(s, &s->compass_cal.raw_comp, 0);
 		do {
 			unsigned short total_sample_cnt = 0;
 
 			/* Mirror FIFO contents and stop processing FIFO if an error was detected*/
 			if(inv_icm20948_updateTs(s, &data_left_in_fifo, &total_sample_cnt, &lastIrqTimeUs))
 				break;
+
+			/* If serif supports it, read next batch of FIFO contents while current one is decoded */
+			prefetching = inv_icm20948_fifo_prefetch_start(s, data_left_in_fifo);
+
 			while(total_sample_cnt--) {
 				/* Read FIFO contents and parse it, and stop processing FIFO if an error was detected*/
 				if (inv_icm20948_fifo_pop(s, &header, &header2, &data_left_in_fifo))
 					break;
 				
+#if INV_ICM20948_CFG_GYROSCOPE || INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED || INV_ICM20948_CFG_RAW_GYROSCOPE
 				/* Gyro sample available from DMP FIFO */
 				if (header & GYRO_SET) {
+#if INV_ICM20948_CFG_GYROSCOPE || INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
 					float lScaleDeg = (1 << inv_icm20948_get_gyro_fullscale(s)) * 250.f ;// From raw to dps to degree per seconds
-					signed long  lRawGyroQ15[3] = {0};
 					signed long  lBiasGyroQ20[3] = {0};
+#endif
+#if INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
+					float gyro_raw_float[3];
+					float gyro_bias_float[3];
+#endif
+					short short_data[3] = {0};
+					signed long  lRawGyroQ15[3] = {0};
+					int gyro_accuracy;
 
 					/* Read raw gyro out of DMP FIFO and convert it from Q15 raw data format to radian per seconds in Android format */
 					inv_icm20948_dmp_get_raw_gyro(short_data);  
 					lRawGyroQ15[0] = (long) short_data[0];
 					lRawGyroQ15[1] = (long) short_data[1];
 					lRawGyroQ15[2] = (long) short_data[2];
+#if INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
 					inv_icm20948_convert_dmp3_to_body(s, lRawGyroQ15, lScaleDeg/(1L<<15), gyro_raw_float);
+#endif
 					
+#if INV_ICM20948_CFG_RAW_GYROSCOPE
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_GYROSCOPE) && !skip_sensor(s, ANDROID_SENSOR_RAW_GYROSCOPE)) {
 						long out[3];
+						int dummy_accuracy = 0;
 						inv_icm20948_convert_quat_rotate_fxp(s->s_quat_chip_to_body, lRawGyroQ15, out);
-						s->timestamp[INV_ICM20948_SENSOR_RAW_GYROSCOPE] += s->sensorlist[INV_ICM20948_SENSOR_RAW_GYROSCOPE].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_RAW_GYROSCOPE, s->timestamp[INV_ICM20948_SENSOR_RAW_GYROSCOPE], out, &dummy_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_RAW_GYROSCOPE] += s->sensorlist[INV_ICM20948_SLOT_RAW_GYROSCOPE].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_RAW_GYROSCOPE, s->timestamp[INV_ICM20948_SLOT_RAW_GYROSCOPE], out, &dummy_accuracy);
 					}
+#endif
+#if INV_ICM20948_CFG_GYROSCOPE || INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
 					/* Read bias gyro out of DMP FIFO and convert it from Q20 raw data format to radian per seconds in Android format */
 					inv_icm20948_dmp_get_gyro_bias(short_data);
 					lBiasGyroQ20[0] = (long) short_data[0];
 					lBiasGyroQ20[1] = (long) short_data[1];
 					lBiasGyroQ20[2] = (long) short_data[2];
+#endif
+#if INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
 					inv_icm20948_convert_dmp3_to_body(s, lBiasGyroQ20, lScaleDeg/(1L<<20), gyro_bias_float);
+#endif
 					
 					/* Extract accuracy and calibrated gyro data based on raw/bias data if calibrated gyro sensor is enabled */
 					gyro_accuracy = inv_icm20948_get_gyro_accuracy();
@@ -627,7 +716,10 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					if(gyro_accuracy != s->new_accuracy){
 						s->set_accuracy = 1;
 					}
+#if INV_ICM20948_CFG_GYROSCOPE
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GYROSCOPE) && !skip_sensor(s, ANDROID_SENSOR_GYROSCOPE)) {
+						signed long long_data[3];
+						float gyro_float[3];
 						// shift to Q20 to do all calibrated gyrometer operations in Q20
 						lRawGyroQ15[0] <<= 5;
 						lRawGyroQ15[1] <<= 5;
@@ -635,9 +727,11 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						/* Compute calibrated gyro data based on raw and bias gyro data and convert it from Q20 raw data format to radian per seconds in Android format */
 						inv_icm20948_dmp_get_calibrated_gyro(long_data, lRawGyroQ15, lBiasGyroQ20);
 						inv_icm20948_convert_dmp3_to_body(s, long_data, lScaleDeg/(1L<<20), gyro_float);
-						s->timestamp[INV_ICM20948_SENSOR_GYROSCOPE] += s->sensorlist[INV_ICM20948_SENSOR_GYROSCOPE].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_GYROSCOPE, s->timestamp[INV_ICM20948_SENSOR_GYROSCOPE], gyro_float, &s->new_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_GYROSCOPE] += s->sensorlist[INV_ICM20948_SLOT_GYROSCOPE].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_GYROSCOPE, s->timestamp[INV_ICM20948_SLOT_GYROSCOPE], gyro_float, &s->new_accuracy);
 					}
+#endif
+#if INV_ICM20948_CFG_GYROSCOPE_UNCALIBRATED
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED)  && !skip_sensor(s, ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED)) {
 						float raw_bias_gyr[6];
 						raw_bias_gyr[0] = gyro_raw_float[0];
@@ -646,45 +740,61 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						raw_bias_gyr[3] = gyro_bias_float[0];
 						raw_bias_gyr[4] = gyro_bias_float[1];
 						raw_bias_gyr[5] = gyro_bias_float[2];
-						s->timestamp[INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED] += s->sensorlist[INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED].odr_applied_us;
+						s->timestamp[INV_ICM20948_SLOT_GYROSCOPE_UNCALIBRATED] += s->sensorlist[INV_ICM20948_SLOT_GYROSCOPE_UNCALIBRATED].odr_applied_us;
 						/* send raw float and bias for uncal gyr*/
-						handler(context, INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED, s->timestamp[INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED], raw_bias_gyr, &s->new_accuracy);
+						handler(context, INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED, s->timestamp[INV_ICM20948_SLOT_GYROSCOPE_UNCALIBRATED], raw_bias_gyr, &s->new_accuracy);
 					}
+#endif
 				}
+#endif
+#if INV_ICM20948_CFG_ACCELEROMETER || INV_ICM20948_CFG_LINEAR_ACCELERATION || INV_ICM20948_CFG_RAW_ACCELEROMETER
 				/* Calibrated accel sample available from DMP FIFO */
 				if (header & ACCEL_SET) {
-					float scale;
+					signed long long_data[3];
 					/* Read calibrated accel out of DMP FIFO and convert it from Q25 raw data format to m/s² in Android format */
 					inv_icm20948_dmp_get_accel(long_data);
 
+#if INV_ICM20948_CFG_RAW_ACCELEROMETER
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_ACCELEROMETER) && !skip_sensor(s, ANDROID_SENSOR_RAW_ACCELEROMETER)) {
 						long out[3];
+						int dummy_accuracy = 0;
 						inv_icm20948_convert_quat_rotate_fxp(s->s_quat_chip_to_body, long_data, out);
 						/* convert to raw data format to Q12/Q11/Q10/Q9 depending on full scale applied,
 						so that it fits on 16bits so that it can go through any protocol, even the one which have raw data on 16b */
 						out[0] = out[0] >> 15;
 						out[1] = out[1] >> 15;
 						out[2] = out[2] >> 15;
-						s->timestamp[INV_ICM20948_SENSOR_RAW_ACCELEROMETER] += s->sensorlist[INV_ICM20948_SENSOR_RAW_ACCELEROMETER].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_RAW_ACCELEROMETER, s->timestamp[INV_ICM20948_SENSOR_RAW_ACCELEROMETER], out, &dummy_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_RAW_ACCELEROMETER] += s->sensorlist[INV_ICM20948_SLOT_RAW_ACCELEROMETER].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_RAW_ACCELEROMETER, s->timestamp[INV_ICM20948_SLOT_RAW_ACCELEROMETER], out, &dummy_accuracy);
 					}
+#endif
+#if INV_ICM20948_CFG_ACCELEROMETER || INV_ICM20948_CFG_LINEAR_ACCELERATION
 					if((inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ACCELEROMETER) && !skip_sensor(s, ANDROID_SENSOR_ACCELEROMETER)) ||
 					   (inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_LINEAR_ACCELERATION))) {
+						float scale;
 						accel_accuracy = inv_icm20948_get_accel_accuracy();
 						scale = (1 << inv_icm20948_get_accel_fullscale(s)) * 2.f / (1L<<30); // Convert from raw units to g's
 
 						inv_icm20948_convert_dmp3_to_body(s, long_data, scale, accel_float);
 
+#if INV_ICM20948_CFG_ACCELEROMETER
 						if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ACCELEROMETER)) {
-							s->timestamp[INV_ICM20948_SENSOR_ACCELEROMETER] += s->sensorlist[INV_ICM20948_SENSOR_ACCELEROMETER].odr_applied_us;
-							handler(context, INV_ICM20948_SENSOR_ACCELEROMETER, s->timestamp[INV_ICM20948_SENSOR_ACCELEROMETER], accel_float, &accel_accuracy);
+							s->timestamp[INV_ICM20948_SLOT_ACCELEROMETER] += s->sensorlist[INV_ICM20948_SLOT_ACCELEROMETER].odr_applied_us;
+							handler(context, INV_ICM20948_SENSOR_ACCELEROMETER, s->timestamp[INV_ICM20948_SLOT_ACCELEROMETER], accel_float, &accel_accuracy);
 						}
+#endif
 					}
+#endif
 				}
+#endif
+#if INV_ICM20948_CFG_GEOMAGNETIC_FIELD
 				/* Calibrated compass sample available from DMP FIFO */
 				if (header & CPASS_CALIBR_SET) {
+					signed long long_data[3];
+					float compass_float[3] = {0};
+					int compass_accuracy;
 					float scale;
-					
+
 					/* Read calibrated compass out of DMP FIFO and convert it from Q16 raw data format to µT in Android format */
 					inv_icm20948_dmp_get_calibrated_compass(long_data);
 
@@ -692,13 +802,19 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					scale = DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
 					inv_icm20948_convert_dmp3_to_body(s, long_data, scale, compass_float);
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GEOMAGNETIC_FIELD) && !skip_sensor(s, ANDROID_SENSOR_GEOMAGNETIC_FIELD)) {
-						s->timestamp[INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD] += s->sensorlist[INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD, s->timestamp[INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD], compass_float, &compass_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_GEOMAGNETIC_FIELD] += s->sensorlist[INV_ICM20948_SLOT_GEOMAGNETIC_FIELD].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD, s->timestamp[INV_ICM20948_SLOT_GEOMAGNETIC_FIELD], compass_float, &compass_accuracy);
 					}
 				}
+#endif
 
+#if INV_ICM20948_CFG_MAGNETIC_FIELD_UNCALIBRATED
 				/* Raw compass sample available from DMP FIFO */
 				if (header & CPASS_SET) {
+					signed long long_data[3];
+					float compass_raw_float[3];
+					int compass_accuracy;
+
 					/* Read calibrated compass out of DMP FIFO and convert it from Q16 raw data format to µT in Android format */
 					inv_icm20948_dmp_get_raw_compass(long_data);
 					compass_raw_float[0] = long_data[0] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
@@ -711,48 +827,63 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						raw_bias_mag[0] = compass_raw_float[0];
 						raw_bias_mag[1] = compass_raw_float[1];
 						raw_bias_mag[2] = compass_raw_float[2];
-						inv_icm20948_ctrl_get_mag_bias(s, mag_bias);
+						compass_accuracy = inv_icm20948_get_mag_accuracy();
+						s->timestamp[INV_ICM20948_SLOT_MAGNETIC_FIELD_UNCALIBRATED] += s->sensorlist[INV_ICM20948_SLOT_MAGNETIC_FIELD_UNCALIBRATED].odr_applied_us;
+						/* bias is read from DMP memory only when it may have changed */
+						inv_icm20948_compass_comp_get_bias(s, compass_accuracy,
+								s->timestamp[INV_ICM20948_SLOT_MAGNETIC_FIELD_UNCALIBRATED], mag_bias);
 						//calculate bias
 						raw_bias_mag[3] = mag_bias[0] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
 						raw_bias_mag[4] = mag_bias[1] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
 						raw_bias_mag[5] = mag_bias[2] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
 						
-						compass_accuracy = inv_icm20948_get_mag_accuracy();
-						s->timestamp[INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED] += s->sensorlist[INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED].odr_applied_us;
 						/* send raw float and bias for uncal mag*/
-						handler(context, INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED, s->timestamp[INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED],
+						handler(context, INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED, s->timestamp[INV_ICM20948_SLOT_MAGNETIC_FIELD_UNCALIBRATED],
 								raw_bias_mag, &compass_accuracy);
 					}
 				}
+#endif
+#if INV_ICM20948_CFG_GAME_ROTATION_VECTOR || INV_ICM20948_CFG_GRAVITY || INV_ICM20948_CFG_LINEAR_ACCELERATION
 				/* 6axis AG orientation quaternion sample available from DMP FIFO */
 				if (header & QUAT6_SET) {
+					signed long long_quat[3] = {0};
+#if INV_ICM20948_CFG_GRAVITY || INV_ICM20948_CFG_LINEAR_ACCELERATION
 					long gravityQ16[3];
-					float ref_quat[4];
+#endif
 					/* Read 6 axis quaternion out of DMP FIFO in Q30 */
 					inv_icm20948_dmp_get_6quaternion(long_quat);
+#if INV_ICM20948_CFG_GAME_ROTATION_VECTOR
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GAME_ROTATION_VECTOR) && !skip_sensor(s, ANDROID_SENSOR_GAME_ROTATION_VECTOR)) {
+						float grv_float[4];
+						float ref_quat[4];
 						/* and convert it from Q30 DMP format to Android format only if GRV sensor is enabled */
 						inv_icm20948_convert_rotation_vector(s, long_quat, grv_float);
 						ref_quat[0] = grv_float[3];
 						ref_quat[1] = grv_float[0];
 						ref_quat[2] = grv_float[1];
 						ref_quat[3] = grv_float[2];
-						s->timestamp[INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR] += s->sensorlist[INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR], ref_quat, 0);
+						s->timestamp[INV_ICM20948_SLOT_GAME_ROTATION_VECTOR] += s->sensorlist[INV_ICM20948_SLOT_GAME_ROTATION_VECTOR].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SLOT_GAME_ROTATION_VECTOR], ref_quat, 0);
 					}
+#endif
 					
+#if INV_ICM20948_CFG_GRAVITY || INV_ICM20948_CFG_LINEAR_ACCELERATION
 					/* Compute gravity sensor data in Q16 in g based on 6 axis quaternion in Q30 DMP format */
 					inv_icm20948_augmented_sensors_get_gravity(s, gravityQ16, long_quat);
+#endif
+#if INV_ICM20948_CFG_GRAVITY
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GRAVITY) && !skip_sensor(s, ANDROID_SENSOR_GRAVITY)) {
 						float gravity_float[3];
 						/* Convert gravity data from Q16 to float format in g */
 						gravity_float[0] = INVN_FXP_TO_FLT(gravityQ16[0], 16);
 						gravity_float[1] = INVN_FXP_TO_FLT(gravityQ16[1], 16);
 						gravity_float[2] = INVN_FXP_TO_FLT(gravityQ16[2], 16);
-						s->timestamp[INV_ICM20948_SENSOR_GRAVITY] += s->sensorlist[INV_ICM20948_SENSOR_GRAVITY].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_GRAVITY, s->timestamp[INV_ICM20948_SENSOR_GRAVITY], gravity_float, &accel_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_GRAVITY] += s->sensorlist[INV_ICM20948_SLOT_GRAVITY].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_GRAVITY, s->timestamp[INV_ICM20948_SLOT_GRAVITY], gravity_float, &accel_accuracy);
 					}
+#endif
 				
+#if INV_ICM20948_CFG_LINEAR_ACCELERATION
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_LINEAR_ACCELERATION) && !skip_sensor(s, ANDROID_SENSOR_LINEAR_ACCELERATION)) {
 						float linacc_float[3];
 						long linAccQ16[3];
@@ -767,16 +898,23 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						linacc_float[0] = INVN_FXP_TO_FLT(linAccQ16[0], 16);
 						linacc_float[1] = INVN_FXP_TO_FLT(linAccQ16[1], 16);
 						linacc_float[2] = INVN_FXP_TO_FLT(linAccQ16[2], 16);
-						s->timestamp[INV_ICM20948_SENSOR_LINEAR_ACCELERATION] += s->sensorlist[INV_ICM20948_SENSOR_LINEAR_ACCELERATION].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_LINEAR_ACCELERATION, s->timestamp[INV_ICM20948_SENSOR_LINEAR_ACCELERATION], linacc_float, &accel_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_LINEAR_ACCELERATION] += s->sensorlist[INV_ICM20948_SLOT_LINEAR_ACCELERATION].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_LINEAR_ACCELERATION, s->timestamp[INV_ICM20948_SLOT_LINEAR_ACCELERATION], linacc_float, &accel_accuracy);
 					}
+#endif
 				}
+#endif
+#if INV_ICM20948_CFG_ROTATION_VECTOR || INV_ICM20948_CFG_ORIENTATION
 				/* 9axis orientation quaternion sample available from DMP FIFO */
 				if (header & QUAT9_SET) {
-					float ref_quat[4];
+					signed long long_quat[3] = {0};
 					/* Read 9 axis quaternion out of DMP FIFO in Q30 */
 					inv_icm20948_dmp_get_9quaternion(long_quat);
+#if INV_ICM20948_CFG_ROTATION_VECTOR
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ROTATION_VECTOR) && !skip_sensor(s, ANDROID_SENSOR_ROTATION_VECTOR)) {
+						float rv_float[4];
+						float rv_accuracy;
+						float ref_quat[4];
 						/* and convert it from Q30 DMP format to Android format only if RV sensor is enabled */
 						inv_icm20948_convert_rotation_vector(s, long_quat, rv_float);
 						/* Read rotation vector heading accuracy out of DMP FIFO in Q29*/
@@ -785,10 +923,12 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						ref_quat[1] = rv_float[0];
 						ref_quat[2] = rv_float[1];
 						ref_quat[3] = rv_float[2];
-						s->timestamp[INV_ICM20948_SENSOR_ROTATION_VECTOR] += s->sensorlist[INV_ICM20948_SENSOR_ROTATION_VECTOR].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SENSOR_ROTATION_VECTOR], ref_quat, &rv_accuracy);
+						s->timestamp[INV_ICM20948_SLOT_ROTATION_VECTOR] += s->sensorlist[INV_ICM20948_SLOT_ROTATION_VECTOR].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SLOT_ROTATION_VECTOR], ref_quat, &rv_accuracy);
 					}
+#endif
 					
+#if INV_ICM20948_CFG_ORIENTATION
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ORIENTATION) && !skip_sensor(s, ANDROID_SENSOR_ORIENTATION)) {
 						long orientationQ16[3];
 						float orientation_float[3];
@@ -797,16 +937,23 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						orientation_float[0] = INVN_FXP_TO_FLT(orientationQ16[0], 16);
 						orientation_float[1] = INVN_FXP_TO_FLT(orientationQ16[1], 16);
 						orientation_float[2] = INVN_FXP_TO_FLT(orientationQ16[2], 16);
-						s->timestamp[INV_ICM20948_SENSOR_ORIENTATION] += s->sensorlist[INV_ICM20948_SENSOR_ORIENTATION].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_ORIENTATION, s->timestamp[INV_ICM20948_SENSOR_ORIENTATION], orientation_float, 0);
+						s->timestamp[INV_ICM20948_SLOT_ORIENTATION] += s->sensorlist[INV_ICM20948_SLOT_ORIENTATION].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_ORIENTATION, s->timestamp[INV_ICM20948_SLOT_ORIENTATION], orientation_float, 0);
 					}
+#endif
 				}
+#endif
+#if INV_ICM20948_CFG_GEOMAGNETIC_ROTATION_VECTOR
 				/* 6axis AM orientation quaternion sample available from DMP FIFO */
 				if (header & GEOMAG_SET) {
+					signed long long_quat[3] = {0};
 					float ref_quat[4];
 					/* Read 6 axis quaternion out of DMP FIFO in Q30 and convert it to Android format */
 					inv_icm20948_dmp_get_gmrvquaternion(long_quat);
 					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR) && !skip_sensor(s, ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR)) {
+						float gmrv_float[4];
+						float gmrv_accuracy;
+
 						inv_icm20948_convert_rotation_vector(s, long_quat, gmrv_float);
 						/* Read geomagnetic rotation vector heading accuracy out of DMP FIFO in Q29*/
 						gmrv_accuracy = (float)inv_icm20948_get_gmrv_accuracy()/(float)(1ULL << (29));
@@ -814,16 +961,20 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						ref_quat[1] = gmrv_float[0];
 						ref_quat[2] = gmrv_float[1];
 						ref_quat[3] = gmrv_float[2];
-						s->timestamp[INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR] += s->sensorlist[INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR].odr_applied_us;
-						handler(context, INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR], 
+						s->timestamp[INV_ICM20948_SLOT_GEOMAGNETIC_ROTATION_VECTOR] += s->sensorlist[INV_ICM20948_SLOT_GEOMAGNETIC_ROTATION_VECTOR].odr_applied_us;
+						handler(context, INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SLOT_GEOMAGNETIC_ROTATION_VECTOR], 
 								ref_quat, &gmrv_accuracy);
 					}
 				}
+#endif
+#if INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON || INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR
 				/* Activity recognition sample available from DMP FIFO */
 				if (header2 & ACT_RECOG_SET) {
 					uint16_t bac_state = 0;
 					long bac_ts = 0;
+#if INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON
 					int bac_event = 0;
+#endif
 					struct bac_map{
 						uint8_t act_id;
 						enum inv_sensor_bac_event sensor_bac;
@@ -845,34 +996,45 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					//Map according to dmp bac events
 					for(i = 0; i < 6; i++) {
 						if ((bac_state >> 8) & map[i].act_id){
+#if INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON
 							//Check if BAC is enabled
 							if (inv_icm20948_ctrl_get_activitiy_classifier_on_flag(s)) {
 								/* Start detected */
 								bac_event = map[i].sensor_bac;
-								handler(context, INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON, s->timestamp[INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON], &bac_event, 0);
+								handler(context, INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON, s->timestamp[INV_ICM20948_SLOT_ACTIVITY_CLASSIFICATON], &bac_event, 0);
 							}
+#endif
+#if INV_ICM20948_CFG_WAKEUP_TILT_DETECTOR
 							//build event TILT only if enabled
 							if((map[i].act_id == BAC_TILT) && inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_WAKEUP_TILT_DETECTOR))
-								handler(context, INV_ICM20948_SENSOR_WAKEUP_TILT_DETECTOR, s->timestamp[INV_ICM20948_SENSOR_WAKEUP_TILT_DETECTOR], 0, 0);
+								handler(context, INV_ICM20948_SENSOR_WAKEUP_TILT_DETECTOR, s->timestamp[INV_ICM20948_SLOT_WAKEUP_TILT_DETECTOR], 0, 0);
+#endif
 						}
+#if INV_ICM20948_CFG_ACTIVITY_CLASSIFICATON
 						/* Check if bit tilt is set for activity end byte */
 						else if (bac_state & map[i].act_id) {
 							//Check if BAC is enabled
 							if (inv_icm20948_ctrl_get_activitiy_classifier_on_flag(s)) {
 								/* End detected */
 								bac_event = -map[i].sensor_bac;
-								handler(context, INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON, s->timestamp[INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON], &bac_event, 0);
+								handler(context, INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON, s->timestamp[INV_ICM20948_SLOT_ACTIVITY_CLASSIFICATON], &bac_event, 0);
 							}
 						}
+#endif
 					}
 				}
+#endif
+#if INV_ICM20948_CFG_FLIP_PICKUP
 				/* Pickup sample available from DMP FIFO */
 				if (header2 & FLIP_PICKUP_SET) {
+					uint16_t pickup_state = 0;
 					/* Read pickup type and associated timestamp out of DMP FIFO */
 					inv_icm20948_dmp_get_flip_pickup_state(&pickup_state);
-					handler(context, INV_ICM20948_SENSOR_FLIP_PICKUP, s->timestamp[INV_ICM20948_SENSOR_FLIP_PICKUP], &pickup_state, 0);
+					handler(context, INV_ICM20948_SENSOR_FLIP_PICKUP, s->timestamp[INV_ICM20948_SLOT_FLIP_PICKUP], &pickup_state, 0);
 				}
+#endif
                                 
+#if INV_ICM20948_CFG_STEP_COUNTER
             	/* Step detector available from DMP FIFO and step counter sensor is enabled*/
 				// If step detector enabled => step counter started too 
 				// So don't watch the step counter data if the user doesn't start the sensor
@@ -887,27 +1049,34 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					stepc = steps;
 					if(stepc != s->sOldSteps) {
 						s->sOldSteps = steps;
-						handler(context, INV_ICM20948_SENSOR_STEP_COUNTER, s->timestamp[INV_ICM20948_SENSOR_STEP_COUNTER], &stepc, 0);
+						handler(context, INV_ICM20948_SENSOR_STEP_COUNTER, s->timestamp[INV_ICM20948_SLOT_STEP_COUNTER], &stepc, 0);
 					}
 				}          
+#endif
 			}
-		} while(data_left_in_fifo);
+		} while(data_left_in_fifo || prefetching);
 
+#if INV_ICM20948_CFG_WAKEUP_SIGNIFICANT_MOTION
 		/* SMD detected by DMP */
 		if (int_read_back & BIT_MSG_DMP_INT_2) { 
 			uint8_t event = 0;
-			handler(context, INV_ICM20948_SENSOR_WAKEUP_SIGNIFICANT_MOTION, s->timestamp[INV_ICM20948_SENSOR_WAKEUP_SIGNIFICANT_MOTION], &event, 0);
+			handler(context, INV_ICM20948_SENSOR_WAKEUP_SIGNIFICANT_MOTION, s->timestamp[INV_ICM20948_SLOT_WAKEUP_SIGNIFICANT_MOTION], &event, 0);
 		}
+#endif
+#if INV_ICM20948_CFG_STEP_DETECTOR
 		/* Step detector triggered by DMP */
 		if (int_read_back & BIT_MSG_DMP_INT_3) {
 			uint8_t event = 0;
-			handler(context, INV_ICM20948_SENSOR_STEP_DETECTOR, s->timestamp[INV_ICM20948_SENSOR_STEP_DETECTOR], &event, 0);
+			handler(context, INV_ICM20948_SENSOR_STEP_DETECTOR, s->timestamp[INV_ICM20948_SLOT_STEP_DETECTOR], &event, 0);
 		}
+#endif
+#if INV_ICM20948_CFG_B2S
 		/* Bring to see detected by DMP */
 		if (int_read_back & BIT_MSG_DMP_INT_5) {
 			uint8_t event = 0;
-			handler(context, INV_ICM20948_SENSOR_B2S, s->timestamp[INV_ICM20948_SENSOR_B2S], &event, 0);
+			handler(context, INV_ICM20948_SENSOR_B2S, s->timestamp[INV_ICM20948_SLOT_B2S], &event, 0);
 		}
+#endif
 	}
 	
 	/* Sometimes, the chip can be put in sleep mode even if there is data in the FIFO. If we poll at this moment, the transport layer will wake-up the chip, but never put it back in sleep. */
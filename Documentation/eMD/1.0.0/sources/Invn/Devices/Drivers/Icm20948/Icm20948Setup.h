@@ -72,6 +72,8 @@ int INV_EXPORT inv_icm20948_get_whoami(struct inv_icm20948 * s, uint8_t * whoami
 void INV_EXPORT inv_icm20948_init_matrix(struct inv_icm20948 * s);
 int INV_EXPORT inv_icm20948_set_matrix(struct inv_icm20948 * s, const float matrix[9], enum inv_icm20948_sensor sensor);
 int INV_EXPORT inv_icm20948_initialize(struct inv_icm20948 * s, const uint8_t *dmp3_image, uint32_t dmp3_image_size);
+void INV_EXPORT inv_icm20948_set_warm_restart(struct inv_icm20948 * s, inv_bool_t enable);
+inv_bool_t INV_EXPORT inv_icm20948_is_warm_restarted(struct inv_icm20948 * s);
 int INV_EXPORT inv_icm20948_init_scale(struct inv_icm20948 * s);
 // int INV_EXPORT inv_icm20948_set_wom_threshold(struct inv_icm20948 * s, uint8_t threshold);
 int INV_EXPORT inv_icm20948_set_fsr(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor, const void * fsr);
@@ -0,0 +1,307 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948Snapshot.h"
+
+#include "Icm20948Defs.h"
+#include "Icm20948DataBaseDriver.h"
+#include "Icm20948DataBaseControl.h"
+
+/* serialized blob header */
+#define SNAPSHOT_MAGIC_0            'S'
+#define SNAPSHOT_MAGIC_1            'N'
+#define SNAPSHOT_HEADER_SIZE        6
+#define SNAPSHOT_CHECKSUM_SIZE      2
+#define SNAPSHOT_PAYLOAD_SIZE       (INV_ICM20948_SNAPSHOT_SIZE - SNAPSHOT_HEADER_SIZE - SNAPSHOT_CHECKSUM_SIZE)
+
+static uint8_t * put_u16(uint8_t * p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	return p + 2;
+}
+
+static uint8_t * put_u32(uint8_t * p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+	return p + 4;
+}
+
+static uint16_t get_u16(const uint8_t * p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t * p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Fletcher-16 checksum */
+static uint16_t snapshot_checksum(const uint8_t * buf, unsigned len)
+{
+	uint16_t sum1 = 0, sum2 = 0;
+	unsigned i;
+
+	for(i = 0; i < len; i++) {
+		sum1 = (sum1 + buf[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return (uint16_t)((sum2 << 8) | sum1);
+}
+
+static void matrix_to_float(float out[9], const int8_t m[9])
+{
+	int i;
+
+	for(i = 0; i < 9; i++)
+		out[i] = (float)m[i];
+}
+
+int inv_icm20948_snapshot_get(struct inv_icm20948 * s, struct inv_icm20948_snapshot * snap)
+{
+	int i;
+
+	if(!snap)
+		return INV_ERROR_BAD_ARG;
+
+	memset(snap, 0, sizeof(*snap));
+
+	snap->android_sensors_mask[0] = (uint32_t)s->inv_androidSensorsOn_mask[0];
+	snap->android_sensors_mask[1] = (uint32_t)s->inv_androidSensorsOn_mask[1];
+	for(i = 0; i < INV_ICM20948_SENSOR_MAX; i++)
+		snap->period_ms[i] = (uint32_t)(s->sensorlist[inv_icm20948_sensor_slot(i)].odr_us / 1000);
+
+	memcpy(snap->mounting_matrix, s->mounting_matrix, sizeof(snap->mounting_matrix));
+	memcpy(snap->compass_matrix, s->mounting_matrix_secondary_compass, sizeof(snap->compass_matrix));
+
+	snap->accel_fullscale = s->base_state.accel_fullscale;
+	snap->gyro_fullscale = s->base_state.gyro_fullscale;
+
+	for(i = 0; i < 9; i++)
+		snap->bias[i] = s->bias[i];
+
+	snap->batch_enabled = s->sBatchMode;
+	snap->batch_timeout_ms = s->sBatchTimeoutMs;
+
+	snap->compass_available = s->s_compass_available;
+	snap->compass_slave_id = (uint8_t)s->secondary_state.compass_slave_id;
+	snap->compass_chip_addr = (uint8_t)s->secondary_state.compass_chip_addr;
+
+	snap->lp_ln_mode = (uint8_t)s->base_state.chip_lp_ln_mode;
+
+	return 0;
+}
+
+int inv_icm20948_snapshot_apply(struct inv_icm20948 * s, const struct inv_icm20948_snapshot * snap)
+{
+	int rc = 0;
+	int sensors_changed = 0;
+	int i;
+	float matrix[9];
+
+	if(!snap)
+		return INV_ERROR_BAD_ARG;
+
+	inv_icm20948_hold_lpen_control(s);
+
+	/* compass must be set up first as compass based sensors depend on it */
+	if(snap->compass_available &&
+		(!s->s_compass_available ||
+		 s->secondary_state.compass_slave_id != snap->compass_slave_id ||
+		 s->secondary_state.compass_chip_addr != snap->compass_chip_addr)) {
+		s->secondary_state.compass_slave_id = snap->compass_slave_id;
+		s->secondary_state.compass_chip_addr = snap->compass_chip_addr;
+		s->secondary_state.compass_state = INV_ICM20948_COMPASS_INITED;
+		rc |= inv_icm20948_initialize_auxiliary(s);
+	}
+
+	/* mounting matrices, compass calibration is updated along with accel/gyro matrix */
+	if(memcmp(s->mounting_matrix, snap->mounting_matrix, sizeof(snap->mounting_matrix))) {
+		memcpy(s->mounting_matrix_secondary_compass, snap->compass_matrix, sizeof(snap->compass_matrix));
+		matrix_to_float(matrix, snap->mounting_matrix);
+		rc |= inv_icm20948_set_matrix(s, matrix, INV_ICM20948_SENSOR_ACCELEROMETER);
+	} else if(memcmp(s->mounting_matrix_secondary_compass, snap->compass_matrix, sizeof(snap->compass_matrix))) {
+		matrix_to_float(matrix, snap->compass_matrix);
+		rc |= inv_icm20948_set_matrix(s, matrix, INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD);
+	}
+
+	/* full scales, before biases as gyro bias format depends on gyro full scale */
+	if(s->base_state.accel_fullscale != snap->accel_fullscale)
+		rc |= inv_icm20948_set_accel_fullscale(s, snap->accel_fullscale);
+	if(s->base_state.gyro_fullscale != snap->gyro_fullscale)
+		rc |= inv_icm20948_set_gyro_fullscale(s, snap->gyro_fullscale);
+
+	/* biases, one DMP burst per sensor */
+	if(memcmp(&s->bias[0], &snap->bias[0], 3 * sizeof(int)))
+		rc |= inv_icm20948_ctrl_set_acc_bias(s, (int *)&snap->bias[0]);
+	if(memcmp(&s->bias[3], &snap->bias[3], 3 * sizeof(int)))
+		rc |= inv_icm20948_ctrl_set_gyr_bias(s, (int *)&snap->bias[3]);
+	if(memcmp(&s->bias[6], &snap->bias[6], 3 * sizeof(int)))
+		rc |= inv_icm20948_ctrl_set_mag_bias(s, (int *)&snap->bias[6]);
+
+	/* sensor periods and states, dividers are computed and written once at commit */
+	inv_icm20948_ctrl_begin_config(s);
+	for(i = 0; i < INV_ICM20948_SENSOR_MAX; i++) {
+		if(snap->period_ms[i] && (s->sensorlist[inv_icm20948_sensor_slot(i)].odr_us / 1000) != snap->period_ms[i]) {
+			rc |= inv_icm20948_set_sensor_period(s, (enum inv_icm20948_sensor)i, snap->period_ms[i]);
+			sensors_changed = 1;
+		}
+	}
+
+	/* sensors state, disable first to release resources */
+	for(i = 0; i < ANDROID_SENSOR_NUM_MAX; i++) {
+		enum inv_icm20948_sensor sensor = inv_icm20948_sensor_android_2_sensor_type(i);
+		uint32_t on = snap->android_sensors_mask[i>>5] & (1UL << (i&0x1F));
+
+		if(sensor == INV_ICM20948_SENSOR_MAX)
+			continue;
+		if(!on && inv_icm20948_ctrl_androidSensor_enabled(s, (unsigned char)i)) {
+			rc |= inv_icm20948_enable_sensor(s, sensor, 0);
+			sensors_changed = 1;
+		}
+	}
+	for(i = 0; i < ANDROID_SENSOR_NUM_MAX; i++) {
+		enum inv_icm20948_sensor sensor = inv_icm20948_sensor_android_2_sensor_type(i);
+		uint32_t on = snap->android_sensors_mask[i>>5] & (1UL << (i&0x1F));
+
+		if(sensor == INV_ICM20948_SENSOR_MAX)
+			continue;
+		if(on && !inv_icm20948_ctrl_androidSensor_enabled(s, (unsigned char)i)) {
+			rc |= inv_icm20948_enable_sensor(s, sensor, 1);
+			sensors_changed = 1;
+		}
+	}
+	rc |= inv_icm20948_ctrl_commit_config(s);
+
+	/* batch timeout is expressed in samples in DMP so it is re-applied when rates changed */
+	if(snap->batch_enabled) {
+		if(sensors_changed || !s->sBatchMode || s->sBatchTimeoutMs != snap->batch_timeout_ms)
+			rc |= inv_icm20948_enable_batch_timeout(s, snap->batch_timeout_ms);
+	} else if(s->sBatchMode) {
+		rc |= inv_icm20948_ctrl_enable_batch(s, 0);
+		s->sBatchTimeoutMs = 0;
+	}
+
+	if(s->base_state.chip_lp_ln_mode != (chip_lp_ln_mode_icm20948_t)snap->lp_ln_mode)
+		rc |= inv_icm20948_set_lowpower_or_highperformance(s, (snap->lp_ln_mode == CHIP_LOW_NOISE_ICM20948));
+
+	inv_icm20948_release_lpen_control(s);
+
+	return (rc == 0) ? 0 : INV_ERROR;
+}
+
+int inv_icm20948_snapshot_serialize(const struct inv_icm20948_snapshot * snap, uint8_t * buf, unsigned size)
+{
+	uint8_t * p = buf;
+	int i;
+
+	if(!snap || !buf)
+		return INV_ERROR_BAD_ARG;
+	if(size < INV_ICM20948_SNAPSHOT_SIZE)
+		return INV_ERROR_SIZE;
+
+	*p++ = SNAPSHOT_MAGIC_0;
+	*p++ = SNAPSHOT_MAGIC_1;
+	*p++ = INV_ICM20948_SNAPSHOT_VERSION;
+	*p++ = 0; /* reserved */
+	p = put_u16(p, SNAPSHOT_PAYLOAD_SIZE);
+
+	p = put_u32(p, snap->android_sensors_mask[0]);
+	p = put_u32(p, snap->android_sensors_mask[1]);
+	for(i = 0; i < INV_ICM20948_SENSOR_MAX; i++)
+		p = put_u32(p, snap->period_ms[i]);
+	for(i = 0; i < 9; i++)
+		*p++ = (uint8_t)snap->mounting_matrix[i];
+	for(i = 0; i < 9; i++)
+		*p++ = (uint8_t)snap->compass_matrix[i];
+	*p++ = snap->accel_fullscale;
+	*p++ = snap->gyro_fullscale;
+	for(i = 0; i < 9; i++)
+		p = put_u32(p, (uint32_t)snap->bias[i]);
+	*p++ = snap->batch_enabled;
+	p = put_u16(p, snap->batch_timeout_ms);
+	*p++ = snap->compass_available;
+	*p++ = snap->compass_slave_id;
+	*p++ = snap->compass_chip_addr;
+	*p++ = snap->lp_ln_mode;
+
+	p = put_u16(p, snapshot_checksum(buf, (unsigned)(p - buf)));
+
+	return (int)(p - buf);
+}
+
+int inv_icm20948_snapshot_deserialize(struct inv_icm20948_snapshot * snap, const uint8_t * buf, unsigned size)
+{
+	const uint8_t * p = buf;
+	int i;
+
+	if(!snap || !buf)
+		return INV_ERROR_BAD_ARG;
+	if(size < INV_ICM20948_SNAPSHOT_SIZE)
+		return INV_ERROR_SIZE;
+	if(buf[0] != SNAPSHOT_MAGIC_0 || buf[1] != SNAPSHOT_MAGIC_1 ||
+			buf[2] != INV_ICM20948_SNAPSHOT_VERSION ||
+			get_u16(&buf[4]) != SNAPSHOT_PAYLOAD_SIZE)
+		return INV_ERROR_BAD_ARG;
+	if(get_u16(&buf[INV_ICM20948_SNAPSHOT_SIZE - SNAPSHOT_CHECKSUM_SIZE]) !=
+			snapshot_checksum(buf, INV_ICM20948_SNAPSHOT_SIZE - SNAPSHOT_CHECKSUM_SIZE))
+		return INV_ERROR_BAD_ARG;
+
+	p += SNAPSHOT_HEADER_SIZE;
+	snap->android_sensors_mask[0] = get_u32(p); p += 4;
+	snap->android_sensors_mask[1] = get_u32(p); p += 4;
+	for(i = 0; i < INV_ICM20948_SENSOR_MAX; i++, p += 4)
+		snap->period_ms[i] = get_u32(p);
+	for(i = 0; i < 9; i++)
+		snap->mounting_matrix[i] = (int8_t)*p++;
+	for(i = 0; i < 9; i++)
+		snap->compass_matrix[i] = (int8_t)*p++;
+	snap->accel_fullscale = *p++;
+	snap->gyro_fullscale = *p++;
+	for(i = 0; i < 9; i++, p += 4)
+		snap->bias[i] = (int32_t)get_u32(p);
+	snap->batch_enabled = *p++;
+	snap->batch_timeout_ms = get_u16(p); p += 2;
+	snap->compass_available = *p++;
+	snap->compass_slave_id = *p++;
+	snap->compass_chip_addr = *p++;
+	snap->lp_ln_mode = *p++;
+
+	return 0;
+}
+
+int inv_icm20948_snapshot_save(struct inv_icm20948 * s, uint8_t * buf, unsigned size)
+{
+	struct inv_icm20948_snapshot snap;
+	int rc;
+
+	if((rc = inv_icm20948_snapshot_get(s, &snap)) != 0)
+		return rc;
+
+	return inv_icm20948_snapshot_serialize(&snap, buf, size);
+}
+
+int inv_icm20948_snapshot_restore(struct inv_icm20948 * s, const uint8_t * buf, unsigned size)
+{
+	struct inv_icm20948_snapshot snap;
+	int rc;
+
+	if((rc = inv_icm20948_snapshot_deserialize(&snap, buf, size)) != 0)
+		return rc;
+
+	return inv_icm20948_snapshot_apply(s, &snap);
+}
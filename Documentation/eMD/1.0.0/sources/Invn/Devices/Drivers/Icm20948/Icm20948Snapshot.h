@@ -0,0 +1,118 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#ifndef INV_ICM20948_SNAPSHOT_H__
+#define INV_ICM20948_SNAPSHOT_H__
+
+/** @defgroup	icm20948_snapshot	snapshot
+    @ingroup 	SmartSensor_driver
+    @{
+*/
+#include "Invn/InvExport.h"
+
+#include "Icm20948Setup.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* forward declaration */
+struct inv_icm20948;
+
+/** @brief Snapshot binary format version
+ *  Must be incremented each time the serialized layout changes.
+ */
+#define INV_ICM20948_SNAPSHOT_VERSION      1
+
+/** @brief Size in bytes of a serialized snapshot
+ *  header (6) + sensors mask (8) + periods (4 * INV_ICM20948_SENSOR_MAX)
+ *  + matrices (18) + fullscales (2) + biases (36) + batch (3) + compass (3)
+ *  + power mode (1) + checksum (2)
+ */
+#define INV_ICM20948_SNAPSHOT_SIZE         (79 + 4 * INV_ICM20948_SENSOR_MAX)
+
+/** @brief Effective driver configuration
+ *  All values are stored in the driver internal format so that they can be
+ *  compared against current states and re-applied without conversion loss.
+ */
+struct inv_icm20948_snapshot {
+	uint32_t android_sensors_mask[2];            /**< inv_androidSensorsOn_mask */
+	uint32_t period_ms[INV_ICM20948_SENSOR_MAX]; /**< requested period per sensor (0 if never set) */
+	int8_t   mounting_matrix[9];                 /**< accel/gyro mounting matrix */
+	int8_t   compass_matrix[9];                  /**< secondary compass mounting matrix */
+	uint8_t  accel_fullscale;                    /**< enum mpu_accel_fs */
+	uint8_t  gyro_fullscale;                     /**< enum mpu_gyro_fs */
+	int32_t  bias[9];                            /**< DMP biases [0-2]:acc(q25),[3-5]:gyr,[6-8]:mag(q16) */
+	uint8_t  batch_enabled;                      /**< 1 if batch mode is on */
+	uint16_t batch_timeout_ms;                   /**< batch timeout */
+	uint8_t  compass_available;                  /**< 1 if a compass was detected */
+	uint8_t  compass_slave_id;                   /**< HW_AKxxxx identifier */
+	uint8_t  compass_chip_addr;                  /**< compass I2C address */
+	uint8_t  lp_ln_mode;                         /**< chip_lp_ln_mode_icm20948_t */
+};
+
+/** @brief Capture current driver configuration
+ *  No bus transaction is performed: values are taken from driver states.
+ *  @param[in]  s     driver states
+ *  @param[out] snap  captured configuration
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_snapshot_get(struct inv_icm20948 * s, struct inv_icm20948_snapshot * snap);
+
+/** @brief Apply a configuration captured with inv_icm20948_snapshot_get()
+ *  Only groups of settings that differ from current states are written
+ *  and LP_EN is kept off for the whole sequence instead of being toggled
+ *  around each access.
+ *  Driver must be initialized and DMP firmware loaded.
+ *  @param[in]  s     driver states
+ *  @param[in]  snap  configuration to apply
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_snapshot_apply(struct inv_icm20948 * s, const struct inv_icm20948_snapshot * snap);
+
+/** @brief Serialize a snapshot to a versioned little-endian binary blob
+ *  @param[in]  snap  configuration to serialize
+ *  @param[out] buf   output buffer
+ *  @param[in]  size  output buffer size (at least INV_ICM20948_SNAPSHOT_SIZE)
+ *  @return     number of bytes written, negative value on error
+ */
+int INV_EXPORT inv_icm20948_snapshot_serialize(const struct inv_icm20948_snapshot * snap, uint8_t * buf, unsigned size);
+
+/** @brief Deserialize a binary blob produced by inv_icm20948_snapshot_serialize()
+ *  @param[out] snap  decoded configuration
+ *  @param[in]  buf   input buffer
+ *  @param[in]  size  input buffer size
+ *  @return     0 on success, INV_ERROR_SIZE if blob is truncated,
+ *              INV_ERROR_BAD_ARG if magic, version or checksum does not match
+ */
+int INV_EXPORT inv_icm20948_snapshot_deserialize(struct inv_icm20948_snapshot * snap, const uint8_t * buf, unsigned size);
+
+/** @brief Capture current driver configuration and serialize it
+ *  @return     number of bytes written, negative value on error
+ */
+int INV_EXPORT inv_icm20948_snapshot_save(struct inv_icm20948 * s, uint8_t * buf, unsigned size);
+
+/** @brief Deserialize a configuration blob and apply it
+ *  @return     0 on success, negative value on error
+ */
+int INV_EXPORT inv_icm20948_snapshot_restore(struct inv_icm20948 * s, const uint8_t * buf, unsigned size);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif // INV_ICM20948_SNAPSHOT_H__
@@ -27,13 +27,22 @@
 
 struct inv_icm20948 * icm20948_instance;
 
+static void wait_mems_xfers(struct inv_icm20948 * s);
+
 int inv_icm20948_read_reg(struct inv_icm20948 * s, uint8_t reg,	uint8_t * buf, uint32_t len)
 {
+	/* serif is busy with an asynchronous request, let it finish first */
+	if(s->async_xfer.active)
+		wait_mems_xfers(s);
+
 	return inv_icm20948_serif_read_reg(&s->serif, reg, buf, len);
 }
 
 int inv_icm20948_write_reg(struct inv_icm20948 * s, uint8_t reg, const uint8_t * buf, uint32_t len)
 {
+	if(s->async_xfer.active)
+		wait_mems_xfers(s);
+
 	return inv_icm20948_serif_write_reg(&s->serif, reg, buf, len);
 }
 
@@ -234,6 +243,130 @@ int inv_icm20948_read_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned i
 	return result;
 }
 
+int inv_icm20948_read_mems_reg_burst(struct inv_icm20948 * s, uint16_t reg, unsigned int length, unsigned char *data)
+{
+	const unsigned int max_read = inv_icm20948_serif_max_read(&s->serif);
+	unsigned char regOnly = (unsigned char)(reg & 0x7F);
+	unsigned int bytesRead = 0;
+	int result;
+
+	if((result = inv_set_bank(s, reg >> 7)) != 0)
+		return result;
+
+	while (bytesRead<length)
+	{
+		unsigned int thisLen = min(max_read, length-bytesRead);
+
+		if((result = inv_icm20948_read_reg(s, regOnly+bytesRead, &data[bytesRead], thisLen)) != 0)
+			return result;
+
+		bytesRead += thisLen;
+	}
+
+	return 0;
+}
+
+static void mems_xfers_done(void * cookie, int status)
+{
+	struct inv_icm20948 * s = (struct inv_icm20948 *)cookie;
+
+	s->async_xfer.status = (status) ? INV_ERROR_TRANSPORT : 0;
+	s->async_xfer.pending = 0;
+}
+
+/**
+*  @brief      Wait for end of asynchronous request and restore power state.
+*              Request status is kept for inv_icm20948_complete_mems_xfers().
+*/
+static void wait_mems_xfers(struct inv_icm20948 * s)
+{
+	while(s->async_xfer.pending)
+		;
+
+	/* clear active first as restoring LP_EN goes through inv_icm20948_write_reg() */
+	s->async_xfer.active = 0;
+
+	if(s->async_xfer.lp_restore) {
+		s->async_xfer.lp_restore = 0;
+		if(inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1) && !s->async_xfer.status)
+			s->async_xfer.status = INV_ERROR_TRANSPORT;
+	}
+}
+
+/**
+*  @brief      Submit asynchronous register accesses on MEMs.
+*  @param[in]  Register bank for all transfers
+*  @param[in]  Transfer descriptors (must remain valid until request is over)
+*  @param[in]  Number of descriptors
+*  @return     0 if successful, INV_ERROR_NIMPL if serif has no asynchronous support.
+*/
+int inv_icm20948_submit_mems_xfers(struct inv_icm20948 * s, uint8_t bank,
+		const struct inv_icm20948_serif_xfer * xfers, uint32_t count)
+{
+	int result = 0;
+	uint32_t i;
+	uint8_t lp_disable = 0;
+	unsigned char power_state;
+
+	if(!inv_icm20948_serif_can_submit(&s->serif))
+		return INV_ERROR_NIMPL;
+
+	/* only one request at a time, previous status is dropped */
+	inv_icm20948_complete_mems_xfers(s);
+
+	power_state = inv_icm20948_get_chip_power_state(s);
+
+	if((power_state & CHIP_AWAKE) == 0)   // Wake up chip since it is asleep
+		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
+
+	for(i = 0; i < count; i++)
+		lp_disable |= check_reg_access_lp_disable(s, ((uint16_t)bank << 7) | xfers[i].reg);
+
+	if(lp_disable)   // Check if registers need LP_EN to be disabled
+		result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 0);  //Disable LP_EN
+
+	result |= inv_set_bank(s, bank);
+
+	if(result) {
+		if(lp_disable)
+			inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+		return result;
+	}
+
+	s->async_xfer.lp_restore = lp_disable;
+	s->async_xfer.status = 0;
+	s->async_xfer.pending = 1;
+	s->async_xfer.active = 1;
+
+	result = inv_icm20948_serif_submit(&s->serif, xfers, count, mems_xfers_done, s);
+
+	if(result) {
+		s->async_xfer.pending = 0;
+		wait_mems_xfers(s);
+		s->async_xfer.status = 0;
+	}
+
+	return result;
+}
+
+int inv_icm20948_mems_xfers_busy(struct inv_icm20948 * s)
+{
+	return (s->async_xfer.active && s->async_xfer.pending);
+}
+
+int inv_icm20948_complete_mems_xfers(struct inv_icm20948 * s)
+{
+	int result;
+
+	if(s->async_xfer.active)
+		wait_mems_xfers(s);
+
+	result = s->async_xfer.status;
+	s->async_xfer.status = 0;
+
+	return result;
+}
+
 /**
 *  @brief      Read data from a register in DMP memory 
 *  @param[in]  DMP memory address
@@ -250,6 +383,8 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 	unsigned char power_state = inv_icm20948_get_chip_power_state(s);
 	unsigned char lBankSelected;
 	unsigned char lStartAddrSelected;
+	const unsigned short addr = reg;
+	const unsigned char * const out = data;
 
 	if(!data)
 		return -1;
@@ -303,6 +438,9 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 		}
 	}
 
+	if(s->fifo_log)
+		inv_icm20948_fifo_log_mem(s, addr, out, (uint16_t)length);
+
 	//Enable LP_EN if we disabled it at begining of this function.
 	if(check_reg_access_lp_disable(s, reg))
 		result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
@@ -374,6 +512,127 @@ int inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short reg, unsigne
     return result;
 }
 
+static int select_mems_bank(struct inv_icm20948 * s, unsigned short reg)
+{
+	unsigned char lBankSelected = (reg >> 8);
+	int result;
+
+	if (lBankSelected == s->lLastBankSelected)
+		return 0;
+
+	result = inv_icm20948_write_reg(s, REG_MEM_BANK_SEL, &lBankSelected, 1);
+	if (result)
+		return result;
+
+	s->lLastBankSelected = lBankSelected;
+
+	return 0;
+}
+
+/* Burst length for DMP memory access: limited by serial interface capability
+   and by the end of the current DMP memory bank (start address does not wrap to next bank) */
+static unsigned int mems_burst_len(unsigned short reg, unsigned int length, uint32_t max_len)
+{
+	unsigned int thisLen = 0x100 - (reg & 0xff);
+
+	if (thisLen > length)
+		thisLen = length;
+	if (thisLen > max_len)
+		thisLen = max_len;
+
+	return thisLen;
+}
+
+/**
+*  @brief       Write data to DMP memory with no power control
+*  @param[in]   DMP memory address
+*  @param[in]   number of byte to be written
+*  @param[in]   data to write
+*  @return     0 if successful.
+*/
+int inv_icm20948_write_mems_core(struct inv_icm20948 * s, unsigned short reg, unsigned int length, const unsigned char *data)
+{
+	int result;
+	unsigned int bytesWritten = 0;
+	const uint32_t max_write = inv_icm20948_serif_max_write(&s->serif);
+
+	if(!data)
+		return -1;
+
+	result = inv_set_bank(s, 0);
+	if (result)
+		return result;
+
+	while (bytesWritten < length)
+	{
+		const unsigned int thisLen = mems_burst_len(reg, length-bytesWritten, max_write);
+		unsigned char lStartAddrSelected = (reg & 0xff);
+
+		result = select_mems_bank(s, reg);
+		if (result)
+			return result;
+
+		/* start address must be written prior to each burst */
+		result = inv_icm20948_write_reg(s, REG_MEM_START_ADDR, &lStartAddrSelected, 1);
+		if (result)
+			return result;
+
+		result = inv_icm20948_write_reg(s, REG_MEM_R_W, &data[bytesWritten], thisLen);
+		if (result)
+			return result;
+
+		bytesWritten += thisLen;
+		reg += thisLen;
+	}
+
+	return 0;
+}
+
+/**
+*  @brief       Read data from DMP memory with no power control
+*  @param[in]   DMP memory address
+*  @param[in]   number of byte to be read
+*  @param[out]  read data
+*  @return     0 if successful.
+*/
+int inv_icm20948_read_mems_core(struct inv_icm20948 * s, unsigned short reg, unsigned int length, unsigned char *data)
+{
+	int result;
+	unsigned int bytesRead = 0;
+	const uint32_t max_read = inv_icm20948_serif_max_read(&s->serif);
+
+	if(!data)
+		return -1;
+
+	result = inv_set_bank(s, 0);
+	if (result)
+		return result;
+
+	while (bytesRead < length)
+	{
+		const unsigned int thisLen = mems_burst_len(reg, length-bytesRead, max_read);
+		unsigned char lStartAddrSelected = (reg & 0xff);
+
+		result = select_mems_bank(s, reg);
+		if (result)
+			return result;
+
+		/* start address must be written prior to each burst */
+		result = inv_icm20948_write_reg(s, REG_MEM_START_ADDR, &lStartAddrSelected, 1);
+		if (result)
+			return result;
+
+		result = inv_icm20948_read_reg(s, REG_MEM_R_W, &data[bytesRead], thisLen);
+		if (result)
+			return result;
+
+		bytesRead += thisLen;
+		reg += thisLen;
+	}
+
+	return 0;
+}
+
 /**
 *  @brief      Write single byte of data to a register on MEMs with no power control
 *  @param[in]  Register address
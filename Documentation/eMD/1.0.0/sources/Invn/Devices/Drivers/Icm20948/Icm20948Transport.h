@@ -39,6 +39,7 @@ extern "C" {
 
 /* forward declaration */
 struct inv_icm20948;
+struct inv_icm20948_serif_xfer;
 
 /** @brief Max size that can be read across I2C or SPI data lines */
 #define INV_MAX_SERIAL_READ 16
@@ -133,6 +134,38 @@ int INV_EXPORT inv_icm20948_write_single_mems_reg(struct inv_icm20948 * s, uint1
 *  @return     0 if successful.
 */
 int INV_EXPORT inv_icm20948_read_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned int length, unsigned char *data);
+/**
+*  @brief      Read consecutive registers on MEMs with as few transactions as possible.
+*              Data is read directly into the caller buffer, in chunks of the serial
+*              interface max_read size. Chip must be awake and LP_EN disabled.
+*  @param[in]  Register address
+*  @param[in]  Length of data
+*  @param[out] Data read
+*  @return     0 if successful.
+*/
+int INV_EXPORT inv_icm20948_read_mems_reg_burst(struct inv_icm20948 * s, uint16_t reg, unsigned int length, unsigned char *data);
+/** @brief Submits asynchronous register accesses on MEMs
+* Chip is woken up, LP_EN is disabled if needed by one of the registers and bank is selected
+* before submission, LP_EN is enabled back once the request is over.
+* Any register access done while the request is in progress first waits for its end.
+* @param[in] bank  	register bank for all transfers
+* @param[in] xfers 	transfer descriptors, must remain valid until request is over
+* @param[in] count 	number of descriptors
+* @return 	   		0 in case of success, INV_ERROR_NIMPL if serif does not support asynchronous requests
+*/
+int INV_EXPORT inv_icm20948_submit_mems_xfers(struct inv_icm20948 * s, uint8_t bank,
+		const struct inv_icm20948_serif_xfer * xfers, uint32_t count);
+
+/** @brief Checks if an asynchronous request is still in progress
+* @return 	   		1 if request is in progress, 0 otherwise
+*/
+int INV_EXPORT inv_icm20948_mems_xfers_busy(struct inv_icm20948 * s);
+
+/** @brief Waits for end of asynchronous request
+* @return 	   		status of last request, 0 in case of success
+*/
+int INV_EXPORT inv_icm20948_complete_mems_xfers(struct inv_icm20948 * s);
+
 /**
 *  @brief      Read data from a register in DMP memory 
 *  @param[in]  DMP memory address
@@ -157,6 +190,26 @@ int INV_EXPORT inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short r
 */
 int INV_EXPORT inv_icm20948_write_single_mems_reg_core(struct inv_icm20948 * s, uint16_t reg, const uint8_t data);
 
+/** @brief Writes data to DMP memory with no power control
+* Data are written in bursts as large as allowed by the serial interface (serif.max_write),
+* a burst never crosses a DMP memory bank boundary.
+* @param[in] reg  	DMP memory address
+* @param[in] length	number of byte to be written
+* @param[in] data	Data to be written
+* @return 	   		0 in case of success, -1 for any error
+*/
+int INV_EXPORT inv_icm20948_write_mems_core(struct inv_icm20948 * s, unsigned short reg, unsigned int length, const unsigned char *data);
+
+/** @brief Reads data from DMP memory with no power control
+* Data are read in bursts as large as allowed by the serial interface (serif.max_read),
+* a burst never crosses a DMP memory bank boundary.
+* @param[in] reg  	DMP memory address
+* @param[in] length	number of byte to be read
+* @param[out] data	Read data
+* @return 	   		0 in case of success, -1 for any error
+*/
+int INV_EXPORT inv_icm20948_read_mems_core(struct inv_icm20948 * s, unsigned short reg, unsigned int length, unsigned char *data);
+
 #ifdef __cplusplus
 }
 #endif
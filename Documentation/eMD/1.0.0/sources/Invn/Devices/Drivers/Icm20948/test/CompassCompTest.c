@@ -0,0 +1,170 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively "Software") is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+/*
+	Host-side exactness tests for Icm20948CompassComp.
+
+	Build and run from the sources directory with a host compiler, once per
+	instruction set to cover every compensation kernel:
+
+		for f in "-U__SSE2__ -U__AVX__" -msse2 -mavx; do
+			cc -O2 $f -I. Invn/Devices/Drivers/Icm20948/test/CompassCompTest.c \
+				Invn/Devices/Drivers/Icm20948/Icm20948*.c Invn/EmbUtils/[A-Z]*.c -lm \
+				-o CompassCompTest && ./CompassCompTest || break
+		done
+
+	The first build uses the scalar kernel of Cortex-M targets, run on an
+	AArch64 host for the NEON one.
+
+	inv_icm20948_compass_comp_apply() and inv_icm20948_compass_comp_apply_f()
+	are checked to be bit exact with inv_icm20948_apply_raw_compass_matrix(),
+	for calibration-like and fully random matrices, random and full scale
+	samples, and lengths that are not a multiple of the kernel block size.
+	The program returns 0 on success.
+*/
+
+#include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948CompassComp.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948AuxCompassAkm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* driver time base, not used here */
+void inv_icm20948_sleep_us(int us)
+{
+	(void)us;
+}
+
+uint64_t inv_icm20948_get_time_us(void)
+{
+	return 0;
+}
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+#define NB_MATRICES 	200
+#define NB_SAMPLES 		4099 	/* not a multiple of the kernel block */
+
+static struct inv_icm20948 icm;
+static short raw[3 * NB_SAMPLES];
+static long ref[3 * NB_SAMPLES], out[3 * NB_SAMPLES];
+static float out_f[3 * NB_SAMPLES];
+
+static uint32_t xorshift(void)
+{
+	static uint64_t x = 88172645463325252ULL;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+
+	return (uint32_t)x;
+}
+
+static void random_matrix(int t)
+{
+	int i;
+
+	for (i = 0; i < 9; i++) {
+		if (t < NB_MATRICES / 2) /* soft iron near identity times AK09916 sensitivity */
+			icm.secondary_state.final_matrix[i] = ((i % 4) == 0 ? 161061 : 0) + (int)(xorshift() % 32768) - 16384;
+		else
+			icm.secondary_state.final_matrix[i] = (int)(xorshift() % (1u << 24)) - (1 << 23);
+	}
+	icm.compass_cal.generation++;
+}
+
+static void random_samples(int t)
+{
+	unsigned k;
+
+	for (k = 0; k < 3 * NB_SAMPLES; k++) {
+		if (t & 1)
+			raw[k] = (short)xorshift();
+		else /* full scale and zero */
+			raw[k] = (short)((xorshift() & 1) ? ((xorshift() & 1) ? 32767 : -32768) : 0);
+	}
+}
+
+/* kernel output must match the per-sample driver computation */
+static void test_exactness(void)
+{
+	struct inv_icm20948_compass_comp c;
+	unsigned n, k, bad = 0, bad_f = 0;
+	int t;
+
+	memset(&c, 0, sizeof(c));
+	for (t = 0; t < NB_MATRICES; t++) {
+		random_matrix(t);
+		CHECK(inv_icm20948_compass_comp_sync(&icm, &c, 0) == 1);
+		CHECK(inv_icm20948_compass_comp_sync(&icm, &c, 0) == 0);
+
+		random_samples(t);
+		n = NB_SAMPLES - t % 7;
+		for (k = 0; k < n; k++)
+			inv_icm20948_apply_raw_compass_matrix(&icm, &raw[3 * k], &ref[3 * k]);
+		inv_icm20948_compass_comp_apply(&c, raw, out, n);
+		inv_icm20948_compass_comp_apply_f(&c, raw, out_f, n);
+		for (k = 0; k < 3 * n; k++) {
+			bad += (out[k] != ref[k]);
+			bad_f += (out_f[k] != ref[k] * (1/(float)(1UL<<16)));
+		}
+	}
+	CHECK(bad == 0);
+	CHECK(bad_f == 0);
+	printf("exactness: %u q16 and %u float mismatches over %u samples\n",
+			bad, bad_f, NB_MATRICES * NB_SAMPLES);
+}
+
+/* calibrated output subtracts the DMP compass bias */
+static void test_offset(void)
+{
+	struct inv_icm20948_compass_comp c;
+	unsigned k;
+
+	memset(&c, 0, sizeof(c));
+	random_matrix(0);
+	random_samples(1);
+	icm.bias[6] = 1000;
+	icm.bias[7] = -7;
+	icm.bias[8] = 1 << 20;
+	CHECK(inv_icm20948_compass_comp_sync(&icm, &c, 1) == 1);
+	/* switching output type rebuilds the cache */
+	CHECK(inv_icm20948_compass_comp_sync(&icm, &c, 0) == 1);
+	CHECK(inv_icm20948_compass_comp_sync(&icm, &c, 1) == 1);
+
+	inv_icm20948_compass_comp_apply(&c, raw, out, NB_SAMPLES);
+	for (k = 0; k < NB_SAMPLES; k++)
+		inv_icm20948_apply_raw_compass_matrix(&icm, &raw[3 * k], &ref[3 * k]);
+	for (k = 0; k < 3 * NB_SAMPLES; k++)
+		CHECK(out[k] == ref[k] - icm.bias[6 + k % 3]);
+}
+
+int main(void)
+{
+	test_exactness();
+	test_offset();
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively "Software") is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+/*
+	Host simulation of sample to callback latency, DMP FIFO path versus
+	raw mode data-ready register reads.
+
+	Build and run from the sources directory with a POSIX host compiler:
+
+		cc -O2 -I. Invn/Devices/Drivers/Icm20948/test/DataReadyLatencySim.c \
+			Invn/Devices/Drivers/Icm20948/Icm20948*.c Invn/EmbUtils/[A-Z]*.c -lm \
+			-o DataReadyLatencySim
+		./DataReadyLatencySim
+
+	Time is virtual. The simulated serif stalls the CPU for a fixed time
+	per transaction plus a per byte time. A new sample is produced every
+	sample period and raises the interrupt, which is serviced after a
+	random delay of 2 to 10 us. For 2 s of samples at 1125 Hz, the
+	interrupt is handled either by inv_icm20948_poll_sensor() draining one
+	raw accel DMP FIFO packet, or by inv_icm20948_raw_mode_data_ready()
+	reading accel and gyro data registers (INV_ICM20948_RAW_MODE_DATA_READY).
+	The DMP internal processing delay is not modelled, which favours the
+	FIFO path.
+
+	Each sample carries its number. Latency is measured from the sample
+	time to the first callback delivering it. The program checks that every
+	sample is delivered once and in order on both paths, and that the
+	data-ready path has lower latency percentiles. It reports p50, p90 and
+	p99 latencies and the number of bus transactions per sample. The
+	program returns 0 on success.
+*/
+
+#include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Defs.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948MPUFifoControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948RawMode.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Setup.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Transport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+#define SIM_RATE_HZ 		1125
+#define SIM_NB_SAMPLES 		(2 * SIM_RATE_HZ)
+#define SIM_IRQ_MIN_US 		2
+#define SIM_IRQ_MAX_US 		10
+#define PACKET_SIZE 		10 		/* header, accel, footer */
+
+enum path {
+	PATH_DMP_FIFO,
+	PATH_DATA_READY,
+};
+
+struct scenario {
+	const char * name;
+	double xfer_us;      /* bus time per transaction */
+	double byte_us;      /* bus time per byte */
+};
+
+static const struct scenario scenarios[] = {
+	{ "SPI",      2,  0.125 },
+	{ "I2C-like", 30, 22.5  },
+};
+
+struct result {
+	unsigned long samples;
+	unsigned long errors;
+	double        xfers_per_sample;
+	double        p50, p90, p99;
+};
+
+static const struct scenario * sc;
+static enum path path;
+static struct result res;
+static double now_us;
+static unsigned long cur_sample, fifo_out, next_sample, nb_xfers;
+static double latency_us[SIM_NB_SAMPLES];
+static uint8_t bank;
+
+void inv_icm20948_sleep_us(int us)
+{
+	now_us += us;
+}
+
+uint64_t inv_icm20948_get_time_us(void)
+{
+	return (uint64_t)now_us;
+}
+
+static double sample_time(unsigned long k)
+{
+	return (k + 1) * 1e6 / SIM_RATE_HZ;
+}
+
+/* accel packet, sample number k spread over the high bits of x and y */
+static uint8_t fifo_byte(unsigned long i)
+{
+	const unsigned long k = i / PACKET_SIZE;
+
+	switch(i % PACKET_SIZE) {
+	case 0: return ACCEL_SET >> 8;
+	case 2: return (k >> 8) & 0x7f;
+	case 3: return k & 0xff;
+	case 4: return (k >> 23) & 0x7f;
+	case 5: return (k >> 15) & 0xff;
+	default: return 0;
+	}
+}
+
+static void bus_xfer(uint32_t len)
+{
+	now_us += sc->xfer_us + (len + 1) * sc->byte_us;
+	nb_xfers++;
+}
+
+static int sim_read_reg(void * context, uint8_t reg, uint8_t * buf, uint32_t len)
+{
+	const unsigned long avail = (cur_sample + 1) * PACKET_SIZE - fifo_out;
+	uint32_t i;
+
+	(void)context;
+	bus_xfer(len);
+	memset(buf, 0, len);
+	if(reg == REG_BANK_SEL) {
+		buf[0] = bank << 4;
+	} else if(bank == 0) {
+		if(reg == (REG_INT_STATUS & 0x7f)) {
+			buf[0] = BIT_DMP_INT;
+		} else if(reg == (REG_INT_STATUS_1 & 0x7f)) {
+			buf[0] = 0x01; /* RAW_DATA_0_RDY_INT */
+		} else if(reg == (REG_FIFO_COUNT_H & 0x7f)) {
+			buf[0] = (uint8_t)(avail >> 8);
+			if(len > 1)
+				buf[1] = (uint8_t)avail;
+		} else if(reg == (REG_FIFO_R_W & 0x7f)) {
+			for(i = 0; i < len; i++)
+				buf[i] = fifo_byte(fifo_out++);
+		} else {
+			/* accel x and gyro x data registers hold sample number */
+			for(i = 0; i < len; i++) {
+				const unsigned r = reg + i;
+
+				if(r == (REG_ACCEL_XOUT_H_SH & 0x7f) || r == (REG_GYRO_XOUT_H_SH & 0x7f))
+					buf[i] = (uint8_t)(cur_sample >> 8);
+				else if(r == (REG_ACCEL_XOUT_H_SH & 0x7f) + 1 || r == (REG_GYRO_XOUT_H_SH & 0x7f) + 1)
+					buf[i] = (uint8_t)cur_sample;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int sim_write_reg(void * context, uint8_t reg, const uint8_t * buf, uint32_t len)
+{
+	(void)context;
+	bus_xfer(len);
+	if(reg == REG_BANK_SEL)
+		bank = (buf[0] >> 4) & 3;
+
+	return 0;
+}
+
+/* latency is taken on the accel sample, delivered first */
+static void sim_handler(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp,
+		const void * data, const void * arg)
+{
+	unsigned long k;
+
+	(void)context, (void)timestamp, (void)arg;
+
+	if(sensor != INV_ICM20948_SENSOR_RAW_ACCELEROMETER)
+		return;
+
+	if(path == PATH_DMP_FIFO) {
+		long acc[3];
+
+		inv_icm20948_dmp_get_accel(acc);
+		k = (unsigned long)(uint16_t)(acc[0] >> 15) | ((unsigned long)(uint16_t)(acc[1] >> 15) << 15);
+	} else {
+		k = (unsigned long)((const long *)data)[0];
+	}
+	if(k != next_sample || res.samples >= SIM_NB_SAMPLES) {
+		res.errors++;
+		return;
+	}
+	next_sample = k + 1;
+	latency_us[res.samples++] = now_us - sample_time(k);
+}
+
+static int compare_double(const void * a, const void * b)
+{
+	const double x = *(const double *)a, y = *(const double *)b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+static void simulate(void)
+{
+	static struct inv_icm20948 icm;
+	struct inv_icm20948_serif serif;
+	unsigned long k;
+
+	memset(&serif, 0, sizeof(serif));
+	serif.read_reg = sim_read_reg;
+	serif.write_reg = sim_write_reg;
+	serif.max_read = 16;
+	serif.max_write = 16;
+	serif.is_spi = 1;
+
+	inv_icm20948_reset_states(&icm, &serif);
+	inv_icm20948_transport_init(&icm);
+	icm.base_state.wake_state = CHIP_AWAKE;
+	icm.base_state.serial_interface = SERIAL_INTERFACE_SPI;
+	icm.mounting_matrix[0] = icm.mounting_matrix[4] = icm.mounting_matrix[8] = 1;
+	if(path == PATH_DMP_FIFO) {
+		icm.inv_androidSensorsOn_mask[ANDROID_SENSOR_RAW_ACCELEROMETER >> 5] |=
+				1L << (ANDROID_SENSOR_RAW_ACCELEROMETER & 31);
+		icm.s_quat_chip_to_body[0] = 1L << 30;
+		icm.sensorlist[INV_ICM20948_SENSOR_RAW_ACCELEROMETER].odr_us = (uint32_t)(1e6 / SIM_RATE_HZ);
+	} else if(inv_icm20948_raw_mode_start(&icm, INV_ICM20948_RAW_MODE_ACCEL | INV_ICM20948_RAW_MODE_GYRO
+			| INV_ICM20948_RAW_MODE_DATA_READY, 0) != 0) {
+		res.errors++;
+		return;
+	}
+
+	srand(1);
+	nb_xfers = 0;
+	for(k = 0; k < SIM_NB_SAMPLES; k++) {
+		const double irq_us = sample_time(k) + SIM_IRQ_MIN_US
+				+ (rand() / (double)RAND_MAX) * (SIM_IRQ_MAX_US - SIM_IRQ_MIN_US);
+
+		cur_sample = k;
+		if(now_us < irq_us)
+			now_us = irq_us;
+		if(path == PATH_DMP_FIFO)
+			inv_icm20948_poll_sensor(&icm, 0, sim_handler);
+		else
+			inv_icm20948_raw_mode_data_ready(&icm, (uint64_t)irq_us, 0, sim_handler);
+	}
+
+	res.xfers_per_sample = (double)nb_xfers / SIM_NB_SAMPLES;
+	if(res.samples) {
+		qsort(latency_us, res.samples, sizeof(latency_us[0]), compare_double);
+		res.p50 = latency_us[res.samples / 2];
+		res.p90 = latency_us[res.samples * 9 / 10];
+		res.p99 = latency_us[res.samples * 99 / 100];
+	}
+}
+
+/* driver FIFO mirror is static, run each simulation in its own process */
+static int run(const struct scenario * s, enum path p, struct result * out)
+{
+	int fd[2], status;
+	ssize_t len;
+	pid_t pid;
+
+	if(pipe(fd) != 0)
+		return -1;
+	pid = fork();
+	if(pid < 0)
+		return -1;
+	if(pid == 0) {
+		close(fd[0]);
+		sc = s;
+		path = p;
+		simulate();
+		len = write(fd[1], &res, sizeof(res));
+		_exit(len == (ssize_t)sizeof(res) ? 0 : 1);
+	}
+	close(fd[1]);
+	len = read(fd[0], out, sizeof(*out));
+	close(fd[0]);
+	if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return -1;
+
+	return (len == (ssize_t)sizeof(*out)) ? 0 : -1;
+}
+
+static void print_result(const char * name, const struct result * r)
+{
+	printf("  %-12s %6.1f %8.1f %8.1f %8.1f\n", name, r->xfers_per_sample, r->p50, r->p90, r->p99);
+}
+
+int main(void)
+{
+	unsigned i;
+
+	for(i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		const struct scenario * s = &scenarios[i];
+		struct result fifo, drdy;
+
+		if(run(s, PATH_DMP_FIFO, &fifo) != 0 || run(s, PATH_DATA_READY, &drdy) != 0) {
+			CHECK(!"simulation failed");
+			continue;
+		}
+
+		CHECK(fifo.errors == 0 && fifo.samples == SIM_NB_SAMPLES);
+		CHECK(drdy.errors == 0 && drdy.samples == SIM_NB_SAMPLES);
+		CHECK(drdy.p50 < fifo.p50 && drdy.p90 < fifo.p90 && drdy.p99 < fifo.p99);
+
+		printf("%s (%.0f us/xfer + %.3f us/byte)\n", s->name, s->xfer_us, s->byte_us);
+		printf("  %-12s %6s %8s %8s %8s\n", "", "xfers", "p50 us", "p90 us", "p99 us");
+		print_result("DMP FIFO", &fifo);
+		print_result("data-ready", &drdy);
+	}
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
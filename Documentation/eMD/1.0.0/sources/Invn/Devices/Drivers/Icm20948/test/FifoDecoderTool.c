@@ -0,0 +1,451 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively "Software") is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+/*
+	Host tool decoding recorded DMP FIFO streams with Icm20948FifoDecoder.
+
+	Build from the sources directory with a POSIX host compiler:
+
+		cc -O2 -pthread -I. Invn/Devices/Drivers/Icm20948/test/FifoDecoderTool.c \
+			Invn/Devices/Drivers/Icm20948/Icm20948*.c Invn/EmbUtils/[A-Z]*.c -lm \
+			-o FifoDecoderTool
+
+	Decode a raw FIFO stream (bytes as read from REG_FIFO_R_W) to a columnar
+	file, see inv_icm20948_fifo_columns_write() for the format:
+
+		./FifoDecoderTool [-j threads] [-a accel_fsr] [-g gyro_fsr] fifo.bin columns.bin
+
+	accel_fsr and gyro_fsr are the full scale indexes the stream was recorded
+	with (as inv_icm20948_get_accel_fullscale(), default 0). The compass
+	matrix is not known offline: the compass column is left at 0.
+
+	Measure decoding throughput versus number of threads on a synthetic
+	stream with lost bytes, and check output is the same as a one thread
+	decode whatever the number of threads:
+
+		./FifoDecoderTool bench [MiB [max threads]]
+
+	The file is memory mapped and processed by windows of one chunk per
+	thread: chunks of a window are decoded in parallel, then written in
+	stream order, after decoding again a chunk whose start fell inside a
+	packet (see inv_icm20948_fifo_decoder_split()). Memory use does not
+	depend on the file size. The program returns 0 on success.
+*/
+
+#include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Defs.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948FifoDecoder.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948MPUFifoControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Setup.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/* driver time base, not used here */
+void inv_icm20948_sleep_us(int us)
+{
+	(void)us;
+}
+
+uint64_t inv_icm20948_get_time_us(void)
+{
+	return 0;
+}
+
+#define MAX_THREADS 	64
+#define CHUNK_SIZE 		(1u << 20) 			/* stream bytes per thread and window */
+#define CHUNK_ROWS 		(CHUNK_SIZE / 8) 	/* rows buffered per thread, more are decoded in several passes */
+
+struct job {
+	const struct inv_icm20948_fifo_decoder * d;
+	const uint8_t * data;
+	uint32_t len;
+	uint32_t begin, end;
+	struct inv_icm20948_fifo_columns cols;
+	pthread_t thread;
+};
+
+struct stats {
+	uint64_t rows;
+	uint32_t resyncs;
+	uint32_t skipped;
+	uint32_t restitched;
+	uint32_t trailing;	/* bytes of a truncated last packet */
+};
+
+typedef int (*output_cb)(void * context, const struct inv_icm20948_fifo_columns * cols);
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cols_alloc(struct inv_icm20948_fifo_columns * cols, uint32_t capacity)
+{
+	int i;
+
+	memset(cols, 0, sizeof(*cols));
+	for (i = 0; i < INV_ICM20948_FIFO_COL_MAX; i++) {
+		cols->col[i] = malloc((size_t)capacity * inv_icm20948_fifo_column_width(i));
+		if (!cols->col[i])
+			return -1;
+	}
+	cols->capacity = capacity;
+
+	return 0;
+}
+
+static void cols_free(struct inv_icm20948_fifo_columns * cols)
+{
+	int i;
+
+	for (i = 0; i < INV_ICM20948_FIFO_COL_MAX; i++)
+		free(cols->col[i]);
+}
+
+static void job_run(struct job * j)
+{
+	j->cols.resyncs = j->cols.skipped = 0;
+	inv_icm20948_fifo_decoder_run(j->d, j->data, j->len, j->begin, j->end, &j->cols);
+}
+
+static void * job_thread(void * arg)
+{
+	job_run((struct job *)arg);
+
+	return 0;
+}
+
+/* output rows of a job, then decode the rest of its chunk if its buffers got full
+   pos is set to the offset where next chunk starts, or to len at end of stream */
+static int job_output(struct job * j, output_cb out, void * context, struct stats * st, uint32_t * pos)
+{
+	for (;;) {
+		st->rows += j->cols.nb_rows;
+		st->resyncs += j->cols.resyncs;
+		st->skipped += j->cols.skipped;
+		if (j->cols.nb_rows && out(context, &j->cols))
+			return -1;
+		*pos = j->cols.next;
+		if (*pos >= j->end)
+			return 0;
+		if (j->cols.nb_rows < j->cols.capacity) {
+			/* truncated last packet */
+			st->trailing = j->len - *pos;
+			*pos = j->len;
+			return 0;
+		}
+		j->begin = *pos;
+		job_run(j);
+	}
+}
+
+/* decode a whole stream with nb_threads, rows are output in stream order */
+static int decode_stream(const struct inv_icm20948_fifo_decoder * d, const uint8_t * data, uint32_t len,
+		unsigned nb_threads, output_cb out, void * context, struct stats * st)
+{
+	static struct job jobs[MAX_THREADS];
+	uint32_t bounds[MAX_THREADS + 1];
+	uint32_t pos = 0, wlen;
+	unsigned i;
+	int rc = 0;
+
+	memset(st, 0, sizeof(*st));
+	for (i = 0; i < nb_threads; i++) {
+		if (cols_alloc(&jobs[i].cols, CHUNK_ROWS))
+			return -1;
+		jobs[i].d = d;
+		jobs[i].data = data;
+		jobs[i].len = len;
+	}
+
+	while (pos < len && rc == 0) {
+		wlen = len - pos;
+		if (wlen > nb_threads * CHUNK_SIZE)
+			wlen = nb_threads * CHUNK_SIZE;
+		inv_icm20948_fifo_decoder_split(&data[pos], wlen, nb_threads, bounds);
+
+		for (i = 0; i < nb_threads; i++) {
+			jobs[i].begin = pos + bounds[i];
+			jobs[i].end = pos + bounds[i + 1];
+		}
+		for (i = 1; i < nb_threads; i++)
+			pthread_create(&jobs[i].thread, 0, job_thread, &jobs[i]);
+		job_run(&jobs[0]);
+		for (i = 1; i < nb_threads; i++)
+			pthread_join(jobs[i].thread, 0);
+
+		for (i = 0; i < nb_threads && pos < len && rc == 0; i++) {
+			if (pos >= jobs[i].end)
+				continue; /* empty chunk, or previous chunk last packet went past it */
+			if (jobs[i].begin != pos) {
+				/* previous chunk did not stop on this chunk start: decode it again from where it did */
+				st->restitched++;
+				jobs[i].begin = pos;
+				job_run(&jobs[i]);
+			}
+			rc = job_output(&jobs[i], out, context, st, &pos);
+		}
+	}
+
+	for (i = 0; i < nb_threads; i++)
+		cols_free(&jobs[i].cols);
+
+	return rc;
+}
+
+static void decoder_setup(struct inv_icm20948 * s, struct inv_icm20948_fifo_decoder * d,
+		uint8_t accel_fsr, uint8_t gyro_fsr)
+{
+	static struct inv_icm20948_serif serif; /* no device */
+
+	inv_icm20948_reset_states(s, &serif);
+	inv_icm20948_init_matrix(s);
+	s->base_state.accel_fullscale = accel_fsr;
+	s->base_state.gyro_fullscale = gyro_fsr;
+	inv_icm20948_fifo_decoder_init(d, s);
+}
+
+/******************************************************************************/
+/* Decode a file                                                              */
+/******************************************************************************/
+
+static int file_write(void * context, const void * buf, uint32_t len)
+{
+	return fwrite(buf, 1, len, (FILE *)context) != len;
+}
+
+static int output_file(void * context, const struct inv_icm20948_fifo_columns * cols)
+{
+	return inv_icm20948_fifo_columns_write(cols, file_write, context);
+}
+
+static int decode_file(const char * in_name, const char * out_name, unsigned nb_threads,
+		uint8_t accel_fsr, uint8_t gyro_fsr)
+{
+	static struct inv_icm20948 icm;
+	struct inv_icm20948_fifo_decoder d;
+	struct stats st;
+	struct stat sb;
+	const uint8_t * map;
+	double t0, t;
+	FILE * out;
+	int fd, rc;
+
+	fd = open(in_name, O_RDONLY);
+	if (fd < 0 || fstat(fd, &sb) || sb.st_size == 0 || (uint64_t)sb.st_size > UINT32_MAX) {
+		fprintf(stderr, "%s: cannot open, empty or larger than 4 GiB\n", in_name);
+		return 1;
+	}
+	map = mmap(0, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: cannot map\n", in_name);
+		return 1;
+	}
+	madvise((void *)map, sb.st_size, MADV_SEQUENTIAL);
+	out = fopen(out_name, "wb");
+	if (!out) {
+		fprintf(stderr, "%s: cannot create\n", out_name);
+		return 1;
+	}
+
+	decoder_setup(&icm, &d, accel_fsr, gyro_fsr);
+	t0 = now_s();
+	rc = decode_stream(&d, map, (uint32_t)sb.st_size, nb_threads, output_file, out, &st);
+	t = now_s() - t0;
+	rc |= fclose(out);
+
+	printf("%s: %llu bytes, %llu packets, %u resyncs (%u bytes skipped), %u trailing bytes, "
+			"%u threads, %.1f MB/s\n", in_name, (unsigned long long)sb.st_size,
+			(unsigned long long)st.rows, st.resyncs, st.skipped, st.trailing, nb_threads,
+			sb.st_size / t / 1e6);
+
+	munmap((void *)map, sb.st_size);
+	close(fd);
+
+	return rc ? 1 : 0;
+}
+
+/******************************************************************************/
+/* Benchmark                                                                  */
+/******************************************************************************/
+
+/* packet layouts of the synthetic stream */
+static const unsigned short bench_headers[][2] = {
+	{ ACCEL_SET | GYRO_SET, 0 },
+	{ ACCEL_SET | GYRO_SET | QUAT6_SET, 0 },
+	{ ACCEL_SET | GYRO_SET | CPASS_SET | QUAT9_SET | GEOMAG_SET, 0 },
+	{ ACCEL_SET | HEADER2_SET, ACCEL_ACCURACY_SET },
+	{ QUAT6_SET, 0 },
+	{ CPASS_SET | CPASS_CALIBR_SET, 0 },
+};
+
+static uint32_t lcg_next(uint32_t * state)
+{
+	*state = *state * 1664525u + 1013904223u;
+
+	return *state >> 8;
+}
+
+/* random walk payloads, one packet in about 5000 loses its tail */
+static uint32_t bench_stream(uint8_t * buf, uint32_t size)
+{
+	int16_t walk[64] = { 0 };
+	uint32_t seed = 1, len = 0;
+
+	while (len + 128 < size) {
+		const unsigned k = lcg_next(&seed) % (sizeof(bench_headers) / sizeof(bench_headers[0]));
+		const unsigned short h = bench_headers[k][0], h2 = bench_headers[k][1];
+		const int hsz = (h & HEADER2_SET) ? HEADER_SZ + HEADER2_SZ : HEADER_SZ;
+		unsigned short header, header2;
+		int sz, i;
+
+		buf[len] = h >> 8;
+		buf[len + 1] = (uint8_t)h;
+		buf[len + 2] = h2 >> 8;
+		buf[len + 3] = (uint8_t)h2;
+		sz = inv_icm20948_fifo_packet_size(&buf[len], size - len, &header, &header2);
+		for (i = hsz; i < sz; i += 2) {
+			int16_t * w = &walk[(i / 2) % 64];
+
+			*w += (int16_t)(lcg_next(&seed) % 33) - 16;
+			buf[len + i] = (uint8_t)(*w >> 8);
+			if (i + 1 < sz)
+				buf[len + i + 1] = (uint8_t)*w;
+		}
+		len += (lcg_next(&seed) % 5000 == 0) ? lcg_next(&seed) % sz : (uint32_t)sz;
+	}
+
+	return len;
+}
+
+struct bench_check {
+	const struct inv_icm20948_fifo_columns * ref;
+	uint32_t row;
+	uint32_t mismatches;
+};
+
+static int output_check(void * context, const struct inv_icm20948_fifo_columns * cols)
+{
+	struct bench_check * chk = (struct bench_check *)context;
+	int i;
+
+	for (i = 0; i < INV_ICM20948_FIFO_COL_MAX; i++) {
+		const unsigned w = inv_icm20948_fifo_column_width(i);
+
+		if (chk->row + cols->nb_rows > chk->ref->nb_rows
+				|| memcmp((const uint8_t *)chk->ref->col[i] + (size_t)chk->row * w, cols->col[i],
+						(size_t)cols->nb_rows * w) != 0)
+			chk->mismatches++;
+	}
+	chk->row += cols->nb_rows;
+
+	return 0;
+}
+
+static int bench(uint32_t size, unsigned max_threads)
+{
+	static struct inv_icm20948 icm;
+	struct inv_icm20948_fifo_decoder d;
+	struct inv_icm20948_fifo_columns ref;
+	struct bench_check chk;
+	struct stats st;
+	uint8_t * buf = malloc(size);
+	uint32_t len;
+	unsigned nb_threads;
+	double t, t1 = 0;
+	int failed = 0;
+
+	if (!buf || cols_alloc(&ref, size / 8))
+		return 1;
+	len = bench_stream(buf, size);
+	decoder_setup(&icm, &d, 0, 0);
+
+	/* reference: whole stream at once */
+	inv_icm20948_fifo_decoder_run(&d, buf, len, 0, len, &ref);
+	printf("stream %u bytes, %u packets, %u resyncs\n", len, ref.nb_rows, ref.resyncs);
+
+	for (nb_threads = 1; nb_threads <= max_threads; nb_threads *= 2) {
+		memset(&chk, 0, sizeof(chk));
+		chk.ref = &ref;
+		t = now_s();
+		decode_stream(&d, buf, len, nb_threads, output_check, &chk, &st);
+		t = now_s() - t;
+		if (nb_threads == 1)
+			t1 = t;
+		failed |= (chk.mismatches != 0 || chk.row != ref.nb_rows);
+		printf("%2u threads: %7.1f MB/s, speedup %.2f, %u rows, %u restitched, %s\n", nb_threads,
+				len / t / 1e6, t1 / t, chk.row, st.restitched,
+				(chk.mismatches == 0 && chk.row == ref.nb_rows) ? "identical" : "MISMATCH");
+	}
+	printf("%ld online CPUs\n", sysconf(_SC_NPROCESSORS_ONLN));
+
+	cols_free(&ref);
+	free(buf);
+
+	return failed;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: FifoDecoderTool [-j threads] [-a accel_fsr] [-g gyro_fsr] <fifo stream> <columns file>\n"
+		"       FifoDecoderTool bench [MiB [max threads]]\n");
+}
+
+int main(int argc, char * argv[])
+{
+	unsigned nb_threads = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+	int accel_fsr = 0, gyro_fsr = 0;
+	int i;
+
+	if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+		const unsigned mib = (argc > 2) ? (unsigned)atoi(argv[2]) : 64;
+		const unsigned max_threads = (argc > 3) ? (unsigned)atoi(argv[3]) : 16;
+
+		if (mib == 0 || mib >= 4096 || max_threads == 0 || max_threads > MAX_THREADS) {
+			usage();
+			return 1;
+		}
+		return bench(mib << 20, max_threads);
+	}
+
+	for (i = 1; i + 2 < argc; i += 2) {
+		if (strcmp(argv[i], "-j") == 0)
+			nb_threads = (unsigned)atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-a") == 0)
+			accel_fsr = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-g") == 0)
+			gyro_fsr = atoi(argv[i + 1]);
+		else
+			break;
+	}
+	if (argc - i != 2 || nb_threads == 0 || nb_threads > MAX_THREADS
+			|| accel_fsr < 0 || accel_fsr > 3 || gyro_fsr < 0 || gyro_fsr > 3) {
+		usage();
+		return 1;
+	}
+
+	return decode_file(argv[i], argv[i + 1], nb_threads, (uint8_t)accel_fsr, (uint8_t)gyro_fsr);
+}
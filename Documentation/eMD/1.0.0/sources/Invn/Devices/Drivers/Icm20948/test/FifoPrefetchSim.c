@@ -0,0 +1,347 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively "Software") is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+/*
+	Host simulation of the FIFO drain of inv_icm20948_poll_sensor(), with and
+	without the asynchronous serif submit() hook.
+
+	Build and run from the sources directory with a POSIX host compiler:
+
+		cc -O2 -I. Invn/Devices/Drivers/Icm20948/test/FifoPrefetchSim.c \
+			Invn/Devices/Drivers/Icm20948/Icm20948*.c Invn/EmbUtils/[A-Z]*.c -lm \
+			-o FifoPrefetchSim
+		./FifoPrefetchSim
+
+	Time is virtual. The simulated serif models each transaction as a fixed
+	overhead plus a per byte time on a single bus. Blocking read_reg() and
+	write_reg() advance CPU time until the transaction is over. submit()
+	only occupies the bus, as a DMA would: CPU time advances when decoding
+	needs a packet that has not landed yet. The sensor handler costs a fixed
+	decode time per sample.
+
+	The DMP FIFO is modelled as a stream of accel packets produced at a
+	fixed rate, each carrying its sample number, and the interrupt fires
+	every batch samples. For each bus configuration, the same 2 s stream is
+	drained once with blocking accesses and once with FIFO prefetch, and
+	the program checks that every sample is delivered once and in order,
+	without FIFO overflow, with timestamps within half a sample period on
+	average, and that prefetch does not increase CPU time.
+
+	It reports the CPU time spent in poll_sensor(), the bus time taken by
+	prefetch requests, and the share of that bus time hidden behind
+	decoding (overlap). The program returns 0 on success.
+*/
+
+#include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Defs.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948MPUFifoControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Setup.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Transport.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+#define SIM_DURATION_US 	2e6
+#define SIM_MAX_SAMPLES 	(1 << 16)
+#define PACKET_SIZE 		10 		/* header, accel, footer */
+
+struct scenario {
+	const char * name;
+	double rate_hz;      /* FIFO sample rate */
+	double xfer_us;      /* bus time per transaction */
+	double byte_us;      /* bus time per byte */
+	double decode_us;    /* handler time per sample */
+	int    batch;        /* samples per interrupt */
+};
+
+static const struct scenario scenarios[] = {
+	{ "SPI 8 MHz",    1125,  5,  1.0, 100, 100 },
+	{ "I2C 400 kHz",  1125, 70, 22.5, 100,  80 },
+	{ "I2C 400 kHz",  1125, 70, 22.5, 200,  40 },
+};
+
+struct result {
+	unsigned long samples;
+	unsigned long errors;
+	int           overflow;
+	double        busy_us;     /* CPU time in poll_sensor() */
+	double        elapsed_us;
+	double        async_us;    /* bus time of submitted requests */
+	double        ts_error_us; /* mean timestamp error */
+};
+
+static const struct scenario * sc;
+static struct result res;
+static double now_us;       /* CPU time */
+static double bus_free_us;  /* end of last bus transaction */
+static unsigned long fifo_out;
+static unsigned long next_sample;
+static double ready_us[SIM_MAX_SAMPLES]; /* time each packet read out lands in memory */
+static uint8_t bank;
+
+void inv_icm20948_sleep_us(int us)
+{
+	now_us += us;
+}
+
+uint64_t inv_icm20948_get_time_us(void)
+{
+	return (uint64_t)now_us;
+}
+
+static unsigned long fifo_produced(double t)
+{
+	return (unsigned long)(t * sc->rate_hz / 1e6) * PACKET_SIZE;
+}
+
+/* accel packet, sample number k spread over the high bits of x and y */
+static uint8_t fifo_byte(unsigned long i)
+{
+	const unsigned long k = i / PACKET_SIZE;
+
+	switch(i % PACKET_SIZE) {
+	case 0: return ACCEL_SET >> 8;
+	case 2: return (k >> 8) & 0x7f;
+	case 3: return k & 0xff;
+	case 4: return (k >> 23) & 0x7f;
+	case 5: return (k >> 15) & 0xff;
+	default: return 0;
+	}
+}
+
+/* returns the end time of a transaction of len bytes issued at time t */
+static double bus_xfer(uint32_t len, double t)
+{
+	if(t < bus_free_us)
+		t = bus_free_us;
+	bus_free_us = t + sc->xfer_us + len * sc->byte_us;
+
+	return bus_free_us;
+}
+
+static void reg_read(uint8_t reg, uint8_t * buf, uint32_t len, double t)
+{
+	const unsigned long avail = fifo_produced(t) - fifo_out;
+	uint32_t i;
+
+	if(avail > HARDWARE_FIFO_SIZE)
+		res.overflow = 1;
+	memset(buf, 0, len);
+	if(reg == REG_BANK_SEL) {
+		buf[0] = bank << 4;
+	} else if(bank == 0) {
+		if(reg == (REG_INT_STATUS & 0x7f)) {
+			buf[0] = BIT_DMP_INT;
+		} else if(reg == (REG_FIFO_COUNT_H & 0x7f)) {
+			buf[0] = (uint8_t)(avail >> 8);
+			if(len > 1)
+				buf[1] = (uint8_t)avail;
+		} else if(reg == (REG_FIFO_R_W & 0x7f)) {
+			for(i = 0; i < len; i++) {
+				buf[i] = fifo_byte(fifo_out++);
+				if(fifo_out % PACKET_SIZE == 0 && fifo_out / PACKET_SIZE <= SIM_MAX_SAMPLES)
+					ready_us[fifo_out / PACKET_SIZE - 1] = t;
+			}
+		}
+	}
+}
+
+static void reg_write(uint8_t reg, const uint8_t * buf)
+{
+	if(reg == REG_BANK_SEL)
+		bank = (buf[0] >> 4) & 3;
+}
+
+static int sim_read_reg(void * context, uint8_t reg, uint8_t * buf, uint32_t len)
+{
+	(void)context;
+	now_us = bus_xfer(len, now_us);
+	reg_read(reg, buf, len, now_us);
+
+	return 0;
+}
+
+static int sim_write_reg(void * context, uint8_t reg, const uint8_t * buf, uint32_t len)
+{
+	(void)context;
+	now_us = bus_xfer(len, now_us);
+	reg_write(reg, buf);
+
+	return 0;
+}
+
+/* transfers are done at once, data is stamped with the time it would land
+   and the handler waits for it, see sim_handler() */
+static int sim_submit(void * context, const struct inv_icm20948_serif_xfer * xfers,
+		uint32_t count, inv_icm20948_serif_done_t done, void * cookie)
+{
+	double t = now_us;
+	uint32_t i;
+
+	(void)context;
+	for(i = 0; i < count; i++) {
+		const double start = (t > bus_free_us) ? t : bus_free_us;
+
+		t = bus_xfer(xfers[i].len, t);
+		res.async_us += t - start;
+		if(xfers[i].write)
+			reg_write(xfers[i].reg, xfers[i].buf);
+		else
+			reg_read(xfers[i].reg, xfers[i].buf, xfers[i].len, t);
+	}
+	done(cookie, 0);
+
+	return 0;
+}
+
+static void sim_handler(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp,
+		const void * data, const void * arg)
+{
+	unsigned long k;
+	long acc[3];
+
+	(void)context, (void)sensor, (void)data, (void)arg;
+
+	inv_icm20948_dmp_get_accel(acc);
+	k = (unsigned long)(uint16_t)(acc[0] >> 15) | ((unsigned long)(uint16_t)(acc[1] >> 15) << 15);
+	if(k != next_sample || k >= SIM_MAX_SAMPLES) {
+		res.errors++;
+		return;
+	}
+	next_sample = k + 1;
+
+	if(ready_us[k] > now_us)
+		now_us = ready_us[k];
+	now_us += sc->decode_us;
+
+	res.ts_error_us += fabs((double)timestamp - (k + 1) * 1e6 / sc->rate_hz);
+	res.samples++;
+}
+
+static void simulate(int async)
+{
+	static struct inv_icm20948 icm;
+	struct inv_icm20948_serif serif;
+
+	memset(&serif, 0, sizeof(serif));
+	serif.read_reg = sim_read_reg;
+	serif.write_reg = sim_write_reg;
+	serif.submit = async ? sim_submit : 0;
+	serif.max_read = 16;
+	serif.max_write = 16;
+	serif.is_spi = 1;
+
+	inv_icm20948_reset_states(&icm, &serif);
+	inv_icm20948_transport_init(&icm);
+	icm.base_state.wake_state = CHIP_AWAKE;
+	icm.base_state.serial_interface = SERIAL_INTERFACE_SPI;
+	icm.inv_androidSensorsOn_mask[ANDROID_SENSOR_RAW_ACCELEROMETER >> 5] |=
+			1L << (ANDROID_SENSOR_RAW_ACCELEROMETER & 31);
+	icm.s_quat_chip_to_body[0] = 1L << 30;
+	icm.sensorlist[INV_ICM20948_SENSOR_RAW_ACCELEROMETER].odr_us = (uint32_t)(1e6 / sc->rate_hz);
+
+	while(now_us < SIM_DURATION_US) {
+		/* wait for the interrupt of next batch */
+		const double irq_us = (floor((double)fifo_out / PACKET_SIZE / sc->batch) + 1)
+				* sc->batch * 1e6 / sc->rate_hz;
+		double start;
+
+		if(irq_us > now_us)
+			now_us = irq_us;
+		start = now_us;
+		inv_icm20948_poll_sensor(&icm, 0, sim_handler);
+		res.busy_us += now_us - start;
+	}
+	res.elapsed_us = now_us;
+	if(res.samples)
+		res.ts_error_us /= res.samples;
+}
+
+/* driver FIFO mirror is static, run each simulation in its own process */
+static int run(const struct scenario * s, int async, struct result * out)
+{
+	int fd[2], status;
+	ssize_t len;
+	pid_t pid;
+
+	if(pipe(fd) != 0)
+		return -1;
+	pid = fork();
+	if(pid < 0)
+		return -1;
+	if(pid == 0) {
+		close(fd[0]);
+		sc = s;
+		simulate(async);
+		len = write(fd[1], &res, sizeof(res));
+		_exit(len == (ssize_t)sizeof(res) ? 0 : 1);
+	}
+	close(fd[1]);
+	len = read(fd[0], out, sizeof(*out));
+	close(fd[0]);
+	if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return -1;
+
+	return (len == (ssize_t)sizeof(*out)) ? 0 : -1;
+}
+
+int main(void)
+{
+	unsigned i;
+
+	printf("%-12s %6s %5s | %8s %8s | %10s %8s %8s\n", "bus", "decode", "batch",
+			"CPU sync", "prefetch", "async bus", "overlap", "ts error");
+	for(i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		const struct scenario * s = &scenarios[i];
+		struct result r_sync, r_async;
+
+		if(run(s, 0, &r_sync) != 0 || run(s, 1, &r_async) != 0) {
+			CHECK(!"simulation failed");
+			continue;
+		}
+
+		CHECK(r_sync.errors == 0 && r_async.errors == 0);
+		CHECK(r_sync.overflow == 0 && r_async.overflow == 0);
+		CHECK(r_sync.samples > 0 && r_async.samples == r_sync.samples);
+		CHECK(r_sync.ts_error_us < 0.5e6 / s->rate_hz && r_async.ts_error_us < 0.5e6 / s->rate_hz);
+		CHECK(r_async.busy_us <= r_sync.busy_us);
+		CHECK(r_async.async_us > 0);
+
+		printf("%-12s %4.0fus %5d | %7.1f%% %7.1f%% | %8.0fms %7.0f%% %4.0f/%.0fus\n",
+				s->name, s->decode_us, s->batch,
+				100 * r_sync.busy_us / r_sync.elapsed_us,
+				100 * r_async.busy_us / r_async.elapsed_us,
+				r_async.async_us / 1e3,
+				100 * (r_sync.busy_us - r_async.busy_us) / r_async.async_us,
+				r_sync.ts_error_us, r_async.ts_error_us);
+	}
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
@@ -0,0 +1,263 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively "Software") is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+/*
+	Host simulation of DMP firmware load time over I2C and SPI.
+
+	Build and run from the sources directory with a host compiler:
+
+		cc -O2 -I. Invn/Devices/Drivers/Icm20948/test/FirmwareLoadSim.c \
+			Invn/Devices/Drivers/Icm20948/Icm20948*.c Invn/EmbUtils/[A-Z]*.c -lm \
+			-o FirmwareLoadSim
+		./FirmwareLoadSim
+
+	The simulated serif models the DMP memory window (MEM_BANK_SEL,
+	MEM_START_ADDR and MEM_R_W registers) and counts bus time: I2C sends 9
+	bits per byte plus address, register and start/stop overhead, SPI 8
+	bits per byte plus the register byte. Sleeps requested by the driver
+	are added to the load time.
+
+	A 14301-byte image is loaded with inv_icm20948_firmware_load_ex() in
+	each verification mode, with 256-byte transfers, and with the former
+	scheme: 16-byte inv_icm20948_write_mems() calls followed by a full read
+	back with inv_icm20948_read_mems(). The program checks that simulated
+	memory holds the image after each load, that a resident image is
+	recognized by inv_icm20948_firmware_check(), and that FULL and SPOT
+	verifications report a stuck memory byte they cover. The program
+	returns 0 on success.
+*/
+
+#include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Defs.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948LoadFirmware.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Transport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+#define IMAGE_SIZE 		14301
+#define MAX_TRANSFER 	256
+
+#define LOAD_LEGACY 	(-1) 	/* 16-byte writes and full read back through the power managed accessors */
+
+struct bus {
+	const char * name;
+	double bit_ns;
+	int    spi;
+};
+
+static const struct bus buses[] = {
+	{ "I2C 400 kHz", 1e9 / 400e3, 0 },
+	{ "SPI 7 MHz",   1e9 / 7e6,   1 },
+};
+
+static const struct bus * bus;
+static uint8_t mem[0x10000];
+static uint8_t mem_bank, mem_start;
+static long stuck_addr = -1; /* memory byte that ignores writes */
+static double bus_ns, sleep_us;
+static unsigned char image[IMAGE_SIZE];
+
+void inv_icm20948_sleep_us(int us)
+{
+	sleep_us += us;
+}
+
+uint64_t inv_icm20948_get_time_us(void)
+{
+	return (uint64_t)(bus_ns / 1e3 + sleep_us);
+}
+
+static void bus_xfer(uint32_t len)
+{
+	/* I2C: start, address, register, restart or stop; SPI: register byte */
+	const double bits = bus->spi ? (1 + len) * 8 : (3 + len) * 9 + 2;
+
+	bus_ns += bits * bus->bit_ns;
+}
+
+static int sim_read_reg(void * context, uint8_t reg, uint8_t * buf, uint32_t len)
+{
+	(void)context;
+	bus_xfer(len);
+	if(reg == REG_MEM_R_W) {
+		memcpy(buf, &mem[mem_bank * 256 + mem_start], len);
+		mem_start += len;
+	} else {
+		memset(buf, 0, len);
+	}
+
+	return 0;
+}
+
+static int sim_write_reg(void * context, uint8_t reg, const uint8_t * buf, uint32_t len)
+{
+	uint32_t i;
+
+	(void)context;
+	bus_xfer(len);
+	if(reg == REG_MEM_BANK_SEL) {
+		mem_bank = buf[0];
+	} else if(reg == REG_MEM_START_ADDR) {
+		mem_start = buf[0];
+	} else if(reg == REG_MEM_R_W) {
+		for(i = 0; i < len; i++) {
+			const long addr = mem_bank * 256 + (uint8_t)(mem_start + i);
+
+			if(addr != stuck_addr)
+				mem[addr] = buf[i];
+		}
+		mem_start += len;
+	}
+
+	return 0;
+}
+
+static void sim_reset(struct inv_icm20948 * s, uint32_t max_xfer)
+{
+	struct inv_icm20948_serif serif;
+
+	memset(&serif, 0, sizeof(serif));
+	serif.read_reg = sim_read_reg;
+	serif.write_reg = sim_write_reg;
+	serif.max_read = max_xfer;
+	serif.max_write = max_xfer;
+	serif.is_spi = bus->spi;
+
+	memset(s, 0, sizeof(*s));
+	s->serif = serif;
+	inv_icm20948_transport_init(s);
+	s->base_state.lp_en_support = 1;
+	s->sAllowLpEn = 1;
+	s->base_state.wake_state = CHIP_AWAKE | CHIP_LP_ENABLE;
+
+	memset(mem, 0, sizeof(mem));
+	bus_ns = 0;
+	sleep_us = 0;
+}
+
+/* former load: 16-byte accesses, each one waking the chip and toggling LP_EN */
+static int legacy_load(struct inv_icm20948 * s, const unsigned char * data, unsigned short size, unsigned short load_addr)
+{
+	unsigned char data_cmp[INV_MAX_SERIAL_READ];
+	unsigned short addr, len;
+	int result;
+
+	for(addr = 0; addr < size; addr += len) {
+		len = min(size - addr, INV_MAX_SERIAL_WRITE);
+		if(((load_addr + addr) & 0xff) + len > 0x100)
+			len = 0x100 - ((load_addr + addr) & 0xff);
+		if((result = inv_icm20948_write_mems(s, load_addr + addr, len, &data[addr])) != 0)
+			return result;
+	}
+	for(addr = 0; addr < size; addr += len) {
+		len = min(size - addr, INV_MAX_SERIAL_READ);
+		if(((load_addr + addr) & 0xff) + len > 0x100)
+			len = 0x100 - ((load_addr + addr) & 0xff);
+		if((result = inv_icm20948_read_mems(s, load_addr + addr, len, data_cmp)) != 0)
+			return result;
+		if(memcmp(data_cmp, &data[addr], len))
+			return -1;
+	}
+
+	return 0;
+}
+
+static int load(struct inv_icm20948 * s, int mode)
+{
+	if(mode == LOAD_LEGACY) {
+		sim_reset(s, INV_MAX_SERIAL_WRITE);
+		return legacy_load(s, image, IMAGE_SIZE, DMP_LOAD_START);
+	}
+	sim_reset(s, MAX_TRANSFER);
+
+	return inv_icm20948_firmware_load_ex(s, image, IMAGE_SIZE, DMP_LOAD_START, mode);
+}
+
+static void test_boot_time(void)
+{
+	static const int modes[] = {
+		LOAD_LEGACY,
+		INV_ICM20948_FIRMWARE_VERIFY_NONE,
+		INV_ICM20948_FIRMWARE_VERIFY_SPOT,
+		INV_ICM20948_FIRMWARE_VERIFY_FULL,
+	};
+	static struct inv_icm20948 icm;
+	unsigned b, m;
+
+	printf("%-12s %12s %12s %12s %12s %12s\n", "load time", "16 B, full", "none", "spot", "full", "check");
+	for(b = 0; b < sizeof(buses) / sizeof(buses[0]); b++) {
+		bus = &buses[b];
+		printf("%-12s", bus->name);
+		for(m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+			CHECK(load(&icm, modes[m]) == 0);
+			CHECK(memcmp(&mem[DMP_LOAD_START], image, IMAGE_SIZE) == 0);
+			printf(" %9.1f ms", (bus_ns / 1e3 + sleep_us) / 1e3);
+		}
+
+		/* warm boot: image left resident by last load */
+		bus_ns = 0;
+		sleep_us = 0;
+		icm.base_state.firmware_loaded = 0;
+		CHECK(inv_icm20948_firmware_check(&icm, image, IMAGE_SIZE, DMP_LOAD_START) == 0);
+		printf(" %9.1f ms\n", (bus_ns / 1e3 + sleep_us) / 1e3);
+
+		memset(mem, 0, sizeof(mem));
+		CHECK(inv_icm20948_firmware_check(&icm, image, IMAGE_SIZE, DMP_LOAD_START) == 1);
+	}
+}
+
+static void test_stuck_byte(void)
+{
+	static struct inv_icm20948 icm;
+	/* first byte of a bank is covered by SPOT, last one only by FULL */
+	const long first = (DMP_LOAD_START + 0x1000) & ~0xff, last = first + 0xff;
+
+	bus = &buses[1];
+
+	stuck_addr = first;
+	CHECK(load(&icm, INV_ICM20948_FIRMWARE_VERIFY_NONE) == 0);
+	CHECK(load(&icm, INV_ICM20948_FIRMWARE_VERIFY_SPOT) != 0);
+	CHECK(load(&icm, INV_ICM20948_FIRMWARE_VERIFY_FULL) != 0);
+
+	stuck_addr = last;
+	CHECK(load(&icm, INV_ICM20948_FIRMWARE_VERIFY_SPOT) == 0);
+	CHECK(load(&icm, INV_ICM20948_FIRMWARE_VERIFY_FULL) != 0);
+
+	stuck_addr = -1;
+}
+
+int main(void)
+{
+	unsigned i;
+
+	for(i = 0; i < IMAGE_SIZE; i++)
+		image[i] = (unsigned char)(i * 7 + 3);
+
+	test_boot_time();
+	test_stuck_byte();
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
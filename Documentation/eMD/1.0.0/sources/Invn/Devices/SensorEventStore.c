@@ -0,0 +1,645 @@
+/*
+ * ________________________________________________________________________________________________________
+ * Copyright (c) 2015-2015 InvenSense Inc. All rights reserved.
+ *
+ * This software, related documentation and any modifications thereto (collectively “Software”) is subject
+ * to InvenSense and its licensors' intellectual property rights under U.S. and international copyright
+ * and other intellectual property rights laws.
+ *
+ * InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+ * and any use, reproduction, disclosure or distribution of the Software without an express license agreement
+ * from InvenSense is strictly prohibited.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE SOFTWARE IS
+ * PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * INVENSENSE BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, OR ANY
+ * DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ * ________________________________________________________________________________________________________
+ */
+
+#include "SensorEventStore.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define STORE_HEADER_SIZE       8   /* magic, version */
+#define STORE_VERSION           1
+#define STORE_BLOCK_HEADER_SIZE 8   /* sensor, nb_rows, nb_words, reserved */
+#define STORE_COLUMN_HEADER_SIZE 16 /* encoding, bits, reserved, size, first value */
+#define STORE_INDEX_ENTRY_SIZE  32  /* offset, sensor, nb_rows, reserved, ts_min, ts_max */
+#define STORE_FOOTER_TAIL_SIZE  32  /* ts_min, ts_max, segment start, index offset, nb_blocks, magic */
+
+/* largest block of a sensor: header then timestamp, status and data word columns stored raw */
+#define STORE_BLOCK_MAX_SIZE(nb_words) \
+	(STORE_BLOCK_HEADER_SIZE + (2 + (nb_words)) * (STORE_COLUMN_HEADER_SIZE + INV_SENSOR_EVENT_STORE_BLOCK_ROWS * 8))
+
+enum store_encoding {
+	STORE_ENCODING_RAW   = 0, /* values as is */
+	STORE_ENCODING_DELTA = 1, /* first value then zigzag deltas packed on 'bits' bits */
+};
+
+static void store_le(uint8_t * p, uint64_t value, unsigned size)
+{
+	unsigned i;
+
+	for(i = 0; i < size; i++) {
+		p[i] = (uint8_t)value;
+		value >>= 8;
+	}
+}
+
+static uint64_t store_get_le(const uint8_t * p, unsigned size)
+{
+	uint64_t value = 0;
+
+	while(size--)
+		value = (value << 8) | p[size];
+
+	return value;
+}
+
+/* Number of 32-bit words of event data used by a sensor type, as filled by devices */
+static uint8_t store_nb_words(uint32_t sensor)
+{
+	switch(INV_SENSOR_ID_TO_TYPE(sensor)) {
+	case INV_SENSOR_TYPE_ACCELEROMETER:
+	case INV_SENSOR_TYPE_MAGNETOMETER:
+	case INV_SENSOR_TYPE_GYROSCOPE:
+	case INV_SENSOR_TYPE_GRAVITY:
+	case INV_SENSOR_TYPE_LINEAR_ACCELERATION:
+	case INV_SENSOR_TYPE_UNCAL_MAGNETOMETER:
+	case INV_SENSOR_TYPE_UNCAL_GYROSCOPE:
+		return 7; /* vect, bias, accuracy_flag */
+	case INV_SENSOR_TYPE_ROTATION_VECTOR:
+	case INV_SENSOR_TYPE_GAME_ROTATION_VECTOR:
+	case INV_SENSOR_TYPE_GEOMAG_ROTATION_VECTOR:
+		return 6; /* quat, accuracy, accuracy_flag */
+	case INV_SENSOR_TYPE_ORIENTATION:
+	case INV_SENSOR_TYPE_RAW_ACCELEROMETER:
+	case INV_SENSOR_TYPE_RAW_GYROSCOPE:
+	case INV_SENSOR_TYPE_RAW_MAGNETOMETER:
+		return 4; /* x, y, z, accuracy_flag or fsr */
+	case INV_SENSOR_TYPE_STEP_COUNTER:
+		return 2; /* 64-bit count */
+	case INV_SENSOR_TYPE_SMD:
+	case INV_SENSOR_TYPE_STEP_DETECTOR:
+	case INV_SENSOR_TYPE_TILT_DETECTOR:
+	case INV_SENSOR_TYPE_PICK_UP_GESTURE:
+	case INV_SENSOR_TYPE_BAC:
+	case INV_SENSOR_TYPE_B2S:
+		return 1; /* event */
+	default:
+		return INV_SENSOR_EVENT_STORE_MAX_WORDS;
+	}
+}
+
+/*
+ * Bit packing (LSB first)
+ */
+
+struct store_bits {
+	uint8_t * p;
+	uint64_t  acc;
+	unsigned  nb;
+};
+
+static void store_bits_put(struct store_bits * b, uint64_t value, unsigned nb)
+{
+	while(nb) {
+		/* at most 7 bits are pending, so 32 more always fit in acc */
+		const unsigned k = (nb > 32) ? 32 : nb;
+
+		b->acc |= (value & (0xFFFFFFFFULL >> (32 - k))) << b->nb;
+		b->nb += k;
+		value >>= k;
+		nb -= k;
+		while(b->nb >= 8) {
+			*b->p++ = (uint8_t)b->acc;
+			b->acc >>= 8;
+			b->nb -= 8;
+		}
+	}
+}
+
+static void store_bits_flush(struct store_bits * b)
+{
+	if(b->nb)
+		*b->p++ = (uint8_t)b->acc;
+}
+
+static uint64_t store_bits_get(struct store_bits * b, unsigned nb)
+{
+	uint64_t value = 0;
+	unsigned got = 0;
+
+	while(got < nb) {
+		unsigned k;
+
+		if(b->nb == 0) {
+			b->acc = *b->p++;
+			b->nb = 8;
+		}
+		k = (nb - got < b->nb) ? nb - got : b->nb;
+		value |= (b->acc & ((1U << k) - 1)) << got;
+		b->acc >>= k;
+		b->nb -= k;
+		got += k;
+	}
+
+	return value;
+}
+
+static uint64_t store_zigzag(uint64_t value, uint64_t prev, unsigned size)
+{
+	if(size == 4) {
+		const int32_t d = (int32_t)(uint32_t)(value - prev);
+		return (uint32_t)((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+	} else {
+		const int64_t d = (int64_t)(value - prev);
+		return ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+	}
+}
+
+static uint64_t store_unzigzag(uint64_t zz, uint64_t prev, unsigned size)
+{
+	const uint64_t value = prev + ((zz >> 1) ^ (0 - (zz & 1)));
+
+	return (size == 4) ? (uint32_t)value : value;
+}
+
+static unsigned store_bit_length(uint64_t value)
+{
+	unsigned nb = 0;
+
+	while(value) {
+		value >>= 1;
+		nb++;
+	}
+
+	return nb;
+}
+
+/*
+ * Writer
+ */
+
+static int store_write(inv_sensor_event_store_writer_t * w, const void * buf, uint32_t len)
+{
+	if(w->error)
+		return w->error;
+
+	if(w->write(w->context, buf, len)) {
+		w->error = INV_ERROR_TRANSPORT;
+		return w->error;
+	}
+	w->offset += len;
+
+	return 0;
+}
+
+/* Write a column chunk of nb values of size bytes (4 or 8) */
+static int store_write_column(inv_sensor_event_store_writer_t * w,
+		const uint64_t * values, unsigned nb, unsigned size)
+{
+	uint8_t buf[STORE_COLUMN_HEADER_SIZE + INV_SENSOR_EVENT_STORE_BLOCK_ROWS * 8];
+	uint8_t * payload = &buf[STORE_COLUMN_HEADER_SIZE];
+	uint8_t encoding = STORE_ENCODING_RAW;
+	unsigned bits = 0;
+	uint32_t len = nb * size;
+	unsigned i;
+
+	if(w->compress) {
+		uint64_t all = 0;
+
+		for(i = 1; i < nb; i++)
+			all |= store_zigzag(values[i], values[i-1], size);
+		bits = store_bit_length(all);
+
+		if(((nb - 1) * bits + 7) / 8 < len) {
+			struct store_bits b = { payload, 0, 0 };
+
+			for(i = 1; i < nb; i++)
+				store_bits_put(&b, store_zigzag(values[i], values[i-1], size), bits);
+			store_bits_flush(&b);
+
+			encoding = STORE_ENCODING_DELTA;
+			len = (uint32_t)(b.p - payload);
+		}
+	}
+
+	if(encoding == STORE_ENCODING_RAW) {
+		bits = 0;
+		for(i = 0; i < nb; i++)
+			store_le(&payload[i * size], values[i], size);
+	}
+
+	buf[0] = encoding;
+	buf[1] = (uint8_t)bits;
+	store_le(&buf[2], 0, 2);
+	store_le(&buf[4], len, 4);
+	store_le(&buf[8], values[0], 8);
+
+	return store_write(w, buf, STORE_COLUMN_HEADER_SIZE + len);
+}
+
+static int store_write_footer(inv_sensor_event_store_writer_t * w)
+{
+	const uint32_t index_offset = w->offset;
+	uint8_t buf[STORE_INDEX_ENTRY_SIZE];
+	uint64_t ts_min = UINT64_MAX, ts_max = 0;
+	uint32_t i;
+	int rc;
+
+	for(i = 0; i < w->nb_blocks; i++) {
+		const inv_sensor_event_store_block_t * e = &w->index[i];
+
+		if(e->ts_min < ts_min)
+			ts_min = e->ts_min;
+		if(e->ts_max > ts_max)
+			ts_max = e->ts_max;
+
+		store_le(&buf[0], e->offset, 4);
+		store_le(&buf[4], e->sensor, 4);
+		store_le(&buf[8], e->nb_rows, 4);
+		store_le(&buf[12], 0, 4);
+		store_le(&buf[16], e->ts_min, 8);
+		store_le(&buf[24], e->ts_max, 8);
+		if((rc = store_write(w, buf, STORE_INDEX_ENTRY_SIZE)) != 0)
+			return rc;
+	}
+
+	store_le(&buf[0], ts_min, 8);
+	store_le(&buf[8], ts_max, 8);
+	store_le(&buf[16], w->segment_start, 4);
+	store_le(&buf[20], index_offset, 4);
+	store_le(&buf[24], w->nb_blocks, 4);
+	store_le(&buf[28], INV_SENSOR_EVENT_STORE_FOOTER_MAGIC, 4);
+	if((rc = store_write(w, buf, STORE_FOOTER_TAIL_SIZE)) != 0)
+		return rc;
+
+	w->segment_start = w->offset;
+	w->nb_blocks = 0;
+
+	return 0;
+}
+
+static int store_flush_slot(inv_sensor_event_store_writer_t * w, inv_sensor_event_store_slot_t * slot)
+{
+	uint64_t values[INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+	inv_sensor_event_store_block_t * e = &w->index[w->nb_blocks];
+	uint8_t hdr[STORE_BLOCK_HEADER_SIZE];
+	const unsigned nb = slot->nb_rows;
+	unsigned i, j;
+	int rc;
+
+	if(nb == 0)
+		return 0;
+
+	/* block and footer of its segment must fit in the file, offsets are 32-bit */
+	if((uint64_t)w->offset + STORE_BLOCK_MAX_SIZE(slot->nb_words)
+			+ (uint64_t)(w->nb_blocks + 1) * STORE_INDEX_ENTRY_SIZE + STORE_FOOTER_TAIL_SIZE
+			> INV_SENSOR_EVENT_STORE_MAX_FILE_SIZE) {
+		w->full = 1;
+		slot->nb_rows = 0;
+		return INV_ERROR_SIZE;
+	}
+
+	e->offset = w->offset;
+	e->sensor = slot->sensor;
+	e->nb_rows = nb;
+	e->ts_min = e->ts_max = slot->timestamp[0];
+	for(i = 1; i < nb; i++) {
+		if(slot->timestamp[i] < e->ts_min)
+			e->ts_min = slot->timestamp[i];
+		if(slot->timestamp[i] > e->ts_max)
+			e->ts_max = slot->timestamp[i];
+	}
+
+	store_le(&hdr[0], slot->sensor, 4);
+	store_le(&hdr[4], nb, 2);
+	hdr[6] = slot->nb_words;
+	hdr[7] = 0;
+	if((rc = store_write(w, hdr, sizeof(hdr))) != 0)
+		return rc;
+
+	if((rc = store_write_column(w, slot->timestamp, nb, 8)) != 0)
+		return rc;
+	for(i = 0; i < nb; i++)
+		values[i] = slot->status[i];
+	if((rc = store_write_column(w, values, nb, 4)) != 0)
+		return rc;
+	for(j = 0; j < slot->nb_words; j++) {
+		for(i = 0; i < nb; i++)
+			values[i] = slot->word[j][i];
+		if((rc = store_write_column(w, values, nb, 4)) != 0)
+			return rc;
+	}
+
+	slot->nb_rows = 0;
+	if(++w->nb_blocks == w->index_size)
+		return store_write_footer(w);
+
+	return 0;
+}
+
+int inv_sensor_event_store_writer_init(inv_sensor_event_store_writer_t * w,
+		int (*write)(void * context, const void * buf, uint32_t len), void * context,
+		inv_sensor_event_store_block_t * index, uint32_t index_size, inv_bool_t compress)
+{
+	uint8_t hdr[STORE_HEADER_SIZE];
+
+	assert(index && index_size);
+
+	memset(w, 0, sizeof(*w));
+	w->write = write;
+	w->context = context;
+	w->index = index;
+	w->index_size = index_size;
+	w->compress = compress;
+
+	store_le(&hdr[0], INV_SENSOR_EVENT_STORE_MAGIC, 4);
+	store_le(&hdr[4], STORE_VERSION, 4);
+	if(store_write(w, hdr, sizeof(hdr)))
+		return w->error;
+	w->segment_start = w->offset;
+
+	return 0;
+}
+
+int inv_sensor_event_store_writer_add(inv_sensor_event_store_writer_t * w,
+		const inv_sensor_event_t * event)
+{
+	inv_sensor_event_store_slot_t * slot = 0;
+	uint32_t words[INV_SENSOR_EVENT_STORE_MAX_WORDS];
+	unsigned i, row;
+	int rc;
+
+	if(w->error)
+		return w->error;
+	if(w->full)
+		return INV_ERROR_SIZE;
+
+	for(i = 0; i < INV_SENSOR_EVENT_STORE_MAX_SENSORS; i++) {
+		if(w->slot[i].nb_rows && w->slot[i].sensor == event->sensor) {
+			slot = &w->slot[i];
+			break;
+		}
+	}
+
+	if(!slot) {
+		/* take an empty slot, or make room by flushing the fullest one */
+		slot = &w->slot[0];
+		for(i = 1; i < INV_SENSOR_EVENT_STORE_MAX_SENSORS && slot->nb_rows; i++) {
+			if(w->slot[i].nb_rows == 0 || w->slot[i].nb_rows > slot->nb_rows)
+				slot = &w->slot[i];
+		}
+		if((rc = store_flush_slot(w, slot)) != 0)
+			return rc;
+		slot->sensor = event->sensor;
+		slot->nb_words = store_nb_words(event->sensor);
+	}
+
+	row = slot->nb_rows;
+	memcpy(words, &event->data, sizeof(words));
+	slot->timestamp[row] = event->timestamp;
+	slot->status[row] = (uint32_t)event->status;
+	for(i = 0; i < slot->nb_words; i++)
+		slot->word[i][row] = words[i];
+
+	if(++slot->nb_rows == INV_SENSOR_EVENT_STORE_BLOCK_ROWS)
+		return store_flush_slot(w, slot);
+
+	return 0;
+}
+
+int inv_sensor_event_store_writer_close(inv_sensor_event_store_writer_t * w)
+{
+	const uint32_t first_segment = STORE_HEADER_SIZE;
+	unsigned i;
+	int rc;
+
+	/* blocks that do not fit are dropped, room is always left for the footer */
+	for(i = 0; i < INV_SENSOR_EVENT_STORE_MAX_SENSORS; i++) {
+		if((rc = store_flush_slot(w, &w->slot[i])) != 0 && rc != INV_ERROR_SIZE)
+			return rc;
+	}
+
+	/* an empty file still needs a footer */
+	if(w->nb_blocks || w->segment_start == first_segment) {
+		if((rc = store_write_footer(w)) != 0)
+			return rc;
+	}
+
+	if(w->error)
+		return w->error;
+
+	return w->full ? INV_ERROR_SIZE : 0;
+}
+
+void inv_sensor_event_store_listener(const inv_sensor_event_t * event, void * context)
+{
+	inv_sensor_event_store_writer_add((inv_sensor_event_store_writer_t *)context, event);
+}
+
+/*
+ * Reader
+ */
+
+/* Locate first segment starting at or after 'start' whose events overlap [t_begin, t_end],
+ * by walking footers back from the end of file (footers only link to previous segment).
+ * Return 1 if found, 0 if there is none, INV_ERROR if file is corrupted
+ */
+static int store_find_segment(const inv_sensor_event_store_reader_t * r, uint32_t start,
+		uint64_t t_begin, uint64_t t_end, uint32_t * index_offset, uint32_t * nb_blocks)
+{
+	uint32_t end = r->len;
+	int found = 0;
+
+	while(end >= STORE_HEADER_SIZE + STORE_FOOTER_TAIL_SIZE) {
+		const uint8_t * tail = &r->data[end - STORE_FOOTER_TAIL_SIZE];
+		const uint64_t ts_min = store_get_le(&tail[0], 8);
+		const uint64_t ts_max = store_get_le(&tail[8], 8);
+		const uint32_t seg_start = (uint32_t)store_get_le(&tail[16], 4);
+		const uint32_t idx_offset = (uint32_t)store_get_le(&tail[20], 4);
+		const uint32_t nb = (uint32_t)store_get_le(&tail[24], 4);
+
+		if(store_get_le(&tail[28], 4) != INV_SENSOR_EVENT_STORE_FOOTER_MAGIC
+				|| seg_start < STORE_HEADER_SIZE || idx_offset < seg_start
+				|| idx_offset > end - STORE_FOOTER_TAIL_SIZE
+				|| (uint64_t)idx_offset + (uint64_t)nb * STORE_INDEX_ENTRY_SIZE + STORE_FOOTER_TAIL_SIZE != end)
+			return INV_ERROR;
+
+		if(seg_start < start)
+			break;
+		if(ts_max >= t_begin && ts_min <= t_end) {
+			*index_offset = idx_offset;
+			*nb_blocks = nb;
+			found = 1;
+		}
+		if(seg_start == STORE_HEADER_SIZE)
+			break;
+		end = seg_start;
+	}
+
+	return found;
+}
+
+int inv_sensor_event_store_reader_open(inv_sensor_event_store_reader_t * r,
+		const uint8_t * data, uint32_t len)
+{
+	uint32_t index_offset, nb_blocks;
+
+	r->data = data;
+	r->len = len;
+
+	if(len < STORE_HEADER_SIZE + STORE_FOOTER_TAIL_SIZE
+			|| store_get_le(&data[0], 4) != INV_SENSOR_EVENT_STORE_MAGIC
+			|| store_get_le(&data[4], 4) != STORE_VERSION)
+		return INV_ERROR;
+
+	/* check last footer only, others are checked while walking them */
+	if(store_find_segment(r, len, 0, UINT64_MAX, &index_offset, &nb_blocks) < 0)
+		return INV_ERROR;
+
+	return 0;
+}
+
+int inv_sensor_event_store_query_init(const inv_sensor_event_store_reader_t * r,
+		inv_sensor_event_store_query_t * q, int sensor, uint64_t t_begin, uint64_t t_end)
+{
+	memset(q, 0, sizeof(*q));
+	q->sensor = sensor;
+	q->t_begin = t_begin;
+	q->t_end = t_end;
+
+	if(store_find_segment(r, STORE_HEADER_SIZE, t_begin, t_end, &q->index_offset, &q->nb_blocks) < 0)
+		return INV_ERROR;
+
+	return 0;
+}
+
+int inv_sensor_event_store_query_next(const inv_sensor_event_store_reader_t * r,
+		inv_sensor_event_store_query_t * q, inv_sensor_event_store_block_t * block)
+{
+	for(;;) {
+		const uint8_t * e;
+		uint32_t next;
+		int rc;
+
+		while(q->block < q->nb_blocks) {
+			e = &r->data[q->index_offset + q->block * STORE_INDEX_ENTRY_SIZE];
+			q->block++;
+
+			block->offset  = (uint32_t)store_get_le(&e[0], 4);
+			block->sensor  = (uint32_t)store_get_le(&e[4], 4);
+			block->nb_rows = (uint32_t)store_get_le(&e[8], 4);
+			block->ts_min  = store_get_le(&e[16], 8);
+			block->ts_max  = store_get_le(&e[24], 8);
+
+			if(q->sensor != INV_SENSOR_EVENT_STORE_ALL_SENSORS && block->sensor != (uint32_t)q->sensor)
+				continue;
+			if(block->ts_max < q->t_begin || block->ts_min > q->t_end)
+				continue;
+
+			return 1;
+		}
+
+		/* no segment left (nb_blocks is 0), or look for one after current footer */
+		next = q->index_offset + q->nb_blocks * STORE_INDEX_ENTRY_SIZE + STORE_FOOTER_TAIL_SIZE;
+		if(q->nb_blocks == 0 || next >= r->len)
+			return 0;
+		rc = store_find_segment(r, next, q->t_begin, q->t_end, &q->index_offset, &q->nb_blocks);
+		if(rc <= 0) {
+			q->nb_blocks = 0;
+			return rc;
+		}
+		q->block = 0;
+	}
+}
+
+/* Decode a column chunk of nb values of size bytes, return its size or 0 if corrupted */
+static uint32_t store_read_column(const inv_sensor_event_store_reader_t * r, uint32_t offset,
+		uint64_t * values, unsigned nb, unsigned size)
+{
+	const uint8_t * hdr = &r->data[offset];
+	unsigned bits, i;
+	uint32_t len;
+
+	if(offset + STORE_COLUMN_HEADER_SIZE > r->len)
+		return 0;
+
+	bits = hdr[1];
+	len = (uint32_t)store_get_le(&hdr[4], 4);
+	if(len > r->len - offset - STORE_COLUMN_HEADER_SIZE)
+		return 0;
+
+	if(hdr[0] == STORE_ENCODING_RAW) {
+		if(len != nb * size)
+			return 0;
+		for(i = 0; i < nb; i++)
+			values[i] = store_get_le(&hdr[STORE_COLUMN_HEADER_SIZE + i * size], size);
+	} else if(hdr[0] == STORE_ENCODING_DELTA) {
+		struct store_bits b = { (uint8_t *)&hdr[STORE_COLUMN_HEADER_SIZE], 0, 0 };
+
+		if(bits > size * 8 || len != ((nb - 1) * bits + 7) / 8)
+			return 0;
+		values[0] = store_get_le(&hdr[8], 8);
+		for(i = 1; i < nb; i++)
+			values[i] = store_unzigzag(store_bits_get(&b, bits), values[i-1], size);
+	} else {
+		return 0;
+	}
+
+	return STORE_COLUMN_HEADER_SIZE + len;
+}
+
+int inv_sensor_event_store_read_block(const inv_sensor_event_store_reader_t * r,
+		const inv_sensor_event_store_block_t * block, inv_sensor_event_t * events)
+{
+	uint64_t values[INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+	const uint8_t * hdr = &r->data[block->offset];
+	uint32_t offset = block->offset + STORE_BLOCK_HEADER_SIZE;
+	unsigned nb, nb_words, i, j;
+	uint32_t sz;
+
+	if(block->offset > r->len || r->len - block->offset < STORE_BLOCK_HEADER_SIZE)
+		return INV_ERROR;
+
+	nb = (unsigned)store_get_le(&hdr[4], 2);
+	nb_words = hdr[6];
+	if(nb == 0 || nb != block->nb_rows || nb > INV_SENSOR_EVENT_STORE_BLOCK_ROWS
+			|| nb_words > INV_SENSOR_EVENT_STORE_MAX_WORDS)
+		return INV_ERROR;
+
+	memset(events, 0, nb * sizeof(*events));
+
+	if((sz = store_read_column(r, offset, values, nb, 8)) == 0)
+		return INV_ERROR;
+	offset += sz;
+	for(i = 0; i < nb; i++) {
+		events[i].sensor = (unsigned int)store_get_le(&hdr[0], 4);
+		events[i].timestamp = values[i];
+	}
+
+	if((sz = store_read_column(r, offset, values, nb, 4)) == 0)
+		return INV_ERROR;
+	offset += sz;
+	for(i = 0; i < nb; i++)
+		events[i].status = (int)(int32_t)values[i];
+
+	for(j = 0; j < nb_words; j++) {
+		if((sz = store_read_column(r, offset, values, nb, 4)) == 0)
+			return INV_ERROR;
+		offset += sz;
+		for(i = 0; i < nb; i++) {
+			const uint32_t word = (uint32_t)values[i];
+			memcpy((uint8_t *)&events[i].data + j * sizeof(word), &word, sizeof(word));
+		}
+	}
+
+	return (int)nb;
+}
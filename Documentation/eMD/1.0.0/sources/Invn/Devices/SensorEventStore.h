@@ -0,0 +1,239 @@
+/*
+ * ________________________________________________________________________________________________________
+ * Copyright (c) 2015-2015 InvenSense Inc. All rights reserved.
+ *
+ * This software, related documentation and any modifications thereto (collectively “Software”) is subject
+ * to InvenSense and its licensors' intellectual property rights under U.S. and international copyright
+ * and other intellectual property rights laws.
+ *
+ * InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+ * and any use, reproduction, disclosure or distribution of the Software without an express license agreement
+ * from InvenSense is strictly prohibited.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE SOFTWARE IS
+ * PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * INVENSENSE BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, OR ANY
+ * DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ * ________________________________________________________________________________________________________
+ */
+
+/** @defgroup SensorEventStore Sensor Event Store
+ *	@brief    Columnar file format for recorded sensor events with a time index
+ *
+ *            Events are grouped per sensor in blocks of up to
+ *            INV_SENSOR_EVENT_STORE_BLOCK_ROWS rows. A block holds one column chunk
+ *            per field: timestamp, status and each 32-bit word of the event data
+ *            used by the sensor type. Column chunks are stored raw or, if enabled,
+ *            as deltas packed on the smallest number of bits.
+ *
+ *            Blocks are followed by a footer indexing their sensor and min/max
+ *            timestamps, so that a reader only decodes blocks covering a time window.
+ *            To bound writer memory, a footer is written each time the index buffer
+ *            is full: a file is a sequence of segments, each ended by its footer.
+ *
+ *            All fields are little endian.
+ *
+ *  @ingroup  Devices
+ *	@{
+ */
+
+#ifndef _INV_SENSOR_EVENT_STORE_H_
+#define _INV_SENSOR_EVENT_STORE_H_
+
+#include "Invn/InvExport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "Invn/InvError.h"
+#include "Invn/Devices/SensorTypes.h"
+
+/** @brief Maximum number of rows in a block
+ */
+#ifndef INV_SENSOR_EVENT_STORE_BLOCK_ROWS
+#define INV_SENSOR_EVENT_STORE_BLOCK_ROWS   32
+#endif
+
+/** @brief Maximum number of sensors buffered at the same time by the writer
+ *
+ *  Default is one slot per sensor type reported by DeviceIcm20948, so that each
+ *  block is only written once full. Each slot takes about 2.5 kB: lower it to the
+ *  number of sensors actually recorded to save memory. When an event of another
+ *  sensor arrives while all slots are used, the fullest block is written out to
+ *  make room for it.
+ */
+#ifndef INV_SENSOR_EVENT_STORE_MAX_SENSORS
+#define INV_SENSOR_EVENT_STORE_MAX_SENSORS  20
+#endif
+
+/** @brief Maximum file size in bytes
+ *
+ *  File offsets are stored on 32 bits. Room for the last footer is kept, so that
+ *  a file reaching this size can still be closed and read.
+ */
+#ifndef INV_SENSOR_EVENT_STORE_MAX_FILE_SIZE
+#define INV_SENSOR_EVENT_STORE_MAX_FILE_SIZE 0xFFFFFFFFUL
+#endif
+
+/** @brief Number of 32-bit words in sensor event data
+ */
+#define INV_SENSOR_EVENT_STORE_MAX_WORDS    (INV_SENSOR_EVENT_DATA_SIZE / 4)
+
+/** @brief Magic number at file start ("ISE1")
+ */
+#define INV_SENSOR_EVENT_STORE_MAGIC        0x31455349UL
+
+/** @brief Magic number ending a segment footer ("ISX1")
+ */
+#define INV_SENSOR_EVENT_STORE_FOOTER_MAGIC 0x31585349UL
+
+/** @brief Sensor value for queries matching all sensors
+ */
+#define INV_SENSOR_EVENT_STORE_ALL_SENSORS  (-1)
+
+/** @brief Index entry describing one block
+ */
+typedef struct inv_sensor_event_store_block {
+	uint32_t offset;  /**< block offset in file */
+	uint32_t sensor;  /**< sensor id (with wake-up flag) */
+	uint32_t nb_rows; /**< number of events in the block */
+	uint64_t ts_min;  /**< lowest event timestamp in us */
+	uint64_t ts_max;  /**< highest event timestamp in us */
+} inv_sensor_event_store_block_t;
+
+/** @brief Events of one sensor buffered before being written as a block
+ */
+typedef struct inv_sensor_event_store_slot {
+	uint32_t sensor;
+	uint16_t nb_rows;
+	uint8_t  nb_words;
+	uint64_t timestamp[INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+	uint32_t status[INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+	uint32_t word[INV_SENSOR_EVENT_STORE_MAX_WORDS][INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+} inv_sensor_event_store_slot_t;
+
+/** @brief Writer states
+ */
+typedef struct inv_sensor_event_store_writer {
+	int                (*write)(void * context, const void * buf, uint32_t len); /**< append callback, returns 0 on success */
+	void *               context;        /**< passed to write */
+	inv_bool_t           compress;       /**< delta+bitpack columns when smaller */
+	int                  error;          /**< first write error, further events are dropped */
+	inv_bool_t           full;           /**< maximum file size reached, further events are dropped */
+	uint32_t             offset;         /**< bytes written so far */
+	uint32_t             segment_start;  /**< offset of current segment */
+	inv_sensor_event_store_block_t * index; /**< index of current segment */
+	uint32_t             index_size;     /**< max number of blocks per segment */
+	uint32_t             nb_blocks;      /**< blocks in current segment */
+	inv_sensor_event_store_slot_t slot[INV_SENSOR_EVENT_STORE_MAX_SENSORS];
+} inv_sensor_event_store_writer_t;
+
+/** @brief Reader states
+ */
+typedef struct inv_sensor_event_store_reader {
+	const uint8_t * data; /**< file content (eg: a memory mapped file) */
+	uint32_t        len;  /**< file size */
+} inv_sensor_event_store_reader_t;
+
+/** @brief Query states, see inv_sensor_event_store_query_next()
+ */
+typedef struct inv_sensor_event_store_query {
+	int      sensor;        /**< sensor id or INV_SENSOR_EVENT_STORE_ALL_SENSORS */
+	uint64_t t_begin;       /**< time window start in us */
+	uint64_t t_end;         /**< time window end in us (included) */
+	uint32_t index_offset;  /**< offset of current segment index */
+	uint32_t nb_blocks;     /**< number of blocks in current segment */
+	uint32_t block;         /**< next block to check in current segment */
+} inv_sensor_event_store_query_t;
+
+/** @brief Start a new file
+ *
+ *  Write file header. index is kept by the writer: a segment footer is written each
+ *  time index_size blocks were written.
+ *
+ *  @param[out] w           writer states
+ *  @param[in]  write       append callback, returns 0 on success
+ *  @param[in]  context     passed to write
+ *  @param[in]  index       buffer for block index
+ *  @param[in]  index_size  number of entries in index buffer (at least 1)
+ *  @param[in]  compress    enable delta+bitpack of columns
+ *  @return     0 on success, INV_ERROR_TRANSPORT if write failed
+ */
+int INV_EXPORT inv_sensor_event_store_writer_init(inv_sensor_event_store_writer_t * w,
+		int (*write)(void * context, const void * buf, uint32_t len), void * context,
+		inv_sensor_event_store_block_t * index, uint32_t index_size, inv_bool_t compress);
+
+/** @brief Add an event to the file
+ *  @return     0 on success, INV_ERROR_TRANSPORT if a write failed,
+ *              INV_ERROR_SIZE if the event was dropped because the file reached
+ *              INV_SENSOR_EVENT_STORE_MAX_FILE_SIZE
+ */
+int INV_EXPORT inv_sensor_event_store_writer_add(inv_sensor_event_store_writer_t * w,
+		const inv_sensor_event_t * event);
+
+/** @brief Flush buffered events and write last segment footer
+ *
+ *  Until this is called, the file misses its last footer and cannot be read.
+ *
+ *  @return     0 on success, INV_ERROR_TRANSPORT if a write failed,
+ *              INV_ERROR_SIZE if events were dropped because the file reached
+ *              INV_SENSOR_EVENT_STORE_MAX_FILE_SIZE (file is still valid)
+ */
+int INV_EXPORT inv_sensor_event_store_writer_close(inv_sensor_event_store_writer_t * w);
+
+/** @brief Sensor event listener callback feeding a writer
+ *
+ *  To be used as inv_sensor_listener_t callback with writer as context
+ *  (or to be called from an application listener callback).
+ */
+void INV_EXPORT inv_sensor_event_store_listener(const inv_sensor_event_t * event, void * context);
+
+/** @brief Open a file
+ *  @param[out] r     reader states
+ *  @param[in]  data  file content (eg: a memory mapped file), kept by reader
+ *  @param[in]  len   file size
+ *  @return     0 on success, INV_ERROR if file header or last footer is invalid
+ */
+int INV_EXPORT inv_sensor_event_store_reader_open(inv_sensor_event_store_reader_t * r,
+		const uint8_t * data, uint32_t len);
+
+/** @brief Start a query for blocks holding events of a sensor in [t_begin, t_end]
+ *  @return     0 on success, INV_ERROR if file is corrupted
+ */
+int INV_EXPORT inv_sensor_event_store_query_init(const inv_sensor_event_store_reader_t * r,
+		inv_sensor_event_store_query_t * q, int sensor, uint64_t t_begin, uint64_t t_end);
+
+/** @brief Get next block matching a query, in file order
+ *
+ *  Only the index is read: blocks outside the time window are not touched.
+ *
+ *  @return     1 if a block was found, 0 at end of file, INV_ERROR if file is corrupted
+ */
+int INV_EXPORT inv_sensor_event_store_query_next(const inv_sensor_event_store_reader_t * r,
+		inv_sensor_event_store_query_t * q, inv_sensor_event_store_block_t * block);
+
+/** @brief Decode events of a block
+ *
+ *  All events of the block are returned, including the ones outside of the query
+ *  time window. Event data words not stored for the sensor type are set to 0.
+ *
+ *  @param[out] events  buffer of at least block->nb_rows events
+ *  @return     number of events, INV_ERROR if block is corrupted
+ */
+int INV_EXPORT inv_sensor_event_store_read_block(const inv_sensor_event_store_reader_t * r,
+		const inv_sensor_event_store_block_t * block, inv_sensor_event_t * events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _INV_SENSOR_EVENT_STORE_H_ */
+
+/** @} */
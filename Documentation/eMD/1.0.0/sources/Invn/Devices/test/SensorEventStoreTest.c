@@ -0,0 +1,270 @@
+/*
+ * ________________________________________________________________________________________________________
+ * Copyright (c) 2015-2015 InvenSense Inc. All rights reserved.
+ * This software, related documentation and any modifications thereto (collectively "Software") is subject
+ * to InvenSense and its licensors' intellectual property rights under U.S. and international copyright
+ * and other intellectual property rights laws.
+ * InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+ * and any use, reproduction, disclosure or distribution of the Software without an express license agreement
+ * from InvenSense is strictly prohibited.
+ * ________________________________________________________________________________________________________
+ */
+
+/*
+	Host-side tests for SensorEventStore.
+
+	Build and run from the sources directory with a host compiler, preferably
+	with -fsanitize=address,undefined to catch out of bounds reads:
+
+		cc -O1 -g -fsanitize=address,undefined -I. Invn/Devices/test/SensorEventStoreTest.c \
+			Invn/Devices/SensorEventStore.c -o SensorEventStoreTest
+		./SensorEventStoreTest
+
+	Checks that recorded events are read back bit-identical, raw and
+	compressed, over several segments, that window queries return every
+	event of the window, and that truncated files and corrupted footers are
+	rejected instead of being read out of bounds. The program returns 0 on
+	success.
+*/
+
+#include "Invn/Devices/SensorEventStore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+#define NB_EVENTS 	20000
+#define FILE_SIZE 	(4 << 20)
+
+static inv_sensor_event_t events[NB_EVENTS];
+static uint8_t file[FILE_SIZE];
+static uint32_t file_len;
+
+static int mem_write(void * context, const void * buf, uint32_t len)
+{
+	(void)context;
+
+	if(len > FILE_SIZE - file_len)
+		return 1;
+	memcpy(&file[file_len], buf, len);
+	file_len += len;
+
+	return 0;
+}
+
+static void put_le(uint8_t * p, uint64_t v, int n)
+{
+	int i;
+
+	for(i = 0; i < n; i++, v >>= 8)
+		p[i] = (uint8_t)v;
+}
+
+/* accel and gyro at 1 kHz, GRV every 4 ms and a few step detections, interleaved as a listener sees them */
+static int make_events(void)
+{
+	uint64_t t = 1000000;
+	uint32_t seed = 1;
+	int n = 0;
+
+	while(n < NB_EVENTS - 4) {
+		inv_sensor_event_t * e;
+
+		t += 1000;
+		seed = seed * 1664525u + 1013904223u;
+
+		e = &events[n++];
+		e->sensor = INV_SENSOR_TYPE_ACCELEROMETER;
+		e->timestamp = t;
+		e->status = INV_SENSOR_STATUS_DATA_UPDATED;
+		e->data.acc.vect[0] = (float)(seed >> 20) * 1e-4f;
+		e->data.acc.vect[2] = 1.f;
+		e->data.acc.accuracy_flag = 3;
+
+		e = &events[n++];
+		e->sensor = INV_SENSOR_TYPE_GYROSCOPE;
+		e->timestamp = t + 3;
+		e->status = INV_SENSOR_STATUS_DATA_UPDATED;
+		e->data.gyr.vect[1] = (float)(seed & 0xFFF) * 1e-3f;
+		e->data.gyr.accuracy_flag = 3;
+
+		if((t / 1000) % 4 == 0) {
+			e = &events[n++];
+			e->sensor = INV_SENSOR_TYPE_GAME_ROTATION_VECTOR;
+			e->timestamp = t + 5;
+			e->status = INV_SENSOR_STATUS_DATA_UPDATED;
+			e->data.quaternion.quat[0] = 1.f;
+			e->data.quaternion.quat[3] = (float)(seed >> 24) * 1e-3f;
+		}
+		if((seed >> 8) % 500 == 0) {
+			e = &events[n++];
+			e->sensor = INV_SENSOR_TYPE_STEP_DETECTOR;
+			e->timestamp = t + 7;
+			e->status = INV_SENSOR_STATUS_DATA_UPDATED;
+			e->data.event = 1;
+		}
+	}
+
+	return n;
+}
+
+static int write_file(int nb_events, inv_bool_t compress)
+{
+	static inv_sensor_event_store_writer_t w;
+	static inv_sensor_event_store_block_t index[16]; /* several segments */
+	int i;
+
+	file_len = 0;
+	if(inv_sensor_event_store_writer_init(&w, mem_write, 0, index, 16, compress) != 0)
+		return -1;
+	for(i = 0; i < nb_events; i++)
+		inv_sensor_event_store_listener(&events[i], &w);
+
+	return inv_sensor_event_store_writer_close(&w);
+}
+
+/* all events of one sensor in [t_begin, t_end] must come back bit-identical and in order */
+static void check_query(int nb_events, int sensor, uint64_t t_begin, uint64_t t_end)
+{
+	static inv_sensor_event_t out[INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+	inv_sensor_event_store_reader_t r;
+	inv_sensor_event_store_query_t q;
+	inv_sensor_event_store_block_t b;
+	int i, k, rc, pos = 0, got = 0, want = 0, bad = 0;
+
+	for(i = 0; i < nb_events; i++)
+		want += ((int)events[i].sensor == sensor && events[i].timestamp >= t_begin && events[i].timestamp <= t_end);
+
+	CHECK(inv_sensor_event_store_reader_open(&r, file, file_len) == 0);
+	CHECK(inv_sensor_event_store_query_init(&r, &q, sensor, t_begin, t_end) == 0);
+	while((rc = inv_sensor_event_store_query_next(&r, &q, &b)) == 1) {
+		k = inv_sensor_event_store_read_block(&r, &b, out);
+		CHECK(k == (int)b.nb_rows);
+		for(i = 0; i < k; i++) {
+			if(out[i].timestamp < t_begin || out[i].timestamp > t_end)
+				continue;
+			while(pos < nb_events && ((int)events[pos].sensor != sensor || events[pos].timestamp < t_begin))
+				pos++;
+			bad += (pos >= nb_events || memcmp(&events[pos], &out[i], sizeof(out[i])) != 0);
+			pos++;
+			got++;
+		}
+	}
+	CHECK(rc == 0);
+	CHECK(got == want);
+	CHECK(bad == 0);
+}
+
+static void test_round_trip(int nb_events)
+{
+	inv_bool_t compress;
+
+	for(compress = 0; compress < 2; compress++) {
+		CHECK(write_file(nb_events, compress) == 0);
+		check_query(nb_events, INV_SENSOR_TYPE_ACCELEROMETER, 0, UINT64_MAX);
+		check_query(nb_events, INV_SENSOR_TYPE_GYROSCOPE, 0, UINT64_MAX);
+		check_query(nb_events, INV_SENSOR_TYPE_GAME_ROTATION_VECTOR, 0, UINT64_MAX);
+		check_query(nb_events, INV_SENSOR_TYPE_STEP_DETECTOR, 0, UINT64_MAX);
+		check_query(nb_events, INV_SENSOR_TYPE_GYROSCOPE, 1500000, 1550000);
+		check_query(nb_events, INV_SENSOR_TYPE_GAME_ROTATION_VECTOR, 3000000, 3000000);
+		printf("round trip compress=%d: %d events, %u bytes\n", compress, nb_events, (unsigned)file_len);
+	}
+}
+
+/* run a full query on a possibly corrupted file, it must fail or stay in bounds (checked by ASan) */
+static int read_all(const uint8_t * data, uint32_t len)
+{
+	static inv_sensor_event_t out[INV_SENSOR_EVENT_STORE_BLOCK_ROWS];
+	inv_sensor_event_store_reader_t r;
+	inv_sensor_event_store_query_t q;
+	inv_sensor_event_store_block_t b;
+	int rc;
+
+	if(inv_sensor_event_store_reader_open(&r, data, len) != 0)
+		return INV_ERROR;
+	if(inv_sensor_event_store_query_init(&r, &q, INV_SENSOR_EVENT_STORE_ALL_SENSORS, 0, UINT64_MAX) != 0)
+		return INV_ERROR;
+	while((rc = inv_sensor_event_store_query_next(&r, &q, &b)) == 1) {
+		if(b.nb_rows > INV_SENSOR_EVENT_STORE_BLOCK_ROWS)
+			return INV_ERROR;
+		if(inv_sensor_event_store_read_block(&r, &b, out) < 0)
+			return INV_ERROR;
+	}
+
+	return rc;
+}
+
+static void test_corrupted(int nb_events)
+{
+	uint8_t * copy, * tail;
+	uint32_t i, len;
+
+	CHECK(write_file(nb_events, 1) == 0);
+	len = file_len;
+	copy = malloc(len);
+	CHECK(read_all(file, len) == 0);
+
+	/* truncated files */
+	for(i = 1; i < 64; i++)
+		CHECK(read_all(file, len - i) == INV_ERROR);
+
+	/* index offset at end of file, with a block count wrapping the index size to 32 bits */
+	memcpy(copy, file, len);
+	tail = &copy[len - 32];
+	put_le(&tail[20], len, 4);
+	put_le(&tail[24], (1UL << 27) - 1, 4);
+	CHECK(read_all(copy, len) == INV_ERROR);
+
+	/* index offset past footer start */
+	memcpy(copy, file, len);
+	put_le(&tail[20], len - 16, 4);
+	put_le(&tail[24], 0, 4);
+	CHECK(read_all(copy, len) == INV_ERROR);
+
+	/* header and a lone footer only, whose index offset points past it */
+	{
+		uint8_t small[8 + 32];
+
+		put_le(&small[0], INV_SENSOR_EVENT_STORE_MAGIC, 4);
+		put_le(&small[4], 1, 4);
+		put_le(&small[8], 0, 8);
+		put_le(&small[16], UINT64_MAX, 8);
+		put_le(&small[24], 8, 4);
+		put_le(&small[28], sizeof(small), 4);
+		put_le(&small[32], (1UL << 27) - 1, 4);
+		put_le(&small[36], INV_SENSOR_EVENT_STORE_FOOTER_MAGIC, 4);
+		CHECK(read_all(small, sizeof(small)) == INV_ERROR);
+	}
+
+	/* single byte corruptions of the last footer tail and of the index before it */
+	for(i = 0; i < 32 + 4 * 32; i++) {
+		memcpy(copy, file, len);
+		copy[len - 1 - i] ^= (uint8_t)(0x5A + i);
+		read_all(copy, len);
+	}
+	printf("corrupted files: %u bytes checked\n", (unsigned)len);
+
+	free(copy);
+}
+
+int main(void)
+{
+	int nb_events = make_events();
+
+	test_round_trip(nb_events);
+	test_corrupted(nb_events);
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
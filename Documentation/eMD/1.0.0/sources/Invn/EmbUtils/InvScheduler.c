@@ -15,165 +15,253 @@
  */
 
 #include "InvScheduler.h"
+#include "InvAssert.h"
 
-static void InvScheduler_insertTask(InvScheduler * scheduler,
-		InvSchedulerTask *task)
+#include "Invn/InvError.h"
+
+/* return true if task a must be scheduled before task b:
+   earliest deadline first, then highest priority, then first inserted */
+static inline int InvScheduler_isBefore(const InvSchedulerTask *a,
+		const InvSchedulerTask *b)
 {
-	if(scheduler->queue == 0) {
-		task->prev = task;
-		task->next = 0;
-		scheduler->queue = task;
-	} else {
-		task->prev = scheduler->queue->prev;
-		task->next = 0;
-		scheduler->queue->prev->next = task;
-		scheduler->queue->prev       = task;
-	}
+	const int32_t diff = (int32_t)(a->deadline - b->deadline);
+
+	if(diff != 0)
+		return (diff < 0);
+	if(a->priority != b->priority)
+		return (a->priority > b->priority);
+	return ((int32_t)(a->seq - b->seq) < 0);
 }
 
-static inline void InvScheduler_removeTask(InvScheduler * scheduler,
+static inline void InvScheduler_heapSet(InvScheduler * scheduler, unsigned i,
 		InvSchedulerTask *task)
 {
-	if(scheduler->queue == task) {
-		scheduler->queue = task->next;
-	} else {
-		if(scheduler->queue->prev == task)
-			scheduler->queue->prev = task->prev;
-		task->prev->next = task->next;
+	scheduler->queue[i] = task;
+	task->hpos = (uint16_t)i;
+}
+
+static void InvScheduler_siftUp(InvScheduler * scheduler, unsigned i)
+{
+	InvSchedulerTask * task = scheduler->queue[i];
+
+	while(i > 0) {
+		const unsigned parent = (i - 1) / 2;
+
+		if(!InvScheduler_isBefore(task, scheduler->queue[parent]))
+			break;
+
+		InvScheduler_heapSet(scheduler, i, scheduler->queue[parent]);
+		i = parent;
 	}
-	if(task->next)
-		task->next->prev = task->prev;
+
+	InvScheduler_heapSet(scheduler, i, task);
 }
 
-static InvSchedulerTask * InvScheduler_getTaskToSchedule(InvScheduler * scheduler,
-		uint32_t now)
+static void InvScheduler_siftDown(InvScheduler * scheduler, unsigned i)
 {
-	InvSchedulerTask * cur  = scheduler->queue;
-	InvSchedulerTask * task = 0;
-	uint32_t           max_diff = 0;
-
-	while(cur) {
-		const uint32_t timeout = (cur->delay != 0) ? cur->delay : cur->period;
-		uint32_t elpased;
-
-		/* initalize task states after it was started */
-		if(cur->state == INVSCHEDULER_TASK_STATE_STARTED) {
-			cur->state    = INVSCHEDULER_TASK_STATE_READY;
-			cur->lasttime = now;
-
-			if(cur->delay == 0) {
-				cur->lasttime -= cur->period; /* ensure task is run ASAP */
-			}
-		}
+	InvSchedulerTask * task = scheduler->queue[i];
+	const unsigned count = scheduler->count;
 
-		elpased = (now - cur->lasttime);
+	for(;;) {
+		unsigned child = 2 * i + 1;
 
-		/* check timeout against elpased time */
-		if(elpased >= timeout) {
-			const uint32_t diff = (elpased - timeout);
+		if(child >= count)
+			break;
 
-			if(task == 0 || diff > max_diff ||
-					(diff == max_diff && cur->priority > task->priority)) {
-				task = cur;
-				max_diff = diff;
-			}
+		if(child + 1 < count && InvScheduler_isBefore(scheduler->queue[child + 1],
+				scheduler->queue[child])) {
+			child += 1;
 		}
 
-		cur = cur->next;
+		if(!InvScheduler_isBefore(scheduler->queue[child], task))
+			break;
+
+		InvScheduler_heapSet(scheduler, i, scheduler->queue[child]);
+		i = child;
 	}
 
-	return task;
+	InvScheduler_heapSet(scheduler, i, task);
 }
 
-int InvScheduler_getActiveTaskCountU(const InvScheduler *scheduler)
+static inline void InvScheduler_updateDeadline(InvSchedulerTask *task)
 {
-	int count = 0;
-	const InvSchedulerTask *cur;
+	const uint32_t timeout = (task->delay != 0) ? task->delay : task->period;
 
-	/* /!\ RUNNING task is not in the queue hence ignored */
-	for(cur = scheduler->queue; cur != 0; cur = cur->next)
-		++count;
+	task->deadline = task->lasttime + timeout;
+}
 
-	return count;
+static int InvScheduler_insertTask(InvScheduler * scheduler,
+		InvSchedulerTask *task)
+{
+	if(scheduler->count >= INVSCHEDULER_MAX_TASKS)
+		return INV_ERROR_MEM;
+
+	task->seq = scheduler->seq++;
+	InvScheduler_heapSet(scheduler, scheduler->count++, task);
+	InvScheduler_siftUp(scheduler, task->hpos);
+
+	return 0;
+}
+
+static void InvScheduler_removeTask(InvScheduler * scheduler,
+		InvSchedulerTask *task)
+{
+	const unsigned i = task->hpos;
+	InvSchedulerTask * last;
+
+	ASSERT(i < scheduler->count && scheduler->queue[i] == task);
+
+	last = scheduler->queue[--scheduler->count];
+
+	if(last != task) {
+		InvScheduler_heapSet(scheduler, i, last);
+		InvScheduler_siftUp(scheduler, i);
+		InvScheduler_siftDown(scheduler, last->hpos);
+	}
+}
+
+static void InvScheduler_updateTask(InvScheduler * scheduler,
+		InvSchedulerTask *task)
+{
+	InvScheduler_siftUp(scheduler, task->hpos);
+	InvScheduler_siftDown(scheduler, task->hpos);
+}
+
+static inline int InvScheduler_isQueued(const InvSchedulerTask *task)
+{
+	return (task->state == INVSCHEDULER_TASK_STATE_STARTED ||
+			task->state == INVSCHEDULER_TASK_STATE_READY);
+}
+
+int InvScheduler_getActiveTaskCountU(const InvScheduler *scheduler)
+{
+	/* /!\ RUNNING task is not in the queue hence ignored */
+	return scheduler->count;
 }
 
 uint32_t InvScheduler_getNextTimeU(const InvScheduler *scheduler)
 {
-	const uint32_t           now = scheduler->currentTime;
-	const InvSchedulerTask * cur = scheduler->queue;
-	uint32_t                 max_diff = UINT32_MAX;
-
-	for(; cur != 0; cur = cur->next ) {
-		if(cur->state == INVSCHEDULER_TASK_STATE_STARTED) {
-			return 0;
-		} else {
-			const uint32_t timeout = (cur->delay != 0) ? cur->delay : cur->period;
-			const uint32_t elpased = (now - cur->lasttime);
-
-			if(elpased >= timeout) {
-				return 0;
-			} else {
-				const uint32_t diff = timeout - elpased;
-
-				if(diff < max_diff) {
-					max_diff = diff;
-				}
-			}
-		}
+	if(scheduler->count) {
+		const int32_t diff = (int32_t)(scheduler->queue[0]->deadline -
+				scheduler->currentTime);
+
+		return (diff > 0) ? (uint32_t)diff : 0;
 	}
 
-	return max_diff;
+	return UINT32_MAX;
 }
 
 uint32_t InvScheduler_getMinPeriodU(const InvScheduler *scheduler)
 {
-	if(scheduler->queue) {
-		InvSchedulerTask *cur = scheduler->queue->next;
-		uint32_t min = scheduler->queue->period;
+	uint32_t min = UINT32_MAX;
+	unsigned i;
 
-		/* /!\ RUNNING task is not in the queue hence ignored */
-		/* /!\ delay is not taken into account */
+	/* /!\ RUNNING task is not in the queue hence ignored */
+	/* /!\ delay is not taken into account */
 
-		for(; cur != 0; cur = cur->next ) {
-			if(cur->period < min) {
-				min = cur->period;
-			}
+	for(i = 0; i < scheduler->count; ++i) {
+		if(scheduler->queue[i]->period < min) {
+			min = scheduler->queue[i]->period;
 		}
-
-		return min;
 	}
 
-	return UINT32_MAX;
+	return min;
+}
+
+uint32_t InvScheduler_idle(InvScheduler *scheduler)
+{
+	const uint32_t next_time = InvScheduler_getNextTime(scheduler);
+	uint32_t slept;
+
+	if(next_time == 0)
+		return 0;
+
+	slept = InvScheduler_onIdleHook(scheduler, next_time);
+	InvScheduler_updateTimeDelta(scheduler, slept);
+
+	return slept;
+}
+
+#ifdef INVSCHEDULER_TASK_STATS
+
+static void InvScheduler_updateTaskStats(InvSchedulerTask *task,
+		uint32_t lateness, uint32_t exec_time)
+{
+	InvSchedulerTaskStats * stats = &task->stats;
+
+	++stats->runCount;
+	stats->execTimeSum += exec_time;
+	stats->latenessSum += lateness;
+
+	if(exec_time > stats->execTimeMax)
+		stats->execTimeMax = exec_time;
+	if(lateness > stats->latenessMax)
+		stats->latenessMax = lateness;
+}
+
+void InvScheduler_resetTaskStats(InvSchedulerTask *task)
+{
+	InvScheduler_lock(task->scheduler->contextLock);
+	task->stats.runCount    = 0;
+	task->stats.execTimeMax = 0;
+	task->stats.execTimeSum = 0;
+	task->stats.latenessMax = 0;
+	task->stats.latenessSum = 0;
+	InvScheduler_unlock(task->scheduler->contextLock);
 }
 
+#endif
+
 int InvScheduler_dispatchOneTask(InvScheduler *scheduler)
 {
 	int run = 0;
 	const uint32_t now = scheduler->currentTime;
 	InvSchedulerTask * task;
+#ifdef INVSCHEDULER_TASK_STATS
+	uint32_t lateness, start;
+#endif
 
 	InvScheduler_lock(scheduler->contextLock);
 
-	task = InvScheduler_getTaskToSchedule(scheduler, now);
+	/* most late task is on top of the heap */
+	task = (scheduler->count) ? scheduler->queue[0] : 0;
 
-	if(task) {
+	if(task && (int32_t)(now - task->deadline) >= 0) {
 		/* update lastime and task state */
 		task->delay    = 0; /* clear delay */
 		task->lasttime = now;
 		task->state    = INVSCHEDULER_TASK_STATE_RUNNING;
 
+#ifdef INVSCHEDULER_TASK_STATS
+		lateness = now - task->deadline;
+#endif
+
 		InvScheduler_removeTask(scheduler, task);
 
 		InvScheduler_unlock(scheduler->contextLock);
 		InvScheduler_onTaskEnterHook(task, scheduler->currentTime);
+#ifdef INVSCHEDULER_TASK_STATS
+		start = InvScheduler_getTimeUs(scheduler);
+#endif
 		task->func(task->arg); /* execute the task */
+#ifdef INVSCHEDULER_TASK_STATS
+		start = InvScheduler_getTimeUs(scheduler) - start;
+#endif
 		InvScheduler_onTaskExitHook(task, scheduler->currentTime);
 		InvScheduler_lock(scheduler->contextLock);
 
+#ifdef INVSCHEDULER_TASK_STATS
+		InvScheduler_updateTaskStats(task, lateness, start);
+#endif
+
 		/* schedule task for next period */
 		if(task->state == INVSCHEDULER_TASK_STATE_RUNNING) {
-			task->state = INVSCHEDULER_TASK_STATE_READY;
-			InvScheduler_insertTask(scheduler, task);
+			InvScheduler_updateDeadline(task);
+			/* heap may have been filled by tasks started meanwhile */
+			if(InvScheduler_insertTask(scheduler, task) == 0)
+				task->state = INVSCHEDULER_TASK_STATE_READY;
+			else
+				task->state = INVSCHEDULER_TASK_STATE_STOP;
 		}
 
 		run = 1;
@@ -191,6 +279,12 @@ int InvScheduler_dispatchTasks(InvScheduler *scheduler)
 	while(InvScheduler_dispatchOneTask(scheduler))
 		++count;
 
+#ifdef INVSCHEDULER_TASK_STATS
+	++scheduler->wakeCount;
+	if(count == 0)
+		++scheduler->idleWakeCount;
+#endif
+
 	return count;
 }
 
@@ -206,30 +300,46 @@ void InvScheduler_initTaskDo(InvScheduler *scheduler, InvSchedulerTask *task,
 #ifdef INVSCHEDULER_TASK_NAME
 	task->name 		= "";
 #endif
+#ifdef INVSCHEDULER_TASK_STATS
+	task->stats.runCount    = 0;
+	task->stats.execTimeMax = 0;
+	task->stats.execTimeSum = 0;
+	task->stats.latenessMax = 0;
+	task->stats.latenessSum = 0;
+#endif
 }
 
-void InvScheduler_startTaskU(InvSchedulerTask *task, uint32_t delay)
+int InvScheduler_startTaskU(InvSchedulerTask *task, uint32_t delay)
 {
-	if(task->state == INVSCHEDULER_TASK_STATE_STARTED ||
-			task->state == INVSCHEDULER_TASK_STATE_READY) {
+	int rc;
+
+	if(InvScheduler_isQueued(task)) {
 		InvScheduler_removeTask(task->scheduler, task);
 	}
-	InvScheduler_insertTask(task->scheduler, task);
-	task->delay = delay;
-	task->state = INVSCHEDULER_TASK_STATE_STARTED;
+	task->delay    = delay;
+	task->lasttime = task->scheduler->currentTime;
+	task->deadline = task->lasttime + delay; /* no delay: run task ASAP */
+
+	rc = InvScheduler_insertTask(task->scheduler, task);
+	task->state = (rc == 0) ? INVSCHEDULER_TASK_STATE_STARTED : INVSCHEDULER_TASK_STATE_STOP;
+
+	return rc;
 }
 
-void InvScheduler_startTask(InvSchedulerTask *task, uint32_t delay)
+int InvScheduler_startTask(InvSchedulerTask *task, uint32_t delay)
 {
+	int rc;
+
 	InvScheduler_lock(task->scheduler->contextLock);
-	InvScheduler_startTaskU(task, delay);
+	rc = InvScheduler_startTaskU(task, delay);
 	InvScheduler_unlock(task->scheduler->contextLock);
+
+	return rc;
 }
 
 void InvScheduler_stopTaskU(InvSchedulerTask *task)
 {
-	if(task->state == INVSCHEDULER_TASK_STATE_STARTED ||
-			task->state == INVSCHEDULER_TASK_STATE_READY) {
+	if(InvScheduler_isQueued(task)) {
 		InvScheduler_removeTask(task->scheduler, task);
 	}
 	task->state = INVSCHEDULER_TASK_STATE_STOP;
@@ -242,6 +352,26 @@ void InvScheduler_stopTask(InvSchedulerTask *task)
 	InvScheduler_unlock(task->scheduler->contextLock);
 }
 
+void InvScheduler_setTaskPeriodU(InvSchedulerTask *task, uint32_t period)
+{
+	task->period = period;
+
+	/* deadline of a started task is only defined by its delay */
+	if(task->state == INVSCHEDULER_TASK_STATE_READY) {
+		InvScheduler_updateDeadline(task);
+		InvScheduler_updateTask(task->scheduler, task);
+	}
+}
+
+void InvScheduler_setTaskPrioU(InvSchedulerTask *task, uint8_t prio)
+{
+	task->priority = prio;
+
+	if(InvScheduler_isQueued(task)) {
+		InvScheduler_updateTask(task->scheduler, task);
+	}
+}
+
 /* Debugging functions ********************************************************/
 
 #ifndef NDEBUG
@@ -263,8 +393,7 @@ void InvScheduler_printTask(const InvSchedulerTask *task,
 	printf_cb("[%p:%s]\n"
 			"    prio   = %-12u state  = %s \n"
 			"    period = %-12u delay = %-12u\n"
-			"    time   = %-12lu\n"
-			"    next   = %p prev   = %p\n",
+			"    time   = %-12lu deadline = %-12lu\n",
 			(void *)task,
 #ifdef INVSCHEDULER_TASK_NAME
 			task->name,
@@ -274,17 +403,27 @@ void InvScheduler_printTask(const InvSchedulerTask *task,
 			(unsigned int)task->priority,
 			InvScheduler_taskState2Str(task->state), (unsigned int)task->period,
 			(unsigned int)task->delay, (unsigned long)task->lasttime,
-			(void *)task->next, (void *)task->prev
+			(unsigned long)task->deadline
 	);
+#ifdef INVSCHEDULER_TASK_STATS
+	printf_cb("    runs   = %-12lu exec   = %lu/%lu us (avg/max)\n"
+			"    late   = %lu/%lu (avg/max)\n",
+			(unsigned long)task->stats.runCount,
+			(unsigned long)InvScheduler_getAvgExecTime(&task->stats),
+			(unsigned long)task->stats.execTimeMax,
+			(unsigned long)InvScheduler_getAvgLateness(&task->stats),
+			(unsigned long)task->stats.latenessMax
+	);
+#endif
 }
 
-void InvScheduler_dumpTasks(const InvSchedulerTask * queue,
+void InvScheduler_dumpTasks(const InvScheduler * scheduler,
 		int (*printf_cb)(const char *format, ...))
 {
-	const InvSchedulerTask *cur = queue;
+	unsigned i;
 
-	for(; cur != 0; cur = cur->next) {
-		InvScheduler_printTask(cur, printf_cb);
+	for(i = 0; i < scheduler->count; ++i) {
+		InvScheduler_printTask(scheduler->queue[i], printf_cb);
 	}
 }
 
@@ -56,9 +56,32 @@ enum InvSchedulerTaskState {
 #define INVSCHEDULER_TASK_PRIO_NORMAL 	(UINT8_MAX/2)	/**< normal priority  */
 #define INVSCHEDULER_TASK_PRIO_MAX 		(UINT8_MAX-1)   /**< maximum priority */
 
+/** @brief Overloadable constant for the maximum number of active tasks
+ *  Tasks waiting to be scheduled are stored in a fixed size min-heap of task
+ *  references (one pointer per entry). Starting a task fails once the heap is
+ *  full. Can be raised up to 65535 (eg: several hundreds of tasks).
+ */
+#ifndef INVSCHEDULER_MAX_TASKS
+  #define INVSCHEDULER_MAX_TASKS   (64)
+#endif
+
 /* Forward declarations */
 struct InvScheduler;
 
+#ifdef INVSCHEDULER_TASK_STATS
+/** @brief 	InvSchedulerTask execution statistics
+ *  Only available if INVSCHEDULER_TASK_STATS is defined
+ */
+typedef struct InvSchedulerTaskStats {
+	uint32_t runCount;                  /**< number of time task was run */
+	uint32_t execTimeMax;               /**< max execution time in us    */
+	uint64_t execTimeSum;               /**< cumulated execution time
+	                                         in us                       */
+	uint32_t latenessMax;               /**< max lateness in tick        */
+	uint64_t latenessSum;               /**< cumulated lateness in tick  */
+} InvSchedulerTaskStats;
+#endif
+
 /** @brief 	InvSchedulerTask objct states definition
  */
 typedef struct InvSchedulerTask {
@@ -72,17 +95,31 @@ typedef struct InvSchedulerTask {
 	uint32_t lasttime;                  /**< last time task was executed */
 	uint32_t period;                    /**< task period value           */
 	uint32_t delay;                     /**< task delay value            */
+	uint32_t deadline;                  /**< time at which task is due   */
+	uint32_t seq;                       /**< insertion order, used to
+	                                         break ties in a FIFO way    */
+	uint16_t hpos;                      /**< position in scheduler heap  */
+#ifdef INVSCHEDULER_TASK_STATS
+	InvSchedulerTaskStats stats;        /**< execution statistics        */
+#endif
 	struct InvScheduler * scheduler;    /**< reference to scheduler the
 	                                         task is attach to           */
-	struct InvSchedulerTask *next;      /**< next task in list           */
-	struct InvSchedulerTask *prev;      /**< previous task in list       */
 } InvSchedulerTask;
 
 /** @brief 	InvScheduler object states definition
  */
 typedef struct InvScheduler {
 	volatile uint32_t 	currentTime;	/** current time value                    */
-	struct InvSchedulerTask *queue;	    /** list of task awaiting to be scheduled */
+	struct InvSchedulerTask *queue[INVSCHEDULER_MAX_TASKS];
+	                                    /** min-heap of task awaiting to be scheduled,
+	                                        ordered by deadline then priority */
+	uint16_t count;                     /** number of task in queue               */
+	uint32_t seq;                       /** insertion counter                     */
+#ifdef INVSCHEDULER_TASK_STATS
+	uint32_t wakeCount;                 /** number of call to dispatcher          */
+	uint32_t idleWakeCount;             /** number of call to dispatcher that
+	                                        did not run any task                  */
+#endif
 	void * contextLock;                 /** reference to some context passed to
 	                                        lock/unlock macro to protect critical section */
 } InvScheduler;
@@ -101,6 +138,19 @@ typedef struct InvScheduler {
 #define INVSCHEDULER_FROM_MS(ms) (((ms)*1000)/(INVSCHEDULER_PERIOD_US))
 #define INVSCHEDULER_FROM_US(us) ((us)/(INVSCHEDULER_PERIOD_US))
 
+#ifdef INVSCHEDULER_TASK_STATS
+/** @brief Overloadable macro returning a time in us used to measure task
+ *  execution time
+ *
+ *  Default implementation relies on scheduler time, hence is limited to tick
+ *  resolution. Define it to some free running timer to get accurate values.
+ */
+#ifndef InvScheduler_getTimeUs
+  #define InvScheduler_getTimeUs(scheduler) \
+		INVSCHEDULER_TO_US((scheduler)->currentTime)
+#endif
+#endif
+
 
 /* Overloadable locks **********************************************************/
 
@@ -133,8 +183,13 @@ typedef struct InvScheduler {
 static inline void InvScheduler_init(InvScheduler *scheduler)
 {
 	scheduler->currentTime  = 0;
-	scheduler->queue        = 0;
+	scheduler->count        = 0;
+	scheduler->seq          = 0;
 	scheduler->contextLock  = 0;
+#ifdef INVSCHEDULER_TASK_STATS
+	scheduler->wakeCount     = 0;
+	scheduler->idleWakeCount = 0;
+#endif
 }
 
 /** @brief Set context reference for crtitical section
@@ -204,6 +259,24 @@ static inline uint32_t InvScheduler_getNextTime(const InvScheduler *scheduler)
 	return next_time;
 }
 
+/** @brief Let the system sleep until next task deadline
+ *
+ *  Compute the exact number of tick until the next task is due and pass it
+ *  to InvScheduler_onIdleHook(), allowing the system to program a one-shot
+ *  wake-up timer and sleep instead of waking up on each tick.
+ *  Number of tick returned by the hook is added to current time.
+ *  Nothing is done if a task is already due.
+ *
+ *  @warning Should not be called from within a task.
+ *           A task started from an interrupt after the deadline was computed
+ *           is not taken into account: the hook implementation must return
+ *           early on any interrupt.
+ *
+ *  @param[in] scheduler    handle to scheduler
+ *  @return number of tick slept
+ */
+uint32_t InvScheduler_idle(InvScheduler *scheduler);
+
 /** @brief Get the minimum period in tick of all active tasks
  *
  *  This function can be useful to update the call rate of
@@ -298,12 +371,14 @@ static inline void InvScheduler_initTask(InvScheduler *scheduler,
 /** @brief Start a task after a delay
  *  @param[in] task     task to start
  *  @param[in] delay    delay in tick before executing the task
+ *  @return    0 on success, INV_ERROR_MEM if INVSCHEDULER_MAX_TASKS tasks are
+ *             already active (task is then left stopped)
  */
-void InvScheduler_startTaskU(InvSchedulerTask *task, uint32_t delay);
+int InvScheduler_startTaskU(InvSchedulerTask *task, uint32_t delay);
 
 /** @brief Identical to InvScheduler_startTaskU() but with locks
  */
-void InvScheduler_startTask(InvSchedulerTask *task, uint32_t delay);
+int InvScheduler_startTask(InvSchedulerTask *task, uint32_t delay);
 
 /** @brief 	Stop a task
  *  @param[in] task    handle to task
@@ -317,21 +392,64 @@ void InvScheduler_stopTask(InvSchedulerTask *task);
 /** @brief Change period of a task
  *  @param[in] task    handle to task
  */
-static inline void InvScheduler_setTaskPeriodU(InvSchedulerTask *task,
-		uint32_t period)
+void InvScheduler_setTaskPeriodU(InvSchedulerTask *task, uint32_t period);
+
+/** @brief Change priority of a task
+ *  @param[in] task    handle to task
+ */
+void InvScheduler_setTaskPrioU(InvSchedulerTask *task, uint8_t prio);
+
+#ifdef INVSCHEDULER_TASK_STATS
+
+/** @brief Get execution statistics of a task
+ *  @param[in]  task    handle to task
+ *  @param[out] stats   copy of task statistics
+ */
+static inline void InvScheduler_getTaskStats(const InvSchedulerTask *task,
+		InvSchedulerTaskStats *stats)
 {
-	task->period = period;
+	InvScheduler_lock(task->scheduler->contextLock);
+	*stats = task->stats;
+	InvScheduler_unlock(task->scheduler->contextLock);
 }
 
-/** @brief Change priority of a task
+/** @brief Reset execution statistics of a task
  *  @param[in] task    handle to task
  */
-static inline void InvScheduler_setTaskPrioU(InvSchedulerTask *task,
-		uint8_t prio)
+void InvScheduler_resetTaskStats(InvSchedulerTask *task);
+
+/** @brief Return average execution time in us from task statistics
+ */
+static inline uint32_t InvScheduler_getAvgExecTime(
+		const InvSchedulerTaskStats *stats)
+{
+	return (stats->runCount) ? (uint32_t)(stats->execTimeSum / stats->runCount) : 0;
+}
+
+/** @brief Return average lateness in tick from task statistics
+ */
+static inline uint32_t InvScheduler_getAvgLateness(
+		const InvSchedulerTaskStats *stats)
 {
-	task->priority = prio;
+	return (stats->runCount) ? (uint32_t)(stats->latenessSum / stats->runCount) : 0;
 }
 
+/** @brief Return number of call to the dispatcher
+ *  @param[in]  scheduler        handle to scheduler
+ *  @param[out] idleWakeCount    number of call that did not run any task
+ *                               (may be null)
+ */
+static inline uint32_t InvScheduler_getWakeCount(const InvScheduler *scheduler,
+		uint32_t *idleWakeCount)
+{
+	if(idleWakeCount)
+		*idleWakeCount = scheduler->idleWakeCount;
+
+	return scheduler->wakeCount;
+}
+
+#endif
+
 /* Optionnal hooks called before/after exectuting a task **********************/
 
 #ifndef   InvScheduler_onTaskEnterHook
@@ -356,6 +474,20 @@ extern void InvScheduler_onTaskExitHook(const InvSchedulerTask *task,
 		uint32_t time);
 #endif
 
+#ifndef   InvScheduler_onIdleHook
+  #define InvScheduler_onIdleHook(scheduler, ticks) ((void)(ticks), 0u)
+#else
+/** @brief Hook called by InvScheduler_idle() to let the system sleep
+ *  @param[in] scheduler handle to scheduler
+ *  @param[in] ticks     number of tick until next task is due
+ *                       (UINT32_MAX if there is no task)
+ *  @return number of tick actually slept
+ *          (0 if scheduler time is still updated by a periodic tick)
+ */
+extern uint32_t InvScheduler_onIdleHook(InvScheduler *scheduler,
+		uint32_t ticks);
+#endif
+
 /* Debugging functions ********************************************************/
 
 #ifndef NDEBUG
@@ -367,7 +499,7 @@ void InvScheduler_printTask(const InvSchedulerTask *task,
 
 /** @brief Dumps all tasks from a scheduler to string
  */
-void InvScheduler_dumpTasks(const InvSchedulerTask *queue,
+void InvScheduler_dumpTasks(const InvScheduler *scheduler,
 		int (*printf_cb)(const char *format, ...));
 
 #endif
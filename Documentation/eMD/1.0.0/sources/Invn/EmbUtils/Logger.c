@@ -14,6 +14,7 @@
 #include "InvFormat.h"
 #include "InvAssert.h"
 #include "RingByteBuffer.h"
+#include "MessageTrace.h"
 
 static uint8_t            sLoggerLevel    = LOG_LEVEL;
 static volatile uint8_t * sLoggerLevelRef = &sLoggerLevel;
@@ -81,3 +82,19 @@ void Logger_logf(const char *label, unsigned level, const char *msg, ...)
 	}
 }
 
+
+void Logger_tracef(const char *label, unsigned level, const char *msg, ...)
+{
+	if(level && level <= *sLoggerLevelRef) {
+		static const int8_t msg_level[LOG_LEVEL_MAX] = {
+			INV_MSG_LEVEL_OFF,     INV_MSG_LEVEL_ERROR, INV_MSG_LEVEL_ERROR,
+			INV_MSG_LEVEL_WARNING, INV_MSG_LEVEL_INFO,  INV_MSG_LEVEL_INFO,
+			INV_MSG_LEVEL_VERBOSE, INV_MSG_LEVEL_DEBUG, INV_MSG_LEVEL_DEBUG
+		};
+		va_list ap;
+
+		va_start(ap, msg);
+		inv_msg_vtrace(label, (level < LOG_LEVEL_MAX) ? msg_level[level] : INV_MSG_LEVEL_DEBUG, msg, ap);
+		va_end(ap);
+	}
+}
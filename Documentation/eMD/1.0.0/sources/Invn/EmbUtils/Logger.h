@@ -16,6 +16,8 @@
 	This file provides LOG macros to add trace to a programm. Trace can be disable by either module or level, depending on define.
 	Caller is responsible for providing hooks to formating and writing function.
 	This Logger provides optional capability to store log message in a ring buffer.
+	Define LOGGER_TRACE to record log message in binary form (see MessageTrace)
+	instead of formatting them in the caller context.
 
 	@ingroup EmbUtils
     @{
@@ -78,6 +80,15 @@ void Logger_log(const char *label, unsigned level, const char *msg, unsigned len
 */
 void Logger_logf(const char *label, unsigned level, const char *msg, ...);
 
+/** @brief	Record a formated message in the binary trace buffer without formatting it
+	Level is converted to the closest INV_MSG level.
+	@param[in]	label 		label of the message (must remain valid until trace is consumed)
+	@param[in]	level 		level of the message
+	@param[in]	msg 		format string of the message (must remain valid until trace is consumed)
+	@return 	none
+*/
+void Logger_tracef(const char *label, unsigned level, const char *msg, ...);
+
 /** @brief	Overloadable hook to vprintf method
 */
 #if !defined(LOGGER_VPRINTFHOOK)
@@ -114,6 +125,12 @@ extern int LOGGER_PUTCHARHOOK(int c);
 #define LOG_LABEL_DISABLE_CMP(label) (0)
 #endif
 
+#if defined(LOGGER_TRACE)
+#define LOGGER_LOGF Logger_tracef
+#else
+#define LOGGER_LOGF Logger_logf
+#endif
+
 #if LOG_LEVEL != LOG_LEVEL_DISABLE
 
 /** @brief	Helper macro to log a formated message
@@ -121,7 +138,7 @@ extern int LOGGER_PUTCHARHOOK(int c);
 #define LOG(label, level, msg, ...)	\
 		do { \
 			if(level != LOG_LEVEL_DISABLE && level <= LOG_LEVEL && LOG_LABEL_ENABLE_CMP(label) && !LOG_LABEL_DISABLE_CMP(label)) { \
-				Logger_logf(label, level, msg, ##__VA_ARGS__); \
+				LOGGER_LOGF(label, level, msg, ##__VA_ARGS__); \
 			} \
 		} while(0)
 
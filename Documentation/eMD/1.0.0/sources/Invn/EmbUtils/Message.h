@@ -33,6 +33,10 @@
  *            Under orther environmment, message are disabled by default. 
  *            Use INV_MSG_ENABLE to disable them.
  *
+ *            Use INV_MSG_TRACE define to record messages in binary form
+ *            instead of formatting them in the caller context
+ *            (see @ref MessageTrace).
+ *
  *  @ingroup  EmbUtils
  *  @{
  */
@@ -97,6 +101,12 @@ extern "C" {
 	#define _INV_MSG_SETUP(level, printer) (void)0
 	#define _INV_MSG_SETUP_LEVEL(level)    (void)0
 	#define _INV_MSG_LEVEL                 INV_MSG_LEVEL_OFF
+#elif defined(INV_MSG_TRACE)
+	#define _INV_MSG(level, ...)           inv_msg_trace(level, __VA_ARGS__)
+ 	#define _INV_MSG_SETUP(level, printer) inv_msg_setup(level, printer)
+ 	#define _INV_MSG_SETUP_LEVEL(level)    inv_msg_setup(level, inv_msg_printer_default)
+	#define _INV_MSG_SETUP_DEFAULT()       inv_msg_setup_default()
+	#define _INV_MSG_LEVEL                 inv_msg_get_level()
 #else
 	#define _INV_MSG(level, ...)           inv_msg(level, __VA_ARGS__)
  	#define _INV_MSG_SETUP(level, printer) inv_msg_setup(level, printer)
@@ -175,6 +185,10 @@ void INV_EXPORT inv_msg(int level, const char * str, ...);
 }
 #endif
 
+#if defined(INV_MSG_TRACE) && !defined(INV_MSG_DISABLE)
+	#include "Invn/EmbUtils/MessageTrace.h"
+#endif
+
 #endif /* INV_MESSAGE_H_ */
 
 /** @} */
@@ -0,0 +1,623 @@
+/*
+ * ________________________________________________________________________________________________________
+ * Copyright (c) 2015-2015 InvenSense Inc. All rights reserved.
+ *
+ * This software, related documentation and any modifications thereto (collectively “Software”) is subject
+ * to InvenSense and its licensors' intellectual property rights under U.S. and international copyright
+ * and other intellectual property rights laws.
+ *
+ * InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+ * and any use, reproduction, disclosure or distribution of the Software without an express license agreement
+ * from InvenSense is strictly prohibited.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE SOFTWARE IS
+ * PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * INVENSENSE BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, OR ANY
+ * DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ * ________________________________________________________________________________________________________
+ */
+
+#include "MessageTrace.h"
+#include "RingBuffer.h"
+
+#include "Invn/InvError.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if (INV_MSG_TRACE_BUFFER_SIZE & (INV_MSG_TRACE_BUFFER_SIZE - 1)) != 0
+	#error "INV_MSG_TRACE_BUFFER_SIZE must be a power of 2"
+#endif
+
+/* kind of argument expected by a conversion specifier */
+enum trace_arg {
+	TRACE_ARG_NONE = 0, /* literal '%' */
+	TRACE_ARG_INT,      /* int, long, size_t, char: 1 word */
+	TRACE_ARG_LLONG,    /* long long: 2 words */
+	TRACE_ARG_DOUBLE,   /* double: 2 words */
+	TRACE_ARG_PTR,      /* void *: 1 word */
+	TRACE_ARG_STR,      /* const char *: recorded by reference */
+	TRACE_ARG_INVALID
+};
+
+typedef struct trace_record {
+	uint32_t     timestamp;
+	const char * fmt;
+	const char * label;
+	int8_t       level;
+	uint8_t      nwords;
+	uint8_t      nstrs;
+	uint32_t     words[INV_MSG_TRACE_MAX_WORDS];
+	const char * strs[INV_MSG_TRACE_MAX_STRS];
+} trace_record_t;
+
+static volatile RINGBUFFER(sTraceBuffer, INV_MSG_TRACE_BUFFER_SIZE, trace_record_t);
+static volatile unsigned long sTraceDropped;
+static inv_msg_trace_time_t   sTraceGetTime;
+
+/* format strings already sent by inv_msg_trace_serialize() */
+static const char * sTraceAnnounced[INV_MSG_TRACE_MAX_IDS];
+static unsigned     sTraceAnnouncedCnt;
+
+/*
+ * Parse one conversion specification (fmt points after the '%').
+ * Flags, width and precision are copied to spec (if not NULL), length modifiers are
+ * dropped (or replaced by 'll' for 64-bit integers) as arguments are stored in a
+ * normalized form. nlong is set to the number of 'l' (or 'z') modifiers.
+ * Return pointer past the conversion.
+ */
+static const char * parse_conversion(const char * fmt, char * spec, unsigned spec_size,
+		enum trace_arg * arg, unsigned * nlong)
+{
+	unsigned i = 0;
+
+	*nlong = 0;
+
+	if(spec)
+		spec[i++] = '%';
+
+	for(;; ++fmt) {
+		switch(*fmt) {
+		case '-': case '+': case ' ': case '#': case '.':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			if(spec && i < spec_size - 4)
+				spec[i++] = *fmt;
+			continue;
+		case 'l': case 'z':
+			++(*nlong);
+			continue;
+		case 'h': case 'j': case 't':
+			continue;
+		default:
+			break;
+		}
+		break;
+	}
+
+	switch(*fmt) {
+	case '%':
+		*arg = TRACE_ARG_NONE;
+		break;
+	case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+		if(*nlong >= 2) {
+			*arg = TRACE_ARG_LLONG;
+			if(spec) {
+				spec[i++] = 'l';
+				spec[i++] = 'l';
+			}
+		} else {
+			*arg = TRACE_ARG_INT;
+		}
+		break;
+	case 'c':
+		*arg = TRACE_ARG_INT;
+		break;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+		*arg = TRACE_ARG_DOUBLE;
+		break;
+	case 'p':
+		*arg = TRACE_ARG_PTR;
+		break;
+	case 's':
+		*arg = TRACE_ARG_STR;
+		break;
+	default:
+		*arg = TRACE_ARG_INVALID;
+		return fmt;
+	}
+
+	if(spec) {
+		spec[i++] = *fmt;
+		spec[i] = '\0';
+	}
+
+	return fmt + 1;
+}
+
+/*
+ * Format a message from its format string and normalized arguments.
+ * Return length of the formatted string.
+ */
+static unsigned format_message(char * out, unsigned size, const char * fmt,
+		const uint32_t * words, unsigned nwords, const char * const * strs, unsigned nstrs)
+{
+	unsigned idx = 0, iword = 0, istr = 0;
+	char spec[16];
+
+	if(size == 0)
+		return 0;
+
+	while(*fmt != '\0' && idx < size - 1) {
+		enum trace_arg arg;
+		unsigned nlong;
+		int n = 0;
+
+		if(*fmt != '%') {
+			out[idx++] = *fmt++;
+			continue;
+		}
+
+		fmt = parse_conversion(fmt + 1, spec, sizeof(spec), &arg, &nlong);
+
+		switch(arg) {
+		case TRACE_ARG_NONE:
+			out[idx++] = '%';
+			break;
+		case TRACE_ARG_INT:
+			if(iword + 1 > nwords)
+				goto truncated;
+			if(strchr("di", spec[strlen(spec) - 1]))
+				n = snprintf(&out[idx], size - idx, spec, (int)(int32_t)words[iword]);
+			else
+				n = snprintf(&out[idx], size - idx, spec, (unsigned)words[iword]);
+			iword += 1;
+			break;
+		case TRACE_ARG_LLONG:
+		{
+			uint64_t v;
+			if(iword + 2 > nwords)
+				goto truncated;
+			v = ((uint64_t)words[iword + 1] << 32) | words[iword];
+			if(strchr("di", spec[strlen(spec) - 1]))
+				n = snprintf(&out[idx], size - idx, spec, (long long)v);
+			else
+				n = snprintf(&out[idx], size - idx, spec, (unsigned long long)v);
+			iword += 2;
+			break;
+		}
+		case TRACE_ARG_DOUBLE:
+		{
+			double d;
+			if(iword + 2 > nwords)
+				goto truncated;
+			memcpy(&d, &words[iword], sizeof(d));
+			n = snprintf(&out[idx], size - idx, spec, d);
+			iword += 2;
+			break;
+		}
+		case TRACE_ARG_PTR:
+			if(iword + 1 > nwords)
+				goto truncated;
+			n = snprintf(&out[idx], size - idx, "0x%08lx", (unsigned long)words[iword]);
+			iword += 1;
+			break;
+		case TRACE_ARG_STR:
+			if(istr + 1 > nstrs)
+				goto truncated;
+			n = snprintf(&out[idx], size - idx, spec, strs[istr] ? strs[istr] : "(null)");
+			istr += 1;
+			break;
+		default:
+			goto truncated;
+		}
+
+		if(n > 0)
+			idx += n;
+		if(idx > size - 1)
+			idx = size - 1;
+	}
+
+	out[idx] = '\0';
+	return idx;
+
+truncated:
+	if(idx + 3 < size) {
+		out[idx++] = '.';
+		out[idx++] = '.';
+		out[idx++] = '.';
+	}
+	out[idx] = '\0';
+	return idx;
+}
+
+void inv_msg_trace_setup(inv_msg_trace_time_t get_time_us)
+{
+	sTraceGetTime = get_time_us;
+}
+
+void inv_msg_vtrace(const char * label, int level, const char * str, va_list ap)
+{
+	volatile trace_record_t * rec;
+	const char * fmt = str;
+	unsigned nwords = 0, nstrs = 0;
+
+	if(RINGBUFFER_FULL(&sTraceBuffer)) {
+		++sTraceDropped;
+		return;
+	}
+
+	RINGBUFFER_GETREFNEXT(&sTraceBuffer, rec);
+
+	rec->timestamp = (sTraceGetTime) ? (uint32_t)sTraceGetTime() : 0;
+	rec->fmt       = str;
+	rec->label     = label;
+	rec->level     = (int8_t)level;
+
+	/* capture raw arguments, without any formatting */
+	while(fmt && (fmt = strchr(fmt, '%')) != NULL) {
+		enum trace_arg arg;
+		unsigned nlong;
+
+		fmt = parse_conversion(fmt + 1, 0, 0, &arg, &nlong);
+
+		if(arg == TRACE_ARG_INT && nwords < INV_MSG_TRACE_MAX_WORDS) {
+			/* 'l' and 'z' modifiers are 32-bit wide on target */
+			if(nlong)
+				rec->words[nwords++] = (uint32_t)va_arg(ap, unsigned long);
+			else
+				rec->words[nwords++] = (uint32_t)va_arg(ap, unsigned);
+		} else if(arg == TRACE_ARG_LLONG && nwords + 2 <= INV_MSG_TRACE_MAX_WORDS) {
+			const uint64_t v = (uint64_t)va_arg(ap, unsigned long long);
+			rec->words[nwords++] = (uint32_t)v;
+			rec->words[nwords++] = (uint32_t)(v >> 32);
+		} else if(arg == TRACE_ARG_DOUBLE && nwords + 2 <= INV_MSG_TRACE_MAX_WORDS) {
+			const double d = va_arg(ap, double);
+			uint32_t w[2];
+			memcpy(w, &d, sizeof(w));
+			rec->words[nwords++] = w[0];
+			rec->words[nwords++] = w[1];
+		} else if(arg == TRACE_ARG_PTR && nwords < INV_MSG_TRACE_MAX_WORDS) {
+			rec->words[nwords++] = (uint32_t)(uintptr_t)va_arg(ap, void *);
+		} else if(arg == TRACE_ARG_STR && nstrs < INV_MSG_TRACE_MAX_STRS) {
+			rec->strs[nstrs++] = va_arg(ap, const char *);
+		} else if(arg != TRACE_ARG_NONE) {
+			/* no more room or unsupported conversion: message will be truncated */
+			break;
+		}
+	}
+
+	rec->nwords = (uint8_t)nwords;
+	rec->nstrs  = (uint8_t)nstrs;
+
+	/* record is complete, make it visible to the consumer */
+	RINGBUFFER_INCREMENT(&sTraceBuffer, rec);
+}
+
+void inv_msg_trace(int level, const char * str, ...)
+{
+	if(level && level <= inv_msg_get_level()) {
+		va_list ap;
+		va_start(ap, str);
+		inv_msg_vtrace(0, level, str, ap);
+		va_end(ap);
+	}
+}
+
+unsigned inv_msg_trace_pending(void)
+{
+	return RINGBUFFER_SIZE(&sTraceBuffer);
+}
+
+unsigned long inv_msg_trace_dropped(void)
+{
+	const unsigned long dropped = sTraceDropped;
+
+	sTraceDropped -= dropped;
+
+	return dropped;
+}
+
+static void read_front(trace_record_t * rec)
+{
+	volatile trace_record_t * front;
+	unsigned i;
+
+	RINGBUFFER_FRONT(&sTraceBuffer, front);
+
+	rec->timestamp = front->timestamp;
+	rec->fmt       = front->fmt;
+	rec->label     = front->label;
+	rec->level     = front->level;
+	rec->nwords    = front->nwords;
+	rec->nstrs     = front->nstrs;
+	for(i = 0; i < rec->nwords; ++i)
+		rec->words[i] = front->words[i];
+	for(i = 0; i < rec->nstrs; ++i)
+		rec->strs[i] = front->strs[i];
+}
+
+static void call_printer(inv_msg_printer_t printer, int level, const char * str, ...)
+{
+	va_list ap;
+
+	va_start(ap, str);
+	printer(level, str, ap);
+	va_end(ap);
+}
+
+int inv_msg_trace_flush(inv_msg_printer_t printer, unsigned max)
+{
+	static char out_str[INV_MSG_TRACE_MAX_STRLEN]; /* static to limit stack usage */
+	int count = 0;
+
+	while(!RINGBUFFER_EMPTY(&sTraceBuffer) && (max == 0 || (unsigned)count < max)) {
+		trace_record_t rec;
+
+		read_front(&rec);
+		format_message(out_str, sizeof(out_str), rec.fmt, rec.words, rec.nwords,
+				rec.strs, rec.nstrs);
+
+		if(printer) {
+			if(rec.label)
+				call_printer(printer, rec.level, "[%lu] %s: %s", (unsigned long)rec.timestamp,
+						rec.label, out_str);
+			else
+				call_printer(printer, rec.level, "[%lu] %s", (unsigned long)rec.timestamp, out_str);
+		}
+
+		RINGBUFFER_POPNLOSE(&sTraceBuffer);
+		++count;
+	}
+
+	return count;
+}
+
+static void put_u32(uint8_t * buf, uint32_t v)
+{
+	buf[0] = (uint8_t)(v);
+	buf[1] = (uint8_t)(v >> 8);
+	buf[2] = (uint8_t)(v >> 16);
+	buf[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_u32(const uint8_t * buf)
+{
+	return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static unsigned str_len8(const char * str)
+{
+	const size_t len = (str) ? strlen(str) : 0;
+
+	return (len > 255) ? 255 : (unsigned)len;
+}
+
+static int is_announced(const char * str)
+{
+	unsigned i;
+
+	for(i = 0; i < sTraceAnnouncedCnt; ++i) {
+		if(sTraceAnnounced[i] == str)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void set_announced(const char * str)
+{
+	if(sTraceAnnouncedCnt < INV_MSG_TRACE_MAX_IDS)
+		sTraceAnnounced[sTraceAnnouncedCnt++] = str;
+}
+
+static unsigned write_string_def(uint8_t * buf, const char * str)
+{
+	const unsigned len = str_len8(str);
+
+	buf[0] = INV_MSG_TRACE_TAG_STRING;
+	put_u32(&buf[1], (uint32_t)(uintptr_t)str);
+	buf[5] = (uint8_t)len;
+	memcpy(&buf[6], str, len);
+	set_announced(str);
+
+	return 6 + len;
+}
+
+int inv_msg_trace_serialize(uint8_t * buf, unsigned size)
+{
+	unsigned idx = 0;
+	const unsigned long dropped = sTraceDropped;
+
+	if(dropped && size >= 5) {
+		buf[idx++] = INV_MSG_TRACE_TAG_DROPPED;
+		put_u32(&buf[idx], (uint32_t)dropped);
+		idx += 4;
+		sTraceDropped -= dropped;
+	}
+
+	while(!RINGBUFFER_EMPTY(&sTraceBuffer)) {
+		trace_record_t rec;
+		const int fmt_def = 0, label_def = 1;
+		int need_def[2], reset;
+		unsigned needed, i;
+
+		read_front(&rec);
+
+		/* compute room needed for the whole record before writing anything */
+		need_def[fmt_def]   = !is_announced(rec.fmt);
+		need_def[label_def] = (rec.label && !is_announced(rec.label) && rec.label != rec.fmt);
+		/* no room left to remember new strings: forget everything, decoder will do the same */
+		reset = (sTraceAnnouncedCnt + need_def[fmt_def] + need_def[label_def] > INV_MSG_TRACE_MAX_IDS);
+		if(reset) {
+			need_def[fmt_def]   = 1;
+			need_def[label_def] = (rec.label && rec.label != rec.fmt);
+		}
+		needed = 16 + 4 * rec.nwords + reset;
+		if(need_def[fmt_def])
+			needed += 6 + str_len8(rec.fmt);
+		if(need_def[label_def])
+			needed += 6 + str_len8(rec.label);
+		for(i = 0; i < rec.nstrs; ++i)
+			needed += 1 + str_len8(rec.strs[i]);
+
+		if(idx + needed > size)
+			break;
+
+		if(reset) {
+			buf[idx++] = INV_MSG_TRACE_TAG_RESET;
+			sTraceAnnouncedCnt = 0;
+		}
+		if(need_def[fmt_def])
+			idx += write_string_def(&buf[idx], rec.fmt);
+		if(need_def[label_def])
+			idx += write_string_def(&buf[idx], rec.label);
+
+		buf[idx++] = INV_MSG_TRACE_TAG_RECORD;
+		put_u32(&buf[idx], rec.timestamp);
+		idx += 4;
+		buf[idx++] = (uint8_t)rec.level;
+		put_u32(&buf[idx], (uint32_t)(uintptr_t)rec.fmt);
+		idx += 4;
+		put_u32(&buf[idx], (uint32_t)(uintptr_t)rec.label);
+		idx += 4;
+		buf[idx++] = rec.nwords;
+		buf[idx++] = rec.nstrs;
+		for(i = 0; i < rec.nwords; ++i) {
+			put_u32(&buf[idx], rec.words[i]);
+			idx += 4;
+		}
+		for(i = 0; i < rec.nstrs; ++i) {
+			const unsigned len = str_len8(rec.strs[i]);
+			buf[idx++] = (uint8_t)len;
+			memcpy(&buf[idx], rec.strs[i], len);
+			idx += len;
+		}
+
+		RINGBUFFER_POPNLOSE(&sTraceBuffer);
+	}
+
+	return (int)idx;
+}
+
+void inv_msg_trace_decoder_init(inv_msg_trace_decoder_t * decoder,
+		inv_msg_trace_output_t output, void * cookie)
+{
+	memset(decoder, 0, sizeof(*decoder));
+	decoder->output = output;
+	decoder->cookie = cookie;
+}
+
+static const char * decoder_lookup(const inv_msg_trace_decoder_t * decoder, uint32_t id)
+{
+	unsigned i;
+
+	for(i = 0; i < decoder->nstrings; ++i) {
+		if(decoder->strings[i].id == id)
+			return decoder->strings[i].str;
+	}
+
+	return 0;
+}
+
+static void decoder_define(inv_msg_trace_decoder_t * decoder, uint32_t id,
+		const uint8_t * str, unsigned len)
+{
+	unsigned i;
+
+	for(i = 0; i < decoder->nstrings; ++i) {
+		if(decoder->strings[i].id == id)
+			break;
+	}
+
+	if(i == decoder->nstrings) {
+		/* serializer sends a reset before it runs out of entries,
+		   a full table means a corrupted stream */
+		if(decoder->nstrings == INV_MSG_TRACE_MAX_IDS)
+			return;
+		++decoder->nstrings;
+	}
+
+	if(len > sizeof(decoder->strings[i].str) - 1)
+		len = sizeof(decoder->strings[i].str) - 1;
+
+	decoder->strings[i].id = id;
+	memcpy(decoder->strings[i].str, str, len);
+	decoder->strings[i].str[len] = '\0';
+}
+
+int inv_msg_trace_decoder_process(inv_msg_trace_decoder_t * decoder,
+		const uint8_t * buf, unsigned len)
+{
+	unsigned idx = 0;
+
+	while(idx < len) {
+		const uint8_t * pkt = &buf[idx];
+		const unsigned avail = len - idx;
+
+		if(pkt[0] == INV_MSG_TRACE_TAG_STRING) {
+			if(avail < 6 || avail < 6u + pkt[5])
+				break;
+			decoder_define(decoder, get_u32(&pkt[1]), &pkt[6], pkt[5]);
+			idx += 6 + pkt[5];
+		} else if(pkt[0] == INV_MSG_TRACE_TAG_DROPPED) {
+			if(avail < 5)
+				break;
+			decoder->dropped += get_u32(&pkt[1]);
+			idx += 5;
+		} else if(pkt[0] == INV_MSG_TRACE_TAG_RESET) {
+			decoder->nstrings = 0;
+			idx += 1;
+		} else if(pkt[0] == INV_MSG_TRACE_TAG_RECORD) {
+			char strs_buf[INV_MSG_TRACE_MAX_STRS][256];
+			const char * strs[INV_MSG_TRACE_MAX_STRS];
+			uint32_t words[INV_MSG_TRACE_MAX_WORDS];
+			char out_str[INV_MSG_TRACE_MAX_STRLEN];
+			const char * fmt, * label;
+			unsigned nwords, nstrs, i, pos;
+
+			if(avail < 16)
+				break;
+
+			nwords = pkt[14];
+			nstrs = pkt[15];
+			if(nwords > INV_MSG_TRACE_MAX_WORDS || nstrs > INV_MSG_TRACE_MAX_STRS)
+				return INV_ERROR;
+			if(avail < 16 + 4 * nwords)
+				break;
+
+			fmt = decoder_lookup(decoder, get_u32(&pkt[6]));
+			label = (get_u32(&pkt[10]) != 0) ? decoder_lookup(decoder, get_u32(&pkt[10])) : 0;
+			if(!fmt)
+				return INV_ERROR; /* unknown format string */
+
+			for(i = 0; i < nwords; ++i)
+				words[i] = get_u32(&pkt[16 + 4 * i]);
+
+			pos = 16 + 4 * nwords;
+			for(i = 0; i < nstrs; ++i) {
+				if(avail < pos + 1 || avail < pos + 1 + pkt[pos])
+					return (int)idx; /* incomplete */
+				memcpy(strs_buf[i], &pkt[pos + 1], pkt[pos]);
+				strs_buf[i][pkt[pos]] = '\0';
+				strs[i] = strs_buf[i];
+				pos += 1 + pkt[pos];
+			}
+
+			format_message(out_str, sizeof(out_str), fmt, words, nwords, strs, nstrs);
+
+			if(decoder->output)
+				decoder->output(decoder->cookie, get_u32(&pkt[1]), (int8_t)pkt[5], label, out_str);
+
+			idx += pos;
+		} else {
+			return INV_ERROR;
+		}
+	}
+
+	return (int)idx;
+}
@@ -0,0 +1,215 @@
+/*
+ * ________________________________________________________________________________________________________
+ * Copyright (c) 2015-2015 InvenSense Inc. All rights reserved.
+ *
+ * This software, related documentation and any modifications thereto (collectively “Software”) is subject
+ * to InvenSense and its licensors' intellectual property rights under U.S. and international copyright
+ * and other intellectual property rights laws.
+ *
+ * InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+ * and any use, reproduction, disclosure or distribution of the Software without an express license agreement
+ * from InvenSense is strictly prohibited.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE SOFTWARE IS
+ * PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * INVENSENSE BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, OR ANY
+ * DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ * ________________________________________________________________________________________________________
+ */
+
+/** @defgroup MessageTrace MessageTrace
+ *  @brief    Deferred binary trace for Message and Logger facilities
+ *
+ *            Instead of formatting the message in the caller context, a trace
+ *            call only stores a reference to the format string (its ID), a
+ *            timestamp and the raw arguments into a lock-free ring buffer.
+ *            Formatting is done later, either on target from an idle task with
+ *            inv_msg_trace_flush(), or on the host by decoding the binary stream
+ *            produced by inv_msg_trace_serialize().
+ *
+ *            Define INV_MSG_TRACE before including Message.h to route INV_MSG()
+ *            to inv_msg_trace() for a compilation unit.
+ *            Define LOGGER_TRACE before including Logger.h to route LOG() to
+ *            Logger_tracef() for a compilation unit.
+ *
+ *            Supported conversions are those of InvPrintf: c, d, i, u, x, X, o,
+ *            p, s, f, e, g with optional flags, width, precision and h, l, ll,
+ *            z length modifiers. Width or precision given as '*' is not supported.
+ *
+ *  @warning  Arguments for %s conversions are recorded by reference: the string
+ *            must still be valid when the trace is flushed or serialized
+ *            (typically a string literal).
+ *  @warning  The ring buffer is lock-free for a single producer and a single
+ *            consumer. If traces are emitted from several interrupt levels,
+ *            the caller is responsible for serializing the producers.
+ *
+ *  @ingroup  EmbUtils
+ *  @{
+ */
+
+#ifndef _INV_MESSAGE_TRACE_H_
+#define _INV_MESSAGE_TRACE_H_
+
+#include "Invn/InvExport.h"
+#include "Invn/EmbUtils/Message.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stdint.h>
+
+/** @brief Number of records the trace ring buffer can hold
+ *  Must be a power of 2
+ */
+#ifndef INV_MSG_TRACE_BUFFER_SIZE
+	#define INV_MSG_TRACE_BUFFER_SIZE    32
+#endif
+
+/** @brief Maximum number of 32-bit words of numerical arguments per record
+ *  (64-bit integers and floating point values use 2 words)
+ */
+#ifndef INV_MSG_TRACE_MAX_WORDS
+	#define INV_MSG_TRACE_MAX_WORDS      8
+#endif
+
+/** @brief Maximum number of %s arguments per record
+ */
+#ifndef INV_MSG_TRACE_MAX_STRS
+	#define INV_MSG_TRACE_MAX_STRS       2
+#endif
+
+/** @brief Number of format strings remembered by the serializer and the decoder
+ *  When the serializer runs out of entries, it sends INV_MSG_TRACE_TAG_RESET and
+ *  defines strings again as they get used.
+ */
+#ifndef INV_MSG_TRACE_MAX_IDS
+	#define INV_MSG_TRACE_MAX_IDS        64
+#endif
+
+/** @brief Maximum length of a formatted trace message (including nul character)
+ */
+#ifndef INV_MSG_TRACE_MAX_STRLEN
+	#define INV_MSG_TRACE_MAX_STRLEN     128
+#endif
+
+/** @brief Tags used in the binary stream produced by inv_msg_trace_serialize()
+ */
+enum inv_msg_trace_tag {
+	INV_MSG_TRACE_TAG_STRING = 0x01, /**< tag(1) id(4) len(1) char[len]: format or label string definition */
+	INV_MSG_TRACE_TAG_RECORD = 0x02, /**< tag(1) timestamp(4) level(1) fmt_id(4) label_id(4) nwords(1)
+	                                      nstrs(1) word[nwords](4) {len(1) char[len]}[nstrs] */
+	INV_MSG_TRACE_TAG_DROPPED = 0x03, /**< tag(1) count(4): number of records lost since last report */
+	INV_MSG_TRACE_TAG_RESET = 0x04,   /**< tag(1): forget all strings defined so far */
+};
+
+/** @brief Prototype for time source used to timestamp trace records
+ */
+typedef uint64_t (*inv_msg_trace_time_t)(void);
+
+/** @brief Set time source used to timestamp trace records
+ *  @param[in] get_time_us  function returning current time in us (may be NULL)
+ *  @return none
+ */
+void INV_EXPORT inv_msg_trace_setup(inv_msg_trace_time_t get_time_us);
+
+/** @brief Record a message without formatting it
+ *  Message level is checked against the level set with inv_msg_setup()
+ *  @param[in] 	level for the message
+ *  @param[in] 	str   format string (must remain valid until the record is consumed)
+ *  @param[in] 	...   optional arguments
+ *  @return none
+ */
+void INV_EXPORT inv_msg_trace(int level, const char * str, ...);
+
+/** @brief Record a labeled message without formatting it
+ *  No level check is done.
+ *  @param[in] 	label label for the message (may be NULL, must remain valid)
+ *  @param[in] 	level for the message
+ *  @param[in] 	str   format string (must remain valid until the record is consumed)
+ *  @param[in] 	ap    arguments
+ *  @return none
+ */
+void INV_EXPORT inv_msg_vtrace(const char * label, int level, const char * str, va_list ap);
+
+/** @brief Return number of records waiting in the trace ring buffer
+ */
+unsigned INV_EXPORT inv_msg_trace_pending(void);
+
+/** @brief Return and reset number of records lost because the ring buffer was full
+ */
+unsigned long INV_EXPORT inv_msg_trace_dropped(void);
+
+/** @brief Format pending records and pass them to a printer function
+ *  Intended to be called from an idle task.
+ *  @param[in] printer  printer function (as used by inv_msg_setup())
+ *  @param[in] max      maximum number of records to flush (0 for all pending records)
+ *  @return number of flushed records
+ */
+int INV_EXPORT inv_msg_trace_flush(inv_msg_printer_t printer, unsigned max);
+
+/** @brief Serialize pending records to a binary stream for host side decoding
+ *  Only complete records are written. Format and label strings are sent
+ *  once, the first time they are referenced.
+ *  @param[out] buf     output buffer
+ *  @param[in]  size    output buffer size
+ *  @return number of bytes written to buf
+ */
+int INV_EXPORT inv_msg_trace_serialize(uint8_t * buf, unsigned size);
+
+/** @brief Prototype for decoded message handler
+ *  @param[in] cookie     value passed to inv_msg_trace_decoder_init()
+ *  @param[in] timestamp  record timestamp in us
+ *  @param[in] level      message level
+ *  @param[in] label      message label (NULL if none)
+ *  @param[in] str        formatted message
+ */
+typedef void (*inv_msg_trace_output_t)(void * cookie, uint32_t timestamp, int level,
+		const char * label, const char * str);
+
+/** @brief States for host side trace decoder
+ *  String table is rather big, the decoder is meant to run on the host.
+ */
+typedef struct inv_msg_trace_decoder {
+	inv_msg_trace_output_t output;
+	void *                 cookie;
+	unsigned long          dropped;
+	unsigned               nstrings;
+	struct {
+		uint32_t id;
+		char     str[INV_MSG_TRACE_MAX_STRLEN];
+	} strings[INV_MSG_TRACE_MAX_IDS];
+} inv_msg_trace_decoder_t;
+
+/** @brief Initialize host side trace decoder
+ *  @param[out] decoder  decoder states
+ *  @param[in]  output   handler called for each decoded record
+ *  @param[in]  cookie   value passed to handler
+ *  @return none
+ */
+void INV_EXPORT inv_msg_trace_decoder_init(inv_msg_trace_decoder_t * decoder,
+		inv_msg_trace_output_t output, void * cookie);
+
+/** @brief Decode a binary stream produced by inv_msg_trace_serialize()
+ *  Incomplete packet at the end of buf is not consumed and must be passed
+ *  again, completed, on next call.
+ *  @param[in] decoder  decoder states
+ *  @param[in] buf      stream data
+ *  @param[in] len      stream data length
+ *  @return number of bytes consumed, or INV_ERROR on malformed stream
+ */
+int INV_EXPORT inv_msg_trace_decoder_process(inv_msg_trace_decoder_t * decoder,
+		const uint8_t * buf, unsigned len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _INV_MESSAGE_TRACE_H_ */
+
+/** @} */
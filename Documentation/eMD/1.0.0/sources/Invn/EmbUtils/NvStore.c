@@ -0,0 +1,356 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+#include "NvStore.h"
+#include "InvCksum.h"
+
+#include "Invn/InvError.h"
+
+#include <string.h>
+
+#define NVSTORE_SECTOR_MAGIC        0x3153564EUL	/* "NVS1" */
+#define NVSTORE_RECORD_COMMIT       0x0A0B0B0AUL
+#define NVSTORE_ERASED              0xFFFFFFFFUL
+#define NVSTORE_SECTOR_HEADER_SIZE  8
+#define NVSTORE_RECORD_HEADER_SIZE  8
+
+#define NVSTORE_WORDS(len)          (((uint32_t)(len) + 3) / 4)
+#define NVSTORE_RECORD_SIZE(len)    (NVSTORE_RECORD_HEADER_SIZE + 4 * NVSTORE_WORDS(len) + 4)
+
+static uint32_t sectorStart(const NvStore * self, uint8_t sector)
+{
+	return (uint32_t)sector * self->flash->sectorSize;
+}
+
+/* return 1 if sector header is valid, 0 otherwise */
+static int readSectorHeader(const NvStore * self, uint8_t sector, uint32_t * seq)
+{
+	uint32_t hdr[2];
+
+	if(self->flash->read(self->flash->context, sectorStart(self, sector), hdr, sizeof(hdr)) != 0)
+		return 0;
+
+	*seq = hdr[1];
+
+	return (hdr[0] == NVSTORE_SECTOR_MAGIC && hdr[1] != NVSTORE_ERASED);
+}
+
+static int isSectorBlank(const NvStore * self, uint8_t sector)
+{
+	uint32_t buf[16];
+	uint32_t offset, len, i;
+
+	for(offset = 0; offset < self->flash->sectorSize; offset += len) {
+		len = self->flash->sectorSize - offset;
+		if(len > sizeof(buf))
+			len = sizeof(buf);
+		if(self->flash->read(self->flash->context, sectorStart(self, sector) + offset, buf, len) != 0)
+			return 0;
+		for(i = 0; i < len / 4; i++) {
+			if(buf[i] != NVSTORE_ERASED)
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int indexFind(const NvStore * self, uint16_t key)
+{
+	int i;
+
+	for(i = 0; i < self->nbKeys; i++) {
+		if(self->index[i].key == key)
+			return i;
+	}
+
+	return -1;
+}
+
+static int indexUpdate(NvStore * self, uint16_t key, uint8_t type, uint8_t version,
+		uint16_t len, uint32_t offset)
+{
+	int i = indexFind(self, key);
+
+	if(i < 0) {
+		if(self->nbKeys == NVSTORE_MAX_KEYS)
+			return INV_ERROR_MEM;
+		i = self->nbKeys++;
+	}
+
+	self->index[i].key = key;
+	self->index[i].type = type;
+	self->index[i].version = version;
+	self->index[i].len = len;
+	self->index[i].offset = offset;
+
+	return 0;
+}
+
+/*
+ * Add committed records of a sector to the index.
+ * Return offset following last record, end of sector if sector content is inconsistent.
+ */
+static uint32_t scanSector(NvStore * self, uint8_t sector)
+{
+	uint32_t data[NVSTORE_WORDS(NVSTORE_MAX_DATA_SIZE)];
+	const uint32_t end = sectorStart(self, sector) + self->flash->sectorSize;
+	uint32_t offset = sectorStart(self, sector) + NVSTORE_SECTOR_HEADER_SIZE;
+	uint32_t hdr[2], commit;
+	uint16_t len;
+
+	while(offset + NVSTORE_RECORD_HEADER_SIZE <= end) {
+		if(self->flash->read(self->flash->context, offset, hdr, sizeof(hdr)) != 0)
+			return end;
+		if(hdr[0] == NVSTORE_ERASED)
+			return offset;
+
+		len = (uint16_t)(hdr[0] & 0xFFFF);
+		if(len > NVSTORE_MAX_DATA_SIZE || offset + NVSTORE_RECORD_SIZE(len) > end)
+			return end;
+
+		if(self->flash->read(self->flash->context, offset + NVSTORE_RECORD_HEADER_SIZE + 4 * NVSTORE_WORDS(len),
+				&commit, sizeof(commit)) != 0)
+			return end;
+		if(commit == NVSTORE_RECORD_COMMIT
+				&& self->flash->read(self->flash->context, offset + NVSTORE_RECORD_HEADER_SIZE, data, len) == 0
+				&& InvCksum_compute(data, len) == (uint16_t)(hdr[0] >> 16)) {
+			/* keys not fitting in the index are ignored */
+			indexUpdate(self, (uint16_t)(hdr[1] & 0xFFFF), (uint8_t)(hdr[1] >> 16),
+					(uint8_t)(hdr[1] >> 24), len, offset + NVSTORE_RECORD_HEADER_SIZE);
+		}
+
+		offset += NVSTORE_RECORD_SIZE(len);
+	}
+
+	return end;
+}
+
+static int appendRecord(NvStore * self, uint16_t key, uint8_t type, uint8_t version,
+		const void * data, uint16_t len)
+{
+	uint32_t words[2 + NVSTORE_WORDS(NVSTORE_MAX_DATA_SIZE)];
+	const uint32_t commit = NVSTORE_RECORD_COMMIT;
+	const uint32_t offset = self->writeOffset;
+	const uint32_t nbWords = NVSTORE_WORDS(len);
+	int rc;
+
+	if(offset + NVSTORE_RECORD_SIZE(len) > sectorStart(self, self->active) + self->flash->sectorSize)
+		return INV_ERROR_SIZE;
+
+	/* size first: a record interrupted after its first word can still be skipped */
+	words[0] = len | ((uint32_t)InvCksum_compute(data, len) << 16);
+	words[1] = key | ((uint32_t)type << 16) | ((uint32_t)version << 24);
+	if(nbWords)
+		words[1 + nbWords] = NVSTORE_ERASED;
+	memcpy(&words[2], data, len);
+
+	/* whatever happens next, space is consumed */
+	self->writeOffset += NVSTORE_RECORD_SIZE(len);
+
+	rc = self->flash->program(self->flash->context, offset, words, 2 + nbWords);
+	if(rc != 0)
+		return rc;
+
+	/* commit once header and data are programmed */
+	rc = self->flash->program(self->flash->context, offset + NVSTORE_RECORD_HEADER_SIZE + 4 * nbWords, &commit, 1);
+	if(rc != 0)
+		return rc;
+
+	return indexUpdate(self, key, type, version, len, offset + NVSTORE_RECORD_HEADER_SIZE);
+}
+
+static int startSector(NvStore * self, uint8_t sector, uint32_t seq)
+{
+	uint32_t hdr[2];
+	int rc;
+
+	if(!isSectorBlank(self, sector)) {
+		rc = self->flash->erase(self->flash->context, sector);
+		if(rc != 0)
+			return rc;
+	}
+
+	hdr[0] = NVSTORE_SECTOR_MAGIC;
+	hdr[1] = seq;
+	rc = self->flash->program(self->flash->context, sectorStart(self, sector), hdr, 2);
+	if(rc != 0)
+		return rc;
+
+	self->active = sector;
+	self->seq = seq;
+	self->writeOffset = sectorStart(self, sector) + NVSTORE_SECTOR_HEADER_SIZE;
+
+	return 0;
+}
+
+/* copy live records of a sector to active sector and erase it */
+static int reclaimSector(NvStore * self, uint8_t sector)
+{
+	uint32_t data[NVSTORE_WORDS(NVSTORE_MAX_DATA_SIZE)];
+	const uint32_t start = sectorStart(self, sector);
+	const uint32_t end = start + self->flash->sectorSize;
+	int i, rc;
+
+	for(i = 0; i < self->nbKeys; i++) {
+		NvStoreEntry entry = self->index[i];
+
+		if(entry.offset < start || entry.offset >= end)
+			continue;
+		rc = self->flash->read(self->flash->context, entry.offset, data, entry.len);
+		if(rc != 0)
+			return rc;
+		rc = appendRecord(self, entry.key, entry.type, entry.version, data, entry.len);
+		if(rc != 0)
+			return rc;
+	}
+
+	return self->flash->erase(self->flash->context, sector);
+}
+
+static int nextSector(NvStore * self)
+{
+	const uint8_t next = (self->active + 1) % self->flash->nbSectors;
+	const uint8_t oldest = (next + 1) % self->flash->nbSectors;
+	uint32_t seq;
+	int rc;
+
+	rc = startSector(self, next, self->seq + 1);
+	if(rc != 0)
+		return rc;
+
+	/* keep the sector following the active one erased */
+	if(readSectorHeader(self, oldest, &seq))
+		return reclaimSector(self, oldest);
+
+	return 0;
+}
+
+int NvStore_format(NvStore * self)
+{
+	uint8_t sector;
+	int rc;
+
+	self->nbKeys = 0;
+
+	for(sector = 0; sector < self->flash->nbSectors; sector++) {
+		rc = self->flash->erase(self->flash->context, sector);
+		if(rc != 0)
+			return rc;
+	}
+
+	return startSector(self, 0, 1);
+}
+
+int NvStore_init(NvStore * self, const NvStoreFlash * flash)
+{
+	uint32_t seqs[NVSTORE_MAX_SECTORS];
+	uint8_t valid[NVSTORE_MAX_SECTORS];
+	uint8_t sector, nbValid = 0;
+	uint32_t last = 0, seq;
+
+	if(flash->nbSectors < 2 || flash->nbSectors > NVSTORE_MAX_SECTORS || (flash->sectorSize % 4) != 0
+			|| flash->sectorSize < NVSTORE_SECTOR_HEADER_SIZE + NVSTORE_RECORD_SIZE(NVSTORE_MAX_DATA_SIZE))
+		return INV_ERROR_BAD_ARG;
+
+	memset(self, 0, sizeof(*self));
+	self->flash = flash;
+
+	for(sector = 0; sector < flash->nbSectors; sector++) {
+		valid[sector] = (uint8_t)readSectorHeader(self, sector, &seqs[sector]);
+		nbValid += valid[sector];
+	}
+
+	if(nbValid == 0)
+		return NvStore_format(self);
+
+	/* replay sectors from oldest to newest, last record of a key wins */
+	while(nbValid--) {
+		uint8_t oldest = 0xFF;
+
+		for(sector = 0; sector < flash->nbSectors; sector++) {
+			if(valid[sector] && (oldest == 0xFF || seqs[sector] < seqs[oldest]))
+				oldest = sector;
+		}
+		valid[oldest] = 0;
+		last = scanSector(self, oldest);
+		self->active = oldest;
+		self->seq = seqs[oldest];
+	}
+	self->writeOffset = last;
+
+	/* reset occurred before the sector following the active one was reclaimed */
+	sector = (self->active + 1) % flash->nbSectors;
+	if(readSectorHeader(self, sector, &seq))
+		return reclaimSector(self, sector);
+
+	return 0;
+}
+
+int NvStore_read(NvStore * self, uint16_t key, uint8_t * type, uint8_t * version,
+		void * data, uint16_t maxLen)
+{
+	const int i = indexFind(self, key);
+	int rc;
+
+	if(i < 0)
+		return INV_ERROR;
+	if(self->index[i].len > maxLen)
+		return INV_ERROR_SIZE;
+
+	rc = self->flash->read(self->flash->context, self->index[i].offset, data, self->index[i].len);
+	if(rc != 0)
+		return rc;
+
+	if(type)
+		*type = self->index[i].type;
+	if(version)
+		*version = self->index[i].version;
+
+	return self->index[i].len;
+}
+
+int NvStore_write(NvStore * self, uint16_t key, uint8_t type, uint8_t version,
+		const void * data, uint16_t len)
+{
+	uint32_t stored[NVSTORE_WORDS(NVSTORE_MAX_DATA_SIZE)];
+	const int i = indexFind(self, key);
+	int rc;
+
+	if(len > NVSTORE_MAX_DATA_SIZE)
+		return INV_ERROR_SIZE;
+
+	if(i < 0) {
+		if(self->nbKeys == NVSTORE_MAX_KEYS)
+			return INV_ERROR_MEM;
+	} else if(self->index[i].type == type && self->index[i].version == version && self->index[i].len == len
+			&& self->flash->read(self->flash->context, self->index[i].offset, stored, len) == 0
+			&& memcmp(stored, data, len) == 0) {
+		/* spare an erase cycle */
+		return 0;
+	}
+
+	rc = appendRecord(self, key, type, version, data, len);
+	if(rc != INV_ERROR_SIZE)
+		return rc;
+
+	rc = nextSector(self);
+	if(rc != 0)
+		return rc;
+
+	return appendRecord(self, key, type, version, data, len);
+}
+
+int NvStore_contains(const NvStore * self, uint16_t key)
+{
+	return (indexFind(self, key) >= 0);
+}
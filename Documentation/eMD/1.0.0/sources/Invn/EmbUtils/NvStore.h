@@ -0,0 +1,146 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+/** @defgroup NvStore NvStore
+	@brief Log-structured key/value store in NV memory
+
+	Values are appended as records to a ring of flash sectors. Updating a key appends a new record,
+	the previous one becoming stale. When the active sector is full, the next (erased) sector becomes
+	active and the oldest sector is reclaimed: its live records are copied to the active sector and it
+	is erased. Erase cycles are thus spread over all sectors.
+	An index of live records is built in RAM once by NvStore_init(), so that reads do not scan memory.
+
+	Flash memory is accessed through a NvStoreFlash object providing read, program and erase hooks.
+	Programming is done by 32-bit words. Erased memory is expected to read 0xFF.
+
+	Sector layout:  magic(4) seq(4) record...
+	Record layout:  len(2) cksum(2) key(2) type(1) version(1) data[len] padding(0..3) commit(4)
+	A record is only taken into account once its commit word is programmed, so that a record
+	interrupted by a reset is ignored.
+
+	@ingroup EmbUtils
+	@{
+*/
+
+#ifndef _NV_STORE_H_
+#define _NV_STORE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NVSTORE_MAX_KEYS
+#	define NVSTORE_MAX_KEYS         16	/**< Maximum number of keys held by the index */
+#endif
+
+#ifndef NVSTORE_MAX_DATA_SIZE
+#	define NVSTORE_MAX_DATA_SIZE    128	/**< Maximum size of a value in bytes, multiple of 4 */
+#endif
+
+#ifndef NVSTORE_MAX_SECTORS
+#	define NVSTORE_MAX_SECTORS      8	/**< Maximum number of sectors */
+#endif
+
+/** @brief 	Value types
+*/
+enum NvStoreType {
+	NVSTORE_TYPE_BYTES = 0,		/**< raw bytes */
+	NVSTORE_TYPE_INT32,			/**< array of int32_t */
+	NVSTORE_TYPE_FLOAT,			/**< array of float */
+};
+
+/** @brief 	Flash memory access hooks
+*/
+typedef struct NvStoreFlash {
+	void *      context;		/**< passed to hooks */
+	uint32_t    sectorSize;		/**< size of a sector in bytes, multiple of 4 */
+	uint8_t     nbSectors;		/**< number of sectors, 2 at least */
+	/** @brief read len bytes at offset from start of first sector, return 0 on success */
+	int (*read)(void * context, uint32_t offset, void * data, uint32_t len);
+	/** @brief program nbWords words at offset (multiple of 4), return 0 on success */
+	int (*program)(void * context, uint32_t offset, const uint32_t * words, uint32_t nbWords);
+	/** @brief erase one sector, return 0 on success */
+	int (*erase)(void * context, uint8_t sector);
+} NvStoreFlash;
+
+/** @brief 	Location of the live record of a key
+*/
+typedef struct NvStoreEntry {
+	uint16_t    key;
+	uint8_t     type;
+	uint8_t     version;
+	uint16_t    len;
+	uint32_t    offset;			/**< offset of record data */
+} NvStoreEntry;
+
+/** @brief 	NvStore object definitions
+*/
+typedef struct NvStore {
+	const NvStoreFlash * flash;
+	NvStoreEntry    index[NVSTORE_MAX_KEYS];
+	uint8_t         nbKeys;
+	uint8_t         active;		/**< sector records are appended to */
+	uint32_t        seq;		/**< sequence number of active sector */
+	uint32_t        writeOffset;/**< offset of next record */
+} NvStore;
+
+/** @brief 		Mount a store and build its index
+	Sectors are formatted if none holds a valid store.
+	If a reset occurred while a sector was being reclaimed, reclaim is completed.
+	@param[in]	flash 	flash access hooks (must remain valid)
+	@return 	0 on success, negative value on error
+*/
+int NvStore_init(NvStore * self, const NvStoreFlash * flash);
+
+/** @brief 		Erase all sectors and start an empty store
+	@return 	0 on success, negative value on error
+*/
+int NvStore_format(NvStore * self);
+
+/** @brief 		Read value of a key
+	@param[in]	key 		key
+	@param[out]	type 		type of stored value (may be NULL)
+	@param[out]	version 	version of stored value (may be NULL)
+	@param[out]	data 		value
+	@param[in]	maxLen 		size of data buffer
+	@return 	size of value, INV_ERROR if key is not found, INV_ERROR_SIZE if data buffer is too small
+*/
+int NvStore_read(NvStore * self, uint16_t key, uint8_t * type, uint8_t * version,
+		void * data, uint16_t maxLen);
+
+/** @brief 		Write value of a key
+	Nothing is programmed if the stored value is identical.
+	@param[in]	key 		key
+	@param[in]	type 		type of value
+	@param[in]	version 	version of value (layout revision, left to the caller)
+	@param[in]	data 		value
+	@param[in]	len 		size of value, up to NVSTORE_MAX_DATA_SIZE
+	@return 	0 on success, INV_ERROR_MEM if index is full, INV_ERROR_SIZE if live values
+	            do not fit in a sector, other negative value on flash error
+*/
+int NvStore_write(NvStore * self, uint16_t key, uint8_t type, uint8_t version,
+		const void * data, uint16_t len);
+
+/** @brief 		Check if a key is stored
+	@return 	1 if key is stored, 0 otherwise
+*/
+int NvStore_contains(const NvStore * self, uint16_t key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/** @} */
@@ -0,0 +1,126 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+#include "NvStoreFile.h"
+
+#include "Invn/InvError.h"
+
+#include <string.h>
+
+static int NvStoreFile_read(void * context, uint32_t offset, void * data, uint32_t len)
+{
+	NvStoreFile * self = (NvStoreFile *)context;
+
+	if(offset + len > self->flash.sectorSize * self->flash.nbSectors)
+		return INV_ERROR_BAD_ARG;
+
+	if(fseek(self->file, (long)offset, SEEK_SET) != 0 || fread(data, 1, len, self->file) != len)
+		return INV_ERROR_IO;
+
+	return 0;
+}
+
+static int NvStoreFile_program(void * context, uint32_t offset, const uint32_t * words, uint32_t nbWords)
+{
+	NvStoreFile * self = (NvStoreFile *)context;
+	uint32_t i, word;
+
+	if((offset % 4) != 0 || offset + 4 * nbWords > self->flash.sectorSize * self->flash.nbSectors)
+		return INV_ERROR_BAD_ARG;
+
+	for(i = 0; i < nbWords; i++) {
+		if(self->wordBudget == 0)
+			return INV_ERROR_HW;
+		if(self->wordBudget > 0)
+			self->wordBudget--;
+		if(NvStoreFile_read(self, offset + 4 * i, &word, sizeof(word)) != 0)
+			return INV_ERROR_IO;
+		if(word != 0xFFFFFFFF)
+			return INV_ERROR_HW;
+		if(fseek(self->file, (long)(offset + 4 * i), SEEK_SET) != 0
+				|| fwrite(&words[i], 1, sizeof(words[i]), self->file) != sizeof(words[i]))
+			return INV_ERROR_IO;
+	}
+
+	return (fflush(self->file) == 0) ? 0 : INV_ERROR_IO;
+}
+
+static int NvStoreFile_erase(void * context, uint8_t sector)
+{
+	NvStoreFile * self = (NvStoreFile *)context;
+	uint8_t erased[256];
+	uint32_t offset;
+
+	if(sector >= self->flash.nbSectors)
+		return INV_ERROR_BAD_ARG;
+
+	memset(erased, 0xFF, sizeof(erased));
+	if(fseek(self->file, (long)sector * self->flash.sectorSize, SEEK_SET) != 0)
+		return INV_ERROR_IO;
+	for(offset = 0; offset < self->flash.sectorSize; offset += sizeof(erased)) {
+		uint32_t len = self->flash.sectorSize - offset;
+		if(len > sizeof(erased))
+			len = sizeof(erased);
+		if(fwrite(erased, 1, len, self->file) != len)
+			return INV_ERROR_IO;
+	}
+	self->eraseCount[sector]++;
+
+	return (fflush(self->file) == 0) ? 0 : INV_ERROR_IO;
+}
+
+int NvStoreFile_open(NvStoreFile * self, const char * path, uint32_t sectorSize, uint8_t nbSectors)
+{
+	const uint8_t erased = 0xFF;
+	long size;
+
+	if(nbSectors > NVSTORE_MAX_SECTORS || (sectorSize % 4) != 0)
+		return INV_ERROR_BAD_ARG;
+
+	memset(self, 0, sizeof(*self));
+	self->wordBudget = -1;
+
+	self->file = fopen(path, "r+b");
+	if(!self->file)
+		self->file = fopen(path, "w+b");
+	if(!self->file)
+		return INV_ERROR_FILE;
+
+	if(fseek(self->file, 0, SEEK_END) != 0 || (size = ftell(self->file)) < 0) {
+		NvStoreFile_close(self);
+		return INV_ERROR_FILE;
+	}
+	while(size < (long)sectorSize * nbSectors) {
+		if(fwrite(&erased, 1, 1, self->file) != 1) {
+			NvStoreFile_close(self);
+			return INV_ERROR_FILE;
+		}
+		size++;
+	}
+
+	self->flash.context = self;
+	self->flash.sectorSize = sectorSize;
+	self->flash.nbSectors = nbSectors;
+	self->flash.read = NvStoreFile_read;
+	self->flash.program = NvStoreFile_program;
+	self->flash.erase = NvStoreFile_erase;
+
+	return 0;
+}
+
+void NvStoreFile_close(NvStoreFile * self)
+{
+	if(self->file) {
+		fclose(self->file);
+		self->file = NULL;
+	}
+}
@@ -0,0 +1,65 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+/** @defgroup NvStoreFile NvStoreFile
+	@brief File backed flash emulator for NvStore
+
+	Emulates NOR flash in a file so that NvStore can run on a host: erased memory reads 0xFF,
+	programming a word which is not erased fails, erase count of each sector is recorded.
+	A power loss can be simulated by limiting the number of words that can still be programmed.
+	Requires standard C file I/O: not meant to be built for the embedded targets.
+
+	@ingroup EmbUtils
+	@{
+*/
+
+#ifndef _NV_STORE_FILE_H_
+#define _NV_STORE_FILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "NvStore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief 	NvStoreFile object definitions
+*/
+typedef struct NvStoreFile {
+	NvStoreFlash    flash;							/**< hooks to be given to NvStore_init() */
+	FILE *          file;
+	uint32_t        eraseCount[NVSTORE_MAX_SECTORS];/**< number of erase per sector since open */
+	int32_t         wordBudget;						/**< words that can still be programmed before programming fails, -1 for no limit */
+} NvStoreFile;
+
+/** @brief 		Open (or create) a flash image file
+	Missing or short file is extended with erased sectors.
+	@param[in]	path 		image file path
+	@param[in]	sectorSize 	size of a sector in bytes, multiple of 4
+	@param[in]	nbSectors 	number of sectors
+	@return 	0 on success, negative value on error
+*/
+int NvStoreFile_open(NvStoreFile * self, const char * path, uint32_t sectorSize, uint8_t nbSectors);
+
+/** @brief 		Close flash image file
+*/
+void NvStoreFile_close(NvStoreFile * self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+/** @} */
@@ -0,0 +1,195 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+/** @defgroup RingByteBufferSpsc RingByteBufferSpsc
+	@brief Lock-free circular buffer of bytes for one producer and one consumer
+	
+	Producer (eg: an ISR) only calls push functions, consumer (eg: a task)
+	only calls pop, peek and commit functions. Each side only writes its own
+	index and reads the other one with acquire semantic, so no critical
+	section is needed. Buffer size must be a power of 2.
+	@ingroup EmbUtils
+	@{
+*/
+
+#ifndef _RING_BYTE_BUFFER_SPSC_H_
+#define _RING_BYTE_BUFFER_SPSC_H_
+
+#include <stdint.h>
+
+#include "Invn/InvBool.h"
+#include "InvAssert.h"
+
+/** @brief Overloadable index accessors
+	Load must have acquire semantic and store release semantic.
+	Default implementation relies on GCC atomic builtins, or on volatile
+	accesses otherwise (enough on a single core target if the compiler does
+	not move memory accesses across volatile accesses).
+*/
+#ifndef RINGBYTEBUFFERSPSC_LOAD_ACQUIRE
+  #if defined(__GNUC__)
+    #define RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define RINGBYTEBUFFERSPSC_STORE_RELEASE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+  #else
+    #define RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(ptr)       (*(volatile const uint32_t *)(ptr))
+    #define RINGBYTEBUFFERSPSC_STORE_RELEASE(ptr, val) (*(volatile uint32_t *)(ptr) = (val))
+  #endif
+#endif
+
+/** @brief 	RingByteBufferSpsc object definitions
+	Indexes are free running, they are masked on access.
+*/
+typedef struct {
+	uint8_t 	*buffer; 	/**< pointer to ring buffer data placeholder */
+	uint32_t 	mask;		/**< size of the data buffer minus 1 */
+	uint32_t 	head;		/**< write index, only written by the producer */
+	uint32_t 	tail;		/**< read index, only written by the consumer */
+} RingByteBufferSpsc;
+
+/** @brief 		Initialize and reset a ring buffer
+	@param[in]	pBuffer		pointer to buffer placeholder
+	@param[in]	sizeBuffer	size of buffer placeholder, must be a power of 2
+	@return none
+*/
+void RingByteBufferSpsc_init(RingByteBufferSpsc *self, uint8_t *pBuffer,
+                             uint32_t sizeBuffer);
+
+/** @brief 		Clear a ring buffer
+				Must not be called while producer or consumer is active
+	@return 	none
+*/
+void RingByteBufferSpsc_clear(RingByteBufferSpsc *self);
+
+/** @brief 		Get maximum size of a ring buffer
+	@return 	Return maximum size of the ring buffer
+*/
+static inline uint32_t RingByteBufferSpsc_maxSize(const RingByteBufferSpsc *self)
+{
+	ASSERT(self);
+
+	return self->mask + 1;
+}
+
+/** @brief 		Get current size of a ring buffer (consumer side)
+	@return 	Return number of byte that can be popped
+*/
+static inline uint32_t RingByteBufferSpsc_size(const RingByteBufferSpsc *self)
+{
+	ASSERT(self);
+
+	return RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->head) - self->tail;
+}
+
+/** @brief 		Get number of empty slot of a ring buffer (producer side)
+	@return 	Return number of byte that can be pushed
+*/
+static inline uint32_t RingByteBufferSpsc_available(const RingByteBufferSpsc *self)
+{
+	ASSERT(self);
+
+	return RingByteBufferSpsc_maxSize(self) -
+			(self->head - RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->tail));
+}
+
+/** @brief 		Check for ring buffer emptyness (consumer side)
+	@return 	Return true if ring buffer is empty, false otherwise
+*/
+static inline inv_bool_t RingByteBufferSpsc_isEmpty(const RingByteBufferSpsc *self)
+{
+	return (RingByteBufferSpsc_size(self) == 0);
+}
+
+/** @brief 		Check for ring buffer fullness (producer side)
+	@return 	Return true if ring buffer is full, false otherwise
+*/
+static inline inv_bool_t RingByteBufferSpsc_isFull(const RingByteBufferSpsc *self)
+{
+	return (RingByteBufferSpsc_available(self) == 0);
+}
+
+/** @brief 		Push a byte to a ring buffer
+	@param[in] 	byte 	byte to push to the ring buffer
+	@return 	true if the byte was pushed, false if the ring buffer is full
+*/
+static inline inv_bool_t RingByteBufferSpsc_pushByte(RingByteBufferSpsc *self, uint8_t byte)
+{
+	uint32_t head;
+
+	ASSERT(self);
+
+	head = self->head;
+	if (head - RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->tail) > self->mask)
+		return false;
+
+	self->buffer[head & self->mask] = byte;
+	RINGBYTEBUFFERSPSC_STORE_RELEASE(&self->head, head + 1);
+
+	return true;
+}
+
+/** @brief 		Pop a byte from a ring buffer
+	@param[out] byte 	placeholder for the popped byte
+	@return 	true if a byte was popped, false if the ring buffer is empty
+*/
+static inline inv_bool_t RingByteBufferSpsc_popByte(RingByteBufferSpsc *self, uint8_t *byte)
+{
+	uint32_t tail;
+
+	ASSERT(self);
+	ASSERT(byte);
+
+	tail = self->tail;
+	if (RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->head) == tail)
+		return false;
+
+	*byte = self->buffer[tail & self->mask];
+	RINGBYTEBUFFERSPSC_STORE_RELEASE(&self->tail, tail + 1);
+
+	return true;
+}
+
+/** @brief 		Push as much data as possible to a ring buffer
+				Data are copied in at most two segments
+	@param[in] 	data 	pointer to data to push to the ring buffer
+	@param[in] 	len  	size of data to push to the ring buffer
+	@return 	number of bytes pushed
+*/
+uint32_t RingByteBufferSpsc_pushBuffer(RingByteBufferSpsc *self, const void *data,
+                                       uint32_t len);
+
+/** @brief 		Pop as much data as possible from a ring buffer
+				Data are copied in at most two segments
+	@param[out]	data 	pointer to placeholder
+	@param[in] 	len  	maximum size of data to pop from the ring buffer
+	@return 	number of bytes popped
+*/
+uint32_t RingByteBufferSpsc_popBuffer(RingByteBufferSpsc *self, void *data, uint32_t len);
+
+/** @brief 		Get direct access to data at the front of a ring buffer
+				Data are not removed until RingByteBufferSpsc_commit() is called.
+				Only the first contiguous segment is returned: once committed,
+				call again to get the part that wrapped around.
+	@param[out]	data 	pointer to first byte to read
+	@return 	number of contiguous bytes that can be read from data
+*/
+uint32_t RingByteBufferSpsc_peek(const RingByteBufferSpsc *self, const uint8_t **data);
+
+/** @brief 		Remove bytes from the front of a ring buffer
+	@param[in] 	len  	number of bytes to remove, at most the value returned by
+						RingByteBufferSpsc_size() or RingByteBufferSpsc_peek()
+	@return 	none
+*/
+void RingByteBufferSpsc_commit(RingByteBufferSpsc *self, uint32_t len);
+
+#endif
+
+/** @} */
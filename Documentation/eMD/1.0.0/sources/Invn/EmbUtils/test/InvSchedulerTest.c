@@ -0,0 +1,285 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+/*
+	Host-side tests and benchmark for InvScheduler.
+
+	Build and run from the sources directory with a POSIX host compiler:
+
+		cc -O2 -DINVSCHEDULER_MAX_TASKS=1024 -I. Invn/EmbUtils/test/InvSchedulerTest.c \
+			Invn/EmbUtils/InvScheduler.c -o InvSchedulerTest
+		./InvSchedulerTest          # functional tests
+		./InvSchedulerTest bench    # dispatch cost versus number of tasks
+
+	Tasks run by the scheduler are checked against a reference scheduler
+	scanning a list of tasks, as InvScheduler did before it was backed by a
+	min-heap: most late task first, then highest priority, then first
+	queued. Workloads mix periodic tasks with random periods and priorities,
+	delayed starts, restarts, stops and priority changes, up to
+	INVSCHEDULER_MAX_TASKS tasks.
+
+	The benchmark runs periodic tasks with random periods of 1 to 50 ticks
+	and reports the cost of a task dispatch for the heap and for the list
+	scan reference. The program returns 0 on success.
+*/
+
+#include "Invn/EmbUtils/InvScheduler.h"
+#include "Invn/InvError.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+#define MAX_TASKS 	INVSCHEDULER_MAX_TASKS
+
+static uint32_t lcg_next(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+
+	return *state >> 8;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Reference scheduler ********************************************************/
+
+struct ref_task {
+	int      queued;
+	uint8_t  priority;
+	uint32_t period;
+	uint32_t deadline;
+	uint32_t seq;
+};
+
+struct ref_scheduler {
+	uint32_t        time;
+	uint32_t        seq;
+	int             count;
+	struct ref_task tasks[MAX_TASKS];
+};
+
+static void ref_start(struct ref_scheduler *r, int i, uint32_t delay)
+{
+	r->tasks[i].queued = 1;
+	r->tasks[i].deadline = r->time + delay;
+	r->tasks[i].seq = r->seq++;
+}
+
+static void ref_stop(struct ref_scheduler *r, int i)
+{
+	r->tasks[i].queued = 0;
+}
+
+/* run the task due, if any, and return its index or -1 */
+static int ref_dispatch_one(struct ref_scheduler *r)
+{
+	int i, best = -1;
+
+	for(i = 0; i < r->count; i++) {
+		const struct ref_task *t = &r->tasks[i];
+		const struct ref_task *b = &r->tasks[best < 0 ? 0 : best];
+
+		if(!t->queued || (int32_t)(r->time - t->deadline) < 0)
+			continue;
+		if(best < 0 || (int32_t)(t->deadline - b->deadline) < 0
+				|| (t->deadline == b->deadline && (t->priority > b->priority
+				|| (t->priority == b->priority && (int32_t)(t->seq - b->seq) < 0))))
+			best = i;
+	}
+	if(best >= 0) {
+		r->tasks[best].deadline = r->time + r->tasks[best].period;
+		r->tasks[best].seq = r->seq++;
+	}
+
+	return best;
+}
+
+/* Workloads ******************************************************************/
+
+static InvScheduler scheduler;
+static InvSchedulerTask tasks[MAX_TASKS];
+static struct ref_scheduler ref;
+static int last_run;
+
+static void task_main(void *arg)
+{
+	last_run = (int)(size_t)arg;
+}
+
+static void setup(int nb_tasks, uint32_t *seed, int same_start)
+{
+	int i;
+
+	InvScheduler_init(&scheduler);
+	memset(&ref, 0, sizeof(ref));
+	ref.count = nb_tasks;
+	for(i = 0; i < nb_tasks; i++) {
+		const uint8_t prio = (uint8_t)(1 + lcg_next(seed) % 200);
+		const uint32_t period = 1 + lcg_next(seed) % 50;
+		const uint32_t delay = same_start ? 0 : lcg_next(seed) % 5;
+
+		InvScheduler_initTask(&scheduler, &tasks[i], "", task_main, (void *)(size_t)i, prio, period);
+		ref.tasks[i].priority = prio;
+		ref.tasks[i].period = period;
+		CHECK(InvScheduler_startTask(&tasks[i], delay) == 0);
+		ref_start(&ref, i, delay);
+	}
+}
+
+/* run both schedulers tick by tick and check they run the same tasks in the same order */
+static void test_order(int nb_tasks, int nb_ticks, uint32_t seed)
+{
+	unsigned long nb_runs = 0, nb_diffs = 0;
+	int k;
+
+	setup(nb_tasks, &seed, 0);
+	for(k = 0; k < nb_ticks; k++) {
+		int i, j;
+
+		InvScheduler_updateTime(&scheduler);
+		ref.time++;
+
+		/* random restart, stop and priority change */
+		if(k % 7 == 0) {
+			j = lcg_next(&seed) % nb_tasks;
+			switch(lcg_next(&seed) % 3) {
+			case 0:
+				i = lcg_next(&seed) % 10;
+				CHECK(InvScheduler_startTask(&tasks[j], i) == 0);
+				ref_start(&ref, j, i);
+				break;
+			case 1:
+				InvScheduler_stopTask(&tasks[j]);
+				ref_stop(&ref, j);
+				break;
+			default:
+				i = 1 + lcg_next(&seed) % 200;
+				InvScheduler_lock(scheduler.contextLock);
+				InvScheduler_setTaskPrioU(&tasks[j], (uint8_t)i);
+				InvScheduler_unlock(scheduler.contextLock);
+				ref.tasks[j].priority = (uint8_t)i;
+				break;
+			}
+		}
+
+		for(;;) {
+			last_run = -1;
+			InvScheduler_dispatchOneTask(&scheduler);
+			i = ref_dispatch_one(&ref);
+			nb_diffs += (i != last_run);
+			if(i < 0 || last_run < 0)
+				break;
+			nb_runs++;
+		}
+		CHECK(InvScheduler_getActiveTaskCount(&scheduler) <= nb_tasks);
+	}
+	CHECK(nb_runs > 0);
+	CHECK(nb_diffs == 0);
+	printf("order nb_tasks=%d: %lu runs, %lu differences\n", nb_tasks, nb_runs, nb_diffs);
+}
+
+static void test_capacity(void)
+{
+	InvSchedulerTask extra;
+	uint32_t seed = 7;
+
+	setup(MAX_TASKS, &seed, 1);
+	CHECK(InvScheduler_getActiveTaskCount(&scheduler) == MAX_TASKS);
+	CHECK(InvScheduler_getNextTime(&scheduler) == 0);
+
+	InvScheduler_initTask(&scheduler, &extra, "", task_main, 0, 1, 1);
+	CHECK(InvScheduler_startTask(&extra, 0) == INV_ERROR_MEM);
+	CHECK(extra.state == INVSCHEDULER_TASK_STATE_STOP);
+
+	InvScheduler_stopTask(&tasks[MAX_TASKS / 2]);
+	CHECK(InvScheduler_startTask(&extra, 0) == 0);
+	CHECK(InvScheduler_getActiveTaskCount(&scheduler) == MAX_TASKS);
+
+	/* every task is due: all of them run once on the first dispatch */
+	CHECK(InvScheduler_dispatchTasks(&scheduler) == MAX_TASKS);
+	CHECK(InvScheduler_getNextTime(&scheduler) >= 1);
+}
+
+/* Benchmark ******************************************************************/
+
+static void bench(void)
+{
+	static const int nb_tasks_list[] = { 4, 16, 64, 256, 512, 1000 };
+	const int nb_ticks = 20000;
+	unsigned n;
+
+	printf("%8s %12s %12s\n", "tasks", "heap", "list scan");
+	for(n = 0; n < sizeof(nb_tasks_list) / sizeof(nb_tasks_list[0]); n++) {
+		const int nb_tasks = nb_tasks_list[n];
+		unsigned long runs_heap = 0, runs_ref = 0;
+		double t_heap, t_ref;
+		uint32_t seed = 1;
+		int k;
+
+		if(nb_tasks > MAX_TASKS)
+			break;
+
+		setup(nb_tasks, &seed, 0);
+		t_heap = now_s();
+		for(k = 0; k < nb_ticks; k++) {
+			InvScheduler_updateTime(&scheduler);
+			runs_heap += InvScheduler_dispatchTasks(&scheduler);
+		}
+		t_heap = now_s() - t_heap;
+
+		t_ref = now_s();
+		for(k = 0; k < nb_ticks; k++) {
+			ref.time++;
+			while(ref_dispatch_one(&ref) >= 0)
+				runs_ref++;
+		}
+		t_ref = now_s() - t_ref;
+
+		CHECK(runs_heap == runs_ref);
+		printf("%8d %9.1f ns %9.1f ns\n", nb_tasks,
+				t_heap * 1e9 / runs_heap, t_ref * 1e9 / runs_ref);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc > 1 && strcmp(argv[1], "bench") == 0) {
+		bench();
+	} else {
+		test_order(4, 20000, 1);
+		test_order(64, 20000, 2);
+		test_order(MAX_TASKS > 300 ? 300 : MAX_TASKS, 5000, 3);
+		test_capacity();
+	}
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
@@ -0,0 +1,320 @@
+/*
+    Copyright (c) 2014-2015 InvenSense Inc. Portions Copyright (c) 2014-2015 Movea. All rights reserved.
+
+    This software, related documentation and any modifications thereto (collectively "Software") is subject
+    to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+    other intellectual property rights laws.
+
+    InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+    and any use, reproduction, disclosure or distribution of the Software without an express license
+    agreement from InvenSense is strictly prohibited.
+*/
+
+/*
+	Host-side tests for RingByteBuffer and RingByteBufferSpsc.
+
+	Build and run from the sources directory with a POSIX host compiler:
+
+		cc -O2 -pthread -I. Invn/EmbUtils/test/RingByteBufferTest.c \
+			Invn/EmbUtils/RingByteBuffer.c Invn/EmbUtils/RingByteBufferSpsc.c \
+			-o RingByteBufferTest
+		./RingByteBufferTest          # functional and stress tests
+		./RingByteBufferTest bench    # SPSC throughput benchmark
+
+	Stress tests run one producer and one consumer thread on a
+	RingByteBufferSpsc and check that the byte stream received is the
+	byte stream sent, with random transfer sizes mixing byte, buffer and
+	peek/commit accesses. The program returns 0 on success.
+*/
+
+#include "Invn/EmbUtils/RingByteBuffer.h"
+#include "Invn/EmbUtils/RingByteBufferSpsc.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int nb_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			nb_failures++; \
+		} \
+	} while (0)
+
+static uint32_t lcg_next(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+
+	return *state >> 8;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/******************************************************************************/
+/* RingByteBuffer                                                             */
+/******************************************************************************/
+
+/* pushBuffer/popBuffer must behave as successive pushByte/popByte calls,
+   for every length up to the buffer size and every start position */
+static void test_ring_byte_buffer(void)
+{
+	enum { SIZE = 13 };
+	uint8_t buf[SIZE + 1], refbuf[SIZE];
+	uint8_t in[SIZE], out[SIZE + 1];
+	RingByteBuffer rb, ref;
+	uint16_t pos, len, i;
+
+	for (pos = 0; pos < SIZE; pos++) {
+		for (len = 0; len <= SIZE; len++) {
+			RingByteBuffer_init(&rb, buf, SIZE);
+			RingByteBuffer_init(&ref, refbuf, SIZE);
+			buf[SIZE] = 0xA5; /* guard byte */
+			for (i = 0; i < pos; i++) {
+				RingByteBuffer_pushByte(&rb, 0);
+				RingByteBuffer_popByte(&rb);
+				RingByteBuffer_pushByte(&ref, 0);
+				RingByteBuffer_popByte(&ref);
+			}
+			for (i = 0; i < len; i++)
+				in[i] = (uint8_t)(pos * 31 + i + 1);
+
+			RingByteBuffer_pushBuffer(&rb, in, len);
+			for (i = 0; i < len; i++)
+				RingByteBuffer_pushByte(&ref, in[i]);
+			CHECK(RingByteBuffer_size(&rb) == len);
+			CHECK(RingByteBuffer_isFull(&rb) == (len == SIZE));
+			CHECK(rb.end == ref.end && rb.msbEnd == ref.msbEnd);
+			CHECK(buf[SIZE] == 0xA5);
+
+			out[len] = 0x5A; /* guard byte */
+			RingByteBuffer_popBuffer(&rb, out, len);
+			CHECK(memcmp(in, out, len) == 0);
+			CHECK(out[len] == 0x5A);
+			CHECK(RingByteBuffer_isEmpty(&rb));
+			for (i = 0; i < len; i++)
+				RingByteBuffer_popByte(&ref);
+			CHECK(rb.start == ref.start && rb.msbStart == ref.msbStart);
+		}
+	}
+}
+
+/******************************************************************************/
+/* RingByteBufferSpsc                                                         */
+/******************************************************************************/
+
+static void test_spsc_single_thread(void)
+{
+	uint8_t buf[8], data[16], out[16];
+	const uint8_t *p;
+	RingByteBufferSpsc rb;
+	uint8_t byte;
+	uint32_t i, n;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = (uint8_t)(i + 1);
+
+	RingByteBufferSpsc_init(&rb, buf, sizeof(buf));
+	CHECK(RingByteBufferSpsc_isEmpty(&rb));
+	CHECK(!RingByteBufferSpsc_popByte(&rb, &byte));
+	CHECK(RingByteBufferSpsc_popBuffer(&rb, out, sizeof(out)) == 0);
+
+	/* push more than the buffer can hold */
+	CHECK(RingByteBufferSpsc_pushBuffer(&rb, data, sizeof(data)) == sizeof(buf));
+	CHECK(RingByteBufferSpsc_isFull(&rb));
+	CHECK(!RingByteBufferSpsc_pushByte(&rb, 0));
+
+	/* move the indexes so that the next transfers wrap around */
+	CHECK(RingByteBufferSpsc_popBuffer(&rb, out, 5) == 5);
+	CHECK(memcmp(out, data, 5) == 0);
+	CHECK(RingByteBufferSpsc_pushBuffer(&rb, data, sizeof(data)) == 5);
+	CHECK(RingByteBufferSpsc_size(&rb) == sizeof(buf));
+
+	n = RingByteBufferSpsc_peek(&rb, &p);
+	CHECK(n == 3 && memcmp(p, &data[5], 3) == 0);
+	RingByteBufferSpsc_commit(&rb, n);
+	n = RingByteBufferSpsc_peek(&rb, &p);
+	CHECK(n == 5 && memcmp(p, data, 5) == 0);
+
+	CHECK(RingByteBufferSpsc_popBuffer(&rb, out, sizeof(out)) == 5);
+	CHECK(memcmp(out, data, 5) == 0);
+	CHECK(RingByteBufferSpsc_isEmpty(&rb));
+	CHECK(RingByteBufferSpsc_available(&rb) == sizeof(buf));
+}
+
+/* largest SPSC buffer tested, transfers are up to twice as large */
+#define SPSC_MAX_SIZE 	4096
+#define SPSC_MAX_CHUNK 	(2 * SPSC_MAX_SIZE + 1)
+
+struct spsc_ctx {
+	RingByteBufferSpsc 	rb;
+	uint64_t 			total;		/* number of bytes to transfer */
+	uint32_t 			max_chunk;	/* maximum size of one transfer */
+	int 				mixed;		/* mix byte, buffer and peek/commit accesses */
+	int 				verify;		/* generate and check stream content */
+	uint64_t 			errors;
+};
+
+/* stream byte at offset i */
+static uint8_t stream_byte(uint64_t i)
+{
+	return (uint8_t)(i ^ (i >> 8) ^ (i >> 16));
+}
+
+static void * spsc_producer(void *arg)
+{
+	struct spsc_ctx *ctx = (struct spsc_ctx *)arg;
+	uint8_t chunk[SPSC_MAX_CHUNK] = { 0 };
+	uint32_t seed = 1, len, n, i;
+	uint64_t sent = 0;
+
+	while (sent < ctx->total) {
+		len = ctx->mixed ? 1 + lcg_next(&seed) % ctx->max_chunk : ctx->max_chunk;
+		if (len > ctx->total - sent)
+			len = (uint32_t)(ctx->total - sent);
+		if (ctx->verify)
+			for (i = 0; i < len; i++)
+				chunk[i] = stream_byte(sent + i);
+
+		if (ctx->mixed && (lcg_next(&seed) & 3) == 0) {
+			for (i = 0; i < len; ) {
+				if (RingByteBufferSpsc_pushByte(&ctx->rb, chunk[i]))
+					i++;
+				else
+					sched_yield();
+			}
+		} else {
+			for (i = 0; i < len; i += n) {
+				n = RingByteBufferSpsc_pushBuffer(&ctx->rb, &chunk[i], len - i);
+				if (n == 0)
+					sched_yield();
+			}
+		}
+		sent += len;
+	}
+
+	return 0;
+}
+
+static void * spsc_consumer(void *arg)
+{
+	struct spsc_ctx *ctx = (struct spsc_ctx *)arg;
+	uint8_t chunk[SPSC_MAX_CHUNK];
+	const uint8_t *p;
+	uint32_t seed = 2, len, n, i;
+	uint64_t received = 0;
+
+	while (received < ctx->total) {
+		len = ctx->mixed ? 1 + lcg_next(&seed) % ctx->max_chunk : ctx->max_chunk;
+
+		switch (ctx->mixed ? lcg_next(&seed) % 3 : 0) {
+		case 0:
+			n = RingByteBufferSpsc_popBuffer(&ctx->rb, chunk, len);
+			for (i = 0; i < n && ctx->verify; i++)
+				ctx->errors += (chunk[i] != stream_byte(received + i));
+			break;
+		case 1:
+			n = RingByteBufferSpsc_popByte(&ctx->rb, chunk) ? 1 : 0;
+			if (n)
+				ctx->errors += (chunk[0] != stream_byte(received));
+			break;
+		default:
+			n = RingByteBufferSpsc_peek(&ctx->rb, &p);
+			if (n > len)
+				n = len;
+			for (i = 0; i < n; i++)
+				ctx->errors += (p[i] != stream_byte(received + i));
+			RingByteBufferSpsc_commit(&ctx->rb, n);
+			break;
+		}
+		received += n;
+		if (n == 0)
+			sched_yield(); /* let the producer run on a single core host */
+	}
+
+	return 0;
+}
+
+/* run one producer and one consumer thread, return transfer time in s */
+static double spsc_run(struct spsc_ctx *ctx, uint8_t *buf, uint32_t size)
+{
+	pthread_t producer, consumer;
+	double t0;
+
+	RingByteBufferSpsc_init(&ctx->rb, buf, size);
+	ctx->errors = 0;
+
+	t0 = now_s();
+	pthread_create(&consumer, 0, spsc_consumer, ctx);
+	pthread_create(&producer, 0, spsc_producer, ctx);
+	pthread_join(producer, 0);
+	pthread_join(consumer, 0);
+
+	return now_s() - t0;
+}
+
+static void test_spsc_stress(void)
+{
+	static const uint32_t sizes[] = { 1, 2, 16, 256, SPSC_MAX_SIZE };
+	static uint8_t buf[SPSC_MAX_SIZE];
+	struct spsc_ctx ctx;
+	unsigned i;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		ctx.total 		= 4u << 20;
+		ctx.max_chunk 	= 2 * sizes[i] + 1;
+		ctx.mixed 		= 1;
+		ctx.verify 		= 1;
+		spsc_run(&ctx, buf, sizes[i]);
+		CHECK(ctx.errors == 0);
+		CHECK(RingByteBufferSpsc_isEmpty(&ctx.rb));
+		printf("spsc stress size=%u: %llu bytes, %llu errors\n", (unsigned)sizes[i],
+				(unsigned long long)ctx.total, (unsigned long long)ctx.errors);
+	}
+}
+
+static void bench_spsc(void)
+{
+	static const uint32_t chunks[] = { 1, 16, 64, 256, 1024 };
+	static uint8_t buf[SPSC_MAX_SIZE];
+	struct spsc_ctx ctx;
+	double t;
+	unsigned i;
+
+	for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+		ctx.total 		= 256u << 20;
+		ctx.max_chunk 	= chunks[i];
+		ctx.mixed 		= 0;
+		ctx.verify 		= 0;
+		t = spsc_run(&ctx, buf, sizeof(buf));
+		printf("spsc bench size=%u chunk=%4u: %7.1f MB/s\n", (unsigned)sizeof(buf),
+				(unsigned)chunks[i], ctx.total / t / 1e6);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+		bench_spsc();
+	} else {
+		test_ring_byte_buffer();
+		test_spsc_single_thread();
+		test_spsc_stress();
+	}
+
+	printf("%s\n", nb_failures ? "FAILED" : "PASSED");
+
+	return nb_failures ? 1 : 0;
+}
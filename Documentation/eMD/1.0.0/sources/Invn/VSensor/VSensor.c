@@ -67,37 +67,164 @@ static int setupVSensor(VSensor * vsensor)
 	return 0;
 }
 
-static struct InvList * getList(VSensorListener * listener)
+#define HEAP_RI  0
+#define HEAP_MRL 1
+
+static inline uint32_t heapKey(const VSensorListener * listener, int h)
 {
-	return &listener->vsensor->list;
+	return (h == HEAP_RI) ? listener->ri : listener->mrl;
 }
 
-static void getMinRimrl(struct InvList * list,
-		uint32_t *minri, uint32_t *minmrl)
+static inline void heapSet(VSensorListenerSet * set, int h, unsigned i, VSensorListener * listener)
 {
-	struct InvList * cur = InvList_head(list);
+	set->heap[h][i] = listener;
+	listener->hpos[h] = (uint8_t)i;
+}
 
-	if(cur == 0) {
-		*minri = 0;
-		*minmrl = 0;
+static void heapSiftUp(VSensorListenerSet * set, int h, unsigned i)
+{
+	VSensorListener * listener = set->heap[h][i];
+	const uint32_t key = heapKey(listener, h);
+
+	while(i > 0) {
+		const unsigned parent = (i - 1) / 2;
+
+		if(heapKey(set->heap[h][parent], h) <= key)
+			break;
+
+		heapSet(set, h, i, set->heap[h][parent]);
+		i = parent;
 	}
-	else {
-		const VSensorListener *listener = INVLIST_GET(cur, VSensorListener, next);
 
-		*minri = listener->ri;
-		*minmrl = listener->mrl;
+	heapSet(set, h, i, listener);
+}
 
-		while ((cur = InvList_next(cur)) != 0) {
-			const VSensorListener *listener = INVLIST_GET(cur, VSensorListener, next);
+static void heapSiftDown(VSensorListenerSet * set, int h, unsigned i, unsigned count)
+{
+	VSensorListener * listener = set->heap[h][i];
+	const uint32_t key = heapKey(listener, h);
 
-			if(listener->ri < *minri) {
-				*minri = listener->ri;
-			}
+	for(;;) {
+		unsigned child = 2 * i + 1;
 
-			if(listener->mrl < *minmrl) {
-				*minmrl = listener->mrl;
-			}
+		if(child >= count)
+			break;
+
+		if(child + 1 < count
+				&& heapKey(set->heap[h][child + 1], h) < heapKey(set->heap[h][child], h)) {
+			child += 1;
 		}
+
+		if(key <= heapKey(set->heap[h][child], h))
+			break;
+
+		heapSet(set, h, i, set->heap[h][child]);
+		i = child;
+	}
+
+	heapSet(set, h, i, listener);
+}
+
+/* to be called after count was incremented */
+static void heapInsert(VSensorListenerSet * set, int h, VSensorListener * listener)
+{
+	const unsigned i = set->count - 1;
+
+	heapSet(set, h, i, listener);
+	heapSiftUp(set, h, i);
+}
+
+/* to be called after count was decremented */
+static void heapRemove(VSensorListenerSet * set, int h, VSensorListener * listener)
+{
+	const unsigned i = listener->hpos[h];
+	VSensorListener * last = set->heap[h][set->count];
+
+	if(last != listener) {
+		heapSet(set, h, i, last);
+		heapSiftUp(set, h, i);
+		heapSiftDown(set, h, last->hpos[h], set->count);
+	}
+}
+
+static void heapUpdate(VSensorListenerSet * set, int h, VSensorListener * listener)
+{
+	heapSiftUp(set, h, listener->hpos[h]);
+	heapSiftDown(set, h, listener->hpos[h], set->count);
+}
+
+static inline int isListenerActive(const VSensorListener * listener)
+{
+	return (listener->slot != VSENSOR_LISTENER_INACTIVE);
+}
+
+/* remove holes left by listeners removed during notification, keeping subscription order */
+static void compactListeners(VSensorListenerSet * set)
+{
+	unsigned i, j = 0;
+
+	for(i = 0; i < set->nitems; ++i) {
+		if(set->item[i]) {
+			set->item[j] = set->item[i];
+			set->item[j]->slot = (uint8_t)j;
+			++j;
+		}
+	}
+
+	set->nitems = (uint8_t)j;
+}
+
+static int addListener(VSensorListenerSet * set, VSensorListener * listener)
+{
+	if(isListenerActive(listener))
+		return -1;
+
+	if(set->nitems >= VSENSOR_MAX_LISTENERS && set->notifying == 0)
+		compactListeners(set);
+
+	if(set->nitems >= VSENSOR_MAX_LISTENERS)
+		return -1;
+
+	listener->slot = set->nitems;
+	set->item[set->nitems++] = listener;
+	++set->count;
+	heapInsert(set, HEAP_RI, listener);
+	heapInsert(set, HEAP_MRL, listener);
+
+	return 0;
+}
+
+static int removeListener(VSensorListenerSet * set, VSensorListener * listener)
+{
+	if(!isListenerActive(listener))
+		return -1;
+
+	if(listener->slot + 1 == set->nitems) {
+		--set->nitems;
+	} else {
+		set->item[listener->slot] = 0;
+		if(set->notifying == 0)
+			compactListeners(set);
+	}
+
+	--set->count;
+	heapRemove(set, HEAP_RI, listener);
+	heapRemove(set, HEAP_MRL, listener);
+	listener->slot = VSENSOR_LISTENER_INACTIVE;
+
+	return 0;
+}
+
+static void getMinRimrl(const VSensorListenerSet * set,
+		uint32_t *minri, uint32_t *minmrl)
+{
+	if(set->count == 0) {
+		*minri = 0;
+		*minmrl = 0;
+	}
+	else {
+		*minri = set->heap[HEAP_RI][0]->ri;
+		*minmrl = set->heap[HEAP_MRL][0]->mrl;
 	}
 }
 
@@ -108,7 +235,7 @@ static void apply(VSensorListener * listener, int flag, int force)
 	struct VSensor * vsensor = listener->vsensor;
 
 	/* Get min RI/MRL from */
-	getMinRimrl(getList(listener), &eri, &emrl);
+	getMinRimrl(&vsensor->list, &eri, &emrl);
 
 	/* Saturate RI according to vsensor attribute */
 	if(eri < vsensor->attr.min_ri) {
@@ -198,7 +325,7 @@ int VSensorListener_attach(VSensorListener *listener, struct VSensor *vsensor,
 		VSensorListenerHandler handler, void * arg)
 {
 	if(listener && vsensor) {
-		InvList_init(&listener->next);
+		listener->slot    = VSENSOR_LISTENER_INACTIVE;
 		listener->handler = (handler != 0) ? handler : dummyHandler;
 		listener->vsensor = vsensor;
 		listener->ri      = 0;
@@ -228,7 +355,8 @@ void VSensorListener_setRi(VSensorListener *listener, uint32_t ri)
 
 	listener->ri = ri;
 
-	if(InvList_isIn(&listener->vsensor->list, &listener->next)) {
+	if(isListenerActive(listener)) {
+		heapUpdate(&listener->vsensor->list, HEAP_RI, listener);
 		apply(listener, 0, (1 << EVENT_UPDATERI));
 	}
 }
@@ -240,27 +368,31 @@ void VSensorListener_setMrl(VSensorListener *listener, uint32_t mrl)
 
 	listener->mrl = mrl;
 
-	if(InvList_isIn(&listener->vsensor->list, &listener->next)) {
+	if(isListenerActive(listener)) {
+		heapUpdate(&listener->vsensor->list, HEAP_MRL, listener);
 		apply(listener, 0, (1 << EVENT_UPDATEMRL));
 	}
 }
 
-void VSensorListener_enable(VSensorListener *listener)
+int VSensorListener_enable(VSensorListener *listener)
 {
 	int  flag = 0;
 
 	if(!isListenerValid(listener))
-		return;
+		return -1;
 
-	if(InvList_isEmpty(&listener->vsensor->list))
+	if(listener->vsensor->list.count == 0)
 		flag |= (1 << VSENSOR_EVENT_SUBSCRIBE);
 
-	if(InvList_add(&listener->vsensor->list, &listener->next) == 0) {
-		/* notify this listener it has successfuly subscribed to the vsensor */
-		listener->handler(listener, VSENSOR_EVENT_HAS_SUBSCRIBED, 0);
+	if(addListener(&listener->vsensor->list, listener) != 0)
+		return -1;
 
-		apply(listener, flag, (1 << EVENT_UPDATERI) | (1 << EVENT_UPDATEMRL));
-	}
+	/* notify this listener it has successfuly subscribed to the vsensor */
+	listener->handler(listener, VSENSOR_EVENT_HAS_SUBSCRIBED, 0);
+
+	apply(listener, flag, (1 << EVENT_UPDATERI) | (1 << EVENT_UPDATEMRL));
+
+	return 0;
 }
 
 void VSensorListener_disable(VSensorListener *listener)
@@ -268,17 +400,17 @@ void VSensorListener_disable(VSensorListener *listener)
 	if(!isListenerValid(listener))
 		return;
 
-	if(InvList_remove(&listener->vsensor->list, &listener->next) == 0) {
-		if(InvList_isEmpty(&listener->vsensor->list)) {
+	if(removeListener(&listener->vsensor->list, listener) == 0) {
+		if(listener->vsensor->list.count == 0) {
 			apply(listener, (1 << VSENSOR_EVENT_UNSUBSCRIBE), 0);
 
 			/*
 			 * Add node back to list and apply update:
 			 * this allows to call VSensorListener_notify() when handling UNSUBSCRIBE event
 			 */
-			InvList_add(&listener->vsensor->list, &listener->next);
+			addListener(&listener->vsensor->list, listener);
 			VSensor_update(listener->vsensor, VSENSOR_EVENT_UNSUBSCRIBE, 0);
-			InvList_remove(&listener->vsensor->list, &listener->next);
+			removeListener(&listener->vsensor->list, listener);
 		}
 		else {
 			apply(listener, 0, 0);
@@ -308,13 +440,22 @@ void VSensor_init(VSensor * vsensor, VSensorUpdateCb update,
 
 void VSensor_notifyEvent(VSensor *vsensor, int event, const void * data)
 {
-	struct InvList *cur = InvList_head(&vsensor->list);
+	VSensorListenerSet * set = &vsensor->list;
+	unsigned i;
+
+	/* a handler may (un)subscribe listeners: removed ones leave a hole until we are done
+	   and nitems is re-read on each iteration so that new ones are notified */
+	++set->notifying;
+
+	for(i = 0; i < set->nitems; ++i) {
+		VSensorListener * listener = set->item[i];
 
-	while (cur != 0) {
-		VSensorListener *listener = INVLIST_GET(cur, VSensorListener, next);
-		listener->handler(listener, event, data);
-		cur = InvList_next(cur);
+		if(listener)
+			listener->handler(listener, event, data);
 	}
+
+	if(--set->notifying == 0 && set->nitems != set->count)
+		compactListeners(set);
 }
 
 
@@ -322,14 +463,15 @@ static void vsensorSmartListenerHandler(struct VSensorListener * listener, int e
 {
 	struct VSensorSmartListener * smartlistener = (struct VSensorSmartListener *)listener;
 	const void * new_data;
-	int result, icount = 0;
+	int result;
 
+	/* recall decimator until it is done with data (eg: block split over several notifications) */
 	do {
 		result = smartlistener->decimator(smartlistener, event, data, &new_data);
 		if(result) {
 			smartlistener->handler(listener, event, new_data);
 		}
-	} while(result > 1 && ++icount < 10);
+	} while(result > 1);
 }
 
 int VSensorSmartListener_attach(VSensorSmartListener * listener, struct VSensor * vsensor,
@@ -376,6 +518,31 @@ int VSensorSmartListenerRIR_decimator(struct VSensorSmartListener * smartlistene
 		rir->cnt = 0;
 		break;
 
+	case VSENSOR_EVENT_NEW_DATA_BLOCK:
+	{
+		/* same as NEW_DATA applied to each sample:
+		   sample i is kept if cnt + i + 1 >= rate, and every rate samples after that */
+		const VSensorDataBlock * block = (const VSensorDataBlock *)data;
+		const uint32_t step = (rir->rate > 1) ? rir->rate : 1;
+		const uint32_t first = (rir->rate > rir->cnt + 1) ? (rir->rate - rir->cnt - 1) : 0;
+		uint32_t kept;
+
+		if(first >= block->count) {
+			/* drop all data */
+			rir->cnt += block->count;
+			return 0;
+		}
+
+		kept = (block->count - 1 - first) / step + 1;
+		rir->cnt = block->count - 1 - (first + (kept - 1) * step);
+
+		rir->block.data   = VSensorDataBlock_get(block, first);
+		rir->block.count  = kept;
+		rir->block.stride = block->stride * step;
+		*new_data = &rir->block;
+		return 1;
+	}
+
 	default:
 		break;
 	}
@@ -392,3 +559,160 @@ int VSensorSmartListenerRIR_attach(VSensorSmartListenerRIR * listener, struct VS
 
 	return VSensorSmartListener_attach(&listener->base, vsensor, handler, arg, VSensorSmartListenerRIR_decimator);
 }
+
+static void cicReset(VSensorSmartListenerCIC * cic)
+{
+	unsigned i;
+
+	cic->phase = 0;
+	cic->resume_data = 0;
+	cic->resume_idx = 0;
+	memset(cic->integ, 0, sizeof(cic->integ));
+	memset(cic->comb, 0, sizeof(cic->comb));
+
+	cic->gain = 1;
+	for(i = 0; i < cic->order; ++i) {
+		cic->gain *= cic->base.rate;
+	}
+}
+
+static void cicIntegrate(VSensorSmartListenerCIC * cic, const uint8_t * in)
+{
+	unsigned c, k;
+
+	for(c = 0; c < cic->nchannels; ++c) {
+		int32_t x;
+
+		memcpy(&x, in + cic->offset + c * sizeof(int32_t), sizeof(x));
+		cic->integ[0][c] += (uint64_t)(int64_t)x;
+		for(k = 1; k < cic->order; ++k) {
+			cic->integ[k][c] += cic->integ[k-1][c];
+		}
+	}
+}
+
+static void cicComb(VSensorSmartListenerCIC * cic, const uint8_t * in, uint8_t * out, unsigned sdata)
+{
+	unsigned c, k;
+
+	memcpy(out, in, sdata);
+
+	for(c = 0; c < cic->nchannels; ++c) {
+		uint64_t y = cic->integ[cic->order-1][c];
+		int32_t x;
+
+		for(k = 0; k < cic->order; ++k) {
+			const uint64_t t = y - cic->comb[k][c];
+			cic->comb[k][c] = y;
+			y = t;
+		}
+		/* wrap-around cancels out: y is the exact sum, within int64_t range */
+		x = (int32_t)((int64_t)y / cic->gain);
+		memcpy(out + cic->offset + c * sizeof(int32_t), &x, sizeof(x));
+	}
+}
+
+int VSensorSmartListenerCIC_decimator(struct VSensorSmartListener * smartlistener, int event,
+		const void * data, const void ** new_data)
+{
+	struct VSensorSmartListenerCIC * cic = (struct VSensorSmartListenerCIC *)smartlistener;
+	const unsigned sdata = VSensor_getDataSize(smartlistener->base.vsensor);
+	VSensorDataBlock single;
+	const VSensorDataBlock * block;
+	uint8_t * out = (uint8_t *)cic->out;
+	uint32_t i, nout = 0;
+
+	switch(event) {
+	case VSENSOR_EVENT_NEW_EFFECTIVE_RI:
+	{
+		const int rc = VSensorSmartListenerRIR_decimator(smartlistener, event, data, new_data);
+		cicReset(cic);
+		return rc;
+	}
+
+	case VSENSOR_EVENT_NEW_DATA:
+		single.data   = data;
+		single.count  = 1;
+		single.stride = sdata;
+		block = &single;
+		break;
+
+	case VSENSOR_EVENT_NEW_DATA_BLOCK:
+		block = (const VSensorDataBlock *)data;
+		break;
+
+	default:
+		*new_data = data;
+		return 1;
+	}
+
+	if(cic->base.rate <= 1) {
+		/* nothing to filter */
+		*new_data = data;
+		return 1;
+	}
+
+	/* resume processing of a block if decimator is recalled for the same block */
+	i = (cic->resume_data == block->data) ? cic->resume_idx : 0;
+	cic->resume_data = 0;
+
+	for(; i < block->count; ++i) {
+		const uint8_t * in = (const uint8_t *)VSensorDataBlock_get(block, i);
+
+		cicIntegrate(cic, in);
+
+		if(++cic->phase >= cic->base.rate) {
+			cic->phase = 0;
+			cicComb(cic, in, &out[nout * sdata], sdata);
+			if(++nout == cic->out_size) {
+				++i;
+				break;
+			}
+		}
+	}
+
+	if(nout == 0) {
+		/* drop data */
+		return 0;
+	}
+
+	if(event == VSENSOR_EVENT_NEW_DATA) {
+		*new_data = out;
+		return 1;
+	}
+
+	cic->base.block.data   = out;
+	cic->base.block.count  = nout;
+	cic->base.block.stride = sdata;
+	*new_data = &cic->base.block;
+
+	if(i < block->count) {
+		/* output buffer is full, recall decimator */
+		cic->resume_data = block->data;
+		cic->resume_idx  = i;
+		return 2;
+	}
+
+	return 1;
+}
+
+int VSensorSmartListenerCIC_attach(VSensorSmartListenerCIC * listener, struct VSensor * vsensor,
+		VSensorListenerHandler handler, void * arg, unsigned offset, unsigned nchannels,
+		unsigned order, void * out, unsigned out_size)
+{
+	ASSERT(nchannels <= VSENSOR_SMARTLISTENER_CIC_MAX_CHANNELS);
+	ASSERT(order >= 1 && order <= VSENSOR_SMARTLISTENER_CIC_MAX_ORDER);
+	ASSERT(out && out_size >= 1);
+
+	listener->base.cnt  = 0;
+	listener->base.rate = 0;
+	listener->offset    = offset;
+	listener->nchannels = nchannels;
+	listener->order     = order;
+	listener->out       = out;
+	listener->out_size  = out_size;
+	cicReset(listener);
+
+	return VSensorSmartListener_attach(&listener->base.base, vsensor, handler, arg,
+			VSensorSmartListenerCIC_decimator);
+}
@@ -45,7 +45,7 @@ extern "C" {
 
 #include <stdint.h>
 
-#include "Invn/EmbUtils/InvList.h"
+#include "Invn/EmbUtils/InvAssert.h"
 
 #include "Invn/VSensor/VSensorType.h"
 #include "Invn/VSensor/VSensorSmartListener.h"
@@ -75,6 +75,30 @@ typedef struct VSensorAttr {
   #define VSENSOR_ATTR_MAX_RI_DEFAULT 1000000 /* 1s */
 #endif
 
+#ifndef VSENSOR_MAX_LISTENERS
+  /** @brief Maximum number of listeners that can subscribe to one VSensor at a time
+   *  Each VSensor reserves 3 pointers per listener. VSensorListener_enable() fails
+   *  once the limit is reached. Must be lower than 255
+   */
+  #define VSENSOR_MAX_LISTENERS 32
+#endif
+
+/** @brief Set of listeners subscribed to a VSensor
+ *
+ *  Listeners are kept in an array in subscription order for fast notification.
+ *  A listener removed while events are being notified leaves a hole (NULL entry)
+ *  in the array, which is compacted once notification is over.
+ *  Two min-heaps (keyed on requested RI and MRL) are maintained incrementally so that
+ *  effective RI/MRL are available in constant time after any listener reconfiguration.
+ */
+typedef struct VSensorListenerSet {
+	struct VSensorListener * item[VSENSOR_MAX_LISTENERS];    /**< subscribed listeners */
+	struct VSensorListener * heap[2][VSENSOR_MAX_LISTENERS]; /**< RI and MRL min-heaps */
+	uint8_t                  count;                          /**< number of subscribed listeners */
+	uint8_t                  nitems;                         /**< number of used entries in item (including holes) */
+	uint8_t                  notifying;                      /**< nesting level of VSensor_notifyEvent() */
+} VSensorListenerSet;
+
 /** @brief VSensor status flags
  */
 enum VSensorStatusFlag {
@@ -101,7 +125,7 @@ typedef int (*VSensorUpdateCb)(struct VSensor * vsensor, int event, void * data)
  */
 typedef struct VSensor {
 	VSensorUpdateCb update; /**< virtual update function */
-	InvList 	    list;   /**< pointer to list of subscribers to current publisher*/
+	VSensorListenerSet list; /**< set of subscribers to current publisher*/
 	int16_t         type;   /**< type of data published by the sensor */
 	uint16_t        sdata;  /**< size of data published by the sensor */
 	uint32_t 	    eri;    /**< effective report interval */
@@ -182,6 +206,15 @@ static inline int VSensor_update(VSensor * vsensor, int event, void * data)
 	return vsensor->update(vsensor, event, data);
 }
 
+/** @brief Return number of listeners currently subscribed to a VSensor
+ *  @param[in] vsensor the VSensor
+ *  @return    number of active listeners
+ */
+static inline unsigned VSensor_getListenerCount(const VSensor * vsensor)
+{
+	return vsensor->list.count;
+}
+
 /** @brief Notify active listeners of a VSensor of a new event
  *  @param[in] vsensor the VSensor
  *  @param[in] event   event type
@@ -200,6 +233,21 @@ static inline void VSensor_notifyData(VSensor * vsensor, const void * data)
 	VSensor_notifyEvent(vsensor, VSENSOR_EVENT_NEW_DATA, data);
 }
 
+/** @brief Notify active listeners of a VSensor of several new data at once
+ *  @param[in] vsensor the VSensor
+ *  @param[in] data    first (oldest) VSensor data
+ *  @param[in] count   number of samples
+ *  @param[in] stride  distance in bytes between two consecutive samples
+ *  @return    none
+ */
+static inline void VSensor_notifyDataBlock(VSensor * vsensor, const void * data,
+		unsigned count, unsigned stride)
+{
+	const VSensorDataBlock block = { data, count, stride };
+
+	VSensor_notifyEvent(vsensor, VSENSOR_EVENT_NEW_DATA_BLOCK, &block);
+}
+
 /** @brief Retrieve last data from a VSsensor
  *  @param[in]  vsensor the VSensor
  *  @param[out] data    last VSensor data
@@ -101,6 +101,27 @@ typedef struct VSensorDataAny {
  */
 #define VSENSOR_DATA_SIZE_MAX (sizeof(VSensorDataAny))
 
+/** @brief Block of VSensor data
+ *
+ *  Upon NEW_DATA_BLOCK event, event data are expected to point to a VSensorDataBlock.
+ *  Sample i is located at address (const uint8_t *)data + i * stride.
+ */
+typedef struct VSensorDataBlock {
+	const void * data;      /**< reference to first (oldest) sample */
+	uint32_t     count;     /**< number of samples in the block */
+	uint32_t     stride;    /**< distance in bytes between two consecutive samples */
+} VSensorDataBlock;
+
+/** @brief Helper function to get reference to a sample from a VSensor data block
+ *  @param[in] block the VSensorDataBlock
+ *  @param[in] i     sample index
+ *  @return    reference to i-th sample
+ */
+static inline const void * VSensorDataBlock_get(const VSensorDataBlock * block, unsigned i)
+{
+	return (const uint8_t *)block->data + i * block->stride;
+}
+
 /** @brief Data for RAW_ACCELEROMETER, RAW_MAGNETOMETER, RAW_GYROMETER VSensor
  */
 typedef struct VSensorDataRaw3d {
@@ -199,6 +199,20 @@ extern "C" {
  */
 #define VSENSOR_EVENT_FLUSH_COMPLETE    9
 
+/** @brief Raised when a VSensor notifies of several new data at once
+ *
+ *  Expected event data: block of VSensor data (passed as VSensorDataBlock *)
+ *
+ *  Publishing by block is opt-in for VSensor implementations (see VSensor_notifyDataBlock()):
+ *  no VSensor provided with this package does so. Listeners attached to such a VSensor
+ *  must handle this event in addition to VSENSOR_EVENT_NEW_DATA.
+ *
+ *  Samples in the block are ordered from oldest to youngest.
+ *  A VSensor publishing data by block will never notify VSENSOR_EVENT_NEW_DATA
+ *  for the same samples.
+ */
+#define VSENSOR_EVENT_NEW_DATA_BLOCK    10
+
 /*
  * Custom event definition boundaries
  */
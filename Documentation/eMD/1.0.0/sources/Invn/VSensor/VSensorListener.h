@@ -43,8 +43,6 @@ extern "C" {
 
 #include <stdint.h>
 
-#include "Invn/EmbUtils/InvList.h"
-
 /*
  * Forward declaration
  */
@@ -63,10 +61,15 @@ struct VSensorListener;
 typedef void (*VSensorListenerHandler)(struct VSensorListener * listener,
 		int event, const void * data);
 
+/** @brief Value of VSensorListener slot field when listener is not subscribed
+ */
+#define VSENSOR_LISTENER_INACTIVE 0xFF
+
 /** @brief VSensorListener states
  */
 typedef struct VSensorListener {
-	InvList                next;    /**< pointer to next listener */
+	uint8_t                slot;    /**< index in VSensor listener array (VSENSOR_LISTENER_INACTIVE if not subscribed) */
+	uint8_t                hpos[2]; /**< position in VSensor RI and MRL min-heaps */
 	VSensorListenerHandler handler; /**< event handler */
 	struct VSensor *       vsensor; /**< reference to VSensor a listener is attach to */
 	uint32_t               ri;      /**< requested report interval */
@@ -124,9 +127,10 @@ void VSensorListener_setMrl(VSensorListener *listener, uint32_t mrl);
  *  Start receiving events from a VSensor
  *
  *  @param[in] listener the VSensorListener
- *	@return none
+ *	@return 0 on success, negative value if listener is invalid, already subscribed
+ *	        or if VSENSOR_MAX_LISTENERS is reached
  */
-void VSensorListener_enable(VSensorListener *listener);
+int VSensorListener_enable(VSensorListener *listener);
 
 /** @brief Unsubscribe from he VSensor
  *
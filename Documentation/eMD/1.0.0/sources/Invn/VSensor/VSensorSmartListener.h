@@ -40,6 +40,7 @@ extern "C" {
 #include <stdbool.h>
 
 #include "Invn/VSensor/VSensorListener.h"
+#include "Invn/VSensor/VSensorData.h"
 
 /*
  * Forward declaration
@@ -59,7 +60,8 @@ struct VSensorSmartListener;
  *  data pointer can simply be copied to new_data pointer.
  
  *  If returned value is 1, (updated) data is notify (user handler is called).
- *  If returned is >1, the decimator is called again with the same argument (this permits to duplicate data).
+ *  If returned is >1, the decimator is called again with the same argument (this permits to duplicate data),
+ *  until it returns 0 or 1: the decimator must eventually do so.
  *  If returned value is 0, data is drop.
  *
  *  @param[in] smartlistener handle to smart listener receiving the event
@@ -111,11 +113,16 @@ int VSensorSmartListener_attach(VSensorSmartListener * listener, struct VSensor
  * The ERI/RI ratio is computed using unsigned integer. Value will be rounded down.
  *
  * The next VSENSOR_EVENT_NEW_DATA received after handling VSENSOR_EVENT_NEW_EFFECTIVE_RI will be forwarded.
+ *
+ * Upon VSENSOR_EVENT_NEW_DATA_BLOCK, kept samples are selected by stride arithmetic and
+ * forwarded as a single VSENSOR_EVENT_NEW_DATA_BLOCK referencing the original samples
+ * (no copy and no per-sample call).
  */
 typedef struct VSensorSmartListenerRIR {
 	struct VSensorSmartListener base; /**< base VSensorSmartListener object */
 	uint32_t cnt;                     /**< internal sample counter */
 	uint32_t rate;                    /**< RIR value */
+	VSensorDataBlock block;           /**< decimated block notified upon NEW_DATA_BLOCK event */
 } VSensorSmartListenerRIR;
 
 /** @brief Helper function to retrieve base VSensorListener object
@@ -145,6 +152,84 @@ int VSensorSmartListenerRIR_attach(struct VSensorSmartListenerRIR * listener, st
 int VSensorSmartListenerRIR_decimator(struct VSensorSmartListener * smartlistener, int event,
 		const void * data, const void ** new_data);
 
+/** @brief Maximum number of channels filtered by VSensorSmartListenerCIC
+ */
+#ifndef VSENSOR_SMARTLISTENER_CIC_MAX_CHANNELS
+	#define VSENSOR_SMARTLISTENER_CIC_MAX_CHANNELS 3
+#endif
+
+/** @brief Maximum order of the VSensorSmartListenerCIC filter
+ */
+#ifndef VSENSOR_SMARTLISTENER_CIC_MAX_ORDER
+	#define VSENSOR_SMARTLISTENER_CIC_MAX_ORDER    3
+#endif
+
+/** @brief Anti-aliasing Report Interval Ratio decimator
+ *
+ * Same decimation ratio as VSensorSmartListenerRIR, but instead of dropping samples, a
+ * Cascaded Integrator-Comb (CIC) filter of order N is applied to a set of consecutive
+ * int32_t channels of the VSensor data (eg: x, y, z fields of VSensorDataRaw3d).
+ * Order 1 is a plain average over the RIR samples. Filter gain is compensated.
+ * Other fields of the notified sample (timestamp, meta data, ...) are copied from the last
+ * input sample of the decimation window.
+ *
+ * Output samples are written to a user provided buffer. Upon VSENSOR_EVENT_NEW_DATA_BLOCK,
+ * all output samples computed from the received block are notified as one
+ * VSENSOR_EVENT_NEW_DATA_BLOCK. If the output buffer gets full, decimator is recalled
+ * to process the remaining of the input block.
+ *
+ * Filter states are reset upon VSENSOR_EVENT_NEW_EFFECTIVE_RI.
+ * Integrators wrap around (modulo 2^64) as in any CIC implementation: comb outputs are
+ * exact as long as RIR ^ order is lower than 2^32.
+ */
+typedef struct VSensorSmartListenerCIC {
+	struct VSensorSmartListenerRIR base; /**< base VSensorSmartListenerRIR object */
+	uint16_t offset;                     /**< offset in bytes of first channel in VSensor data */
+	uint8_t  nchannels;                  /**< number of int32_t channels to filter */
+	uint8_t  order;                      /**< filter order */
+	void *   out;                        /**< output buffer */
+	uint32_t out_size;                   /**< output buffer size in number of VSensor data */
+	uint32_t phase;                      /**< number of input samples in current window */
+	int64_t  gain;                       /**< filter gain (RIR ^ order) */
+	const void * resume_data;            /**< input block being processed */
+	uint32_t resume_idx;                 /**< index of next sample to process in input block */
+	uint64_t integ[VSENSOR_SMARTLISTENER_CIC_MAX_ORDER][VSENSOR_SMARTLISTENER_CIC_MAX_CHANNELS]; /**< integrators (modulo 2^64) */
+	uint64_t comb[VSENSOR_SMARTLISTENER_CIC_MAX_ORDER][VSENSOR_SMARTLISTENER_CIC_MAX_CHANNELS];  /**< comb delays (modulo 2^64) */
+} VSensorSmartListenerCIC;
+
+/** @brief Helper function to retrieve base VSensorListener object
+ *  @return handle to parent VSensorListener object
+ */
+static inline VSensorListener * VSensorSmartListenerCIC_getBase(VSensorSmartListenerCIC * l)
+{
+	return VSensorSmartListenerRIR_getBase(&l->base);
+}
+
+/** @brief Initialize CIC VSensorListener
+ *  Will utltimately call VSensorListener_attach() with the same argument
+ *  @param[in] listener  the VSensorSmartListenerCIC
+ *  @param[in] vsensor   reference to the VSensor the listener connects to
+ *  @param[in] handler   handler to be called upon new event send by the VSensor
+ *  @param[in] arg       cookie passed to listener object
+ *  @param[in] offset    offset in bytes of first int32_t channel in VSensor data
+ *  @param[in] nchannels number of consecutive int32_t channels to filter
+ *  @param[in] order     filter order (1 to VSENSOR_SMARTLISTENER_CIC_MAX_ORDER)
+ *  @param[in] out       output buffer (must be able to hold out_size VSensor data)
+ *  @param[in] out_size  output buffer size in number of VSensor data (at least 1)
+ *  @return underlying VSensorListener_attach() return value
+ */
+int VSensorSmartListenerCIC_attach(struct VSensorSmartListenerCIC * listener, struct VSensor * vsensor,
+		VSensorListenerHandler handler, void * arg, unsigned offset, unsigned nchannels,
+		unsigned order, void * out, unsigned out_size);
+
+/** @brief Decimator function called internaly by VSensorSmartListenerCIC object upon event
+ *
+ *  This function is exported only to reuse the internal logic in case a enhanced SmartListener need to be built.
+ *  User does not need to call it explicitly when using VSensorSmartListenerCIC in a normal way.
+ */
+int VSensorSmartListenerCIC_decimator(struct VSensorSmartListener * smartlistener, int event,
+		const void * data, const void ** new_data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,174 +26,104 @@
 #include "stm32f4xx.h"
 #include "stm32f4xx_flash.h"
 
-#define FLASH_SECTOR		FLASH_Sector_1
-#define FLASH_DATA_SIZE		84
-#define FLASH_HEADER_SIZE	4
-#define FLASH_HEADER		0x0A0B0B0A
+#include <string.h>
+
+/* First sector of the reserved area (0x08004000) */
+#define FLASH_FIRST_SECTOR	FLASH_Sector_1
+#define FLASH_SECTOR_STEP	(FLASH_Sector_2 - FLASH_Sector_1)
+
+/* Words are programmed at once with a 2.7V to 3.6V supply.
+   Define FLASH_LOW_VOLTAGE for a 1.8V to 2.1V supply, words are then programmed byte by byte */
+#ifdef FLASH_LOW_VOLTAGE
+	#define FLASH_VOLTAGE_RANGE	VoltageRange_1
+#else
+	#define FLASH_VOLTAGE_RANGE	VoltageRange_3
+#endif
 
 static uint32_t* start_sector_address;
 static uint32_t* end_sector_address;
 
-typedef enum flash_manager_status
-{
-	FLASH_MANAGER_STATUS_NOERROR = 0,
-	FLASH_MANAGER_STATUS_EMPTY,
-	FLASH_MANAGER_STATUS_FULL,
-	FLASH_MANAGER_STATUS_ERASE_ERROR,
-	FLASH_MANAGER_STATUS_WRITE_ERROR
-} flash_manager_status;
-
-static flash_manager_status flash_manager_getEmptySlotAddr(uint32_t * pAddress)
-{
-	uint32_t addr = (uint32_t)(start_sector_address);
-	
-	/* Check page address starting from begining */
-	while (addr <= (uint32_t)(end_sector_address) - (FLASH_DATA_SIZE + FLASH_HEADER_SIZE))
-	{
-		/* Verify if address contents are 0xFFFFFFFF */
-		if ((*(volatile uint32_t*)addr) == 0xFFFFFFFF)
-		{
-			*pAddress = addr;
-			return FLASH_MANAGER_STATUS_NOERROR;
-		}
-		else
-		{
-			/* Next block address location */
-			addr = addr + FLASH_DATA_SIZE + FLASH_HEADER_SIZE;
-		}
-	}
-	return FLASH_MANAGER_STATUS_FULL;
-}
+static NvStoreFlash nv_flash;
 
-static flash_manager_status flash_manager_eraseUnsafe(void)
+static int flash_manager_read(void * context, uint32_t offset, void * data, uint32_t len)
 {
-	/* Clear pending flags (if any) */  
-	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | 
-			  FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR|FLASH_FLAG_PGSERR); 
+	(void)context;
 
-	/* Device voltage range supposed to be [1.8V to 2.1V], the operation will
-	   be done by byte */ 
-	if (FLASH_EraseSector(FLASH_SECTOR, VoltageRange_1) != FLASH_COMPLETE)
-	{
-		/* Erase sector error */
-		return FLASH_MANAGER_STATUS_ERASE_ERROR;
-	}
-	return FLASH_MANAGER_STATUS_NOERROR;
-}
+	/* FLASH is memory mapped */
+	memcpy(data, (const uint8_t *)start_sector_address + offset, len);
 
-/** Public functions **/
+	return 0;
+}
 
-int flash_manager_eraseData(void)
+static int flash_manager_program(void * context, uint32_t offset, const uint32_t * words, uint32_t nbWords)
 {
-	flash_manager_status status;
-	
+	uint32_t address = (uint32_t)(start_sector_address) + offset;
+	FLASH_Status FlashStatus = FLASH_COMPLETE;
+	uint32_t i;
+#ifdef FLASH_LOW_VOLTAGE
+	uint32_t j;
+#endif
+
+	(void)context;
+
 	/* Unlock the Flash */
 	/* Enable the flash control register access */
 	FLASH_Unlock();
-	
-	status = flash_manager_eraseUnsafe();
-	
-	/* Lock the Flash to disable the flash control register access (recommended
-	to protect the FLASH memory against possible unwanted operation) */
-	FLASH_Lock();
 
-	return status;
-}
+	/* Clear pending flags (if any) */
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+			  FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR|FLASH_FLAG_PGSERR);
 
-int flash_manager_readData(uint8_t* pData)
-{
-	uint8_t i;
-	uint32_t address;
-	uint32_t header;
-	uint8_t readStatus = 0;
-	
-	/* Get the valid Page end address */
-	address = (uint32_t)(end_sector_address);
-	
-	/* Check each active page address starting from end */
-	while (address > (uint32_t)(start_sector_address))
+	for(i = 0; i < nbWords && FlashStatus == FLASH_COMPLETE; i++)
 	{
-		/* Get the header to delimitate context data */
-		header = (*(volatile uint32_t*)address);
-		
-		/* Compare the read header */
-		if (header == FLASH_HEADER)
-		{
-			address = address - FLASH_DATA_SIZE;
-			/* Get content of data in the correct order */
-			for(i = 0; i < FLASH_DATA_SIZE; i++)
-			{
-				pData[i] = (*(volatile uint8_t*)(address));
-				address ++;
-			}
-			readStatus = 1;
-			break;
-		}
-		else
-		{
-			address = address - sizeof(uint8_t);
-		}
+#ifdef FLASH_LOW_VOLTAGE
+		for(j = 0; j < sizeof(uint32_t) && FlashStatus == FLASH_COMPLETE; j++)
+			FlashStatus = FLASH_ProgramByte(address + j, ((const uint8_t *)&words[i])[j]);
+#else
+		FlashStatus = FLASH_ProgramWord(address, words[i]);
+#endif
+		address += sizeof(uint32_t);
 	}
-	if(readStatus)
-		return FLASH_MANAGER_STATUS_NOERROR;
-	else
-		return FLASH_MANAGER_STATUS_EMPTY;
+
+	/* Lock the Flash to disable the flash control register access (recommended
+	to protect the FLASH memory against possible unwanted operation) */
+	FLASH_Lock();
+
+	return (FlashStatus == FLASH_COMPLETE) ? 0 : -1;
 }
 
-int flash_manager_writeData(const uint8_t* pData)
+static int flash_manager_erase(void * context, uint8_t sector)
 {
-	uint32_t i;
 	FLASH_Status FlashStatus;
-	uint32_t address = (uint32_t)(start_sector_address);
-	static const uint8_t cFlashHeader[4] = {0xA, 0xB, 0xB, 0xA};
 
-	/* Unlock the Flash *********************************************************/
-	/* Enable the flash control register access */
+	(void)context;
+
 	FLASH_Unlock();
 
-	 /* Get the next empty address to write data */
-	if(flash_manager_getEmptySlotAddr(&address) == FLASH_MANAGER_STATUS_FULL)
-	{
-		/* Erase the Flash area */
-		flash_manager_eraseUnsafe();
+	/* Clear pending flags (if any) */  
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | 
+			  FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR|FLASH_FLAG_PGSERR); 
 
-		/* Get the start Address */
-		address = (uint32_t)(start_sector_address);
-	}
-	
-	/* Program the Flash area byte by byte */
-	for(i = 0; i < FLASH_DATA_SIZE; i++)
-	{
-		FlashStatus = FLASH_ProgramByte(address, pData[i]);
-		/* If program operation was failed, a Flash error code is returned */
-		if (FlashStatus != FLASH_COMPLETE)
-		{
-			/* Flash write operation error */
-			FLASH_Lock();
-			return FLASH_MANAGER_STATUS_WRITE_ERROR;
-		}
-		address++;
-	}
-	
-	/* Program the header */
-	for(i = 0; i < FLASH_HEADER_SIZE; i++)
-	{
-		FlashStatus = FLASH_ProgramByte(address, cFlashHeader[i]);
-		/* If program operation was failed, a Flash error code is returned */
-		if (FlashStatus != FLASH_COMPLETE)
-		{
-			/* Flash write operation error */
-			FLASH_Lock();
-			return FLASH_MANAGER_STATUS_WRITE_ERROR;
-		}
-		address++;
-	}
-	
-	/* Lock the Flash to disable the flash control register access (recommended
-	to protect the FLASH memory against possible unwanted operation) ****************/
-	FLASH_Lock(); 
-	
-	return FLASH_MANAGER_STATUS_NOERROR;
+	FlashStatus = FLASH_EraseSector(FLASH_FIRST_SECTOR + sector * FLASH_SECTOR_STEP, FLASH_VOLTAGE_RANGE);
+
+	FLASH_Lock();
+
+	return (FlashStatus == FLASH_COMPLETE) ? 0 : -1;
+}
+
+/** Public functions **/
+
+const NvStoreFlash * flash_manager_getNvFlash(void)
+{
+	nv_flash.context = 0;
+	nv_flash.sectorSize = FLASH_MANAGER_SECTOR_SIZE;
+	nv_flash.nbSectors = (uint8_t)(((uint32_t)(end_sector_address) + 1 - (uint32_t)(start_sector_address))
+			/ FLASH_MANAGER_SECTOR_SIZE);
+	nv_flash.read = flash_manager_read;
+	nv_flash.program = flash_manager_program;
+	nv_flash.erase = flash_manager_erase;
+
+	return &nv_flash;
 }
 
 uint32_t** flash_manager_get_start_sector_address(void)
@@ -204,4 +134,4 @@ uint32_t** flash_manager_get_start_sector_address(void)
 uint32_t** flash_manager_get_end_sector_address(void)
 {
 	return &end_sector_address;
-}
\ No newline at end of file
+}
@@ -26,25 +26,20 @@
 
 #include <stdint.h>
 
-/**
-  * @brief	Erase a FLASH sector
-  * @return	0 if read succeeds, flash_status otherwise
-  */
-int flash_manager_eraseData(void);
+#include "Invn/EmbUtils/NvStore.h"
 
-/**
-  * @brief	Read data from the FLASH sector
-  * @param	pData, pointer on 84 bytes buffer of data
-  * @return	0 if read succeeds, flash_status otherwise
+/** @brief Size of a FLASH sector of the reserved area
   */
-int flash_manager_readData(uint8_t* pData);
+#define FLASH_MANAGER_SECTOR_SIZE	0x4000
 
 /**
-  * @brief	Write data to the FLASH sector
-  * @param	pData, pointer on 84 bytes buffer of data
-  * @return	0 if write succeeds, flash_status otherwise
+  * @brief	Get flash access hooks for the reserved area, to be given to NvStore_init()
+  * The reserved area is split in FLASH_MANAGER_SECTOR_SIZE sectors, it must be at least
+  * 2 sectors long for records to be moved from one sector to the other.
+  * Must be called after flash_linker_init().
+  * @return	pointer on flash access hooks
   */
-int flash_manager_writeData(const uint8_t* pData);
+const NvStoreFlash * flash_manager_getNvFlash(void);
 
 /**
   * @brief	Get the start address of the FLASH sector reserved
@@ -38,7 +38,10 @@
 
 #include "Invn/EmbUtils/Message.h"
 #include "Invn/EmbUtils/DataConverter.h"
+#include "Invn/EmbUtils/NvStore.h"
+#include "Invn/EmbUtils/InvScheduler.h"
 #include "Invn/Devices/DeviceIcm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948BiasTracker.h"
 #include "Invn/DynamicProtocol/DynProtocol.h"
 #include "Invn/DynamicProtocol/DynProtocolTransportUart.h"
 
@@ -178,6 +181,9 @@ uint64_t inv_icm20948_get_time_us(void);
 uint64_t inv_icm20948_get_dataready_interrupt_time_us(void);
 static void check_rc(int rc);
 static void msg_printer(int level, const char * str, va_list ap);
+static void restore_tracked_biases(void);
+static int bias_tracker_store(void * cookie, uint8_t sensor, const int bias[3], int accuracy);
+static void bias_tracker_task_main(void * arg);
 #if USE_IDDWRAPPER
   int handle_command(enum DynProtocolEid eid, const DynProtocolEdata_t * edata, DynProtocolEdata_t * respdata);
   static void convert_sensor_event_to_dyn_prot_data(const inv_sensor_event_t * event, VSensorDataAny * vsensor_data);
@@ -185,8 +191,10 @@ static void msg_printer(int level, const char * str, va_list ap);
   static void iddwrapper_protocol_event_cb(enum DynProtocolEtype etype, enum DynProtocolEid eid, const DynProtocolEdata_t * edata, void * cookie);
   static void iddwrapper_transport_event_cb(enum DynProTransportEvent e, union DynProTransportEventData data, void * cookie);
   /* Offsets are written when cleanup function is received. It has no meaning without IDDWRAPPER */
-  static void apply_stored_offsets(void);
+  static void apply_stored_calibration(void);
   static void store_offsets(void);
+  static void store_mounting_matrix(int sensor, const float matrix[9]);
+  static void store_self_test(int sensor, int result);
 #endif
 /*
  * Flag set from device irq handler 
@@ -232,12 +240,53 @@ static const inv_sensor_listener_t sensor_listener = {
 	0                /* some pointer passed to the callback */
 };
 
+/*
+ * Calibration store in NV memory
+ * Keys are made of a NV_KEY_xxx prefix and of the sensor type
+ */
+static NvStore nv_store;
+#define NV_KEY_OFFSET             0x0100  /* int32_t[3], q16 */
+#define NV_KEY_MOUNTING_MATRIX    0x0200  /* float[9] */
+#define NV_KEY_SELF_TEST          0x0300  /* int32_t, inv_device_self_test() result */
+#define NV_VERSION                1
+
+/*
+ * Cooperative scheduler running background tasks from the main loop
+ */
+static InvScheduler scheduler;
+
+/*
+ * Background bias tracking: converged DMP biases are stored under NV_KEY_OFFSET
+ * and restored right after the DMP image is loaded
+ */
+#define BIAS_TRACKER_PERIOD_MS    1000
+static struct inv_icm20948_bias_tracker bias_tracker;
+static InvSchedulerTask bias_tracker_task;
+
+static const struct {
+	uint8_t tracker_sensor;
+	int     type;
+} tracked_biases[] = {
+	{ INV_ICM20948_BIAS_TRACKER_ACCEL, INV_SENSOR_TYPE_ACCELEROMETER },
+	{ INV_ICM20948_BIAS_TRACKER_GYRO,  INV_SENSOR_TYPE_GYROSCOPE },
+	{ INV_ICM20948_BIAS_TRACKER_MAG,   INV_SENSOR_TYPE_MAGNETOMETER },
+};
+
 #if USE_IDDWRAPPER
   /*
    * Dynamic protocol and transport handles
    */
   static DynProtocol_t protocol;
   static DynProTransportUart_t transport;
+
+  /*
+   * Sensors which calibration is kept in NV memory
+   */
+  static const int nv_sensors[] = {
+	INV_SENSOR_TYPE_GYROSCOPE,
+	INV_SENSOR_TYPE_ACCELEROMETER,
+	INV_SENSOR_TYPE_MAGNETOMETER,
+  };
 #endif
 
 /*
@@ -254,6 +303,7 @@ int main(void)
 {
 	int rc = 0;
 	unsigned i = 0;
+	uint32_t scheduler_time_us = 0;
 
 	uint8_t whoami = 0xff;
 	uart_init_struct_t uart_config;
@@ -330,6 +380,12 @@ int main(void)
 	 * Setup message facility to see internal traces from IDD
 	 */
 	INV_MSG_SETUP(MSG_LEVEL, msg_printer);
+#if defined(INV_MSG_TRACE)
+	/*
+	 * Messages are recorded in binary form and formatted from the main loop when idle
+	 */
+	inv_msg_trace_setup(inv_icm20948_get_time_us);
+#endif
 
 	/*
 	 * Welcome message
@@ -338,6 +394,25 @@ int main(void)
 	INV_MSG(INV_MSG_LEVEL_INFO, "#          20948 example          #");
 	INV_MSG(INV_MSG_LEVEL_INFO, "###################################");
 
+	/*
+	 * Mount calibration store, index of stored values is built once here
+	 */
+	rc = NvStore_init(&nv_store, flash_manager_getNvFlash());
+	if(rc != 0) {
+		INV_MSG(INV_MSG_LEVEL_WARNING, "Calibration store corrupted (%d), formatting it", rc);
+		rc = NvStore_format(&nv_store);
+		check_rc(rc);
+	}
+
+	/*
+	 * Background tasks are run from the main loop
+	 */
+	InvScheduler_init(&scheduler);
+	inv_icm20948_bias_tracker_init(&bias_tracker, INV_ICM20948_BIAS_TRACKER_ACCEL |
+			INV_ICM20948_BIAS_TRACKER_GYRO | INV_ICM20948_BIAS_TRACKER_MAG, bias_tracker_store, 0);
+	InvScheduler_initTask(&scheduler, &bias_tracker_task, "biasTrackerTask", bias_tracker_task_main, 0,
+			INVSCHEDULER_TASK_PRIO_MIN, INVSCHEDULER_FROM_MS(BIAS_TRACKER_PERIOD_MS));
+
 	/*
 	 * Open serial interface before using the device
 	 * Init SPI communication: SPI1 - SCK(PA5) / MISO(PA6) / MOSI(PA7) / CS(PB6)
@@ -397,6 +472,12 @@ int main(void)
 	check_rc(rc);
 	
 #if !USE_IDDWRAPPER
+	/*
+	 * Warm-start DMP calibration with biases learnt during previous runs
+	 */
+	restore_tracked_biases();
+	InvScheduler_startTask(&bias_tracker_task, INVSCHEDULER_FROM_MS(BIAS_TRACKER_PERIOD_MS));
+
 	{
 		uint64_t available_sensor_mask; /* To keep track of available sensors*/
 		unsigned i;
@@ -452,6 +533,25 @@ int main(void)
 				__enable_irq();
 			}
 		}
+#if defined(INV_MSG_TRACE)
+		else {
+			/*
+			 * Nothing to do, format a few deferred messages
+			 */
+			inv_msg_trace_flush(msg_printer, 4);
+		}
+#endif
+		/*
+		 * Advance scheduler time from the timebase and run due background tasks
+		 */
+		{
+			const uint32_t elapsed = INVSCHEDULER_FROM_US((uint32_t)inv_icm20948_get_time_us() - scheduler_time_us);
+			if(elapsed) {
+				InvScheduler_updateTimeDelta(&scheduler, elapsed);
+				scheduler_time_us += INVSCHEDULER_TO_US(elapsed);
+			}
+			InvScheduler_dispatchTasks(&scheduler);
+		}
 	} while(1);
 }
 
@@ -739,12 +839,14 @@ int handle_command(enum DynProtocolEid eid,
 		DynProtocol_setPrecision(&protocol, DYN_PRO_SENSOR_TYPE_ACCELEROMETER, 13);
 		DynProtocol_setPrecision(&protocol, DYN_PRO_SENSOR_TYPE_GYROSCOPE, 4);
 		rc += inv_device_load(device, NULL, dmp3_image, sizeof(dmp3_image), true /* verify */, NULL);
-		/* Retrieve offsets stored in NV memory */
-		apply_stored_offsets();
+		/* Retrieve offsets and mounting matrices stored in NV memory */
+		apply_stored_calibration();
+		InvScheduler_startTask(&bias_tracker_task, INVSCHEDULER_FROM_MS(BIAS_TRACKER_PERIOD_MS));
 		return rc;
 
 	case DYN_PROTOCOL_EID_CLEANUP:
 		INV_MSG(INV_MSG_LEVEL_DEBUG, "DeviceEmdWrapper: received command cleanup(%s)", inv_sensor_2str(sensor));
+		InvScheduler_stopTask(&bias_tracker_task);
 		store_offsets();
 		return inv_device_cleanup(device);
 
@@ -779,7 +881,9 @@ int handle_command(enum DynProtocolEid eid,
 		
 	case DYN_PROTOCOL_EID_SELF_TEST:
 		INV_MSG(INV_MSG_LEVEL_DEBUG, "DeviceEmdWrapper: received command selft_test(%s)", inv_sensor_2str(sensor));
-		return inv_device_self_test(device, sensor);
+		rc = inv_device_self_test(device, sensor);
+		store_self_test(sensor, rc);
+		return rc;
 	
 	case DYN_PROTOCOL_EID_SET_SENSOR_CFG:
 		INV_MSG(INV_MSG_LEVEL_DEBUG, "DeviceEmdWrapper: received command set_sensor_cfg(%s)", inv_sensor_2str(sensor));
@@ -788,7 +892,10 @@ int handle_command(enum DynProtocolEid eid,
 			if(edata->d.command.cfg.size > sizeof(ref_frame))
 				return INV_ERROR;
 			memcpy(ref_frame, &edata->d.command.cfg.buffer[0], edata->d.command.cfg.size);
-			return inv_device_set_sensor_mounting_matrix(device, sensor, ref_frame);		
+			rc = inv_device_set_sensor_mounting_matrix(device, sensor, ref_frame);
+			if(rc == 0 && edata->d.command.cfg.size == sizeof(ref_frame))
+				store_mounting_matrix(sensor, ref_frame);
+			return rc;
 		} else {
 			if(edata->d.command.cfg.base.type == INV_SENSOR_CONFIG_FSR) {
 				// Transmit the new encoding format for the protocol
@@ -1089,57 +1196,127 @@ static void iddwrapper_transport_event_cb(enum DynProTransportEvent e,
 	}
 }
 
-void apply_stored_offsets(void)
+void apply_stored_calibration(void)
 {
-	uint8_t sensor_bias[84];
-	int32_t acc_bias_q16[6] = {0}, gyro_bias_q16[6] = {0};
-	uint8_t i, idx = 0;
+	float matrix[9];
+	uint8_t type, version;
+	unsigned i;
 	int rc;
 	
-	/* Retrieve Sel-test offsets stored in NV memory */
-	if(flash_manager_readData(sensor_bias) != 0) {
-		INV_MSG(INV_MSG_LEVEL_WARNING, "No bias values retrieved from NV memory !");
-		return;
-	}
-	
-	for(i = 0; i < 6; i++)
-		gyro_bias_q16[i] = inv_dc_little8_to_int32((const uint8_t *)(&sensor_bias[i * sizeof(uint32_t)]));
-	idx += sizeof(gyro_bias_q16);
-	rc = inv_device_set_sensor_config(device, INV_SENSOR_TYPE_GYROSCOPE,
-		VSENSOR_CONFIG_TYPE_OFFSET, gyro_bias_q16, sizeof(gyro_bias_q16));
-	check_rc(rc);
-	
-	for(i = 0; i < 6; i++)
-		acc_bias_q16[i] = inv_dc_little8_to_int32((const uint8_t *)(&sensor_bias[idx + i * sizeof(uint32_t)]));
-	idx += sizeof(acc_bias_q16);
-	rc = inv_device_set_sensor_config(device, INV_SENSOR_TYPE_ACCELEROMETER,
-		VSENSOR_CONFIG_TYPE_OFFSET, acc_bias_q16, sizeof(acc_bias_q16));
+	/* Retrieve offsets stored in NV memory */
+	restore_tracked_biases();
 
+	for(i = 0; i < sizeof(nv_sensors)/sizeof(nv_sensors[0]); i++) {
+		rc = NvStore_read(&nv_store, NV_KEY_MOUNTING_MATRIX | nv_sensors[i], &type, &version, matrix, sizeof(matrix));
+		if(rc == sizeof(matrix) && type == NVSTORE_TYPE_FLOAT && version == NV_VERSION) {
+			rc = inv_device_set_sensor_mounting_matrix(device, nv_sensors[i], matrix);
+			check_rc(rc);
+		}
+	}
 }
 
 void store_offsets(void)
 {
-	int rc = 0;
-	uint8_t i, idx = 0;
-	int gyro_bias_q16[6] = {0}, acc_bias_q16[6] = {0};
+	int32_t bias_q16[3];
+	unsigned i;
+	int rc;
 
-	uint8_t sensor_bias[84] = {0};
-	
-	/* Strore Self-test bias in NV memory */
-	rc = inv_device_get_sensor_config(device, INV_SENSOR_TYPE_GYROSCOPE,
-			VSENSOR_CONFIG_TYPE_OFFSET, gyro_bias_q16, sizeof(gyro_bias_q16));
-	check_rc(rc);
-	for(i = 0; i < 6; i++)
-		inv_dc_int32_to_little8(gyro_bias_q16[i], &sensor_bias[i * sizeof(uint32_t)]);
-	idx += sizeof(gyro_bias_q16);
-	
-	rc = inv_device_get_sensor_config(device, INV_SENSOR_TYPE_ACCELEROMETER,
-			VSENSOR_CONFIG_TYPE_OFFSET, acc_bias_q16, sizeof(acc_bias_q16));
-	check_rc(rc);
-	for(i = 0; i < 6; i++)
-		inv_dc_int32_to_little8(acc_bias_q16[i], &sensor_bias[idx + i * sizeof(uint32_t)]);
-	idx += sizeof(acc_bias_q16);
+	/* Store Self-test bias in NV memory, unchanged values are not written again */
+	for(i = 0; i < sizeof(nv_sensors)/sizeof(nv_sensors[0]); i++) {
+		rc = inv_device_get_sensor_config(device, nv_sensors[i],
+				VSENSOR_CONFIG_TYPE_OFFSET, bias_q16, sizeof(bias_q16));
+		if(rc != sizeof(bias_q16))
+			continue;
+		rc = NvStore_write(&nv_store, NV_KEY_OFFSET | nv_sensors[i], NVSTORE_TYPE_INT32, NV_VERSION,
+				bias_q16, sizeof(bias_q16));
+		if(rc != 0)
+			INV_MSG(INV_MSG_LEVEL_WARNING, "Failed to store %s bias (%d)", inv_sensor_2str(nv_sensors[i]), rc);
+	}
+}
+
+void store_mounting_matrix(int sensor, const float matrix[9])
+{
+	int rc = NvStore_write(&nv_store, NV_KEY_MOUNTING_MATRIX | sensor, NVSTORE_TYPE_FLOAT, NV_VERSION,
+			matrix, 9 * sizeof(float));
+
+	if(rc != 0)
+		INV_MSG(INV_MSG_LEVEL_WARNING, "Failed to store %s mounting matrix (%d)", inv_sensor_2str(sensor), rc);
+}
+
+void store_self_test(int sensor, int result)
+{
+	int32_t value = result;
+	int rc = NvStore_write(&nv_store, NV_KEY_SELF_TEST | sensor, NVSTORE_TYPE_INT32, NV_VERSION,
+			&value, sizeof(value));
 
-	flash_manager_writeData(sensor_bias);
+	if(rc != 0)
+		INV_MSG(INV_MSG_LEVEL_WARNING, "Failed to store %s self-test result (%d)", inv_sensor_2str(sensor), rc);
 }
 #endif
+
+/*
+ * Apply biases stored in NV memory to the DMP, they become the reference for bias tracking
+ */
+static void restore_tracked_biases(void)
+{
+	int32_t bias_q16[3];
+	uint8_t type, version;
+	unsigned i;
+	int rc;
+
+	for(i = 0; i < sizeof(tracked_biases)/sizeof(tracked_biases[0]); i++) {
+		rc = NvStore_read(&nv_store, NV_KEY_OFFSET | tracked_biases[i].type, &type, &version, bias_q16, sizeof(bias_q16));
+		if(rc == sizeof(bias_q16) && type == NVSTORE_TYPE_INT32 && version == NV_VERSION) {
+			rc = inv_icm20948_bias_tracker_restore(&device_icm20948.icm20948_states, &bias_tracker,
+					tracked_biases[i].tracker_sensor, bias_q16);
+			check_rc(rc);
+		} else {
+			INV_MSG(INV_MSG_LEVEL_WARNING, "No %s bias values retrieved from NV memory !", inv_sensor_2str(tracked_biases[i].type));
+		}
+	}
+}
+
+/*
+ * Called by the bias tracker when a converged bias moved away from the stored one
+ */
+static int bias_tracker_store(void * cookie, uint8_t sensor, const int bias[3], int accuracy)
+{
+	int32_t bias_q16[3];
+	unsigned i;
+	int rc;
+
+	(void)cookie;
+
+	for(i = 0; i < sizeof(tracked_biases)/sizeof(tracked_biases[0]); i++) {
+		if(tracked_biases[i].tracker_sensor == sensor)
+			break;
+	}
+	if(i == sizeof(tracked_biases)/sizeof(tracked_biases[0]))
+		return INV_ERROR_BAD_ARG;
+
+	bias_q16[0] = bias[0];
+	bias_q16[1] = bias[1];
+	bias_q16[2] = bias[2];
+	rc = NvStore_write(&nv_store, NV_KEY_OFFSET | tracked_biases[i].type, NVSTORE_TYPE_INT32, NV_VERSION,
+			bias_q16, sizeof(bias_q16));
+	if(rc != 0)
+		INV_MSG(INV_MSG_LEVEL_WARNING, "Failed to store %s bias (%d)", inv_sensor_2str(tracked_biases[i].type), rc);
+	else
+		INV_MSG(INV_MSG_LEVEL_DEBUG, "Stored %s bias (accuracy %d)", inv_sensor_2str(tracked_biases[i].type), accuracy);
+
+	return rc;
+}
+
+/*
+ * Periodic task sampling DMP biases, runs in the main loop context as inv_device_poll()
+ */
+static void bias_tracker_task_main(void * arg)
+{
+	int rc;
+
+	(void)arg;
+
+	rc = inv_icm20948_bias_tracker_poll(&device_icm20948.icm20948_states, &bias_tracker);
+	if(rc < 0)
+		INV_MSG(INV_MSG_LEVEL_WARNING, "Bias tracking failed (%d)", rc);
+}
@@ -28,7 +28,7 @@
 #include "Invn/Devices/SensorTypes.h"
 #include "Invn/Devices/SensorConfig.h"
 #include "Invn/EmbUtils/InvScheduler.h"
-#include "Invn/EmbUtils/RingByteBuffer.h"
+#include "Invn/EmbUtils/RingByteBufferSpsc.h"
 #include "Invn/EmbUtils/Message.h"
 #include "Invn/EmbUtils/ErrorHelper.h"
 #include "Invn/EmbUtils/DataConverter.h"
@@ -75,20 +75,15 @@ uint64_t inv_icm20948_get_time_us(void){
 static void CommandHandlerTaskMain(void * arg){
 	(void)arg;
 
-	int byte;
-	do {
-		byte = EOF;
-		__disable_irq();
+	const uint8_t * data;
+	uint32_t len, i;
 
-		if(!RingByteBuffer_isEmpty(&uart_rx_rb)) {
-			byte = RingByteBuffer_popByte(&uart_rx_rb);
-		}
-		__enable_irq();
-
-		if(byte != EOF) {
-			DynProTransportUart_rxProcessByte(&transport, (uint8_t)byte);
-		}
-	} while(byte != EOF);
+	/* UART ISR is the only producer, bytes are parsed in place without masking interrupts */
+	while((len = RingByteBufferSpsc_peek(&uart_rx_rb, &data)) != 0) {
+		for(i = 0; i < len; i++)
+			DynProTransportUart_rxProcessByte(&transport, data[i]);
+		RingByteBufferSpsc_commit(&uart_rx_rb, len);
+	}
 }
 
 int main (void){
@@ -29,7 +29,7 @@
 #include "Invn/Devices/SensorTypes.h"
 #include "Invn/Devices/SensorConfig.h"
 #include "Invn/EmbUtils/InvScheduler.h"
-#include "Invn/EmbUtils/RingByteBuffer.h"
+#include "Invn/EmbUtils/RingByteBufferSpsc.h"
 #include "Invn/EmbUtils/Message.h"
 #include "Invn/EmbUtils/ErrorHelper.h"
 #include "Invn/EmbUtils/DataConverter.h"
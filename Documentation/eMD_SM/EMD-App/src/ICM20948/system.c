@@ -28,7 +28,7 @@
 #include "Invn/Devices/SensorTypes.h"
 #include "Invn/Devices/SensorConfig.h"
 #include "Invn/EmbUtils/InvScheduler.h"
-#include "Invn/EmbUtils/RingByteBuffer.h"
+#include "Invn/EmbUtils/RingByteBufferSpsc.h"
 #include "Invn/EmbUtils/Message.h"
 #include "Invn/EmbUtils/ErrorHelper.h"
 #include "Invn/EmbUtils/DataConverter.h"
@@ -103,7 +103,7 @@ void ext_int_initialize(void (*handler_function)(void)){
 #define console_uart_irq_handler    FLEXCOM0_Handler
 
 static uint8_t uart_rx_rb_buffer[512];
-RingByteBuffer uart_rx_rb;
+RingByteBufferSpsc uart_rx_rb;
 
 void configure_console(void){
 	const usart_serial_options_t uart_serial_options_debug = {
@@ -128,7 +128,7 @@ void configure_console(void){
 	sysclk_enable_peripheral_clock(CONSOLE_UART_ID);
 	usart_serial_init(CONF_UART, (usart_serial_options_t *)&uart_serial_options);
 
-	RingByteBuffer_init(&uart_rx_rb, uart_rx_rb_buffer, sizeof(uart_rx_rb_buffer));
+	RingByteBufferSpsc_init(&uart_rx_rb, uart_rx_rb_buffer, sizeof(uart_rx_rb_buffer));
 
 	/* Enable UART IRQ */
 	usart_enable_interrupt(CONSOLE_UART, US_IER_RXRDY);
@@ -153,8 +153,7 @@ void console_uart_irq_handler(void){
 	{
 		uint8_t rxbyte;
 		usart_serial_getchar(CONSOLE_UART, &rxbyte);
-		if(!RingByteBuffer_isFull(&uart_rx_rb))
-			RingByteBuffer_pushByte(&uart_rx_rb, rxbyte);
+		RingByteBufferSpsc_pushByte(&uart_rx_rb, rxbyte); /* byte is dropped if buffer is full */
 	}
 }
 
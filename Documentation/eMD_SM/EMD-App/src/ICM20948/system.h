@@ -74,6 +74,6 @@ uint64_t InvEMDFrontEnd_getTimestampUs(void);
 void hw_timer_start(uint32_t timer_freq);
 void hw_timer_stop(void);
 
-extern RingByteBuffer uart_rx_rb;
+extern RingByteBufferSpsc uart_rx_rb;
 extern volatile uint32_t ul_ticks;
 extern InvScheduler 	scheduler;
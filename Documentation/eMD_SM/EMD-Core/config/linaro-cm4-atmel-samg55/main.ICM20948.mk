@@ -67,6 +67,7 @@ DEPS    +=  \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948Augmented.h \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948AuxCompassAkm.h \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948AuxTransport.h \
+	sources/Invn/Devices/Drivers/Icm20948/Icm20948Capture.h \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.h \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948DataBaseDriver.h \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948DataConverter.h \
@@ -93,6 +94,7 @@ DEPS    +=  \
 	sources/Invn/EmbUtils/Message.h \
 	sources/Invn/EmbUtils/RingBuffer.h \
 	sources/Invn/EmbUtils/RingByteBuffer.h \
+	sources/Invn/EmbUtils/RingByteBufferSpsc.h \
 	sources/Invn/IDDVersion.h \
 	sources/Invn/VSensor/VSensorConfig.h \
 	sources/Invn/VSensor/VSensorData.h
@@ -101,6 +103,7 @@ CSRCS   +=  \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948Augmented.c \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948AuxCompassAkm.c \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948AuxTransport.c \
+	sources/Invn/Devices/Drivers/Icm20948/Icm20948Capture.c \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.c \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948DataBaseDriver.c \
 	sources/Invn/Devices/Drivers/Icm20948/Icm20948DataConverter.c \
@@ -119,7 +122,8 @@ CSRCS   +=  \
 	sources/Invn/EmbUtils/InvQueue.c \
 	sources/Invn/EmbUtils/InvScheduler.c \
 	sources/Invn/EmbUtils/Message.c \
-	sources/Invn/EmbUtils/RingByteBuffer.c
+	sources/Invn/EmbUtils/RingByteBuffer.c \
+	sources/Invn/EmbUtils/RingByteBufferSpsc.c
 DEFS    +=  \
 	-DINV_MSG_ENABLE=INV_MSG_LEVEL_VERBOSE \
 	-DASSERT \
@@ -41,6 +41,7 @@
 #include "Icm20948DataConverter.h"
 #include "Icm20948AuxCompassAkm.h"
 #include "Icm20948SelfTest.h"
+#include "Icm20948Capture.h"
 
 
 #include <stdint.h>
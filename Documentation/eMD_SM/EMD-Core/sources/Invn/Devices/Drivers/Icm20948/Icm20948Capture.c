@@ -0,0 +1,176 @@
+/*
+* ________________________________________________________________________________________________________
+* Copyright  2014-2015 InvenSense Inc. Portions Copyright  2014-2015 Movea. All rights reserved.
+* This software, related documentation and any modifications thereto (collectively Software) is subject
+* to InvenSense and its licensors' intellectual property rights under U.S. and international copyright and
+* other intellectual property rights laws.
+* InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+* and any use, reproduction, disclosure or distribution of the Software without an express license
+* agreement from InvenSense is strictly prohibited.
+* ________________________________________________________________________________________________________
+*/
+
+#include "Icm20948.h"
+#include "Icm20948Capture.h"
+
+#include "Icm20948Defs.h"
+
+/* bytes read from the FIFO before accumulation, multiple of both record sizes and INV_MAX_SERIAL_READ */
+#define CAPTURE_CHUNK_SIZE          48
+
+/* scalar per record accumulation, 64-bit sums keep the variance exact up to
+   INV_ICM20948_CAPTURE_MAX_SAMPLES records */
+static void inv_capture_accumulate(struct inv_icm20948_capture * cap, const uint8_t * d, int nb)
+{
+	int16_t rec[INV_ICM20948_CAPTURE_MAX_AXES];
+	int i, j;
+
+	for (i = 0; i < nb; i++) {
+		for (j = 0; j < cap->nb_axes; j++)
+			rec[j] = (int16_t)((d[2*j] << 8) | d[2*j + 1]);
+
+		for (j = 0; j < cap->nb_axes; j++) {
+			cap->sum[j] += rec[j];
+			cap->sum_sq[j] += (int32_t)rec[j] * rec[j];
+		}
+
+		if (cap->samples) {
+			for (j = 0; j < cap->nb_axes; j++)
+				cap->samples[cap->nb_samples * cap->nb_axes + j] = rec[j];
+		}
+
+		cap->nb_samples++;
+		d += cap->nb_axes * 2;
+	}
+}
+
+int inv_icm20948_capture_start(struct inv_icm20948 * s, struct inv_icm20948_capture * cap,
+		uint8_t sensors, int16_t * samples, int nb_samples)
+{
+	int result = 0;
+	uint8_t fifo_en_2 = 0;
+	uint8_t user_ctrl;
+
+	memset(cap, 0, sizeof(*cap));
+
+	if (sensors & INV_ICM20948_CAPTURE_ACCEL) {
+		fifo_en_2 |= BIT_ACCEL_FIFO_EN;
+		cap->nb_axes += THREE_AXES;
+	}
+	if (sensors & INV_ICM20948_CAPTURE_GYRO) {
+		fifo_en_2 |= BITS_GYRO_FIFO_EN;
+		cap->nb_axes += THREE_AXES;
+	}
+	if (!cap->nb_axes || nb_samples <= 0 || nb_samples > INV_ICM20948_CAPTURE_MAX_SAMPLES)
+		return INV_ERROR_BAD_ARG;
+
+	cap->sensors = sensors;
+	cap->samples = samples;
+	cap->max_samples = nb_samples;
+
+	result |= inv_icm20948_read_mems_reg(s, REG_USER_CTRL, 1, &user_ctrl);
+	user_ctrl = (user_ctrl & ~BIT_DMP_EN) | BIT_FIFO_EN;
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN_2, 0);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, MAX_5_BIT_VALUE);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_RST, 0);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_USER_CTRL, user_ctrl);
+	result |= inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN_2, fifo_en_2);
+
+	return result;
+}
+
+int inv_icm20948_capture_poll(struct inv_icm20948 * s, struct inv_icm20948_capture * cap)
+{
+	uint8_t d[CAPTURE_CHUNK_SIZE];
+	uint8_t fifo_count[FIFO_COUNT_BYTE];
+	int record_size = cap->nb_axes * 2;
+	int count, len, bytes;
+
+	if (cap->nb_samples >= cap->max_samples)
+		return 0;
+
+	if (inv_icm20948_read_mems_reg(s, REG_FIFO_COUNT_H, FIFO_COUNT_BYTE, fifo_count))
+		return INV_ERROR_TRANSPORT;
+	count = (fifo_count[0] << 8) | fifo_count[1];
+
+	// records are no longer aligned once FIFO overflowed
+	if (count >= HARDWARE_FIFO_SIZE)
+		return INV_ERROR_SIZE;
+
+	count /= record_size;
+	if (count > cap->max_samples - cap->nb_samples)
+		count = cap->max_samples - cap->nb_samples;
+
+	while (count > 0) {
+		len = min(count, CAPTURE_CHUNK_SIZE / record_size);
+
+		// FIFO_R_W does not auto-increment, so each burst is limited to INV_MAX_SERIAL_READ bytes
+		for (bytes = 0; bytes < len * record_size; bytes += INV_MAX_SERIAL_READ) {
+			if (inv_icm20948_read_mems_reg(s, REG_FIFO_R_W,
+					min(INV_MAX_SERIAL_READ, len * record_size - bytes), &d[bytes]))
+				return INV_ERROR_TRANSPORT;
+		}
+
+		inv_capture_accumulate(cap, d, len);
+		count -= len;
+	}
+
+	return (cap->nb_samples < cap->max_samples);
+}
+
+int inv_icm20948_capture_stop(struct inv_icm20948 * s)
+{
+	return inv_icm20948_write_single_mems_reg(s, REG_FIFO_EN_2, 0);
+}
+
+int inv_icm20948_capture_run(struct inv_icm20948 * s, struct inv_icm20948_capture * cap,
+		uint8_t sensors, int16_t * samples, int nb_samples)
+{
+	int rc, idle = 0;
+	int last = 0;
+
+	rc = inv_icm20948_capture_start(s, cap, sensors, samples, nb_samples);
+	if (rc) {
+		inv_icm20948_capture_stop(s);
+		return rc;
+	}
+
+	do {
+		inv_icm20948_sleep_us(INV_ICM20948_CAPTURE_POLL_TIME*1000);
+		rc = inv_icm20948_capture_poll(s, cap);
+		if (rc == 1) {
+			// sensor not running
+			idle = (cap->nb_samples == last) ? idle + 1 : 0;
+			last = cap->nb_samples;
+			if (idle >= INV_ICM20948_CAPTURE_MAX_IDLE_POLLS)
+				rc = INV_ERROR_TIMEOUT;
+		}
+	} while (rc == 1);
+
+	inv_icm20948_capture_stop(s);
+
+	return rc;
+}
+
+int inv_icm20948_capture_get_stats(const struct inv_icm20948_capture * cap,
+		int32_t * mean, uint32_t * variance)
+{
+	int j;
+	int n = cap->nb_samples;
+
+	for (j = 0; j < cap->nb_axes; j++) {
+		if (n == 0) {
+			mean[j] = 0;
+			if (variance)
+				variance[j] = 0;
+			continue;
+		}
+		mean[j] = (int32_t)(cap->sum[j] / n);
+		if (variance)
+			variance[j] = (uint32_t)((cap->sum_sq[j] - cap->sum[j] * cap->sum[j] / n) / n);
+	}
+
+	return n;
+}
+
+/** @} */
@@ -12,6 +12,7 @@
 
 #include "Icm20948.h"
 #include "Icm20948SelfTest.h"
+#include "Icm20948Capture.h"
 
 #include "Icm20948Defs.h"
 #include "Icm20948DataBaseDriver.h"
@@ -27,8 +28,6 @@
 #define SELFTEST_ACCEL_SMPLRT_DIV       10
 #define SELFTEST_ACCEL_DEC3_CFG     	2
 
-/* wait time in ms between 2 data collection */
-#define WAIT_TIME_BTW_2_SAMPLESREAD     10
 /* wait time in ms after sensor self-test enabling for oscillations to stabilize */
 #define DEF_ST_STABLE_TIME              20 //ms
 /* number of times self test reading should be done until abort */
@@ -319,11 +318,13 @@ static int inv_setup_selftest(struct inv_icm20948 * s, struct recover_regs * rec
 	return result;
 }
 
-static int inv_selftest_read_samples(struct inv_icm20948 * self, enum INV_SENSORS type, int *sum_result, int *s)
+/*
+*  inv_selftest_read_samples() - average DEF_ST_SAMPLES samples captured through the FIFO
+*/
+static int inv_selftest_read_samples(struct inv_icm20948 * self, enum INV_SENSORS type, int *mean_result)
 {
-	uint8_t w;
-	int16_t vals[3];
-	uint8_t d[BYTES_PER_SENSOR];
+	struct inv_icm20948_capture cap;
+	int32_t mean[THREE_AXES];
 	int j;
 
 	// Average 200 readings and save the averaged values as GX_OS, GY_OS, GZ_OS, AX_OS, AY_OS and AZ_OS. 
@@ -334,25 +335,15 @@ static int inv_selftest_read_samples(struct inv_icm20948 * self, enum INV_SENSOR
 	// - AY_OS = Average (ACCEL_YOUT_H | ACCEL_YOUT_L)
 	// - AZ_OS = Average (ACCEL_ZOUT_H | ACCEL_ZOUT_L)
 
-	if (INV_SENSOR_GYRO == type)
-		w = REG_GYRO_XOUT_H_SH;
-	else
-		w = REG_ACCEL_XOUT_H_SH;
-
-	while (*s < DEF_ST_SAMPLES) {
+	if(inv_icm20948_capture_run(self, &cap,
+			(INV_SENSOR_GYRO == type) ? INV_ICM20948_CAPTURE_GYRO : INV_ICM20948_CAPTURE_ACCEL,
+			0, DEF_ST_SAMPLES))
+		return -1;
 
-		if(inv_icm20948_read_mems_reg(self, w, BYTES_PER_SENSOR, d))
-			return -1;
-
-		for (j = 0; j < THREE_AXES; j++) {
-			vals[j] = (d[(2*j)]<<8) | (d[(2*j)+ 1] & 0xff);
-			sum_result[j] += vals[j];
-		}
+	inv_icm20948_capture_get_stats(&cap, mean, 0);
+	for (j = 0; j < THREE_AXES; j++)
+		mean_result[j] = mean[j];
 
-		(*s)++;
-
-		inv_icm20948_sleep_us(WAIT_TIME_BTW_2_SAMPLESREAD*1000);
-	}
 	return 0;
 }
 
@@ -361,8 +352,7 @@ static int inv_selftest_read_samples(struct inv_icm20948 * self, enum INV_SENSOR
 */
 static int inv_do_test_accelgyro(struct inv_icm20948 * s, enum INV_SENSORS sensorType, int *meanValue, int *stMeanValue)
 {
-	int result, i, j;
-	int lNbSamples = 0;
+	int result, i;
 
 	// initialize output to be 0
 	for (i = 0; i < THREE_AXES; i++) {
@@ -373,12 +363,9 @@ static int inv_do_test_accelgyro(struct inv_icm20948 * s, enum INV_SENSORS senso
 	// read the accel/gyro output
 	// the output values are 16 bits wide and in 2s complement
 	// Average 200 readings and save the averaged values
-	result = inv_selftest_read_samples(s, sensorType, meanValue, &lNbSamples);
+	result = inv_selftest_read_samples(s, sensorType, meanValue);
 	if (result)
 		return result;
-	for (j = 0; j < THREE_AXES; j++) {
-		meanValue[j] /= lNbSamples;
-	}
 
 	// Set Self-Test Bit
 	if (sensorType == INV_SENSOR_GYRO)
@@ -397,13 +384,9 @@ static int inv_do_test_accelgyro(struct inv_icm20948 * s, enum INV_SENSORS senso
 
 	// Read the accel/gyro output and average 200 readings
 	// These readings are in units of LSBs
-	lNbSamples = 0; 
-	result = inv_selftest_read_samples(s, sensorType, stMeanValue, &lNbSamples);
+	result = inv_selftest_read_samples(s, sensorType, stMeanValue);
 	if (result)
 		return result;
-	for (j = 0; j < THREE_AXES; j++) {
-		stMeanValue[j] /= lNbSamples;
-	}
 
 	return 0;
 }
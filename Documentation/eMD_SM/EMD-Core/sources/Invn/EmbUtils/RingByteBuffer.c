@@ -23,6 +23,8 @@
 
 #include "RingByteBuffer.h"
 
+#include <string.h>
+
 void RingByteBuffer_init(RingByteBuffer *self, uint8_t *pBuffer,
                          uint16_t sizeBuffer)
 {
@@ -91,31 +93,53 @@ uint8_t RingByteBuffer_popByte(RingByteBuffer *self)
 void RingByteBuffer_pushBuffer(RingByteBuffer *self, const void *data,
                                uint16_t len)
 {
-	const uint8_t *byte;
-	uint16_t i;
+	const uint8_t *src = (const uint8_t *)data;
+	uint16_t first;
 
 	ASSERT(self);
 	ASSERT(data);
-
-	byte = (const uint8_t *)data;
-
-	for (i = 0; i < len; ++i) {
-		RingByteBuffer_pushByte(self, byte[i]);
+	ASSERT(len <= self->size);
+
+	/* data may wrap around, copy it in segments of at most size - end bytes
+	   (two segments unless len > size, in which case the oldest bytes are
+	   overwritten as with successive calls to RingByteBuffer_pushByte()) */
+	while (len > 0) {
+		first = self->size - self->end;
+		if (first > len)
+			first = len;
+		memcpy(&self->buffer[self->end], src, first);
+		src 	  += first;
+		len 	  -= first;
+		self->end += first;
+		if (self->end == self->size) {
+			self->msbEnd ^= 1;
+			self->end 	  = 0;
+		}
 	}
 }
 
 void RingByteBuffer_popBuffer(RingByteBuffer *self, void *data, uint16_t len)
 {
-	uint8_t *byte;
-	uint16_t i;
+	uint8_t *dst = (uint8_t *)data;
+	uint16_t first;
 
 	ASSERT(self);
 	ASSERT(data);
-
-	byte = (uint8_t *)data;
-
-	for (i = 0; i < len; ++i) {
-		byte[i] = RingByteBuffer_popByte(self);
+	ASSERT(len <= self->size);
+
+	/* data may wrap around, copy it in segments of at most size - start bytes */
+	while (len > 0) {
+		first = self->size - self->start;
+		if (first > len)
+			first = len;
+		memcpy(dst, &self->buffer[self->start], first);
+		dst 		+= first;
+		len 		-= first;
+		self->start += first;
+		if (self->start == self->size) {
+			self->msbStart ^= 1;
+			self->start 	= 0;
+		}
 	}
 }
 
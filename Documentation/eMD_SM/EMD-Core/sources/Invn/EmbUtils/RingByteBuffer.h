@@ -121,7 +121,8 @@ uint8_t RingByteBuffer_popByte(RingByteBuffer *self);
 /** @brief 		Push a buffer of data to a ring buffer
 				Check for available size must be done by the caller
 	@param[in] 	data 	pointer to data to push to the ring buffer
-	@param[in] 	size  	size of data to push to the ring buffer
+	@param[in] 	size  	size of data to push to the ring buffer, at most
+						RingByteBuffer_maxSize()
 	@return 	none
 */
 void RingByteBuffer_pushBuffer(RingByteBuffer *self, const void *data,
@@ -130,7 +131,8 @@ void RingByteBuffer_pushBuffer(RingByteBuffer *self, const void *data,
 /** @brief 		Pop a buffer of data to a ring buffer
 				Check for size of the ring buffer must be done by the caller
 	@param[in] 	data 	pointer to placeholder
-	@param[in] 	size  	size of data to pop to the ring buffer
+	@param[in] 	size  	size of data to pop to the ring buffer, at most
+						RingByteBuffer_maxSize()
 	@return 	none
 */
 void RingByteBuffer_popBuffer(RingByteBuffer *self, void *data, uint16_t len);
@@ -0,0 +1,126 @@
+/*
+ * ________________________________________________________________________________________________________
+ * Copyright (c) 2017 InvenSense Inc. All rights reserved.
+ *
+ * This software, related documentation and any modifications thereto (collectively Software) is subject
+ * to InvenSense and its licensors' intellectual property rights under U.S. and international copyright
+ * and other intellectual property rights laws.
+ *
+ * InvenSense and its licensors retain all intellectual property and proprietary rights in and to the Software
+ * and any use, reproduction, disclosure or distribution of the Software without an express license agreement
+ * from InvenSense is strictly prohibited.
+ *
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, THE SOFTWARE IS
+ * PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * EXCEPT AS OTHERWISE PROVIDED IN A LICENSE AGREEMENT BETWEEN THE PARTIES, IN NO EVENT SHALL
+ * INVENSENSE BE LIABLE FOR ANY DIRECT, SPECIAL, INDIRECT, INCIDENTAL, OR CONSEQUENTIAL DAMAGES, OR ANY
+ * DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE
+ * OF THE SOFTWARE.
+ * ________________________________________________________________________________________________________
+ */
+
+#include "RingByteBufferSpsc.h"
+
+#include <string.h>
+
+void RingByteBufferSpsc_init(RingByteBufferSpsc *self, uint8_t *pBuffer,
+                             uint32_t sizeBuffer)
+{
+	ASSERT(self);
+	ASSERT(pBuffer);
+	ASSERT(sizeBuffer != 0 && (sizeBuffer & (sizeBuffer - 1)) == 0);
+
+	self->buffer 	= pBuffer;
+	self->mask 		= sizeBuffer - 1;
+
+	RingByteBufferSpsc_clear(self);
+}
+
+void RingByteBufferSpsc_clear(RingByteBufferSpsc *self)
+{
+	ASSERT(self);
+
+	self->head		= 0;
+	self->tail		= 0;
+}
+
+uint32_t RingByteBufferSpsc_pushBuffer(RingByteBufferSpsc *self, const void *data,
+                                       uint32_t len)
+{
+	uint32_t head, idx, first;
+
+	ASSERT(self);
+	ASSERT(data);
+
+	head = self->head;
+	idx = head & self->mask;
+
+	first = RingByteBufferSpsc_maxSize(self) - (head - RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->tail));
+	if (len > first)
+		len = first;
+
+	first = RingByteBufferSpsc_maxSize(self) - idx;
+	if (first > len)
+		first = len;
+
+	memcpy(&self->buffer[idx], data, first);
+	memcpy(self->buffer, (const uint8_t *)data + first, len - first);
+
+	RINGBYTEBUFFERSPSC_STORE_RELEASE(&self->head, head + len);
+
+	return len;
+}
+
+uint32_t RingByteBufferSpsc_popBuffer(RingByteBufferSpsc *self, void *data, uint32_t len)
+{
+	uint32_t tail, idx, first;
+
+	ASSERT(self);
+	ASSERT(data);
+
+	tail = self->tail;
+	idx = tail & self->mask;
+
+	first = RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->head) - tail;
+	if (len > first)
+		len = first;
+
+	first = RingByteBufferSpsc_maxSize(self) - idx;
+	if (first > len)
+		first = len;
+
+	memcpy(data, &self->buffer[idx], first);
+	memcpy((uint8_t *)data + first, self->buffer, len - first);
+
+	RINGBYTEBUFFERSPSC_STORE_RELEASE(&self->tail, tail + len);
+
+	return len;
+}
+
+uint32_t RingByteBufferSpsc_peek(const RingByteBufferSpsc *self, const uint8_t **data)
+{
+	uint32_t tail, idx, len, first;
+
+	ASSERT(self);
+	ASSERT(data);
+
+	tail = self->tail;
+	idx = tail & self->mask;
+
+	len = RINGBYTEBUFFERSPSC_LOAD_ACQUIRE(&self->head) - tail;
+	first = RingByteBufferSpsc_maxSize(self) - idx;
+
+	*data = &self->buffer[idx];
+
+	return (len < first) ? len : first;
+}
+
+void RingByteBufferSpsc_commit(RingByteBufferSpsc *self, uint32_t len)
+{
+	ASSERT(self);
+	ASSERT(len <= RingByteBufferSpsc_size(self));
+
+	RINGBYTEBUFFERSPSC_STORE_RELEASE(&self->tail, self->tail + len);
+}